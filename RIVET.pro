@@ -27,12 +27,14 @@ SOURCES	+= main.cpp                         \
 		dcel/arrangement.cpp                       \
 		interface/control_dot.cpp           \
 		#interface/input_manager.cpp         \
+		#interface/checkpoint.cpp            \
 		interface/persistence_bar.cpp       \
 		interface/persistence_diagram.cpp   \
 		interface/persistence_dot.cpp       \
 		interface/slice_diagram.cpp         \
 		interface/slice_line.cpp            \
 	    math/bool_array.cpp                 \
+		math/implicit_boundary_matrix.cpp   \
 		math/index_matrix.cpp               \
 		math/map_matrix.cpp                 \
 		#math/multi_betti.cpp                \
@@ -44,6 +46,10 @@ SOURCES	+= main.cpp                         \
 		dcel/arrangement_message.cpp               \
 		dcel/grades.cpp                     \
 		#math/persistence_updater.cpp        \
+		#math/ru_snapshot_cache.cpp          \
+		#math/crossing_cost_model.cpp        \
+		#math/edge_collapser.cpp             \
+		#math/memory_estimate.cpp            \
 		math/template_points_matrix.cpp          \
 		math/template_point.cpp                   \
 		interface/progressdialog.cpp        \
@@ -66,12 +72,14 @@ HEADERS  += visualizationwindow.h			\
 		dcel/arrangement.h							\
 		interface/control_dot.h				\
 		interface/input_manager.h			\
+		interface/checkpoint.h			\
 		interface/persistence_bar.h			\
 		interface/persistence_diagram.h		\
 		interface/persistence_dot.h			\
 		interface/slice_diagram.h			\
 		interface/slice_line.h				\
 		math/bool_array.h                 \
+		math/implicit_boundary_matrix.h		\
 		math/index_matrix.h					\
 		math/map_matrix.h					\
 		math/multi_betti.h					\
@@ -82,6 +90,10 @@ HEADERS  += visualizationwindow.h			\
 		dcel/anchor.h						\
 		dcel/grades.h                       \
 		math/persistence_updater.h			\
+		math/ru_snapshot_cache.h			\
+		math/crossing_cost_model.h			\
+		math/edge_collapser.h			\
+		math/memory_estimate.h			\
 		math/template_points_matrix.h			\
 		math/template_point.h \
     interface/progressdialog.h \
@@ -22,6 +22,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "dcel/arrangement.h"
 #include "dcel/arrangement_builder.h"
 #include "debug.h"
+#include "interface/checkpoint.h"
 #include "math/multi_betti.h"
 #include "timer.h"
 #include <chrono>
@@ -37,7 +38,7 @@ Computation::~Computation()
 {
 }
 
-std::unique_ptr<ComputationResult> Computation::compute_raw(ComputationInput& input)
+std::unique_ptr<ComputationResult> Computation::compute_raw(ComputationInput& input, bool betti_only)
 {
     if (verbosity >= 2) {
         debug() << "\nBIFILTRATION:";
@@ -55,27 +56,44 @@ std::unique_ptr<ComputationResult> Computation::compute_raw(ComputationInput& in
         }
     }
 
+    //if requested, the results of each stage are saved next to the output file, and a stage whose results were saved by an earlier run is skipped
+    std::unique_ptr<Checkpoint> checkpoint;
+    if (params.resume && !params.outputFile.empty()) {
+        checkpoint.reset(new Checkpoint(params.outputFile, params.dim, input.bifiltration(), input.x_exact, input.y_exact, params.checkpoint_interval, verbosity));
+    }
+
     //STAGE 3: COMPUTE MULTIGRADED BETTI NUMBERS
 
     std::unique_ptr<ComputationResult> result(new ComputationResult);
-    //compute xi_0 and xi_1 at all bigrades
-    if (verbosity >= 2) {
-        debug() << "COMPUTING xi_0, xi_1, AND xi_2 FOR HOMOLOGY DIMENSION " << params.dim << ":";
-    }
     MultiBetti mb(input.bifiltration(), params.dim);
     Timer timer;
-    mb.compute(result->homology_dimensions, progress);
-    mb.compute_xi2(result->homology_dimensions);
+    if (checkpoint && checkpoint->load_betti(result->homology_dimensions, result->template_points)) {
+        if (verbosity >= 2) {
+            debug() << "RESTORED xi_0, xi_1, AND xi_2 FOR HOMOLOGY DIMENSION " << params.dim << " FROM CHECKPOINT";
+        }
+    } else {
+        //compute xi_0 and xi_1 at all bigrades
+        if (verbosity >= 2) {
+            debug() << "COMPUTING xi_0, xi_1, AND xi_2 FOR HOMOLOGY DIMENSION " << params.dim << ":";
+        }
+        mb.compute(result->homology_dimensions, progress);
+        mb.compute_xi2(result->homology_dimensions);
 
-    if (verbosity >= 2) {
-        debug() << "  -- xi_i computation took " << timer.elapsed() << " milliseconds";
-    }
+        if (verbosity >= 2) {
+            debug() << "  -- xi_i computation took " << timer.elapsed() << " milliseconds";
+        }
 
-    //store the xi support points
-    mb.store_support_points(result->template_points);
+        //store the xi support points
+        mb.store_support_points(result->template_points);
+        if (checkpoint) {
+            checkpoint->save_betti(result->homology_dimensions, result->template_points);
+        }
+    }
 
     template_points_ready(TemplatePointsMessage{ input.x_label, input.y_label, result->template_points, result->homology_dimensions, input.x_exact, input.y_exact }); //signal that xi support points are ready for visualization
     progress.advanceProgressStage(); //update progress box to stage 4
+    if (betti_only)
+        return result;
 
     //STAGES 4 and 5: BUILD THE LINE ARRANGEMENT AND COMPUTE BARCODE TEMPLATES
 
@@ -85,8 +103,8 @@ std::unique_ptr<ComputationResult> Computation::compute_raw(ComputationInput& in
     }
 
     timer.restart();
-    ArrangementBuilder builder(verbosity);
-    auto arrangement = builder.build_arrangement(mb, input.x_exact, input.y_exact, result->template_points, progress); ///TODO: update this -- does not need to store list of xi support points in xi_support
+    ArrangementBuilder builder(verbosity, params.num_segments, params.snapshot_budget, params.seed, params.strategy);
+    auto arrangement = builder.build_arrangement(mb, input.x_exact, input.y_exact, result->template_points, progress, checkpoint.get()); ///TODO: update this -- does not need to store list of xi support points in xi_support
     //NOTE: this also computes and stores barcode templates in the arrangement
 
     if (verbosity >= 2) {
@@ -110,12 +128,12 @@ std::unique_ptr<ComputationResult> Computation::compute_raw(ComputationInput& in
     return result;
 }
 
-std::unique_ptr<ComputationResult> Computation::compute(InputData data)
+std::unique_ptr<ComputationResult> Computation::compute(InputData data, bool betti_only)
 {
     progress.advanceProgressStage(); //update progress box to stage 3
 
     auto input = ComputationInput(data);
     //print bifiltration statistics
     //debug() << "Computing from raw data";
-    return compute_raw(input);
+    return compute_raw(input, betti_only);
 }
@@ -75,7 +75,9 @@ public:
     Computation(InputParameters& params, Progress& progress);
     ~Computation();
 
-    std::unique_ptr<ComputationResult> compute(InputData data);
+    //computes the augmented arrangement for the dimension of homology in params, or only the Betti numbers if betti_only is true
+    //  the simplex tree of data is only read, so computations for several dimensions can share it, each in its own thread
+    std::unique_ptr<ComputationResult> compute(InputData data, bool betti_only = false);
 
 private:
     InputParameters& params;
@@ -83,5 +85,5 @@ private:
 
     const int verbosity;
 
-    std::unique_ptr<ComputationResult> compute_raw(ComputationInput& input);
+    std::unique_ptr<ComputationResult> compute_raw(ComputationInput& input, bool betti_only);
 };
@@ -79,7 +79,7 @@ bool ComputationThread::is_precomputed(std::string file_name)
     }
     std::string line;
     std::getline(file, line);
-    return line == "RIVET_1";
+    return line == "RIVET_2" || line == "RIVET_1"; //RIVET_1 files are recognized only to be rejected by load_from_file()
 }
 
 void ComputationThread::load_from_file()
@@ -90,7 +90,10 @@ void ComputationThread::load_from_file()
     }
     std::string type;
     std::getline(file, type);
-    assert(type == "RIVET_1");
+    if (type == "RIVET_1") {
+        throw std::runtime_error(params.fileName + " was written by an earlier version of RIVET, whose precomputed format is no longer supported; please recompute it");
+    }
+    assert(type == "RIVET_2");
     boost::archive::binary_iarchive archive(file);
 
     arrangement.reset(new ArrangementMessage());
@@ -158,7 +161,7 @@ void ComputationThread::compute_from_file()
                     }
                     std::string type;
                     std::getline(input, type);
-                    if (type != "RIVET_1") {
+                    if (type != "RIVET_2") {
                         throw std::runtime_error("Unsupported file format");
                     }
                     //qDebug() << "ComputationThread::compute_from_file() : checkpoint A -- template_points.size() = "
@@ -206,7 +209,7 @@ void write_boost_file(QString file_name, InputParameters const& params, Template
     if (!file.is_open()) {
         throw std::runtime_error("Could not open " + file_name.toStdString() + " for writing");
     }
-    file << "RIVET_1\n";
+    file << "RIVET_2\n";
     boost::archive::binary_oarchive oarchive(file);
     oarchive& params& message& arrangement;
     file.flush();
@@ -34,8 +34,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <dcel/grades.h>
 
 #include "dcel/arrangement_message.h"
+#include "interface/checkpoint.h"
 #include "dcel/serialization.h"
 
+#include <algorithm>
+#include <exception>
+#include <thread>
+
 static const char USAGE[] =
     R"(RIVET: Rank Invariant Visualization and Exploration Tool
 
@@ -49,14 +54,16 @@ static const char USAGE[] =
       rivet_console (-h | --help)
       rivet_console --version
       rivet_console <input_file> --identify
-      rivet_console <input_file> --betti [-H <dimension>] [-V <verbosity>] [-x <xbins>] [-y <ybins>]
+      rivet_console <input_file> --betti [-H <dimension>] [-V <verbosity>] [-x <xbins>] [-y <ybins>] [--x-binning=<mode>] [--y-binning=<mode>]
       rivet_console <precomputed_file> --bounds
       rivet_console <precomputed_file> --barcodes <line_file>
-      rivet_console <input_file> <output_file> [-H <dimension>] [-V <verbosity>] [-x <xbins>] [-y <ybins>] [-f <format>] [--binary]
+      rivet_console <input_file> <output_file> [-H <dimension>] [-V <verbosity>] [-x <xbins>] [-y <ybins>] [--x-binning=<mode>] [--y-binning=<mode>] [-f <format>] [--binary] [--segments=<segments>] [--snapshot-budget=<megabytes>] [--seed=<seed>] [--strategy=<strategy>] [--collapse-edges] [--estimate] [--memory-limit=<megabytes>] [--resume] [--checkpoint-interval=<seconds>]
 
     Options:
       <input_file>                             A text file with suitably formatted point cloud, bifiltration, or
-                                               finite metric space as described at http://rivet.online/doc/input-data/
+                                               finite metric space as described at http://rivet.online/doc/input-data/,
+                                               or a binary point cloud, finite metric space, or bifiltration as
+                                               described in interface/input_manager.cpp
       <precomputed_file>                       A precomputed RIVET file, as generated by this program by processing an
                                                <input_file>
       -h --help                                Show this screen
@@ -64,10 +71,54 @@ static const char USAGE[] =
       --identify                               Parse the file and print filetype information
       --binary                                 Include binary data (used by RIVET viewer only)
       -H <dimension> --homology=<dimension>    Dimension of homology to compute [default: 0]
+                                               A list such as 0,1,2 computes several dimensions from the same
+                                               bifiltration, concurrently (up to the number of cores), and writes
+                                               one file per dimension, named by inserting _H<dimension> before the
+                                               extension of <output_file>; with --betti, each is printed in turn.
       -x <xbins> --xbins=<xbins>               Number of bins in the x direction [default: 0]
       -y <ybins> --ybins=<ybins>               Number of bins in the y direction [default: 0]
+      --x-binning=<mode>                       How to choose the bins in the x direction [default: uniform]
+                                               uniform: bins of equal width between the smallest and largest grades;
+                                               quantile: bins holding about equal numbers of grades;
+                                               adaptive: bins whose largest width is as small as possible.
+                                               Every mode aims for the number of bins given by -x or -y, not for a
+                                               number of anchors, which is only known once the Betti numbers have
+                                               been computed from the binned grades; to bound the size of the
+                                               arrangement, use --memory-limit.
+                                               With verbosity 2 or more, the error that the bins introduce is shown.
+      --y-binning=<mode>                       How to choose the bins in the y direction [default: uniform]
       -V <verbosity> --verbosity=<verbosity>   Verbosity level: 0 (no console output) to 10 (lots of output) [default: 0]
       -f <format>                              Output format for file [default: R1]
+      --segments=<segments>                    Number of segments of the path through the arrangement [default: 1]
+                                               Barcode templates for the segments are computed in parallel, one thread
+                                               per segment (up to the number of cores); each thread holds its own
+                                               copy of the boundary matrices.
+      --snapshot-budget=<megabytes>            Memory for snapshots of the RU-decomposition along the path [default: 0]
+                                               When the matrices are reset, the nearest snapshot (if any) is updated
+                                               to the new order instead of decomposing the matrices from scratch.
+      --seed=<seed>                            Seed for the random vineyard updates that calibrate the model [default: 0]
+                                               used to choose between vineyard updates and resetting the matrices.
+      --strategy=<strategy>                    How to handle expensive anchor crossings [default: reset]
+                                               reset: rebuild the matrices and compute a new RU-decomposition;
+                                               quicksort: move all columns at once and fix the RU-decomposition;
+                                               vineyards: do vineyard updates anyway.
+      --collapse-edges                         Remove edges of a Vietoris-Rips bifiltration that can be collapsed
+                                               without changing the persistence module, before building the complex.
+      --estimate                               Print the projected numbers of simplices and memory use, then exit
+                                               before building the complex.
+      --memory-limit=<megabytes>               Memory that the computation may use [default: 0]
+                                               If the projected memory use is larger, then the grades are merged into
+                                               fewer bins until it fits; if that is not enough, the run stops. The
+                                               projection is printed in either case. 0 means no limit.
+      --resume                                 Save the results of each finished stage (the Betti numbers, then the
+                                               line arrangement) in checkpoint files next to <output_file>, and
+                                               start from the latest valid checkpoint left by an earlier run with
+                                               the same input and options. The checkpoints are removed once
+                                               <output_file> has been written.
+      --checkpoint-interval=<seconds>          With --resume, time between checkpoints of the barcode templates [default: 600]
+                                               computed so far along the path through the arrangement, from which
+                                               a later run continues. The checkpoints are not saved while the path
+                                               is traversed in several segments.
       -b --betti                               Print dimension and Betti number information, then exit.        
       --bounds                                 Print lower and upper bounds for the module in <precomputed_file> and exit
       --barcodes <line_file>                   Print barcodes for the line queries in line_file, then exit.
@@ -105,6 +156,42 @@ unsigned int get_uint_or_die(std::map<std::string, docopt::value>& args, const s
     }
 }
 
+//parses a comma-separated list of dimensions, returning them in increasing order without repetitions
+std::vector<int> get_dims_or_die(std::map<std::string, docopt::value>& args, const std::string& key)
+{
+    std::vector<int> dims;
+    std::stringstream ss(args[key].asString());
+    std::string item;
+    try {
+        while (std::getline(ss, item, ',')) {
+            size_t end;
+            int dim = std::stoi(item, &end);
+            if (end != item.size() || dim < 0)
+                throw std::invalid_argument(item);
+            dims.push_back(dim);
+        }
+    } catch (std::exception& e) {
+        dims.clear();
+    }
+    if (dims.empty()) {
+        std::cerr << "Argument " << key << " must be a nonnegative integer or a comma-separated list of them";
+        throw std::runtime_error("Failed to parse dimensions");
+    }
+    std::sort(dims.begin(), dims.end());
+    dims.erase(std::unique(dims.begin(), dims.end()), dims.end());
+    return dims;
+}
+
+//returns the name of the output file for one of several dimensions of homology: file_name with _H<dim> inserted before its extension
+std::string output_file_for_dimension(const std::string& file_name, int dim)
+{
+    size_t dot = file_name.find_last_of('.');
+    size_t slash = file_name.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash) || dot == slash + 1)
+        dot = file_name.size();
+    return file_name.substr(0, dot) + "_H" + std::to_string(dim) + file_name.substr(dot);
+}
+
 //TODO: this doesn't really belong here, look for a better place.
 void write_boost_file(InputParameters const& params, TemplatePointsMessage const& message, ArrangementMessage const& arrangement)
 {
@@ -112,7 +199,7 @@ void write_boost_file(InputParameters const& params, TemplatePointsMessage const
     if (!file.is_open()) {
         throw std::runtime_error("Could not open " + params.outputFile + " for writing.");
     }
-    file << "RIVET_1\n";
+    file << "RIVET_2\n";
     boost::archive::binary_oarchive oarchive(file);
     oarchive& params& message& arrangement;
     file.flush();
@@ -203,13 +290,23 @@ void process_barcode_queries(std::string query_file_name, const ComputationResul
 
     typedef std::numeric_limits<double> dbl;
 
+    //rescale the templates for all queries in one batch
+    std::vector<const BarcodeTemplate*> templates;
+    std::vector<ProjectionLine> lines;
     for (auto query : queries) {
-        auto angle = query.first;
-        auto offset = query.second;
+        templates.push_back(&computation_result.arrangement->get_barcode_template(query.first, query.second));
+        lines.push_back(ProjectionLine(query.first, query.second));
+    }
+    TemplatePointCoords coords(computation_result.template_points, grades);
+    RescaledBars rescaled;
+    BarcodeTemplate::rescale_batch(templates, lines, coords, rescaled);
+
+    for (unsigned i = 0; i < queries.size(); i++) {
+        auto angle = queries[i].first;
+        auto offset = queries[i].second;
         std::cout.precision(dbl::max_digits10);
         std::cout  << angle << " " << offset << ": ";
-        auto templ = computation_result.arrangement->get_barcode_template(angle, offset);
-        auto barcode = templ.rescale(angle, offset, computation_result.template_points, grades);
+        auto barcode = rescaled.barcode(i);
         for (auto it = barcode->begin(); it != barcode->end(); it++) {
             auto bar = *it;
             std::cout << bar.birth << " ";
@@ -236,7 +333,7 @@ bool is_precomputed(std::string file_name)
     }
     std::string line;
     std::getline(file, line);
-    return line == "RIVET_1";
+    return line == "RIVET_2" || line == "RIVET_1"; //RIVET_1 files are recognized only to be rejected by load_from_precomputed()
 }
 
 std::unique_ptr<ComputationResult> load_from_precomputed(std::string file_name)
@@ -247,7 +344,10 @@ std::unique_ptr<ComputationResult> load_from_precomputed(std::string file_name)
     }
     std::string type;
     std::getline(file, type);
-    if (type != "RIVET_1") {
+    if (type == "RIVET_1") {
+        throw std::runtime_error(file_name + " was written by an earlier version of RIVET, whose precomputed format is no longer supported; please recompute it");
+    }
+    if (type != "RIVET_2") {
         throw std::runtime_error("Expected a precomputed RIVET file");
     }
     boost::archive::binary_iarchive archive(file);
@@ -269,6 +369,83 @@ std::unique_ptr<ComputationResult> load_from_precomputed(std::string file_name)
     return result;
 }
 
+//computes the modules for each of params.dims from the same bifiltration, one thread per dimension (up to the number of cores),
+//  and writes each to its own output file, or prints its Betti numbers if betti_only is true
+void compute_dimensions(InputParameters& params, InputData& input, bool betti_only)
+{
+    struct DimensionRun {
+        InputParameters params;
+        Progress progress; //not connected, since the stages of the dimensions are interleaved
+        std::shared_ptr<TemplatePointsMessage> points;
+        std::unique_ptr<ComputationResult> result;
+        std::exception_ptr error;
+    };
+    std::vector<std::unique_ptr<DimensionRun>> runs;
+    for (int dim : params.dims) {
+        runs.emplace_back(new DimensionRun);
+        runs.back()->params = params;
+        runs.back()->params.dim = dim;
+        runs.back()->params.outputFile = output_file_for_dimension(params.outputFile, dim);
+    }
+
+    auto compute = [&input, betti_only](DimensionRun* run) {
+        try {
+            Computation computation(run->params, run->progress);
+            computation.template_points_ready.connect([run](TemplatePointsMessage message) {
+                run->points.reset(new TemplatePointsMessage(message));
+            });
+            run->result = computation.compute(input, betti_only);
+        } catch (...) {
+            run->error = std::current_exception();
+        }
+    };
+
+    unsigned max_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::thread> threads;
+    for (unsigned k = 0; k < runs.size(); k++) {
+        if (k >= max_threads)
+            threads[k - max_threads].join();
+        threads.emplace_back(compute, runs[k].get());
+    }
+    for (unsigned k = (runs.size() > max_threads) ? runs.size() - max_threads : 0; k < runs.size(); k++)
+        threads[k].join();
+
+    for (auto& run : runs) {
+        if (run->error)
+            std::rethrow_exception(run->error);
+        if (betti_only) {
+            std::cout << "HOMOLOGY DIMENSION " << run->params.dim << std::endl;
+            FileWriter::write_grades(std::cout, run->points->x_exact, run->points->y_exact);
+            print_dims(*run->points, std::cout);
+            std::cout << std::endl;
+            print_betti(*run->points, std::cout);
+            continue;
+        }
+        if (params.outputFile.empty())
+            continue;
+
+        std::ofstream file(run->params.outputFile);
+        if (!file.is_open())
+            throw std::runtime_error("Error: Unable to write file:" + run->params.outputFile);
+        if (params.verbosity > 0) {
+            debug() << "Writing file:" << run->params.outputFile;
+        }
+        if (params.outputFormat == "R0") {
+            FileWriter fw(run->params, input, *(run->result->arrangement), run->result->template_points);
+            fw.write_augmented_arrangement(file);
+        } else if (params.outputFormat == "R1") {
+            write_boost_file(run->params, *run->points, ArrangementMessage(*(run->result->arrangement)));
+        } else {
+            throw std::runtime_error("Unsupported output format: " + params.outputFormat);
+        }
+        file.close();
+        if (params.resume) {
+            Checkpoint::remove(run->params.outputFile);
+        }
+    }
+    std::cout.flush();
+} //end compute_dimensions()
+
 int main(int argc, char* argv[])
 {
     InputParameters params; //parameter values stored here
@@ -291,10 +468,34 @@ int main(int argc, char* argv[])
     if (out_file_name.isString()) {
         params.outputFile = out_file_name.asString();
     }
-    params.dim = get_uint_or_die(args, "--homology");
+    params.dims = get_dims_or_die(args, "--homology");
+    params.dim = params.dims.back();
+    if (params.dims.size() == 1)
+        params.dims.clear();
     params.x_bins = get_uint_or_die(args, "--xbins");
     params.y_bins = get_uint_or_die(args, "--ybins");
+    params.x_binning = args["--x-binning"].asString();
+    params.y_binning = args["--y-binning"].asString();
+    for (const std::string& binning : { params.x_binning, params.y_binning }) {
+        if (binning != "uniform" && binning != "quantile" && binning != "adaptive") {
+            std::cerr << "Arguments --x-binning and --y-binning must be uniform, quantile, or adaptive";
+            throw std::runtime_error("Unsupported binning: " + binning);
+        }
+    }
     params.verbosity = get_uint_or_die(args, "--verbosity");
+    params.num_segments = get_uint_or_die(args, "--segments");
+    params.snapshot_budget = get_uint_or_die(args, "--snapshot-budget");
+    params.seed = get_uint_or_die(args, "--seed");
+    params.strategy = args["--strategy"].asString();
+    if (params.strategy != "reset" && params.strategy != "quicksort" && params.strategy != "vineyards") {
+        std::cerr << "Argument --strategy must be reset, quicksort, or vineyards";
+        throw std::runtime_error("Unsupported strategy: " + params.strategy);
+    }
+    params.collapse_edges = args["--collapse-edges"].isBool() && args["--collapse-edges"].asBool();
+    params.estimate = args["--estimate"].isBool() && args["--estimate"].asBool();
+    params.memory_limit = get_uint_or_die(args, "--memory-limit");
+    params.resume = args["--resume"].isBool() && args["--resume"].asBool();
+    params.checkpoint_interval = get_uint_or_die(args, "--checkpoint-interval");
     params.outputFormat = args["-f"].asString();
     bool betti_only = args["--betti"].isBool() && args["--betti"].asBool();
     bool binary = args["--binary"].isBool() && args["--binary"].asBool();
@@ -313,6 +514,8 @@ int main(int argc, char* argv[])
     if (params.verbosity >= 8) {
         debug() << "X bins: " << params.x_bins;
         debug() << "Y bins: " << params.y_bins;
+        debug() << "X binning: " << params.x_binning;
+        debug() << "Y binning: " << params.y_binning;
         debug() << "Verbosity: " << params.verbosity;
     }
 
@@ -417,7 +620,14 @@ int main(int argc, char* argv[])
     std::unique_ptr<ComputationResult> result;
 
     if (barcodes || bounds) {
-        result = load_from_precomputed(params.fileName);
+        try {
+            result = load_from_precomputed(params.fileName);
+        } catch (const std::exception& e) {
+            std::cerr << "INPUT ERROR: " << e.what() << " :END" << std::endl;
+            std::cerr << "Exiting" << std::endl
+                      << std::flush;
+            return 1;
+        }
         if (barcodes) {
             if (!slices.empty()) {
                 process_barcode_queries(slices, *result);
@@ -440,6 +650,17 @@ int main(int argc, char* argv[])
         if (params.verbosity >= 4) {
             debug() << "Input processed.";
         }
+        if (params.estimate) {
+            return 0;
+        }
+        if (!params.dims.empty()) {
+            if (binary) {
+                std::cerr << "Argument --binary requires a single dimension of homology" << std::endl;
+                return 1;
+            }
+            compute_dimensions(params, *input, betti_only);
+            return 0;
+        }
         result = computation.compute(*input);
         if (params.verbosity >= 2) {
             debug() << "Computation complete; augmented arrangement ready.";
@@ -464,6 +685,10 @@ int main(int argc, char* argv[])
                 } else {
                     throw std::runtime_error("Unsupported output format: " + params.outputFormat);
                 }
+                file.close();
+                if (params.resume) {
+                    Checkpoint::remove(params.outputFile);
+                }
             } else {
                 std::stringstream ss;
                 ss << "Error: Unable to write file:" << params.outputFile;
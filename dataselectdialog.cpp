@@ -114,7 +114,10 @@ void DataSelectDialog::detect_file_type()
 
     auto line = reader.next_line().first;
     if (line[0] == "RIVET_1") {
-        //TODO: It would be nice to support RIVET_1 in the console like other file types
+        invalid_file("This file was written by an earlier version of RIVET, whose precomputed format is no longer supported. Please recompute it.");
+        return;
+    } else if (line[0] == "RIVET_2") {
+        //TODO: It would be nice to support RIVET_2 in the console like other file types
         // rather than having this special case here
         ui->fileTypeLabel->setText("This file appears to contain pre-computed RIVET data");
         QFileInfo fileInfo(QString::fromStdString(params.fileName));
@@ -112,6 +112,11 @@ std::shared_ptr<TemplatePointsMatrixEntry> Anchor::get_entry()
     return entry;
 }
 
+void Anchor::set_entry(std::shared_ptr<TemplatePointsMatrixEntry> e)
+{
+    entry = e;
+}
+
 void Anchor::set_weight(unsigned long w)
 {
     weight = w;
@@ -56,6 +56,7 @@ public:
     void toggle(); //toggles above/below state of this Anchor; called whever the slice line crosses this Anchor in the vineyard-update process of storing persistence data
 
     std::shared_ptr<TemplatePointsMatrixEntry> get_entry(); //accessor
+    void set_entry(std::shared_ptr<TemplatePointsMatrixEntry> e); //sets the entry, for an Anchor that was constructed from its coordinates
 
     void set_weight(unsigned long w); //sets the estimate of the cost of updating the RU-decomposition when crossing this anchor
     unsigned long get_weight(); //returns estimate of the cost of updating the RU-decomposition when crossing this anchor
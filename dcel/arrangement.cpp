@@ -39,6 +39,7 @@ Arrangement::Arrangement()
     , vertices()
     , halfedges()
     , faces()
+    , barcode_templates()
     , verbosity(0)
     , all_anchors()
     , topleft()
@@ -59,6 +60,7 @@ Arrangement::Arrangement(std::vector<exact> xe,
     , vertices()
     , halfedges()
     , faces()
+    , barcode_templates()
     , verbosity(verbosity)
 {
     //create vertices
@@ -184,7 +186,7 @@ std::shared_ptr<Halfedge> Arrangement::create_edge_left(std::shared_ptr<Halfedge
 
 //returns barcode template associated with the specified line (point)
 //REQUIREMENT: 0 <= degrees <= 90
-BarcodeTemplate& Arrangement::get_barcode_template(double degrees, double offset)
+const BarcodeTemplate& Arrangement::get_barcode_template(double degrees, double offset)
 {
     ///TODO: store some point/cell to seed the next query
     std::shared_ptr<Face> cell;
@@ -216,19 +218,25 @@ BarcodeTemplate& Arrangement::get_barcode_template(double degrees, double offset
     }
     ///TODO: REPLACE THIS WITH A SEEDED SEARCH
 
-    return cell->get_barcode();
+    return barcode_templates.get(cell->get_template_id());
 } //end get_barcode_template()
 
 //returns the barcode template associated with faces[i]
-BarcodeTemplate& Arrangement::get_barcode_template(unsigned i)
+const BarcodeTemplate& Arrangement::get_barcode_template(unsigned i)
 {
-    return faces[i]->get_barcode();
+    return barcode_templates.get(faces[i]->get_template_id());
 }
 
-//stores (a copy of) the given barcode template in faces[i]
-void Arrangement::set_barcode_template(unsigned i, BarcodeTemplate& bt)
+//stores (a copy of) the given barcode template in faces[i]; identical templates are stored only once
+void Arrangement::set_barcode_template(unsigned i, const BarcodeTemplate& bt)
 {
-    faces[i]->set_barcode(bt);
+    faces[i]->set_template_id(barcode_templates.intern(bt));
+}
+
+//returns the number of distinct barcode templates stored in the arrangement
+unsigned Arrangement::num_distinct_templates()
+{
+    return barcode_templates.size();
 }
 
 //returns the number of 2-cells, and thus the number of barcode templates, in the arrangement
@@ -238,9 +246,12 @@ unsigned Arrangement::num_faces()
 }
 
 //creates a new anchor in the vector all_anchors
+//  if there is already an anchor at the same position (as in an arrangement restored from a checkpoint), then gives it the entry of anchor instead
 void Arrangement::add_anchor(Anchor anchor)
 {
-    all_anchors.insert(std::make_shared<Anchor>(anchor.get_entry()));
+    auto inserted = all_anchors.insert(std::make_shared<Anchor>(anchor.get_entry()));
+    if (!inserted.second)
+        (*inserted.first)->set_entry(anchor.get_entry());
 }
 
 //finds the first anchor that intersects the left edge of the arrangement at a point not less than the specified y-coordinate
@@ -426,7 +437,8 @@ std::shared_ptr<Face> Arrangement::find_point(double x_coord, double y_coord)
 //prints a summary of the arrangement information, such as the number of anchors, vertices, halfedges, and faces
 void Arrangement::print_stats()
 {
-    debug() << "The arrangement contains: " << all_anchors.size() << " anchors, " << vertices.size() << " vertices, " << halfedges.size() << " halfedges, and " << faces.size() << " faces";
+    debug() << "The arrangement contains: " << all_anchors.size() << " anchors, " << vertices.size() << " vertices, " << halfedges.size() << " halfedges, and " << faces.size() << " faces"
+            << " (with " << barcode_templates.size() << " distinct barcode templates)";
 }
 
 //print all the data from the arrangement
@@ -28,7 +28,6 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define __DCEL_Mesh_H__
 
 //forward declarations
-class BarcodeTemplate;
 class ComputationThread;
 class Face;
 class Halfedge;
@@ -37,6 +36,7 @@ class PersistenceUpdater;
 class Vertex;
 
 #include "anchor.h"
+#include "barcode_template.h"
 #include "interface/progress.h"
 #include "math/template_point.h"
 #include "numerics.h"
@@ -61,15 +61,18 @@ public:
     Arrangement(std::vector<exact> xe, std::vector<exact> ye, unsigned verbosity);
 
     //returns barcode template associated with the specified line (point)
-    BarcodeTemplate& get_barcode_template(double degrees, double offset);
+    const BarcodeTemplate& get_barcode_template(double degrees, double offset);
 
     //returns the barcode template associated with faces[i]
-    BarcodeTemplate& get_barcode_template(unsigned i);
+    const BarcodeTemplate& get_barcode_template(unsigned i);
 
     //returns the number of 2-cells, and thus the number of barcode templates, in the arrangement
     unsigned num_faces();
 
-    //creates a new anchor in the vector all_anchors
+    //returns the number of distinct barcode templates stored in the arrangement
+    unsigned num_distinct_templates();
+
+    //creates a new anchor in the vector all_anchors, or gives the entry of anchor to the anchor already at its position
     void add_anchor(Anchor anchor);
 
     //FUNCTIONS FOR TESTING
@@ -96,6 +99,7 @@ private:
     std::vector<std::shared_ptr<Vertex>> vertices; //all vertices in the arrangement
     std::vector<std::shared_ptr<Halfedge>> halfedges; //all halfedges in the arrangement
     std::vector<std::shared_ptr<Face>> faces; //all faces in the arrangement
+    BarcodeTemplatePool barcode_templates; //distinct barcode templates, referenced by index from the faces
 
     unsigned verbosity;
 
@@ -125,7 +129,7 @@ private:
     void find_subpath(unsigned cur_node, std::vector<std::vector<unsigned>>& adj, std::vector<std::shared_ptr<Halfedge>>& pathvec, bool return_path);
 
     //stores (a copy of) the given barcode template in faces[i]; used for re-building the arrangement from a RIVET data file
-    void set_barcode_template(unsigned i, BarcodeTemplate& bt);
+    void set_barcode_template(unsigned i, const BarcodeTemplate& bt);
 
     ///// functions for searching the arrangement /////
 
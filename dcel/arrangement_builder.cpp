@@ -21,6 +21,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "dcel/arrangement_builder.h"
 #include "dcel/anchor.h"
 #include "dcel/arrangement.h"
+#include "dcel/arrangement_message.h"
 #include "dcel/dcel.h"
 #include "debug.h"
 #include "timer.h"
@@ -32,12 +33,18 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <algorithm> //for find function in version 3 of find_subpath
 #include <cutgraph.h>
+#include <interface/checkpoint.h>
 #include <stack> //for find_subpath
+#include <unordered_map>
 
     using rivet::numeric::INFTY;
 
-ArrangementBuilder::ArrangementBuilder(unsigned verbosity)
+ArrangementBuilder::ArrangementBuilder(unsigned verbosity, unsigned num_segments, unsigned snapshot_budget, unsigned seed, const std::string& strategy)
     : verbosity(verbosity)
+    , num_segments(num_segments)
+    , snapshot_budget(snapshot_budget)
+    , seed(seed)
+    , strategy(strategy)
 {
 }
 
@@ -48,22 +55,69 @@ std::shared_ptr<Arrangement> ArrangementBuilder::build_arrangement(MultiBetti& m
     std::vector<exact> x_exact,
     std::vector<exact> y_exact,
     std::vector<TemplatePoint>& template_points,
-    Progress& progress)
+    Progress& progress,
+    Checkpoint* checkpoint)
 {
     Timer timer;
 
+    //if there is a checkpoint of the arrangement and the path, then start from it
+    auto arrangement = std::make_shared<Arrangement>(x_exact, y_exact, verbosity);
+    std::vector<std::shared_ptr<Halfedge>> path;
+    bool resumed = (checkpoint != nullptr) && load_checkpoint(*checkpoint, *arrangement, path);
+    size_t restored_anchors = arrangement->all_anchors.size();
+
     //first, create PersistenceUpdater
     //this also finds anchors and stores them in the vector Arrangement::all_anchors -- JULY 2015 BUG FIX
+    //  (in a restored arrangement, the anchors are already there, and they are given their entries in the xi support matrix)
     progress.progress(10);
-    auto arrangement = std::make_shared<Arrangement>(x_exact, y_exact, verbosity);
-    PersistenceUpdater updater(*arrangement, mb.bifiltration, template_points, verbosity); //PersistenceUpdater object is able to do the calculations necessary for finding anchors and computing barcode templates
+    PersistenceUpdater updater(*arrangement, mb.bifiltration, mb.dimension, template_points, verbosity); //PersistenceUpdater object is able to do the calculations necessary for finding anchors and computing barcode templates
     if (verbosity >= 2) {
         debug() << "Anchors found; this took " << timer.elapsed() << " milliseconds.";
     }
+    if (resumed) {
+        //the updater must have found exactly the anchors of the checkpoint
+        bool anchors_match = (arrangement->all_anchors.size() == restored_anchors);
+        for (auto anchor : arrangement->all_anchors)
+            anchors_match = anchors_match && (anchor->get_entry() != nullptr);
+        if (!anchors_match)
+            throw std::runtime_error("The anchors of the checkpoint do not match the xi support points");
+        progress.progress(75);
+    } else {
+        build_path(arrangement, updater, path, progress);
+        if (checkpoint != nullptr)
+            save_checkpoint(*checkpoint, *arrangement, path);
+    }
+
+    //update the progress dialog box
+    progress.advanceProgressStage(); //update now in stage 5 (compute discrete barcodes)
+    progress.setProgressMaximum(path.size());
+
+    //finally, we can traverse the path, computing and storing a barcode template in each 2-cell
+    updater.set_num_segments(num_segments);
+    updater.set_snapshot_budget((unsigned long)snapshot_budget << 20);
+    updater.set_seed(seed);
+    updater.set_checkpoint(checkpoint);
+    if (strategy == "reset") {
+        updater.store_barcodes_with_reset(path, progress);
+    } else if (strategy == "quicksort") {
+        updater.store_barcodes_quicksort(path, progress);
+    } else if (strategy == "vineyards") {
+        updater.store_barcodes_vineyards(path, progress);
+    } else {
+        throw std::runtime_error("Unsupported strategy: " + strategy);
+    }
+
+    return arrangement;
+
+} //end build_arrangement()
+
+//builds the interior of the arrangement whose anchors have been found, computes the edge weights, and finds a path through all 2-cells
+void ArrangementBuilder::build_path(std::shared_ptr<Arrangement> arrangement, PersistenceUpdater& updater, std::vector<std::shared_ptr<Halfedge>>& path, Progress& progress)
+{
+    Timer timer;
 
     //now that we have all the anchors, we can build the interior of the arrangement
     progress.progress(25);
-    timer.restart();
     build_interior(arrangement);
     if (verbosity >= 2) {
         debug() << "Line arrangement constructed; this took " << timer.elapsed() << " milliseconds.";
@@ -82,23 +136,45 @@ std::shared_ptr<Arrangement> ArrangementBuilder::build_arrangement(MultiBetti& m
 
     //now that the arrangement is constructed, we can find a path -- NOTE: path starts with a (near-vertical) line to the right of all multigrades
     progress.progress(75);
-    std::vector<std::shared_ptr<Halfedge>> path;
     timer.restart();
     find_path(*arrangement, path);
     if (verbosity >= 2) {
         debug() << "Found path through the arrangement; this took " << timer.elapsed() << " milliseconds.";
     }
+} //end build_path()
 
-    //update the progress dialog box
-    progress.advanceProgressStage(); //update now in stage 5 (compute discrete barcodes)
-    progress.setProgressMaximum(path.size());
+//saves the arrangement, with the anchors and their weights, and the path through it, as indexes of halfedges
+void ArrangementBuilder::save_checkpoint(Checkpoint& checkpoint, Arrangement& arrangement, std::vector<std::shared_ptr<Halfedge>>& path)
+{
+    std::unordered_map<Halfedge*, unsigned> halfedge_index;
+    for (unsigned i = 0; i < arrangement.halfedges.size(); i++)
+        halfedge_index[arrangement.halfedges[i].get()] = i;
 
-    //finally, we can traverse the path, computing and storing a barcode template in each 2-cell
-    updater.store_barcodes_with_reset(path, progress);
+    std::vector<unsigned> path_indexes;
+    path_indexes.reserve(path.size());
+    for (auto& edge : path)
+        path_indexes.push_back(halfedge_index.at(edge.get()));
 
-    return arrangement;
+    checkpoint.save_arrangement(ArrangementMessage(arrangement), path_indexes);
+}
 
-} //end build_arrangement()
+//restores the arrangement and the path through it from the checkpoint; returns false if there is no valid checkpoint for them
+bool ArrangementBuilder::load_checkpoint(Checkpoint& checkpoint, Arrangement& arrangement, std::vector<std::shared_ptr<Halfedge>>& path)
+{
+    ArrangementMessage message;
+    std::vector<unsigned> path_indexes;
+    if (!checkpoint.load_arrangement(message, path_indexes))
+        return false;
+
+    arrangement = message.to_arrangement();
+    arrangement.verbosity = verbosity;
+    for (unsigned index : path_indexes) {
+        if (index >= arrangement.halfedges.size())
+            throw std::runtime_error("The path of the checkpoint does not fit its arrangement");
+        path.push_back(arrangement.halfedges[index]);
+    }
+    return true;
+}
 
 //builds the DCEL arrangement from the supplied xi support points, but does NOT compute persistence data
 std::shared_ptr<Arrangement> ArrangementBuilder::build_arrangement(std::vector<exact> x_exact, std::vector<exact> y_exact,
@@ -112,7 +188,7 @@ std::shared_ptr<Arrangement> ArrangementBuilder::build_arrangement(std::vector<e
     //TODO: this is odd, fix.
     SimplexTree dummy_tree(0, 0);
     std::shared_ptr<Arrangement> arrangement(new Arrangement(x_exact, y_exact, verbosity));
-    PersistenceUpdater updater(*arrangement, dummy_tree, xi_pts, verbosity); //we only use the PersistenceUpdater to find and store the anchors
+    PersistenceUpdater updater(*arrangement, dummy_tree, 0, xi_pts, verbosity); //we only use the PersistenceUpdater to find and store the anchors
     if (verbosity >= 2) {
         debug() << "Anchors found; this took " << timer.elapsed() << " milliseconds.";
     }
@@ -28,18 +28,28 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "interface/progress.h"
 #include "math/multi_betti.h"
 
+class Checkpoint;
+
+#include <string>
+
 class ArrangementBuilder {
 public:
-    ArrangementBuilder(unsigned verbosity);
+    //num_segments is the number of segments of the path that are traversed in parallel
+    //  snapshot_budget is the number of megabytes for snapshots of RU-decompositions, used to speed up resets
+    //  seed determines the random vineyard updates that calibrate the cost model for resets
+    //  strategy is "reset", "quicksort", or "vineyards"; see the corresponding store_barcodes functions of PersistenceUpdater
+    ArrangementBuilder(unsigned verbosity, unsigned num_segments, unsigned snapshot_budget, unsigned seed, const std::string& strategy);
 
     //builds the DCEL arrangement, computes and stores persistence data
     //also stores ordered list of xi support points in the supplied vector
     //precondition: the constructor has already created the boundary of the arrangement
+    //if checkpoint is not null, then the arrangement and the path through it are restored from it if possible, and saved to it otherwise
     std::shared_ptr<Arrangement> build_arrangement(MultiBetti& mb,
         std::vector<exact> x_exact,
         std::vector<exact> y_exact,
         std::vector<TemplatePoint>& template_points,
-        Progress& progress);
+        Progress& progress,
+        Checkpoint* checkpoint = nullptr);
 
     //builds the DCEL arrangement from the supplied xi support points, but does NOT compute persistence data
     std::shared_ptr<Arrangement> build_arrangement(
@@ -49,11 +59,19 @@ public:
 
 private:
     unsigned verbosity;
+    unsigned num_segments;
+    unsigned snapshot_budget;
+    unsigned seed;
+    std::string strategy;
     void build_interior(std::shared_ptr<Arrangement> arrangement);
     //builds the interior of DCEL arrangement using a version of the Bentley-Ottmann algorithm
     //precondition: all achors have been stored via find_anchors()
     void find_edge_weights(Arrangement& arrangement, PersistenceUpdater& updater);
     void find_path(Arrangement& arrangement, std::vector<std::shared_ptr<Halfedge>>& pathvec);
+    //builds the interior, computes the edge weights, and finds the path through all 2-cells
+    void build_path(std::shared_ptr<Arrangement> arrangement, PersistenceUpdater& updater, std::vector<std::shared_ptr<Halfedge>>& path, Progress& progress);
+    void save_checkpoint(Checkpoint& checkpoint, Arrangement& arrangement, std::vector<std::shared_ptr<Halfedge>>& path);
+    bool load_checkpoint(Checkpoint& checkpoint, Arrangement& arrangement, std::vector<std::shared_ptr<Halfedge>>& path);
     void find_subpath(Arrangement& arrangement, unsigned cur_node, std::vector<std::vector<unsigned>>& adj, std::vector<std::shared_ptr<Halfedge>>& pathvec);
 };
 
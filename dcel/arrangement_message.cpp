@@ -44,6 +44,7 @@ ArrangementMessage::ArrangementMessage(Arrangement const& arrangement)
     , vertices()
     , anchors()
     , faces()
+    , barcode_templates(arrangement.barcode_templates)
 {
     std::map<std::shared_ptr<Face>, long, Ptr_Compare<Face>> face_map;
     std::map<std::shared_ptr<Halfedge>, long, Ptr_Compare<Halfedge>> halfedge_map;
@@ -90,7 +91,7 @@ ArrangementMessage::ArrangementMessage(Arrangement const& arrangement)
     //build data structures
 
     for (auto face : arrangement.faces) {
-        faces.push_back(FaceM{ HalfedgeId(HID(face->get_boundary())), face->get_barcode() });
+        faces.push_back(FaceM{ HalfedgeId(HID(face->get_boundary())), face->get_template_id() });
     }
     for (auto half : arrangement.halfedges) {
         half_edges.push_back(HalfedgeM{
@@ -141,6 +142,7 @@ ArrangementMessage::ArrangementMessage()
     , vertices()
     , anchors()
     , faces()
+    , barcode_templates()
 {
 }
 
@@ -331,7 +333,7 @@ BarcodeTemplate ArrangementMessage::get_barcode_template(double degrees, double
     }
     ///TODO: REPLACE THIS WITH A SEEDED SEARCH
 
-    return get(cell).dbc;
+    return barcode_templates.get(get(cell).template_id);
 } //end get_barcode_template()
 
 bool check(bool condition, std::string message)
@@ -362,7 +364,7 @@ bool operator==(ArrangementMessage::VertexM const& left, ArrangementMessage::Ver
 bool operator==(ArrangementMessage::FaceM const& left, ArrangementMessage::FaceM const& right)
 {
     return left.boundary == right.boundary
-        && left.dbc == right.dbc;
+        && left.template_id == right.template_id;
 }
 
 bool operator==(ArrangementMessage::AnchorM const& left, ArrangementMessage::AnchorM const& right)
@@ -391,6 +393,8 @@ bool operator==(ArrangementMessage const& left, ArrangementMessage const& right)
         return false;
     if (!check(left.faces == right.faces, "faces"))
         return false;
+    if (!check(left.barcode_templates == right.barcode_templates, "barcode templates"))
+        return false;
     if (!check(left.half_edges == right.half_edges, "edges"))
         return false;
     if (!check(left.x_grades == right.x_grades, "x_grades"))
@@ -453,7 +457,7 @@ Arrangement ArrangementMessage::to_arrangement() const
         if (faces[i].boundary != HalfedgeId::invalid()) {
             mface->set_boundary(arrangement.halfedges[static_cast<long>(face.boundary)]);
         }
-        mface->set_barcode(face.dbc);
+        mface->set_template_id(face.template_id);
     }
     for (size_t i = 0; i < half_edges.size(); i++) {
         ::Halfedge& edge = *(arrangement.halfedges[i]);
@@ -508,6 +512,8 @@ Arrangement ArrangementMessage::to_arrangement() const
     arrangement.topright = arrangement.halfedges[static_cast<long>(topright)];
     arrangement.topleft = arrangement.halfedges[static_cast<long>(topleft)];
 
+    arrangement.barcode_templates = barcode_templates;
+
     arrangement.x_exact = x_exact;
     arrangement.y_exact = y_exact;
 
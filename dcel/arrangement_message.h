@@ -42,7 +42,7 @@ public:
     void serialize(Archive& ar, const unsigned int /*version*/)
     {
         ar& x_grades& y_grades& x_exact & y_exact & half_edges& vertices
-        & anchors& faces& topleft& topright& bottomleft& bottomright& vertical_line_query_list;
+        & anchors& barcode_templates& faces& topleft& topright& bottomleft& bottomright& vertical_line_query_list;
     }
 
     BarcodeTemplate get_barcode_template(double degrees, double offset);
@@ -118,12 +118,12 @@ private:
 
     struct FaceM {
         HalfedgeId boundary; //pointer to one halfedge in the boundary of this cell
-        BarcodeTemplate dbc; //barcode template stored in this cell
+        unsigned template_id; //index of the barcode template for this cell in barcode_templates
 
         template <typename Archive>
         void serialize(Archive& ar, const unsigned int /*version*/)
         {
-            ar& boundary& dbc;
+            ar& boundary& template_id;
         }
     };
 
@@ -146,6 +146,7 @@ private:
     std::vector<VertexM> vertices;
     std::vector<AnchorM> anchors;
     std::vector<FaceM> faces;
+    BarcodeTemplatePool barcode_templates; //each distinct barcode template, stored once and referenced by the faces
 
     //finds the first anchor that intersects the left edge of the arrangement at a point not less than the specified y-coordinate
     //  if no such anchor, returns nullptr
@@ -20,6 +20,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "barcode.h"
 
+#include <algorithm>
 #include <debug.h>
 #include <math.h>
 
@@ -56,31 +57,66 @@ bool MultiBar::operator<(const MultiBar other) const
 }
 
 Barcode::Barcode()
+    : births()
+    , deaths()
+    , multiplicities()
 {
 }
 
+//bulk construction: sorts the bars once
+Barcode::Barcode(std::vector<MultiBar> bars)
+    : births()
+    , deaths()
+    , multiplicities()
+{
+    std::stable_sort(bars.begin(), bars.end());
+
+    births.reserve(bars.size());
+    deaths.reserve(bars.size());
+    multiplicities.reserve(bars.size());
+    for (std::vector<MultiBar>::iterator it = bars.begin(); it != bars.end(); ++it) {
+        births.push_back(it->birth);
+        deaths.push_back(it->death);
+        multiplicities.push_back(it->multiplicity);
+    }
+}
+
 //adds a bar to the barcode
 void Barcode::add_bar(double b, double d, unsigned m)
 {
-    bars.insert(MultiBar(b, d, m));
+    //insert after all bars that are not greater than the new bar
+    MultiBar bar(b, d, m);
+    unsigned i = births.size();
+    while (i > 0 && bar < MultiBar(births[i - 1], deaths[i - 1], multiplicities[i - 1]))
+        i--;
+
+    births.insert(births.begin() + i, b);
+    deaths.insert(deaths.begin() + i, d);
+    multiplicities.insert(multiplicities.begin() + i, m);
 }
 
 //returns an iterator to the first bar in the barcode
-std::set<MultiBar>::const_iterator Barcode::begin() const
+Barcode::const_iterator Barcode::begin() const
 {
-    return bars.cbegin();
+    return const_iterator(this, 0);
 }
 
 //returns an iterator to the pst-the-end element the barcode
-std::set<MultiBar>::const_iterator Barcode::end() const
+Barcode::const_iterator Barcode::end() const
 {
-    return bars.cend();
+    return const_iterator(this, births.size());
 }
 
 //returns the number of multibars in the barcode
 unsigned Barcode::size() const
 {
-    return bars.size();
+    return births.size();
+}
+
+//returns the i-th bar in sorted order
+MultiBar Barcode::bar(unsigned i) const
+{
+    return MultiBar(births[i], deaths[i], multiplicities[i]);
 }
 
 //for testing only
@@ -88,8 +124,7 @@ void Barcode::print() const
 {
     Debug qd = debug(true);
     qd << "      rescaled barcode: ";
-    for (std::multiset<MultiBar>::iterator it = bars.begin(); it != bars.end(); ++it) {
-        MultiBar b = *it;
-        qd << "(" << b.birth << "," << b.death << ")x" << b.multiplicity << ", ";
+    for (unsigned i = 0; i < births.size(); i++) {
+        qd << "(" << births[i] << "," << deaths[i] << ")x" << multiplicities[i] << ", ";
     }
 }
@@ -21,7 +21,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef __BARCODE_H__
 #define __BARCODE_H__
 
-#include <set>
+#include <cstddef>
+#include <iterator>
+#include <vector>
 
 struct MultiBar {
     double birth; //coordinate where this bar begins
@@ -31,23 +33,74 @@ struct MultiBar {
     MultiBar(double b, double d, unsigned m);
     MultiBar(const MultiBar& other);
 
+    MultiBar& operator=(const MultiBar& other) = default;
+
     bool operator<(const MultiBar other) const;
 };
 
+//stores the bars of a barcode in contiguous arrays, sorted with the longest bars first
 class Barcode {
 public:
+    //iterates over the bars in sorted order; dereferencing yields a MultiBar by value
+    class const_iterator {
+    public:
+        typedef std::input_iterator_tag iterator_category;
+        typedef MultiBar value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const MultiBar* pointer;
+        typedef MultiBar reference;
+
+        const_iterator(const Barcode* bc, unsigned i)
+            : bc(bc)
+            , i(i)
+            , cur(0, 0, 0)
+        {
+        }
+
+        MultiBar operator*() const { return bc->bar(i); }
+        const MultiBar* operator->()
+        {
+            cur = bc->bar(i);
+            return &cur;
+        }
+        const_iterator& operator++()
+        {
+            ++i;
+            return *this;
+        }
+        const_iterator operator++(int)
+        {
+            const_iterator temp = *this;
+            ++i;
+            return temp;
+        }
+        bool operator==(const const_iterator& other) const { return i == other.i && bc == other.bc; }
+        bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+    private:
+        const Barcode* bc;
+        unsigned i;
+        MultiBar cur;
+    };
+
     Barcode();
+    Barcode(std::vector<MultiBar> bars); //bulk construction: sorts the bars once
 
     void add_bar(double b, double d, unsigned m); //adds a bar to the barcode
 
-    std::multiset<MultiBar>::const_iterator begin() const; //returns an iterator to the first bar in the barcode
-    std::multiset<MultiBar>::const_iterator end() const; //returns an iterator to the pst-the-end element the barcode
+    const_iterator begin() const; //returns an iterator to the first bar in the barcode
+    const_iterator end() const; //returns an iterator to the pst-the-end element the barcode
     unsigned size() const; //returns the number of multibars in the barcode
+    MultiBar bar(unsigned i) const; //returns the i-th bar in sorted order
 
     void print() const; //for testing only
 
 private:
-    std::multiset<MultiBar> bars; //must be a multiset because the comparison operator for MultiBars might not establish a total order
+    //bars in sorted order; bars that are equivalent under the comparison operator for MultiBars remain in insertion order,
+    //  since that operator might not establish a total order
+    std::vector<double> births;
+    std::vector<double> deaths;
+    std::vector<unsigned> multiplicities;
 };
 
 #endif // __BARCODE_H__
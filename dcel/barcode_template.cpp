@@ -20,11 +20,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "barcode_template.h"
 #include <cassert>
+#include <algorithm>
 #include <cmath>
 #include <dcel/barcode.h>
-#include <map>
+#include <functional>
 #include <math/template_point.h>
 #include <numerics.h>
+#include <stdexcept>
 #include <vector>
 
 #include "debug.h"
@@ -64,73 +66,186 @@ bool BarTemplate::operator<(const BarTemplate other) const
 }
 
 BarcodeTemplate::BarcodeTemplate()
-    : bars()
+    : begins()
+    , ends()
+    , multiplicities()
 {
 }
 
-//adds a bar to the barcode (updating multiplicity, if necessary)
-void BarcodeTemplate::add_bar(unsigned a, unsigned b)
+//bulk construction: bars need not be sorted, and repeated bars are combined
+BarcodeTemplate::BarcodeTemplate(std::vector<BarTemplate> bars)
+    : begins()
+    , ends()
+    , multiplicities()
 {
-    //look for the bar
-    BarTemplate bar(a, b);
-    std::set<BarTemplate>::iterator it = bars.find(bar);
+    update_bars(bars, std::vector<BarTemplate>());
+}
 
-    if (it == bars.end()) //then the bar doesn't already exist, so insert it
-    {
-        bars.insert(bar);
-    } else //then the bar already exists, so increment its multiplicity
-    {
-        (*it).multiplicity++;
+//returns the position of the first bar not less than (a,b)
+unsigned BarcodeTemplate::lower_bound(unsigned a, unsigned b) const
+{
+    unsigned min = 0;
+    unsigned max = begins.size();
+    while (min < max) {
+        unsigned mid = (min + max) / 2;
+        if (begins[mid] < a || (begins[mid] == a && ends[mid] < b))
+            min = mid + 1;
+        else
+            max = mid;
     }
+    return min;
+}
+
+//adds a bar to the barcode (updating multiplicity, if necessary)
+void BarcodeTemplate::add_bar(unsigned a, unsigned b)
+{
+    add_bar(a, b, 1);
 }
 
 //adds a bar with multiplicity to the barcode template
 void BarcodeTemplate::add_bar(unsigned a, unsigned b, unsigned m)
 {
     //look for the bar
-    BarTemplate bar(a, b, m);
-    std::set<BarTemplate>::iterator it = bars.find(bar);
+    unsigned i = lower_bound(a, b);
 
-    if (it == bars.end()) //then the bar doesn't already exist, so insert it
+    if (i < begins.size() && begins[i] == a && ends[i] == b) //then the bar already exists, so increment its multiplicity
     {
-        bars.insert(bar);
-    } else //then the bar already exists, so increment its multiplicity
+        multiplicities[i] += m;
+    } else //then the bar doesn't already exist, so insert it
     {
-        (*it).multiplicity += m;
+        begins.insert(begins.begin() + i, a);
+        ends.insert(ends.begin() + i, b);
+        multiplicities.insert(multiplicities.begin() + i, m);
+    }
+}
+
+//removes one copy of a bar from the barcode template (updating multiplicity, if necessary)
+void BarcodeTemplate::remove_bar(unsigned a, unsigned b)
+{
+    unsigned i = lower_bound(a, b);
+
+    if (i == begins.size() || begins[i] != a || ends[i] != b)
+        throw std::runtime_error("BarcodeTemplate::remove_bar(): bar not found");
+
+    if (multiplicities[i] > 1) {
+        multiplicities[i]--;
+    } else {
+        begins.erase(begins.begin() + i);
+        ends.erase(ends.begin() + i);
+        multiplicities.erase(multiplicities.begin() + i);
     }
 }
 
+//adds and removes many bars in a single pass over the template; neither list needs to be sorted
+//  this is a merge of three sorted sequences, so it takes time linear in the size of the template (after sorting the lists)
+void BarcodeTemplate::update_bars(std::vector<BarTemplate> added, std::vector<BarTemplate> removed)
+{
+    std::sort(added.begin(), added.end());
+    std::sort(removed.begin(), removed.end());
+
+    std::vector<unsigned> new_begins, new_ends, new_mults;
+    new_begins.reserve(begins.size() + added.size());
+    new_ends.reserve(begins.size() + added.size());
+    new_mults.reserve(begins.size() + added.size());
+
+    unsigned i = 0; //position in this template
+    std::vector<BarTemplate>::const_iterator ait = added.begin();
+    std::vector<BarTemplate>::const_iterator rit = removed.begin();
+
+    while (i < begins.size() || ait != added.end() || rit != removed.end()) {
+        //find the least bar at the front of the three sequences
+        BarTemplate least(-1, -1);
+        bool found = false;
+        if (i < begins.size()) {
+            least = BarTemplate(begins[i], ends[i]);
+            found = true;
+        }
+        if (ait != added.end() && (!found || *ait < least)) {
+            least = BarTemplate(ait->begin, ait->end);
+            found = true;
+        }
+        if (rit != removed.end() && (!found || *rit < least))
+            least = BarTemplate(rit->begin, rit->end);
+
+        //compute the new multiplicity of this bar
+        long count = 0;
+        if (i < begins.size() && begins[i] == least.begin && ends[i] == least.end) {
+            count += multiplicities[i];
+            i++;
+        }
+        for (; ait != added.end() && ait->begin == least.begin && ait->end == least.end; ++ait)
+            count += ait->multiplicity;
+        for (; rit != removed.end() && rit->begin == least.begin && rit->end == least.end; ++rit)
+            count -= rit->multiplicity;
+
+        if (count < 0)
+            throw std::runtime_error("BarcodeTemplate::update_bars(): removed a bar that is not in the template");
+
+        if (count > 0) {
+            new_begins.push_back(least.begin);
+            new_ends.push_back(least.end);
+            new_mults.push_back(count);
+        }
+    }
+
+    begins.swap(new_begins);
+    ends.swap(new_ends);
+    multiplicities.swap(new_mults);
+} //end update_bars()
+
 //returns an iterator to the first bar in the barcode
-std::set<BarTemplate>::iterator BarcodeTemplate::begin()
+BarcodeTemplate::const_iterator BarcodeTemplate::begin() const
 {
-    return bars.begin();
+    return const_iterator(this, 0);
 }
 
 //returns an iterator to the past-the-end element of the barcode
-std::set<BarTemplate>::iterator BarcodeTemplate::end()
+BarcodeTemplate::const_iterator BarcodeTemplate::end() const
 {
-    return bars.end();
+    return const_iterator(this, begins.size());
 }
 
 //returns true iff this barcode has no bars
-bool BarcodeTemplate::is_empty()
+bool BarcodeTemplate::is_empty() const
 {
-    return bars.empty();
+    return begins.empty();
+}
+
+//returns the number of distinct bars
+unsigned BarcodeTemplate::size() const
+{
+    return begins.size();
+}
+
+//returns the i-th bar in sorted order
+BarTemplate BarcodeTemplate::bar(unsigned i) const
+{
+    return BarTemplate(begins[i], ends[i], multiplicities[i]);
+}
+
+//returns the multiplicity of the bar (a,b), which is 0 if the bar does not occur
+unsigned BarcodeTemplate::multiplicity(unsigned a, unsigned b) const
+{
+    unsigned i = lower_bound(a, b);
+    if (i < begins.size() && begins[i] == a && ends[i] == b)
+        return multiplicities[i];
+    return 0;
 }
 
 //for testing only
-void BarcodeTemplate::print()
+void BarcodeTemplate::print() const
 {
     debug() << "      barcode template: ";
-    for (std::set<BarTemplate>::iterator it = bars.begin(); it != bars.end(); ++it) {
-        BarTemplate b = *it;
-        debug(true) << "(" << b.begin << "," << b.end << ")x" << b.multiplicity << ", ";
+    for (unsigned i = 0; i < begins.size(); i++) {
+        debug(true) << "(" << begins[i] << "," << ends[i] << ")x" << multiplicities[i] << ", ";
     }
 }
 
 bool operator==(BarcodeTemplate const& left, BarcodeTemplate const& right)
 {
-    return left.bars == right.bars;
+    return left.begins == right.begins
+        && left.ends == right.ends
+        && left.multiplicities == right.multiplicities;
 }
 
 bool operator==(BarTemplate const& left, BarTemplate const& right)
@@ -144,84 +259,328 @@ bool operator==(BarTemplate const& left, BarTemplate const& right)
 // NOTE: angle in DEGREES
 std::unique_ptr<Barcode> BarcodeTemplate::rescale(double angle, double offset,
     const std::vector<TemplatePoint>& template_points,
-    const Grades& grades)
-{
-    std::unique_ptr<Barcode> bc = std::unique_ptr<Barcode>(new Barcode());
-
-    std::map<unsigned, unsigned> infinite_bars; //used for combining infinite bars (only necessary for vertical or horizontal lines)
-
-    //loop through bars
-    for (std::set<BarTemplate>::iterator it = this->begin(); it != this->end(); ++it) {
-        assert(it->begin < template_points.size());
-        TemplatePoint begin = template_points[it->begin];
-        double birth = project(begin, angle, offset, grades);
-
-        if (birth != rivet::numeric::INFTY) { //then bar exists in this rescaling
-            if (it->end >= template_points.size()) { //then endpoint is at infinity
-                if (angle == 0 || angle == 90) { //then add bar to the list of infinite bars, since we may need to combine bars
-                    std::map<unsigned, unsigned>::iterator ibit = infinite_bars.find(it->begin);
-                    if (ibit == infinite_bars.end()) { //add a new item
-                        infinite_bars.insert(std::pair<unsigned, unsigned>(it->begin, it->multiplicity));
-                    } else { //increment the multiplicity
-                        ibit->second += it->multiplicity;
-                    }
-                } else { //then add the bar to the barcode -- no combining will be necessary
-                    bc->add_bar(birth, rivet::numeric::INFTY, it->multiplicity);
-                }
-            } else { //then compute endpoint of bar (may still be infinite, but only for for horizontal or vertical lines)
-                assert(it->end < template_points.size());
-                TemplatePoint end = template_points[it->end];
-                double death = project(end, angle, offset, grades);
-                if (death == rivet::numeric::INFTY) { //add bar to the list of infinite bars
-                    std::map<unsigned, unsigned>::iterator ibit = infinite_bars.find(it->begin);
-                    if (ibit == infinite_bars.end()) { //add a new item
-                        infinite_bars.insert(std::pair<unsigned, unsigned>(it->begin, it->multiplicity));
-                    } else { //increment the multiplicity
-                        ibit->second += it->multiplicity;
-                    }
-                } else { //then add (finite) bar to the barcode
-                    bc->add_bar(birth, death, it->multiplicity);
-                }
-            }
-        }
-    }
+    const Grades& grades) const
+{
+    ProjectionLine line(angle, offset);
+    unsigned num_bars = begins.size();
 
-    //if the line is vertical or horizontal, we must now add the vertical bars
-    if (angle == 0 || angle == 90) {
-        for (std::map<unsigned, unsigned>::iterator it = infinite_bars.begin(); it != infinite_bars.end(); ++it) {
-            double birth = project(template_points[it->first], angle, offset, grades);
-            bc->add_bar(birth, rivet::numeric::INFTY, it->second);
+    //gather the coordinates of the endpoints of the bars
+    std::vector<double> begin_x(num_bars), begin_y(num_bars), end_x(num_bars), end_y(num_bars);
+    for (unsigned i = 0; i < num_bars; i++) {
+        assert(begins[i] < template_points.size());
+        const TemplatePoint& begin = template_points[begins[i]];
+        begin_x[i] = grades.x[begin.x];
+        begin_y[i] = grades.y[begin.y];
+
+        if (ends[i] >= template_points.size()) { //then endpoint is at infinity
+            end_x[i] = rivet::numeric::INFTY;
+            end_y[i] = rivet::numeric::INFTY;
+        } else {
+            const TemplatePoint& end = template_points[ends[i]];
+            end_x[i] = grades.x[end.x];
+            end_y[i] = grades.y[end.y];
         }
     }
 
-    return bc;
+    std::vector<double> births(num_bars), deaths(num_bars);
+    std::vector<unsigned> mults(num_bars);
+    rescale_bars(line, begin_x.data(), begin_y.data(), end_x.data(), end_y.data(), births.data(), deaths.data(), mults.data());
+
+    std::vector<MultiBar> bars; //rescaled bars, sorted once when the Barcode is constructed
+    bars.reserve(num_bars);
+    for (unsigned i = 0; i < num_bars; i++) {
+        if (mults[i] > 0)
+            bars.push_back(MultiBar(births[i], deaths[i], mults[i]));
+    }
+    return std::unique_ptr<Barcode>(new Barcode(bars));
 } //end rescale_barcode_template()
 
+//projects the bars of this template onto a line, given the coordinates of their endpoints
+void BarcodeTemplate::rescale_bars(const ProjectionLine& line, const double* begin_x, const double* begin_y,
+    const double* end_x, const double* end_y,
+    double* births, double* deaths, unsigned* mults) const
+{
+    unsigned num_bars = begins.size();
+    line.project(begin_x, begin_y, num_bars, births);
+    line.project(end_x, end_y, num_bars, deaths);
+
+    for (unsigned i = 0; i < num_bars; i++)
+        mults[i] = (births[i] == rivet::numeric::INFTY) ? 0 : multiplicities[i];
+
+    //if the line is vertical or horizontal, the infinite bars that begin at the same point must be combined
+    //  since bars are sorted by begin index, such bars are consecutive; the first of them collects the multiplicity
+    if (line.is_horizontal() || line.is_vertical()) {
+        unsigned first = num_bars; //position of the first infinite bar with the current begin index
+        for (unsigned i = 0; i < num_bars; i++) {
+            if (i > 0 && begins[i] != begins[i - 1])
+                first = num_bars;
+            if (mults[i] == 0 || deaths[i] != rivet::numeric::INFTY)
+                continue;
+            if (first == num_bars) {
+                first = i;
+            } else {
+                mults[first] += mults[i];
+                mults[i] = 0;
+            }
+        }
+    }
+} //end rescale_bars()
+
 //computes the projection of an xi support point onto the specified line
 //  NOTE: returns INFTY if the point has no projection (can happen only for horizontal and vertical lines)
 //  NOTE: angle in DEGREES
-double BarcodeTemplate::project(const TemplatePoint& pt, double angle, double offset, const Grades& grades)
+double BarcodeTemplate::project(const TemplatePoint& pt, double angle, double offset, const Grades& grades) const
 {
-    if (angle == 0) //then line is horizontal
-    {
-        if (grades.y[pt.y] <= offset) //then point is below the line, so projection exists
-            return grades.x[pt.x];
-        else //then no projection
-            return rivet::numeric::INFTY;
-    } else if (angle == 90) //then line is vertical
-    {
-        if (grades.x[pt.x] <= -1 * offset) //then point is left of the line, so projection exists
-            return grades.y[pt.y];
-        else //then no projection
-            return rivet::numeric::INFTY;
+    return ProjectionLine(angle, offset).project(grades.x[pt.x], grades.y[pt.y]);
+} //end project()
+
+//rescales many barcode templates at once, templates[i] along lines[i]
+void BarcodeTemplate::rescale_batch(const std::vector<const BarcodeTemplate*>& templates,
+    const std::vector<ProjectionLine>& lines,
+    const TemplatePointCoords& coords,
+    RescaledBars& out)
+{
+    if (templates.size() != lines.size())
+        throw std::runtime_error("BarcodeTemplate::rescale_batch(): number of templates does not match number of lines");
+
+    //lay out the output arrays
+    out.offsets.resize(templates.size() + 1);
+    out.offsets[0] = 0;
+    unsigned max_bars = 0;
+    for (unsigned i = 0; i < templates.size(); i++) {
+        out.offsets[i + 1] = out.offsets[i] + templates[i]->size();
+        max_bars = std::max(max_bars, templates[i]->size());
     }
-    //if we get here, then line is neither horizontal nor vertical
-    double radians = angle * rivet::numeric::PI / 180;
-    double x = grades.x[pt.x];
-    double y = grades.y[pt.y];
+    unsigned total_bars = out.offsets.back();
+    out.births.resize(total_bars);
+    out.deaths.resize(total_bars);
+    out.multiplicities.resize(total_bars);
+
+    //endpoint coordinates of the bars of one template, reused for every line
+    std::vector<double> begin_x(max_bars), begin_y(max_bars), end_x(max_bars), end_y(max_bars);
+    unsigned infinity = coords.num_points(); //index of the point at infinity
+
+    for (unsigned i = 0; i < templates.size(); i++) {
+        const BarcodeTemplate& bt = *templates[i];
+        for (unsigned j = 0; j < bt.size(); j++) {
+            assert(bt.begins[j] < infinity);
+            unsigned end = std::min(bt.ends[j], infinity);
+            begin_x[j] = coords.x[bt.begins[j]];
+            begin_y[j] = coords.y[bt.begins[j]];
+            end_x[j] = coords.x[end];
+            end_y[j] = coords.y[end];
+        }
 
-    if (y > x * tan(radians) + offset / cos(radians)) //then point is above line
-        return y / sin(radians) - offset / tan(radians); //project right
+        unsigned k = out.offsets[i];
+        bt.rescale_bars(lines[i], begin_x.data(), begin_y.data(), end_x.data(), end_y.data(),
+            &out.births[k], &out.deaths[k], &out.multiplicities[k]);
+    }
+} //end rescale_batch()
 
-    return x / cos(radians) + offset * tan(radians); //project up
+ProjectionLine::ProjectionLine(double angle, double offset)
+    : angle(angle)
+    , offset(offset)
+    , tan_angle(0)
+    , sin_angle(0)
+    , cos_angle(0)
+{
+    if (!is_horizontal() && !is_vertical()) {
+        double radians = angle * rivet::numeric::PI / 180;
+        tan_angle = tan(radians);
+        sin_angle = sin(radians);
+        cos_angle = cos(radians);
+    }
+}
+
+bool ProjectionLine::is_horizontal() const
+{
+    return angle == 0;
+}
+
+bool ProjectionLine::is_vertical() const
+{
+    return angle == 90;
+}
+
+//computes the projection of the point (x,y) onto this line
+double ProjectionLine::project(double x, double y) const
+{
+    double out;
+    project(&x, &y, 1, &out);
+    return out;
+}
+
+//projects n points onto this line
+//  each branch computes both candidate projections and selects one, which keeps the loop bodies free of branches
+void ProjectionLine::project(const double* x, const double* y, unsigned n, double* out) const
+{
+    const double inf = rivet::numeric::INFTY;
+
+    if (is_horizontal()) {
+        //point projects onto the line iff it is below the line
+        for (unsigned i = 0; i < n; i++)
+            out[i] = (y[i] <= offset) ? x[i] : inf;
+    } else if (is_vertical()) {
+        //point projects onto the line iff it is left of the line
+        const double neg_offset = -1 * offset;
+        for (unsigned i = 0; i < n; i++)
+            out[i] = (x[i] <= neg_offset) ? y[i] : inf;
+    } else {
+        const double above = offset / cos_angle; //point is above the line iff y > x * tan + above
+        const double right = offset / tan_angle; //points above the line project right
+        const double up = offset * tan_angle; //points below the line project up
+        for (unsigned i = 0; i < n; i++) {
+            double proj_right = y[i] / sin_angle - right;
+            double proj_up = x[i] / cos_angle + up;
+            out[i] = (y[i] > x[i] * tan_angle + above) ? proj_right : proj_up;
+        }
+    }
 } //end project()
+
+TemplatePointCoords::TemplatePointCoords(const std::vector<TemplatePoint>& template_points, const Grades& grades)
+    : x(template_points.size() + 1)
+    , y(template_points.size() + 1)
+{
+    for (unsigned i = 0; i < template_points.size(); i++) {
+        x[i] = grades.x[template_points[i].x];
+        y[i] = grades.y[template_points[i].y];
+    }
+    x.back() = rivet::numeric::INFTY;
+    y.back() = rivet::numeric::INFTY;
+}
+
+unsigned TemplatePointCoords::num_points() const
+{
+    return x.size() - 1;
+}
+
+unsigned RescaledBars::num_lines() const
+{
+    return offsets.empty() ? 0 : offsets.size() - 1;
+}
+
+//returns the barcode along line i, with its bars sorted
+std::unique_ptr<Barcode> RescaledBars::barcode(unsigned i) const
+{
+    std::vector<MultiBar> bars;
+    bars.reserve(offsets[i + 1] - offsets[i]);
+    for (unsigned k = offsets[i]; k < offsets[i + 1]; k++) {
+        if (multiplicities[k] > 0)
+            bars.push_back(MultiBar(births[k], deaths[k], multiplicities[k]));
+    }
+    return std::unique_ptr<Barcode>(new Barcode(bars));
+}
+
+BarcodeTemplatePool::BarcodeTemplatePool()
+    : templates()
+    , index()
+{
+    intern(BarcodeTemplate());
+}
+
+//returns the index of a template equal to bt, adding a copy of bt to the pool if no such template exists yet
+unsigned BarcodeTemplatePool::intern(const BarcodeTemplate& bt)
+{
+    size_t h = hash(bt);
+
+    //look for an equal template among those with the same hash
+    auto range = index.equal_range(h);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (templates[it->second] == bt)
+            return it->second;
+    }
+
+    //not found, so store a new template
+    unsigned id = templates.size();
+    templates.push_back(bt);
+    index.emplace(h, id);
+    return id;
+} //end intern()
+
+//returns the template with the given index
+const BarcodeTemplate& BarcodeTemplatePool::get(unsigned id) const
+{
+    if (id >= templates.size())
+        throw std::runtime_error("BarcodeTemplatePool: template index out of range");
+    return templates[id];
+}
+
+//returns the number of distinct templates in the pool
+unsigned BarcodeTemplatePool::size() const
+{
+    return templates.size();
+}
+
+//removes all templates except the empty template
+void BarcodeTemplatePool::clear()
+{
+    templates.clear();
+    index.clear();
+    intern(BarcodeTemplate());
+}
+
+size_t BarcodeTemplatePool::hash(const BarcodeTemplate& bt)
+{
+    size_t h = bt.begins.size();
+    for (unsigned i = 0; i < bt.begins.size(); i++) {
+        h ^= std::hash<unsigned>()(bt.begins[i]) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        h ^= std::hash<unsigned>()(bt.ends[i]) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        h ^= std::hash<unsigned>()(bt.multiplicities[i]) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    }
+    return h;
+}
+
+//recomputes index from templates; used after deserialization
+void BarcodeTemplatePool::rebuild_index()
+{
+    index.clear();
+    for (unsigned i = 0; i < templates.size(); i++) {
+        index.emplace(hash(templates[i]), i);
+    }
+    if (templates.empty()) //keep the invariant that index 0 is the empty template
+        intern(BarcodeTemplate());
+}
+
+//returns the bars whose multiplicities differ between from and to, with their multiplicities in to (0 for bars not in to)
+std::vector<BarTemplate> BarcodeTemplatePool::difference(const BarcodeTemplate& from, const BarcodeTemplate& to)
+{
+    std::vector<BarTemplate> delta;
+    unsigned f = 0;
+    unsigned t = 0;
+
+    //merge the two sorted arrays of bars
+    while (f < from.size() || t < to.size()) {
+        if (t == to.size() || (f < from.size() && from.bar(f) < to.bar(t))) { //bar was removed
+            delta.push_back(BarTemplate(from.begins[f], from.ends[f], 0));
+            f++;
+        } else if (f == from.size() || to.bar(t) < from.bar(f)) { //bar was added
+            delta.push_back(to.bar(t));
+            t++;
+        } else { //bar is in both templates
+            if (from.multiplicities[f] != to.multiplicities[t])
+                delta.push_back(to.bar(t));
+            f++;
+            t++;
+        }
+    }
+    return delta;
+} //end difference()
+
+//applies the output of difference() to a barcode template
+void BarcodeTemplatePool::apply_difference(BarcodeTemplate& bt, const std::vector<BarTemplate>& delta)
+{
+    std::vector<BarTemplate> added, removed;
+    for (std::vector<BarTemplate>::const_iterator it = delta.begin(); it != delta.end(); ++it) {
+        unsigned old_mult = bt.multiplicity(it->begin, it->end);
+        if (old_mult > 0)
+            removed.push_back(BarTemplate(it->begin, it->end, old_mult));
+        if (it->multiplicity > 0)
+            added.push_back(*it);
+    }
+    bt.update_bars(added, removed);
+}
+
+bool operator==(BarcodeTemplatePool const& left, BarcodeTemplatePool const& right)
+{
+    return left.templates == right.templates;
+}
@@ -24,20 +24,25 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "barcode.h"
 #include "grades.h"
 #include "math/template_point.h"
+#include <boost/serialization/split_member.hpp>
+#include <cstddef>
+#include <iterator>
 #include <memory>
-#include <set>
+#include <unordered_map>
 #include <vector>
 
 struct BarTemplate {
     unsigned begin; //index of TemplatePointsMatrixEntry of the equivalence class corresponding to the beginning of this bar
     unsigned end; //index of TemplatePointsMatrixEntry of the equivalence class corresponding to the end of this bar
-    mutable unsigned multiplicity; //maybe this is bad style, but multiplicity is not involved in comparisons
+    unsigned multiplicity; //not involved in comparisons
 
     BarTemplate(unsigned a, unsigned b);
     BarTemplate(unsigned a, unsigned b, unsigned m);
     BarTemplate(const BarTemplate& other);
     BarTemplate(); // for serialization
 
+    BarTemplate& operator=(const BarTemplate& other) = default;
+
     bool operator<(const BarTemplate other) const;
 
     template <class Archive>
@@ -48,39 +53,237 @@ struct BarTemplate {
     friend bool operator==(BarTemplate const& left, BarTemplate const& right);
 };
 
+//a line along which barcode templates are rescaled, with its trigonometric quantities computed once
+//  so that many points can be projected onto the line without recomputing them
+//  NOTE: angle in DEGREES
+struct ProjectionLine {
+    double angle; //angle of the line, in DEGREES
+    double offset; //signed distance of the line from the origin
+    double tan_angle, sin_angle, cos_angle; //trigonometric functions of the angle (unused for horizontal and vertical lines)
+
+    ProjectionLine(double angle, double offset);
+
+    bool is_horizontal() const;
+    bool is_vertical() const;
+
+    //computes the projection of the point (x,y) onto this line
+    //  NOTE: returns INFTY if the point has no projection (can happen only for horizontal and vertical lines)
+    double project(double x, double y) const;
+
+    //projects n points onto this line, writing the results to out; same semantics as project()
+    //  the loops are branch-free so that the compiler can vectorize them
+    void project(const double* x, const double* y, unsigned n, double* out) const;
+};
+
+//real coordinates of the template points, stored contiguously for batch projection
+//  an extra point at (INFTY, INFTY) is appended, which stands for the endpoint of every infinite bar
+struct TemplatePointCoords {
+    std::vector<double> x;
+    std::vector<double> y;
+
+    TemplatePointCoords(const std::vector<TemplatePoint>& template_points, const Grades& grades);
+
+    unsigned num_points() const; //returns the number of template points, not counting the point at infinity
+};
+
+//bars of many rescaled barcode templates, stored in preallocated contiguous arrays
+//  the bars for line i occupy positions offsets[i] through offsets[i+1]-1, in the order of the template bars
+//  a bar with multiplicity 0 does not exist along its line; bars are neither sorted nor combined into a Barcode
+//  until barcode() is called, so that callers extracting features need not pay for that
+struct RescaledBars {
+    std::vector<unsigned> offsets;
+    std::vector<double> births;
+    std::vector<double> deaths;
+    std::vector<unsigned> multiplicities;
+
+    unsigned num_lines() const;
+    std::unique_ptr<Barcode> barcode(unsigned i) const; //returns the barcode along line i
+};
+
+//stores the bars of a barcode template in contiguous arrays (one entry per distinct bar), sorted by (begin, end)
 class BarcodeTemplate {
 public:
+    //iterates over the bars in sorted order; dereferencing yields a BarTemplate by value
+    class const_iterator {
+    public:
+        typedef std::input_iterator_tag iterator_category;
+        typedef BarTemplate value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const BarTemplate* pointer;
+        typedef BarTemplate reference;
+
+        const_iterator(const BarcodeTemplate* bt, unsigned i)
+            : bt(bt)
+            , i(i)
+            , cur()
+        {
+        }
+
+        BarTemplate operator*() const { return bt->bar(i); }
+        const BarTemplate* operator->()
+        {
+            cur = bt->bar(i);
+            return &cur;
+        }
+        const_iterator& operator++()
+        {
+            ++i;
+            return *this;
+        }
+        const_iterator operator++(int)
+        {
+            const_iterator temp = *this;
+            ++i;
+            return temp;
+        }
+        bool operator==(const const_iterator& other) const { return i == other.i && bt == other.bt; }
+        bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+    private:
+        const BarcodeTemplate* bt;
+        unsigned i;
+        BarTemplate cur;
+    };
+
     BarcodeTemplate();
+    BarcodeTemplate(std::vector<BarTemplate> bars); //bulk construction: bars need not be sorted, and repeated bars are combined
 
     void add_bar(unsigned a, unsigned b); //adds a bar to the barcode template (updating multiplicity, if necessary)
     void add_bar(unsigned a, unsigned b, unsigned m); //adds a bar with multiplicity to the barcode template
+    void remove_bar(unsigned a, unsigned b); //removes one copy of a bar from the barcode template (updating multiplicity, if necessary)
+
+    //adds and removes many bars in a single pass over the template; neither list needs to be sorted
+    void update_bars(std::vector<BarTemplate> added, std::vector<BarTemplate> removed);
 
-    std::set<BarTemplate>::iterator begin(); //returns an iterator to the first bar in the barcode
-    std::set<BarTemplate>::iterator end(); //returns an iterator to the past-the-end element of the barcode
-    bool is_empty(); //returns true iff this barcode has no bars
+    const_iterator begin() const; //returns an iterator to the first bar in the barcode
+    const_iterator end() const; //returns an iterator to the past-the-end element of the barcode
+    bool is_empty() const; //returns true iff this barcode has no bars
+    unsigned size() const; //returns the number of distinct bars
+    BarTemplate bar(unsigned i) const; //returns the i-th bar in sorted order
+    unsigned multiplicity(unsigned a, unsigned b) const; //returns the multiplicity of the bar (a,b), which is 0 if the bar does not occur
 
     //rescales a barcode template by projecting points onto the specified line
     // NOTE: angle in DEGREES
     std::unique_ptr<Barcode> rescale(double angle, double offset,
         const std::vector<TemplatePoint>& template_points,
-        const Grades& grades);
+        const Grades& grades) const;
 
     //computes the projection of an xi support point onto the specified line
     //  NOTE: returns INFTY if the point has no projection (can happen only for horizontal and vertical lines)
     //  NOTE: angle in DEGREES
-    double project(const TemplatePoint& pt, double angle, double offset, const Grades& grades);
+    double project(const TemplatePoint& pt, double angle, double offset, const Grades& grades) const;
+
+    //rescales many barcode templates at once, templates[i] along lines[i], writing the bars to out
+    //  the arrays in out are only reallocated if they are too small, so out may be reused across calls
+    static void rescale_batch(const std::vector<const BarcodeTemplate*>& templates,
+        const std::vector<ProjectionLine>& lines,
+        const TemplatePointCoords& coords,
+        RescaledBars& out);
 
-    void print(); //for testing only
+    void print() const; //for testing only
 
     template <class Archive>
     void serialize(Archive& ar, const unsigned int /*version*/)
     {
-        ar& bars;
+        ar& begins& ends& multiplicities;
     }
     friend bool operator==(BarcodeTemplate const& left, BarcodeTemplate const& right);
 
 private:
-    std::set<BarTemplate> bars;
+    friend class BarcodeTemplatePool;
+
+    std::vector<unsigned> begins; //begin index of each bar
+    std::vector<unsigned> ends; //end index of each bar
+    std::vector<unsigned> multiplicities; //multiplicity of each bar
+
+    //returns the position of the first bar not less than (a,b)
+    unsigned lower_bound(unsigned a, unsigned b) const;
+
+    //projects the bars of this template onto a line, given the coordinates of their endpoints (INFTY for an infinite endpoint)
+    //  writes one birth, death, and multiplicity per bar; bars that do not exist along the line get multiplicity 0,
+    //  and for horizontal or vertical lines, the infinite bars that begin at the same point are combined
+    void rescale_bars(const ProjectionLine& line, const double* begin_x, const double* begin_y,
+        const double* end_x, const double* end_y,
+        double* births, double* deaths, unsigned* mults) const;
+};
+
+//stores each distinct barcode template exactly once
+//  2-cells of the arrangement refer to their barcode templates by index into this pool, since neighboring cells
+//  frequently have identical templates; index 0 always holds the empty barcode template
+//  templates are interned in path order, so consecutive templates usually differ by few bars; the pool is therefore
+//  serialized as a full snapshot every SNAPSHOT_INTERVAL templates, with only the differences stored in between
+class BarcodeTemplatePool {
+public:
+    BarcodeTemplatePool(); //creates a pool that contains only the empty barcode template
+
+    //returns the index of a template equal to bt, adding a copy of bt to the pool if no such template exists yet
+    unsigned intern(const BarcodeTemplate& bt);
+
+    const BarcodeTemplate& get(unsigned id) const; //returns the template with the given index
+    unsigned size() const; //returns the number of distinct templates in the pool
+    void clear(); //removes all templates except the empty template
+
+    static const unsigned SNAPSHOT_INTERVAL = 64; //number of templates between full snapshots in the serialized pool
+
+    //NOTE: bars are written as plain integers, since the snapshots and differences are temporaries (which must not be tracked by the archive)
+    template <class Archive>
+    void save(Archive& ar, const unsigned int /*version*/) const
+    {
+        unsigned num_templates = templates.size();
+        ar& num_templates;
+        for (unsigned i = 0; i < num_templates; i++) {
+            std::vector<BarTemplate> bars;
+            if (i % SNAPSHOT_INTERVAL == 0)
+                bars.assign(templates[i].begin(), templates[i].end());
+            else
+                bars = difference(templates[i - 1], templates[i]);
+
+            unsigned num_bars = bars.size();
+            ar& num_bars;
+            for (unsigned j = 0; j < num_bars; j++)
+                ar& bars[j].begin& bars[j].end& bars[j].multiplicity;
+        }
+    }
+
+    template <class Archive>
+    void load(Archive& ar, const unsigned int /*version*/)
+    {
+        unsigned num_templates;
+        ar& num_templates;
+        templates.clear();
+        templates.reserve(num_templates);
+        for (unsigned i = 0; i < num_templates; i++) {
+            unsigned num_bars;
+            ar& num_bars;
+            std::vector<BarTemplate> bars(num_bars);
+            for (unsigned j = 0; j < num_bars; j++)
+                ar& bars[j].begin& bars[j].end& bars[j].multiplicity;
+
+            if (i % SNAPSHOT_INTERVAL == 0)
+                templates.push_back(BarcodeTemplate());
+            else
+                templates.push_back(templates.back());
+            apply_difference(templates.back(), bars);
+        }
+        rebuild_index();
+    }
+
+    BOOST_SERIALIZATION_SPLIT_MEMBER()
+
+    friend bool operator==(BarcodeTemplatePool const& left, BarcodeTemplatePool const& right);
+
+private:
+    std::vector<BarcodeTemplate> templates; //distinct templates, in the order they were first interned
+    std::unordered_multimap<size_t, unsigned> index; //maps the hash of a template to its index in templates
+
+    static size_t hash(const BarcodeTemplate& bt);
+    void rebuild_index(); //recomputes index from templates; used after deserialization
+
+    //returns the bars whose multiplicities differ between from and to, with their multiplicities in to (0 for bars not in to)
+    static std::vector<BarTemplate> difference(const BarcodeTemplate& from, const BarcodeTemplate& to);
+
+    //applies the output of difference() to a barcode template
+    static void apply_difference(BarcodeTemplate& bt, const std::vector<BarTemplate>& delta);
 };
 
 #endif // __BARCODE_TEMPLATE_H__
@@ -170,6 +170,7 @@ Debug& operator<<(Debug& qd, const Halfedge& e)
 
 Face::Face(std::shared_ptr<Halfedge> e, unsigned long id)
     : boundary(e)
+    , template_id(0)
     , visited(false)
 , identifier(id)
 {
@@ -177,6 +178,7 @@ Face::Face(std::shared_ptr<Halfedge> e, unsigned long id)
 
 Face::Face()
     : boundary()
+    , template_id(0)
     , visited(false)
 , identifier(-1)
 {
@@ -196,14 +198,14 @@ std::shared_ptr<Halfedge> Face::get_boundary()
     return boundary;
 }
 
-BarcodeTemplate& Face::get_barcode()
+unsigned Face::get_template_id() const
 {
-    return dbc;
+    return template_id;
 }
 
-void Face::set_barcode(const BarcodeTemplate& bt)
+void Face::set_template_id(unsigned id)
 {
-    dbc = bt; ///TODO: is this good design???
+    template_id = id;
 }
 
 bool Face::has_been_visited()
@@ -110,13 +110,13 @@ class Face {
 public:
     Face(std::shared_ptr<Halfedge> e, unsigned long id); //constructor: requires pointer to a boundary halfedge
     Face(); // For serialization
-    ~Face(); //destructor: destroys barcode template
+    ~Face(); //destructor
 
     void set_boundary(std::shared_ptr<Halfedge> e); //set the pointer to a halfedge on the boundary of this face
     std::shared_ptr<Halfedge> get_boundary(); //get the (pointer to the) boundary halfedge
 
-    BarcodeTemplate& get_barcode(); //returns a reference to the barcode template stored in this cell
-    void set_barcode(const BarcodeTemplate& bt); //stores (a copy of) the specified barcode template in this cell
+    unsigned get_template_id() const; //returns the index (in the arrangement's BarcodeTemplatePool) of the barcode template for this cell
+    void set_template_id(unsigned id); //sets the index of the barcode template for this cell
 
     bool has_been_visited(); //true iff cell has been visited in the vineyard-update process (so that we can distinguish a cell with an empty barcode from an unvisited cell)
     void mark_as_visited(); //marks this cell as visited
@@ -130,7 +130,7 @@ public:
 
 private:
     std::shared_ptr<Halfedge> boundary; //pointer to one halfedge in the boundary of this cell
-    BarcodeTemplate dbc; //barcode template stored in this cell
+    unsigned template_id; //index of the barcode template for this cell in the arrangement's BarcodeTemplatePool (0 is the empty template)
     bool visited; //initially false, set to true after this cell has been visited in the vineyard-update process (so that we can distinguish a cell with an empty barcode from an unvisited cell)
     unsigned long identifier; // Arrangement-specific ID for this face
 }; //end class Face
@@ -0,0 +1,262 @@
+/**********************************************************************
+Copyright 2014-2016 The RIVET Developers. See the COPYRIGHT file at
+the top-level directory of this distribution.
+
+This file is part of RIVET.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+
+#include "checkpoint.h"
+
+#include "dcel/arrangement_message.h"
+#include "debug.h"
+#include "math/simplex_tree.h"
+#include "math/template_point.h"
+
+//NOTE: dcel/serialization.h is not included here, since it exports classes and so can only be included once in each program
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/serialization/set.hpp>
+#include <boost/serialization/shared_ptr.hpp>
+#include <boost/serialization/utility.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+//written at the start of every checkpoint file, so that other files are not mistaken for checkpoints
+const std::string MAGIC = "RIVET checkpoint";
+
+//Multigrade is serialized in dcel/serialization.h, which cannot be included here, so a list of them is stored as a flat list of their fields
+void save_grades(boost::archive::binary_oarchive& ar, const std::vector<Multigrade>& grades)
+{
+    std::vector<int> fields;
+    fields.reserve(4 * grades.size());
+    for (const Multigrade& mg : grades) {
+        fields.push_back(mg.x);
+        fields.push_back(mg.y);
+        fields.push_back(mg.num_cols);
+        fields.push_back(mg.simplex_index);
+    }
+    ar << fields;
+}
+
+void load_grades(boost::archive::binary_iarchive& ar, std::vector<Multigrade>& grades)
+{
+    std::vector<int> fields;
+    ar >> fields;
+    if (fields.size() % 4 != 0)
+        throw std::runtime_error("a list of multigrades is malformed");
+    grades.clear();
+    grades.reserve(fields.size() / 4);
+    for (size_t i = 0; i < fields.size(); i += 4)
+        grades.push_back(Multigrade(fields[i], fields[i + 1], fields[i + 2], fields[i + 3]));
+}
+
+//flushes the file with the given name to disk, so that it is complete before it is renamed; returns false if this fails
+bool sync_file(const std::string& name)
+{
+#ifndef _WIN32
+    int fd = open(name.c_str(), O_WRONLY);
+    if (fd == -1)
+        return false;
+    bool synced = (fsync(fd) == 0);
+    return close(fd) == 0 && synced;
+#else
+    (void)name; //the file is flushed when it is closed, which is the best that is portable
+    return true;
+#endif
+}
+
+} //end anonymous namespace
+
+Checkpoint::Checkpoint(const std::string& output_file, int dim, SimplexTree& bifiltration,
+    const std::vector<exact>& x_exact, const std::vector<exact>& y_exact, unsigned interval, unsigned verbosity)
+    : output_file(output_file)
+    , interval(interval)
+    , last_save(std::chrono::steady_clock::now())
+    , verbosity(verbosity)
+{
+    fingerprint.dim = dim;
+    fingerprint.num_simplices = { bifiltration.get_size(dim), bifiltration.get_size(dim + 1) };
+    fingerprint.simplex_hashes = { bifiltration.hash_simplices(dim), bifiltration.hash_simplices(dim + 1) };
+    fingerprint.x_exact = x_exact;
+    fingerprint.y_exact = y_exact;
+}
+
+bool Checkpoint::Fingerprint::operator==(const Fingerprint& other) const
+{
+    return dim == other.dim && num_simplices == other.num_simplices && simplex_hashes == other.simplex_hashes && x_exact == other.x_exact && y_exact == other.y_exact;
+}
+
+void Checkpoint::save_betti(const unsigned_matrix& homology_dimensions, const std::vector<TemplatePoint>& template_points)
+{
+    //the matrix is stored as its shape and its entries, as in dcel/serialization.h
+    std::vector<unsigned> shape(homology_dimensions.shape(), homology_dimensions.shape() + homology_dimensions.num_dimensions());
+    std::vector<unsigned> entries(homology_dimensions.origin(), homology_dimensions.origin() + homology_dimensions.num_elements());
+    save("betti", [&](boost::archive::binary_oarchive& ar) {
+        ar << shape << entries << template_points;
+    });
+}
+
+bool Checkpoint::load_betti(unsigned_matrix& homology_dimensions, std::vector<TemplatePoint>& template_points)
+{
+    std::vector<unsigned> shape, entries;
+    std::vector<TemplatePoint> points;
+    bool loaded = load("betti", [&](boost::archive::binary_iarchive& ar) {
+        ar >> shape >> entries >> points;
+        if (shape.size() != 2 || entries.size() != (size_t)shape[0] * shape[1])
+            throw std::runtime_error("the dimensions of homology are malformed");
+    });
+    if (!loaded)
+        return false;
+
+    homology_dimensions.resize(boost::extents[shape[0]][shape[1]]);
+    std::copy(entries.begin(), entries.end(), homology_dimensions.origin());
+    template_points = points;
+    return true;
+}
+
+void Checkpoint::save_arrangement(const ArrangementMessage& arrangement, const std::vector<unsigned>& path)
+{
+    save("arrangement", [&](boost::archive::binary_oarchive& ar) {
+        ar << arrangement << path;
+    });
+}
+
+bool Checkpoint::load_arrangement(ArrangementMessage& arrangement, std::vector<unsigned>& path)
+{
+    return load("arrangement", [&](boost::archive::binary_iarchive& ar) {
+        ar >> arrangement >> path;
+    });
+}
+
+bool Checkpoint::due() const
+{
+    return std::chrono::steady_clock::now() - last_save >= interval;
+}
+
+void Checkpoint::save_path(const PathCheckpoint& state)
+{
+    save("path", [&](boost::archive::binary_oarchive& ar) {
+        ar << state.step << state.path_length << state.perm_low << state.inv_perm_low << state.perm_high << state.inv_perm_high;
+        ar << static_cast<unsigned>(state.entries.size());
+        for (const PathCheckpoint::EntryState& entry : state.entries) {
+            save_grades(ar, entry.low_simplices);
+            save_grades(ar, entry.high_simplices);
+            ar << entry.low_count << entry.high_count << entry.low_index << entry.high_index;
+        }
+        ar << state.lift_low << state.lift_high << state.visited << state.template_ids << state.templates;
+    });
+}
+
+bool Checkpoint::load_path(PathCheckpoint& state)
+{
+    return load("path", [&](boost::archive::binary_iarchive& ar) {
+        ar >> state.step >> state.path_length >> state.perm_low >> state.inv_perm_low >> state.perm_high >> state.inv_perm_high;
+        unsigned num_entries;
+        ar >> num_entries;
+        state.entries.resize(num_entries);
+        for (PathCheckpoint::EntryState& entry : state.entries) {
+            load_grades(ar, entry.low_simplices);
+            load_grades(ar, entry.high_simplices);
+            ar >> entry.low_count >> entry.high_count >> entry.low_index >> entry.high_index;
+        }
+        ar >> state.lift_low >> state.lift_high >> state.visited >> state.template_ids >> state.templates;
+    });
+}
+
+void Checkpoint::remove(const std::string& output_file)
+{
+    for (const char* stage : { "betti", "arrangement", "path" }) {
+        std::remove(file_name(output_file, stage).c_str());
+    }
+}
+
+template <typename Write>
+void Checkpoint::save(const std::string& stage, Write write)
+{
+    std::string name = file_name(output_file, stage);
+    std::string temp_name = name + ".tmp";
+    bool written;
+    {
+        std::ofstream file(temp_name, std::ios::binary);
+        if (!file.is_open()) {
+            //a run that cannot save a checkpoint can still finish, so this is not an error
+            debug() << "Unable to write checkpoint file:" << temp_name;
+            return;
+        }
+        boost::archive::binary_oarchive ar(file);
+        ar << MAGIC << stage << fingerprint;
+        write(ar);
+        file.flush();
+        written = file.good();
+    }
+    last_save = std::chrono::steady_clock::now();
+    if (!written || !sync_file(temp_name)) {
+        debug() << "Unable to write checkpoint file to disk:" << temp_name;
+        std::remove(temp_name.c_str());
+        return;
+    }
+    if (std::rename(temp_name.c_str(), name.c_str()) != 0) {
+        debug() << "Unable to rename" << temp_name << "to" << name;
+        return;
+    }
+    if (verbosity >= 2) {
+        debug() << "Saved checkpoint:" << name;
+    }
+}
+
+template <typename Read>
+bool Checkpoint::load(const std::string& stage, Read read)
+{
+    std::string name = file_name(output_file, stage);
+    std::ifstream file(name, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    try {
+        boost::archive::binary_iarchive ar(file);
+        std::string magic, file_stage;
+        Fingerprint file_fingerprint;
+        ar >> magic >> file_stage;
+        if (magic != MAGIC || file_stage != stage)
+            throw std::runtime_error("it is not a checkpoint of this stage");
+        ar >> file_fingerprint;
+        if (!(file_fingerprint == fingerprint))
+            throw std::runtime_error("it belongs to a different computation");
+        read(ar);
+    } catch (std::exception& e) {
+        debug() << "Ignoring checkpoint file" << name << "because" << e.what();
+        return false;
+    }
+    if (verbosity >= 2) {
+        debug() << "Resuming from checkpoint:" << name;
+    }
+    return true;
+} //end load()
+
+std::string Checkpoint::file_name(const std::string& output_file, const std::string& stage)
+{
+    return output_file + "." + stage + ".checkpoint";
+}
@@ -0,0 +1,149 @@
+/**********************************************************************
+Copyright 2014-2016 The RIVET Developers. See the COPYRIGHT file at
+the top-level directory of this distribution.
+
+This file is part of RIVET.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+/**
+ * \class	Checkpoint
+ * \brief	Saves the results of the finished stages of a computation next to its output file, so that a run that stops can be resumed
+ *
+ * Each stage has its own file, named by appending a suffix to the output file: the xi support points and the dimensions of homology
+ * found by MultiBetti go to <output_file>.betti.checkpoint, and the anchors, the DCEL and the path through its cells (everything that is
+ * needed before the barcode templates are computed) go to <output_file>.arrangement.checkpoint. While the barcode templates are
+ * computed along the path, the state of the traversal is saved to <output_file>.path.checkpoint, at most once per interval of wall
+ * time. A file is first written under a temporary name and then renamed, so a run that stops while writing leaves the previous
+ * checkpoint intact; it is flushed to disk before it is renamed, so a crash cannot leave a truncated checkpoint under the final name.
+ * Every file records the dimension of homology, the numbers of simplices, a hash of their vertices and grades, and the grades of the
+ * computation, and is ignored if these do not match.
+ */
+
+#ifndef __CHECKPOINT_H__
+#define __CHECKPOINT_H__
+
+//forward declarations
+class ArrangementMessage;
+class SimplexTree;
+class TemplatePoint;
+
+#include "dcel/barcode_template.h"
+#include "math/template_points_matrix.h"
+#include "numerics.h"
+
+#include <boost/multi_array.hpp>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+typedef boost::multi_array<unsigned, 2> unsigned_matrix;
+
+//the state of the traversal of the path through the arrangement by PersistenceUpdater, after some of its steps
+//  the RU-decomposition is not included, since it is computed again from the order on simplices
+struct PathCheckpoint {
+    //the grade lists of an entry of the xi support matrix
+    struct EntryState {
+        std::vector<Multigrade> low_simplices;
+        std::vector<Multigrade> high_simplices;
+        unsigned low_count;
+        unsigned high_count;
+        unsigned low_index;
+        unsigned high_index;
+    };
+
+    unsigned step; //number of steps of the path that have been traversed
+    unsigned path_length; //number of steps in the whole path
+    std::vector<unsigned> perm_low; //order on simplices, as in PersistenceUpdater
+    std::vector<unsigned> inv_perm_low;
+    std::vector<unsigned> perm_high;
+    std::vector<unsigned> inv_perm_high;
+    std::vector<EntryState> entries; //grade lists of the entries of the xi support matrix, by index
+    std::vector<std::pair<unsigned, unsigned>> lift_low; //lift maps, as in PersistenceUpdater
+    std::vector<std::pair<unsigned, unsigned>> lift_high;
+    std::vector<bool> visited; //for each face of the arrangement, whether its barcode template has been stored
+    std::vector<unsigned> template_ids; //for each face of the arrangement, the index of its barcode template in templates
+    BarcodeTemplatePool templates; //the barcode templates stored so far
+};
+
+class Checkpoint {
+public:
+    //checkpoints for the computation of homology of dimension dim from the given bifiltration and grades, whose output goes to output_file
+    //  the state of the traversal of the path is saved at most once every interval seconds
+    Checkpoint(const std::string& output_file, int dim, SimplexTree& bifiltration,
+        const std::vector<exact>& x_exact, const std::vector<exact>& y_exact, unsigned interval, unsigned verbosity);
+
+    //saves the dimensions of homology at each grade and the xi support points
+    void save_betti(const unsigned_matrix& homology_dimensions, const std::vector<TemplatePoint>& template_points);
+
+    //loads the dimensions of homology and the xi support points; returns false if there is no valid checkpoint for them
+    bool load_betti(unsigned_matrix& homology_dimensions, std::vector<TemplatePoint>& template_points);
+
+    //saves the arrangement, before any barcode templates are stored in it, and the path through its cells, given by the indexes of its halfedges
+    void save_arrangement(const ArrangementMessage& arrangement, const std::vector<unsigned>& path);
+
+    //loads the arrangement and the path through its cells; returns false if there is no valid checkpoint for them
+    bool load_arrangement(ArrangementMessage& arrangement, std::vector<unsigned>& path);
+
+    //returns true if the interval given to the constructor has passed since the last checkpoint was saved (or since the constructor)
+    bool due() const;
+
+    //saves the state of the traversal of the path
+    void save_path(const PathCheckpoint& state);
+
+    //loads the state of the traversal of the path; returns false if there is no valid checkpoint for it
+    bool load_path(PathCheckpoint& state);
+
+    //removes the checkpoints for output_file, once that file has been written
+    static void remove(const std::string& output_file);
+
+private:
+    //identifies the computation that a checkpoint belongs to
+    struct Fingerprint {
+        int dim;
+        std::vector<unsigned> num_simplices; //numbers of simplices of dimensions dim and dim+1
+        std::vector<uint64_t> simplex_hashes; //hashes of the vertices and grades of the simplices of dimensions dim and dim+1
+        std::vector<exact> x_exact;
+        std::vector<exact> y_exact;
+
+        template <class Archive>
+        void serialize(Archive& ar, const unsigned int /*version*/)
+        {
+            ar& dim& num_simplices& simplex_hashes& x_exact& y_exact;
+        }
+
+        bool operator==(const Fingerprint& other) const;
+    };
+
+    const std::string output_file;
+    Fingerprint fingerprint;
+    const std::chrono::seconds interval;
+    std::chrono::steady_clock::time_point last_save;
+    const unsigned verbosity;
+
+    //writes the fingerprint to the file for the given stage, then calls write with the archive to write the data of the stage
+    template <typename Write>
+    void save(const std::string& stage, Write write);
+
+    //if the file for the given stage exists and its fingerprint matches, calls read with the archive to read the data of the stage
+    //  returns false if there is no such file, or if it cannot be read
+    template <typename Read>
+    bool load(const std::string& stage, Read read);
+
+    static std::string file_name(const std::string& output_file, const std::string& stage);
+};
+
+#endif // __CHECKPOINT_H__
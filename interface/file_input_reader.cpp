@@ -20,30 +20,208 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "file_input_reader.h"
 
-#include <boost/algorithm/string.hpp>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//true iff the token consists of the characters of the null-terminated string s
+bool TokenView::operator==(const char* s) const
+{
+    return std::strlen(s) == length && std::memcmp(begin, s, length) == 0;
+}
+
+//parses a token that represents an int, such as "-12"
+int parse_int(const TokenView& token)
+{
+    const char* c = token.begin;
+    bool neg = (c != token.end() && *c == '-');
+    if (neg || (c != token.end() && *c == '+'))
+        ++c;
+    if (c == token.end())
+        throw std::runtime_error("'" + token.str() + "' is not an integer");
+
+    long long value = 0;
+    for (; c != token.end(); ++c) {
+        if (*c < '0' || *c > '9')
+            throw std::runtime_error("'" + token.str() + "' is not an integer");
+        value = 10 * value + (*c - '0');
+        if (value > (long long)std::numeric_limits<int>::max() + 1)
+            throw std::runtime_error("'" + token.str() + "' is out of range");
+    }
+    if (neg)
+        value = -value;
+    if (value > std::numeric_limits<int>::max())
+        throw std::runtime_error("'" + token.str() + "' is out of range");
+    return (int)value;
+}
+
+//parses a token that represents a floating-point number, such as "1.5e-3"
+double parse_double(const TokenView& token)
+{
+    //strtod() needs a null-terminated string, and the token is followed by more of the file, so copy it
+    char local[64];
+    std::string long_token;
+    const char* str = local;
+    if (token.length < sizeof(local)) {
+        std::memcpy(local, token.begin, token.length);
+        local[token.length] = '\0';
+    } else {
+        long_token = token.str();
+        str = long_token.c_str();
+    }
+
+    char* end;
+    errno = 0;
+    double value = std::strtod(str, &end);
+    if (token.length == 0 || end != str + token.length || errno == ERANGE)
+        throw std::runtime_error("'" + token.str() + "' is not a number");
+    return value;
+}
+
+//constructor: reads the stream one line at a time
 FileInputReader::FileInputReader(std::ifstream& file)
-    : in(file)
+    : in(&file)
+    , data(nullptr)
+    , data_end(nullptr)
+    , pos(nullptr)
+    , map_size(0)
+    , line_number(0)
+    , next_line_found(false)
+    , next_slot(0)
+    , returned_end(data)
+    , returned_line(0)
+{
+    find_next_line();
+}
+
+//constructor: maps the file into memory
+//  if the file cannot be mapped (e.g. on Windows), its contents are read into a buffer instead
+FileInputReader::FileInputReader(const std::string& file_name)
+    : in(nullptr)
+    , data(nullptr)
+    , data_end(nullptr)
+    , pos(nullptr)
+    , map_size(0)
+    , line_number(0)
+    , next_line_found(false)
+    , next_slot(0)
+    , returned_end(data)
+    , returned_line(0)
+{
+#ifndef _WIN32
+    int fd = open(file_name.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Could not open " + file_name);
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            madvise(mapped, info.st_size, MADV_SEQUENTIAL);
+            data = static_cast<const char*>(mapped);
+            map_size = info.st_size;
+        }
+    }
+    close(fd);
+#endif
+    if (map_size == 0) {
+        std::ifstream file(file_name, std::ios::binary);
+        if (!file.is_open())
+            throw std::runtime_error("Could not open " + file_name);
+        buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        data = buffer.data();
+    }
+    data_end = data + (map_size > 0 ? map_size : buffer.size());
+    pos = data;
+    returned_end = data;
+
+    find_next_line();
+}
+
+//constructor: reads the characters from begin to end, which must outlive the reader
+FileInputReader::FileInputReader(const char* begin, const char* end)
+    : in(nullptr)
+    , data(begin)
+    , data_end(end)
+    , pos(begin)
+    , map_size(0)
     , line_number(0)
     , next_line_found(false)
+    , next_slot(0)
+    , returned_end(data)
+    , returned_line(0)
 {
     find_next_line();
 }
 
-//finds the next line in the file that is not empty and not a comment, if such line exists
-//this is the only function that should call in.readLine()
+FileInputReader::~FileInputReader()
+{
+#ifndef _WIN32
+    if (map_size > 0)
+        munmap(const_cast<char*>(data), map_size);
+#endif
+}
+
+//finds the next line in the file that is not empty and not a comment, if such line exists, and stores its tokens in the next slot
+//this is the only function that should read from the file
 void FileInputReader::find_next_line()
 {
-    std::string line;
-    while (std::getline(in, line)) {
-        line_number++;
-        boost::trim(line);
-        if (line.empty() || line[0] == '#')
-            continue;
-        next_line_tokens.clear();
-        boost::split(next_line_tokens, line, boost::is_space(std::locale()), boost::token_compress_on);
-        next_line_found = true;
-        break;
+    std::vector<TokenView>& tokens = line_tokens[next_slot];
+    if (in) {
+        line_ends[next_slot] = nullptr;
+        std::string& line = line_buffers[next_slot];
+        while (std::getline(*in, line)) {
+            line_number++;
+            split(line.data(), line.data() + line.size(), tokens);
+            if (!tokens.empty()) {
+                next_line_found = true;
+                break;
+            }
+        }
+    } else {
+        while (pos != data_end) {
+            const char* eol = static_cast<const char*>(std::memchr(pos, '\n', data_end - pos));
+            if (eol == nullptr)
+                eol = data_end;
+            line_number++;
+            split(pos, eol, tokens);
+            pos = (eol == data_end) ? eol : eol + 1;
+            line_ends[next_slot] = pos;
+            if (!tokens.empty()) {
+                next_line_found = true;
+                break;
+            }
+        }
+    }
+    line_numbers[next_slot] = line_number;
+}
+
+//splits a line into tokens, dropping white space; returns no tokens for comments
+void FileInputReader::split(const char* begin, const char* end, std::vector<TokenView>& tokens)
+{
+    tokens.clear();
+    const char* c = begin;
+    while (c != end && std::isspace((unsigned char)*c))
+        ++c;
+    if (c == end || *c == '#')
+        return;
+
+    while (c != end) {
+        const char* token = c;
+        while (c != end && !std::isspace((unsigned char)*c))
+            ++c;
+        tokens.push_back(TokenView{ token, std::size_t(c - token) });
+        while (c != end && std::isspace((unsigned char)*c))
+            ++c;
     }
 }
 
@@ -56,11 +234,135 @@ bool FileInputReader::has_next_line()
 //returns the next line as a std::vector<std::string> of tokens
 std::pair<std::vector<std::string>, unsigned> FileInputReader::next_line()
 {
-    std::vector<std::string> current = next_line_tokens;
-    auto num = line_number;
+    unsigned num;
+    const std::vector<TokenView>& tokens = next_line_tokens(num);
+
+    std::vector<std::string> current;
+    current.reserve(tokens.size());
+    for (const TokenView& token : tokens)
+        current.push_back(token.str());
+    return std::make_pair(current, num);
+}
+
+//returns the next line as a vector of tokens, which remain valid until the next call to next_line() or next_line_tokens()
+const std::vector<TokenView>& FileInputReader::next_line_tokens(unsigned& line)
+{
+    if (!next_line_found)
+        throw std::runtime_error("unexpected end of file");
+
+    unsigned current = next_slot;
+    line = line_numbers[current];
+    returned_end = line_ends[current];
+    returned_line = line;
 
     next_line_found = false;
+    next_slot = 1 - current;
     find_next_line();
 
-    return std::make_pair(current, num);
+    return line_tokens[current];
+}
+
+//returns the number of lines read so far, including the next line if there is one
+unsigned FileInputReader::lines_read() const
+{
+    return line_number;
+}
+
+//stores the characters that follow the line returned most recently, and the number of lines before them
+bool FileInputReader::take_remaining_text(const char*& begin, const char*& end, unsigned& lines_before)
+{
+    if (in)
+        return false;
+
+    begin = returned_end;
+    end = data_end;
+    lines_before = returned_line;
+
+    next_line_found = false;
+    pos = data_end;
+    return true;
+}
+
+BinaryInputReader::BinaryInputReader(const char* begin, const char* end)
+    : begin(begin)
+    , pos(begin)
+    , end(end)
+{
+}
+
+//true iff all characters have been read
+bool BinaryInputReader::at_end() const
+{
+    return pos == end;
+}
+
+//returns the number of characters read so far
+std::size_t BinaryInputReader::offset() const
+{
+    return pos - begin;
+}
+
+//returns the characters up to the next newline, without leading and trailing white space
+std::string BinaryInputReader::read_line()
+{
+    const char* eol = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+    if (eol == nullptr)
+        throw std::runtime_error("unexpected end of file");
+    const char* first = pos;
+    const char* last = eol;
+    pos = eol + 1;
+
+    while (first != last && std::isspace((unsigned char)*first))
+        ++first;
+    while (last != first && std::isspace((unsigned char)*(last - 1)))
+        --last;
+    return std::string(first, last);
+}
+
+uint32_t BinaryInputReader::read_uint32()
+{
+    return (uint32_t)read_bytes(4);
+}
+
+uint64_t BinaryInputReader::read_uint64()
+{
+    return read_bytes(8);
+}
+
+int64_t BinaryInputReader::read_int64()
+{
+    uint64_t bits = read_bytes(8);
+    int64_t value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+//reads an IEEE 754 single-precision float
+float BinaryInputReader::read_float()
+{
+    uint32_t bits = (uint32_t)read_bytes(4);
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+//reads an IEEE 754 double
+double BinaryInputReader::read_double()
+{
+    uint64_t bits = read_bytes(8);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+//reads an n-byte little-endian unsigned integer
+uint64_t BinaryInputReader::read_bytes(unsigned n)
+{
+    if ((std::size_t)(end - pos) < n)
+        throw std::runtime_error("unexpected end of file at byte " + std::to_string(offset()));
+    uint64_t value = 0;
+    for (unsigned k = 0; k < n; k++)
+        value |= (uint64_t)(unsigned char)pos[k] << (8 * k);
+    pos += n;
+    return value;
 }
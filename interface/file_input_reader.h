@@ -21,33 +21,116 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
  * \brief	Reads a file, ignoring white space and comments. returns tokens by line or individually.
  * \author	Matthew L. Wright
  * \date	2015
+ *
+ * A reader constructed from a file name maps the whole file into memory, and returns each line as a vector of
+ * TokenViews that point into the mapped file, so that no characters are copied. A reader constructed from a stream
+ * reads the stream one line at a time, and its TokenViews point into a buffer that holds the current line.
+ * next_line() copies the tokens into strings, for code that needs to keep them. A reader can also be constructed
+ * from a range of characters in memory, such as a part of the text of another reader (see take_remaining_text()),
+ * so that parts of a large file can be read in parallel.
  */
 
 #ifndef FILEINPUTREADER_H
 #define FILEINPUTREADER_H
 
+#include <cstddef>
+#include <cstdint>
 #include <fstream>
+#include <iterator>
+#include <string>
 #include <vector>
 
+//a token in a line returned by a FileInputReader, which points to characters stored by the reader
+struct TokenView {
+    const char* begin;
+    std::size_t length;
+
+    const char* end() const { return begin + length; }
+    std::string str() const { return std::string(begin, length); }
+    bool operator==(const char* s) const; //true iff the token consists of the characters of the null-terminated string s
+};
+
+//parse a token in place; these throw std::runtime_error if the token is not a number of the given type
+int parse_int(const TokenView& token);
+double parse_double(const TokenView& token);
+
 class FileInputReader : public std::iterator<std::output_iterator_tag,
                             std::vector<std::string>,
                             std::ptrdiff_t,
                             std::vector<std::string>*,
                             std::vector<std::string>&> {
 public:
-    FileInputReader(std::ifstream& file); //constructor
+    FileInputReader(std::ifstream& file); //constructor: reads the stream one line at a time
+    FileInputReader(const std::string& file_name); //constructor: maps the file into memory
+    FileInputReader(const char* begin, const char* end); //constructor: reads the characters from begin to end, which must outlive the reader
+    ~FileInputReader();
+
+    FileInputReader(const FileInputReader&) = delete;
+    FileInputReader& operator=(const FileInputReader&) = delete;
 
     //true iff the file has another line of printable, non-commented characters
     bool has_next_line();
-    //returns the next line, as a vector of strings, plus the line number at which the line was found
+    //returns the next line, as a vector of strings, plus the line number at which the line was found; throws std::runtime_error if there is no next line
     std::pair<std::vector<std::string>, unsigned> next_line();
+    //returns the next line, as a vector of tokens, and stores the line number at which the line was found in line
+    //  the tokens remain valid until the next call to next_line() or next_line_tokens() (or for the lifetime of the reader, if the file is mapped)
+    const std::vector<TokenView>& next_line_tokens(unsigned& line);
+
+    //returns the number of lines read so far, including the next line if there is one
+    unsigned lines_read() const;
+    //stores the characters that follow the line returned most recently (or all characters, if no line has been returned)
+    //  in [begin, end), and the number of lines before them in lines_before; after this, the reader has no next line
+    //  the characters need not be text, since the reader has looked only at the next line
+    //  returns false (and does nothing) if the reader reads a stream
+    bool take_remaining_text(const char*& begin, const char*& end, unsigned& lines_before);
 
 private:
-    std::ifstream& in;
-    unsigned line_number;
+    std::ifstream* in; //the stream, if the file is not mapped
+    const char* data; //the contents of the file, if it is mapped
+    const char* data_end;
+    const char* pos; //position of the next character to read from data
+    std::size_t map_size; //number of bytes mapped (0 if the contents are in buffer instead)
+    std::string buffer; //the contents of the file, if it could not be mapped
+
+    unsigned line_number; //line number of the last line read
     bool next_line_found;
-    std::vector<std::string> next_line_tokens;
+
+    //the line returned most recently and the next line are stored in alternate slots, so that the tokens of the
+    //  returned line remain valid while the next line is found
+    unsigned next_slot;
+    std::vector<TokenView> line_tokens[2];
+    unsigned line_numbers[2];
+    const char* line_ends[2]; //character after the end of each line, if the text is in memory
+    const char* returned_end; //character after the end of the line returned most recently
+    unsigned returned_line; //line number of the line returned most recently
+    std::string line_buffers[2]; //characters of the lines, if the file is read from a stream
+
     void find_next_line();
+    static void split(const char* begin, const char* end, std::vector<TokenView>& tokens); //splits a line into tokens, dropping white space; returns no tokens for comments
+};
+
+//reads little-endian binary values from a range of characters, such as the part of a file that follows its text header
+//  (see FileInputReader::take_remaining_text()); throws std::runtime_error if the range ends before a value
+class BinaryInputReader {
+public:
+    BinaryInputReader(const char* begin, const char* end); //the characters must outlive the reader
+
+    bool at_end() const; //true iff all characters have been read
+    std::size_t offset() const; //returns the number of characters read so far
+
+    std::string read_line(); //returns the characters up to the next newline, without leading and trailing white space
+    uint32_t read_uint32();
+    uint64_t read_uint64();
+    int64_t read_int64();
+    float read_float(); //reads an IEEE 754 single-precision float
+    double read_double(); //reads an IEEE 754 double
+
+private:
+    const char* begin;
+    const char* pos;
+    const char* end;
+
+    uint64_t read_bytes(unsigned n); //reads an n-byte little-endian unsigned integer
 };
 
 #endif // FILEINPUTREADER_H
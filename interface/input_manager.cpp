@@ -20,16 +20,25 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "input_manager.h"
 #include "../computation.h"
+#include "../math/edge_collapser.h"
+#include "../math/memory_estimate.h"
 #include "../math/simplex_tree.h"
 #include "file_input_reader.h"
 #include "input_parameters.h"
 
 #include "debug.h"
+#include "timer.h"
 
 #include <algorithm>
 #include <boost/algorithm/string.hpp>
+#include <cmath>
+#include <cstring>
+#include <exception>
 #include <set>
 #include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <memory>
 
@@ -54,38 +63,36 @@ std::vector<std::string> split(std::string& str, std::string separators)
     return strings;
 }
 
+//returns the tokens of a FileInputReader one at a time, across lines
+//  each token remains valid until the reader moves to the next line
 class TokenReader {
 public:
     TokenReader(FileInputReader& reader)
         : reader(reader)
-        , tokens()
-        , it(tokens.end())
+        , tokens(nullptr)
+        , next(0)
         , line(0)
     {
     }
     bool has_next_token()
     {
-        if (it != tokens.end()) {
+        if (tokens && next < tokens->size()) {
             return true;
         }
         if (reader.has_next_line()) {
-            auto info = reader.next_line();
-            tokens = info.first;
-            line = info.second;
-            it = tokens.begin();
+            tokens = &reader.next_line_tokens(line);
+            next = 0;
             return true;
         }
         return false;
     }
 
-    std::string next_token()
+    TokenView next_token()
     {
         if (has_next_token()) {
-            auto val = *it;
-            it++;
-            return val;
+            return (*tokens)[next++];
         }
-        return "";
+        return TokenView{ "", 0 };
     }
 
     unsigned line_number() const
@@ -95,11 +102,344 @@ public:
 
 private:
     FileInputReader& reader;
-    std::vector<std::string> tokens;
-    std::vector<std::string>::iterator it;
+    const std::vector<TokenView>* tokens; //tokens of the current line
+    size_t next; //index of the next token in the current line
     unsigned line;
 };
 
+//simplices and grades parsed from a part of a bifiltration file, which are merged into the simplex tree and the ExactSets afterwards
+//  each distinct grade string is converted to an exact value once, and the simplices refer to the grades by their indexes here
+struct BifiltrationChunk {
+    std::vector<int> vertices; //vertices of all simplices, concatenated
+    std::vector<size_t> ends; //simplex i has vertices[ends[i-1]] (or vertices[0]) through vertices[ends[i] - 1]
+    std::vector<unsigned> x_grades; //index in x_values of the x-grade of each simplex
+    std::vector<unsigned> y_grades; //index in y_values of the y-grade of each simplex
+    std::vector<exact> x_values; //distinct x-grades, in order of first appearance
+    std::vector<exact> y_values; //distinct y-grades, in order of first appearance
+    unsigned lines; //number of lines read
+    std::exception_ptr error; //error that stopped parsing, if any
+    unsigned error_line; //line of the error, counted from the start of the chunk
+};
+
+//returns the index of the grade given by token in values, adding it if it has not been seen before
+unsigned find_grade(const TokenView& token, std::unordered_map<std::string, unsigned>& seen, std::vector<exact>& values)
+{
+    auto ret = seen.insert(std::make_pair(token.str(), (unsigned)values.size()));
+    if (ret.second)
+        values.push_back(str_to_exact(token.begin, token.end()));
+    return ret.first->second;
+}
+
+//parses the lines of a bifiltration file that remain in reader, each of which gives the vertices and the grades of a simplex
+void parse_bifiltration_chunk(FileInputReader& reader, BifiltrationChunk& chunk)
+{
+    std::unordered_map<std::string, unsigned> x_seen, y_seen;
+    unsigned line_number = 0;
+    try {
+        while (reader.has_next_line()) {
+            const std::vector<TokenView>& tokens = reader.next_line_tokens(line_number);
+
+            if (tokens.size() < 3) {
+                throw std::runtime_error("a simplex needs at least one vertex and two grades");
+            }
+            if (tokens.size() > std::numeric_limits<unsigned>::max()) {
+                throw std::runtime_error("line longer than " + std::to_string(std::numeric_limits<unsigned>::max()) + " tokens");
+            }
+
+            //read vertices
+            unsigned dim = static_cast<unsigned>(tokens.size() - 3); //-3 because a n-simplex has (n+1) vertices, and the line also contains two grade values
+            for (unsigned i = 0; i <= dim; i++)
+                chunk.vertices.push_back(parse_int(tokens[i]));
+
+            //read multigrade
+            unsigned x = find_grade(tokens[dim + 1], x_seen, chunk.x_values);
+            unsigned y = find_grade(tokens[dim + 2], y_seen, chunk.y_values);
+            chunk.ends.push_back(chunk.vertices.size());
+            chunk.x_grades.push_back(x);
+            chunk.y_grades.push_back(y);
+        }
+    } catch (std::exception& e) {
+        chunk.error = std::current_exception();
+        chunk.error_line = line_number;
+    }
+    chunk.lines = reader.lines_read();
+} //end parse_bifiltration_chunk()
+
+//stores floating-point distances in dist_set, where for_each_distance(f) calls f(index, value) for the entries of the triangle of distances
+//  each distinct value is converted to an exact value by to_exact only once, rather than once per pair of points
+//  values whose exact value is greater than max_dist are omitted, so values above a slightly larger bound are never converted
+//  for_each_distance is called twice: first to find the distinct values, then to store the indexes
+template <typename ForEachDistance, typename ToExact>
+void insert_distances(ForEachDistance for_each_distance, ToExact to_exact, const exact& max_dist, ExactSet& dist_set)
+{
+    double max_double = ExactValue(max_dist).double_value;
+    double bound = max_double + std::abs(max_double) * 1e-5;
+
+    //find the distinct values, removing duplicates whenever the vector has doubled in size
+    std::vector<double> values;
+    size_t next_unique = 1 << 20;
+    auto remove_duplicates = [&]() {
+        std::sort(values.begin(), values.end());
+        values.erase(std::unique(values.begin(), values.end()), values.end());
+        next_unique = std::max(next_unique, 2 * values.size());
+    };
+    for_each_distance([&](unsigned, double value) {
+        if (value <= bound) {
+            values.push_back(value);
+            if (values.size() >= next_unique)
+                remove_duplicates();
+        }
+    });
+    remove_duplicates();
+
+    std::vector<ExactSet::iterator> its(values.size(), dist_set.end()); //the entry of dist_set for each distinct value, or end() if it is too large
+    for (size_t v = 0; v < values.size(); v++) {
+        exact cur_dist = to_exact(values[v]);
+        if (cur_dist <= max_dist) //then this distance is allowed
+            its[v] = dist_set.insert(ExactValue(cur_dist)).first;
+    }
+
+    for_each_distance([&](unsigned index, double value) {
+        if (value <= bound) {
+            ExactSet::iterator it = its[std::lower_bound(values.begin(), values.end(), value) - values.begin()];
+            if (it != dist_set.end())
+                it->indexes.push_back(index);
+        }
+    });
+} //end insert_distances()
+
+//a value whose exact value is computed only when it must be compared exactly with an ExactValue
+//  approx is the value as a double, up to rounding in its last few bits
+template <typename ToExact>
+class LazyValue {
+public:
+    LazyValue(double approx, ToExact to_exact)
+        : approx(approx)
+        , to_exact(to_exact)
+        , computed(false)
+    {
+    }
+
+    const exact& exact_value()
+    {
+        if (!computed) {
+            value = to_exact();
+            computed = true;
+        }
+        return value;
+    }
+
+    //compares this value with other in the same way as ExactValueComparator: returns -1 if it is less, 0 if equal, and 1 if greater
+    int compare(const ExactValue& other)
+    {
+        if (ExactValue::almost_equal(approx, other.double_value)) {
+            const exact& e = exact_value();
+            return (e < other.exact_value) ? -1 : (e == other.exact_value ? 0 : 1);
+        }
+        return (approx < other.double_value) ? -1 : 1;
+    }
+
+    const double approx;
+
+private:
+    ToExact to_exact;
+    bool computed;
+    exact value;
+};
+
+template <typename ToExact>
+LazyValue<ToExact> make_lazy_value(double approx, ToExact to_exact)
+{
+    return LazyValue<ToExact>(approx, to_exact);
+}
+
+//finds the value of a token cheaply, if it is a decimal number with at most 15 digits, so that the value is correctly rounded
+//  returns false for other tokens, which must be converted by str_to_exact()
+bool decimal_approx(const TokenView& token, double& value)
+{
+    static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15 };
+
+    const char* c = token.begin;
+    bool neg = (c != token.end() && *c == '-');
+    if (neg)
+        ++c;
+
+    long long num = 0;
+    unsigned digits = 0;
+    int exp = -1; //number of digits after the decimal point, or -1 if there is no decimal point
+    for (; c != token.end(); ++c) {
+        if (*c >= '0' && *c <= '9') {
+            num = 10 * num + (*c - '0');
+            digits++;
+            if (exp >= 0)
+                exp++;
+        } else if (*c == '.' && exp < 0) {
+            exp = 0;
+        } else {
+            return false;
+        }
+    }
+    if (digits == 0 || digits > 15)
+        return false;
+
+    value = (exp > 0) ? (double)num / powers[exp] : (double)num;
+    if (neg)
+        value = -value;
+    return true;
+} //end decimal_approx()
+
+//chooses bins of consecutive values that hold about equal numbers of indexes, so that the grades are quantiles of the values
+//  returns the largest value in each bin; there may be fewer than num_bins bins if some values have many indexes
+std::vector<ExactSet::iterator> quantile_bins(ExactSet& value_set, unsigned num_bins)
+{
+    uint64_t total = 0;
+    for (ExactSet::iterator it = value_set.begin(); it != value_set.end(); ++it)
+        total += it->indexes.size();
+
+    //bin c closes once the values so far hold at least (c + 1) / num_bins of the indexes
+    std::vector<ExactSet::iterator> last;
+    uint64_t count = 0;
+    unsigned closed = 0; //number of quantiles reached so far
+    for (ExactSet::iterator it = value_set.begin(); it != value_set.end(); ++it) {
+        count += it->indexes.size();
+        bool reached = false;
+        while (closed < num_bins && count * num_bins >= total * (closed + 1)) {
+            closed++;
+            reached = true;
+        }
+        if (reached || std::next(it) == value_set.end())
+            last.push_back(it);
+    }
+    return last;
+} //end quantile_bins()
+
+//chooses bins of consecutive values whose widths are at most a bound, which is as small as possible for there to be at most num_bins bins
+//  each bin starts at the smallest value not in an earlier bin, so the grade of a bin, its largest value, exceeds the values in it by at most the bound
+//  returns the largest value in each bin
+//  NOTE: the target is the number of bins, not a number of anchors, since the anchors depend on the xi support points, which are
+//    only found from the binned grades; the size of the arrangement is bounded instead by coarsening the bins to fit --memory-limit
+std::vector<ExactSet::iterator> adaptive_bins(ExactSet& value_set, unsigned num_bins)
+{
+    //finds the bins for a bound, stopping once there are more than num_bins of them
+    std::vector<ExactSet::iterator> last;
+    auto find_bins = [&](double bound) {
+        last.clear();
+        ExactSet::iterator start = value_set.begin();
+        for (ExactSet::iterator it = value_set.begin(); it != value_set.end(); ++it) {
+            if (it->double_value - start->double_value > bound) {
+                if (last.size() == num_bins)
+                    return false;
+                last.push_back(std::prev(it));
+                start = it;
+            }
+        }
+        last.push_back(std::prev(value_set.end()));
+        return last.size() <= num_bins;
+    };
+
+    //bisect between a bound that gives too many bins and one that gives few enough
+    double low = 0;
+    double high = value_set.rbegin()->double_value - value_set.begin()->double_value;
+    for (int step = 0; step < 64 && low < high; step++) {
+        double mid = low + (high - low) / 2;
+        if (mid <= low || mid >= high)
+            break;
+        if (find_bins(mid))
+            high = mid;
+        else
+            low = mid;
+    }
+    find_bins(high);
+    return last;
+} //end adaptive_bins()
+
+//the differences between the grades of bins and the values in them, which measure the error that binning introduces
+struct BinningError {
+    double max = 0; //largest difference
+    double total = 0; //sum of the differences, over all indexes
+    uint64_t count = 0; //number of indexes
+
+    void add(double error, uint64_t weight)
+    {
+        max = std::max(max, error);
+        total += error * weight;
+        count += weight;
+    }
+};
+
+//prints the error that binning the grades on the given axis introduces
+void report_binning_error(char axis, const std::string& binning, size_t num_bins, const BinningError& error)
+{
+    debug() << "  " + std::string(1, axis) + "-grades:" << binning << "binning into" << num_bins << "bins moves values up by at most"
+            << error.max << "and by" << (error.count > 0 ? error.total / error.count : 0) << "on average";
+}
+
+//merges pairs of consecutive grades, so that each pair gets the larger grade, and updates the discrete indexes to match
+//  this halves the number of grades; if the grades are uniform bins, then so are the merged ones
+void merge_grade_pairs(std::vector<exact>& grades, std::vector<unsigned>& indexes)
+{
+    std::vector<exact> merged;
+    for (size_t c = 0; c < grades.size(); c += 2)
+        merged.push_back(grades[std::min(c + 1, grades.size() - 1)]);
+    grades.swap(merged);
+
+    for (unsigned& index : indexes)
+        if (index != std::numeric_limits<unsigned>::max())
+            index /= 2;
+}
+
+//discretizes distances into num_bins equally spaced bins in the same way as build_grade_vectors(), but without storing the distinct distances
+//  for_each_distance(f) calls f(index, value) for the entries of the triangle of distances, where value is a LazyValue, and it is called twice:
+//  first to find the smallest and largest distances that are at most max_dist, then to store the bin of each such distance in dist_indexes
+//  returns false, having stored nothing, if there might be at most num_bins distinct distances (including 0), in which case bins are not used
+//  the differences between the grades of the bins and the distances in them are added to error
+template <typename ForEachDistance>
+bool bin_distances(ForEachDistance for_each_distance, const exact& max_dist, unsigned num_bins, std::vector<unsigned>& dist_indexes, std::vector<exact>& grades_exact, BinningError& error)
+{
+    const ExactValue max_value(max_dist);
+    ExactValue low((exact(0))), high((exact(0))); //smallest and largest allowed distances, where the distance from a point to itself is zero
+    std::unordered_set<double> distinct = { 0.0 }; //distinct values, as doubles, until there are more than num_bins of them
+
+    for_each_distance([&](unsigned, auto& value) {
+        if (value.compare(max_value) > 0) //then this distance is not allowed
+            return;
+        if (distinct.size() <= num_bins)
+            distinct.insert(value.approx);
+        if (value.compare(low) < 0)
+            low = ExactValue(value.exact_value());
+        else if (value.compare(high) > 0)
+            high = ExactValue(value.exact_value());
+    });
+    if (distinct.size() <= num_bins)
+        return false;
+
+    //bin c holds the distances greater than the right endpoint of bin c-1, up to low + (c + 1) * bin_size
+    exact bin_size = (high.exact_value - low.exact_value) / num_bins;
+    std::vector<ExactValue> bins;
+    bins.reserve(num_bins);
+    for (unsigned c = 0; c < num_bins; c++) {
+        bins.push_back(ExactValue(static_cast<exact>(low.exact_value + (c + 1) * bin_size)));
+        grades_exact.push_back(bins.back().exact_value);
+    }
+
+    for_each_distance([&](unsigned index, auto& value) {
+        if (value.compare(max_value) > 0)
+            return;
+        //find the first bin whose right endpoint is at least the value
+        unsigned first = 0, last = num_bins - 1;
+        while (first < last) {
+            unsigned mid = (first + last) / 2;
+            if (value.compare(bins[mid]) <= 0)
+                last = mid;
+            else
+                first = mid + 1;
+        }
+        dist_indexes[index] = first;
+        error.add(bins[first].double_value - value.approx, 1);
+    });
+    return true;
+} //end bin_distances()
+
 //==================== InputManager class ====================
 using namespace rivet::numeric;
 
@@ -113,8 +453,14 @@ InputManager::InputManager(InputParameters& params)
 
     register_file_type(FileType{ "metric", "metric data", true,
         std::bind(&InputManager::read_discrete_metric_space, this, std::placeholders::_1, std::placeholders::_2) });
+    register_file_type(FileType{ "binary_points", "binary point-cloud data", true,
+        std::bind(&InputManager::read_binary_point_cloud, this, std::placeholders::_1, std::placeholders::_2) });
+    register_file_type(FileType{ "binary_metric", "binary metric data", true,
+        std::bind(&InputManager::read_binary_metric_space, this, std::placeholders::_1, std::placeholders::_2) });
     register_file_type(FileType{ "bifiltration", "bifiltration data", true,
         std::bind(&InputManager::read_bifiltration, this, std::placeholders::_1, std::placeholders::_2) });
+    register_file_type(FileType{ "binary_bifiltration", "binary bifiltration data", true,
+        std::bind(&InputManager::read_binary_bifiltration, this, std::placeholders::_1, std::placeholders::_2) });
     //    register_file_type(FileType {"RIVET_0", "pre-computed RIVET data", false,
     //                                 std::bind(&InputManager::read_RIVET_data, this, std::placeholders::_1, std::placeholders::_2) });
 }
@@ -154,11 +500,8 @@ std::unique_ptr<InputData> InputManager::start(Progress& progress)
         debug() << "READING FILE:" << input_params.fileName;
     }
     auto file_type = get_file_type(input_params.fileName);
-    std::ifstream infile(input_params.fileName); //input file
-    if (!infile.is_open()) {
-        throw std::runtime_error("Could not open input file.");
-    }
-    auto data = file_type.parser(infile, progress);
+    FileInputReader reader(input_params.fileName); //maps the input file into memory
+    auto data = file_type.parser(reader, progress);
     data->file_type = file_type;
     data->is_data = file_type.is_data;
     return data;
@@ -172,10 +515,9 @@ InputError::InputError(unsigned line, std::string message)
 //reads a point cloud
 //  points are given by coordinates in Euclidean space, and each point has a "birth time"
 //  constructs a simplex tree representing the bifiltered Vietoris-Rips complex
-std::unique_ptr<InputData> InputManager::read_point_cloud(std::ifstream& stream, Progress& progress)
+std::unique_ptr<InputData> InputManager::read_point_cloud(FileInputReader& reader, Progress& progress)
 {
     //TODO : switch to YAML or JSON input or switch to proper parser generator or combinators
-    FileInputReader reader(stream);
     auto data = std::make_unique<InputData>();
     if (verbosity >= 6) {
         debug() << "InputManager: Found a point cloud file.";
@@ -234,15 +576,14 @@ std::unique_ptr<InputData> InputManager::read_point_cloud(std::ifstream& stream,
         data->y_label = "distance";
 
         while (reader.has_next_line()) {
-            line_info = reader.next_line();
-            std::vector<std::string> tokens = line_info.first;
+            const std::vector<TokenView>& tokens = reader.next_line_tokens(line_info.second);
             if (tokens.size() != dimension + 1) {
                 std::stringstream ss;
                 ss << "invalid line (should be " << dimension + 1 << " tokens but was " << tokens.size() << ")"
                    << std::endl;
                 ss << "[";
                 for (auto t : tokens) {
-                    ss << t << " ";
+                    ss << t.str() << " ";
                 }
                 ss << "]" << std::endl;
 
@@ -262,91 +603,12 @@ std::unique_ptr<InputData> InputManager::read_point_cloud(std::ifstream& stream,
         throw std::runtime_error("No points loaded.");
     }
 
-    // STEP 2: compute distance matrix, and create ordered lists of all unique distance and time values
-
-    if (verbosity >= 4) {
-        debug() << "  Building lists of grade values.";
-    }
     progress.advanceProgressStage();
 
-    unsigned num_points = points.size();
-
-    ExactSet dist_set; //stores all unique distance values
-    ExactSet time_set; //stores all unique time values
-    std::pair<ExactSet::iterator, bool> ret; //for return value upon insert()
-
-    dist_set.insert(ExactValue(exact(0))); //distance from a point to itself is always zero
-
-    //consider all points
-    for (unsigned i = 0; i < num_points; i++) {
-        //store time value, if it doesn't exist already
-        ret = time_set.insert(ExactValue(points[i].birth));
-
-        //remember that point i has this birth time value
-        (ret.first)->indexes.push_back(i);
-
-        //compute (approximate) distances from this point to all following points
-        for (unsigned j = i + 1; j < num_points; j++) {
-            //compute (approximate) distance squared between points[i] and points[j]
-            double fp_dist_squared = 0;
-            for (unsigned k = 0; k < dimension; k++) {
-                double kth_dist = points[i].coords[k] - points[j].coords[k];
-                fp_dist_squared += (kth_dist * kth_dist);
-            }
-
-            //find an approximate square root of fp_dist_squared, and store it as an exact value
-            exact cur_dist(0);
-            if (fp_dist_squared > 0)
-                cur_dist = approx(sqrt(fp_dist_squared)); //OK for now...
-
-            if (cur_dist <= max_dist) //then this distance is allowed
-            {
-                //store distance value, if it doesn't exist already
-                ret = dist_set.insert(ExactValue(cur_dist));
-
-                //remember that the pair of points (i,j) has this distance value, which will go in entry j(j-1)/2 + i
-                (ret.first)->indexes.push_back((j * (j - 1)) / 2 + i);
-            }
-        }
-    } //end for
-
-    // STEP 3: build vectors of discrete indexes for constructing the bifiltration
-
-    unsigned max_unsigned = std::numeric_limits<unsigned>::max();
-
-    //first, times
-
-    //vector of discrete time indexes for each point; max_unsigned shall represent undefined time (is this reasonable?)
-    std::vector<unsigned> time_indexes(num_points, max_unsigned);
-    build_grade_vectors(*data, time_set, time_indexes, data->x_exact, input_params.x_bins);
-
-    //second, distances
-
-    //discrete distance matrix (triangle); max_unsigned shall represent undefined distance
-    std::vector<unsigned> dist_indexes((num_points * (num_points - 1)) / 2, max_unsigned);
-    build_grade_vectors(*data, dist_set, dist_indexes, data->y_exact, input_params.y_bins);
-
-    //update progress
-    progress.progress(30);
-
-    // STEP 4: build the bifiltration
-
-    //simplex_tree stores only DISCRETE information!
-    //this only requires (suppose there are k points):
-    //  1. a list of k discrete times
-    //  2. a list of k(k-1)/2 discrete distances
-    //  3. max dimension of simplices to construct, which is one more than the dimension of homology to be computed
+    // STEPS 2-4: compute the distances, and build the bifiltration
+    build_point_cloud_bifiltration(*data, points, dimension, max_dist, progress);
 
-    if (verbosity >= 4) {
-        debug() << "  Building Vietoris-Rips bifiltration.";
-        debug() << "     x-grades: " << data->x_exact.size();
-        debug() << "     y-grades: " << data->y_exact.size();
-    }
-
-    data->simplex_tree.reset(new SimplexTree(input_params.dim, input_params.verbosity));
-    data->simplex_tree->build_VR_complex(time_indexes, dist_indexes, data->x_exact.size(), data->y_exact.size());
-
-    if (verbosity >= 8) {
+    if (verbosity >= 8 && data->simplex_tree) { //there is no simplex tree if only the projection was wanted
         data->simplex_tree->print_bifiltration();
     }
 
@@ -354,17 +616,18 @@ std::unique_ptr<InputData> InputManager::read_point_cloud(std::ifstream& stream,
 } //end read_point_cloud()
 
 //reads data representing a discrete metric space with a real-valued function and constructs a simplex tree
-std::unique_ptr<InputData> InputManager::read_discrete_metric_space(std::ifstream& stream, Progress& progress)
+std::unique_ptr<InputData> InputManager::read_discrete_metric_space(FileInputReader& reader, Progress& progress)
 {
     if (verbosity >= 2) {
         debug() << "InputManager: Found a discrete metric space file.";
     }
     std::unique_ptr<InputData> data(new InputData);
-    FileInputReader reader(stream);
 
     //prepare data structures
     ExactSet value_set; //stores all unique values of the function; must DELETE all elements later
-    ExactSet dist_set; //stores all unique values of the distance metric; must DELETE all elements later
+    ExactSet dist_set; //stores all unique values of the distance metric, unless they are binned as they are read
+    std::vector<unsigned> dist_indexes; //discrete distance matrix (triangle); max_unsigned shall represent undefined distance
+    bool binned = false; //true iff the distances have been binned as they were read
     unsigned num_points;
 
     // STEP 1: read data file and store exact (rational) values of the function for each point
@@ -377,13 +640,12 @@ std::unique_ptr<InputData> InputManager::read_discrete_metric_space(std::ifstrea
         data->x_label = line_info.first[0];
 
         //now read the values
-        line_info = reader.next_line();
-        std::vector<std::string> line = line_info.first;
+        const std::vector<TokenView>& line = reader.next_line_tokens(line_info.second);
         std::vector<exact> values;
         values.reserve(line.size());
 
         for (size_t i = 0; i < line.size(); i++) {
-            values.push_back(str_to_exact(line.at(i)));
+            values.push_back(str_to_exact(line[i].begin, line[i].end()));
         }
 
         // STEP 2: read data file and store exact (rational) values for all distances
@@ -402,23 +664,19 @@ std::unique_ptr<InputData> InputManager::read_discrete_metric_space(std::ifstrea
             debug() << "  Maximum distance of edges in Vietoris-Rips complex:" << oss.str();
         }
 
-        std::pair<ExactSet::iterator, bool> ret; //for return value upon insert()
-
-        dist_set.insert(ExactValue(exact(0))); //distance from a point to itself is always zero
-
         //consider all points
         num_points = values.size();
         for (unsigned i = 0; i < num_points; i++) {
-            //store value, if it doesn't exist already
-            ret = value_set.insert(ExactValue(values[i]));
-
-            //remember that point i has this value
-            (ret.first)->indexes.push_back(i);
+            //store value, if it doesn't exist already, and remember that point i has this value
+            value_set.insert(ExactValue(values[i])).first->indexes.push_back(i);
+        }
 
-            //read distances from this point to all following points
-            if (i < num_points - 1) //then there is at least one point after point i, and there should be another line to read
-            {
-                TokenReader tokens(reader);
+        //reads the distances from lines, in which the distances from each point to all following points begin on a new line
+        //  f(index, value) is called for each distance, where index is the entry of the triangle of distances for the pair of points,
+        //  and value is a LazyValue that converts the token to an exact value only when it is needed
+        auto for_each_distance = [&](FileInputReader& lines, unsigned lines_before, auto f) {
+            for (unsigned i = 0; i + 1 < num_points; i++) {
+                TokenReader tokens(lines);
                 try {
                     for (unsigned j = i + 1; j < num_points; j++) {
                         //read distance between points i and j
@@ -426,25 +684,50 @@ std::unique_ptr<InputData> InputManager::read_discrete_metric_space(std::ifstrea
                             throw std::runtime_error("no distance between points " + std::to_string(i)
                                 + "and" + std::to_string(j));
 
-                        std::string str = tokens.next_token();
-
-                        exact cur_dist = str_to_exact(str);
-
-                        if (cur_dist <= max_dist) //then this distance is allowed
-                        {
-                            //store distance value, if it doesn't exist already
-                            ret = dist_set.insert(ExactValue(cur_dist));
+                        TokenView str = tokens.next_token();
+                        auto to_exact = [str]() { return str_to_exact(str.begin, str.end()); };
+                        double approx;
+                        if (!decimal_approx(str, approx))
+                            approx = ExactValue(to_exact()).double_value;
+                        auto value = make_lazy_value(approx, to_exact);
 
-                            //remember that the pair of points (i,j) has this distance value, which will go in entry j(j-1)/2 + i
-                            (ret.first)->indexes.push_back((j * (j - 1)) / 2 + i);
-                        }
+                        //the pair of points (i,j) goes in entry j(j-1)/2 + i
+                        f((unsigned)(((uint64_t)j * (j - 1)) / 2 + i), value);
                     }
                 } catch (std::exception& e) {
-                    throw InputError(tokens.line_number(), e.what());
+                    throw InputError(lines_before + tokens.line_number(), e.what());
                 }
             }
-        } //end for
+        };
 
+        //stores a distance in dist_set if it is allowed, remembering the pair of points at this distance
+        auto store_distance = [&](unsigned index, auto& value) {
+            const exact& cur_dist = value.exact_value();
+            if (cur_dist <= max_dist) //then this distance is allowed
+                dist_set.insert(ExactValue(cur_dist)).first->indexes.push_back(index);
+        };
+
+        dist_set.insert(ExactValue(exact(0))); //distance from a point to itself is always zero
+        dist_indexes.assign(((size_t)num_points * (num_points - 1)) / 2, std::numeric_limits<unsigned>::max());
+
+        //if the distances are to be binned, then read them twice, first for their range and then for their bins, rather than storing every distinct distance
+        const char* begin;
+        const char* end;
+        unsigned lines_before;
+        if (input_params.y_bins > 0 && input_params.y_binning == "uniform" && reader.take_remaining_text(begin, end, lines_before)) {
+            auto read_distances = [&](auto f) {
+                FileInputReader lines(begin, end);
+                for_each_distance(lines, lines_before, f);
+            };
+            BinningError error;
+            binned = bin_distances(read_distances, max_dist, input_params.y_bins, dist_indexes, data->y_exact, error);
+            if (binned && verbosity >= 2)
+                report_binning_error('y', input_params.y_binning, data->y_exact.size(), error);
+            if (!binned)
+                read_distances(store_distance);
+        } else {
+            for_each_distance(reader, 0, store_distance);
+        }
     } catch (InputError& e) {
         throw;
     } catch (std::exception& e) {
@@ -452,41 +735,253 @@ std::unique_ptr<InputData> InputManager::read_discrete_metric_space(std::ifstrea
     }
     progress.advanceProgressStage(); //advance progress box to stage 2: building bifiltration
 
-    // STEP 3: build vectors of discrete indexes for constructing the bifiltration
+    // STEPS 3-4: build the bifiltration
+    if (!binned)
+        build_grade_vectors(dist_set, dist_indexes, data->y_exact, 'y');
+    build_VR_bifiltration(*data, value_set, dist_indexes, num_points, progress);
 
-    unsigned max_unsigned = std::numeric_limits<unsigned>::max();
+    return data;
+} //end read_discrete_metric_space()
 
-    //first, values
-    std::vector<unsigned> value_indexes(num_points, max_unsigned); //vector of discrete value indexes for each point; max_unsigned shall represent undefined value (is this reasonable?)
-    build_grade_vectors(*data, value_set, value_indexes, data->x_exact, input_params.x_bins);
+//reads a point cloud in binary form and constructs a simplex tree representing the bifiltered Vietoris-Rips complex
+//  the file begins with three lines of text: "binary_points", the maximum distance for edges, and the label for the x-axis
+//  the rest of the file is binary, with all values little-endian:
+//    uint32 version, which is 1
+//    uint32 dimension d of the points (at least 1)
+//    uint64 number n of points (at least 1)
+//    the coordinates of the points, as n * d IEEE 754 doubles, with the coordinates of each point consecutive
+//    the birth times of the points, as n doubles
+//  the birth times are converted to exact values without rounding, and the distances are approximated as for a text point cloud
+std::unique_ptr<InputData> InputManager::read_binary_point_cloud(FileInputReader& reader, Progress& progress)
+{
+    auto data = std::make_unique<InputData>();
+    if (verbosity >= 6) {
+        debug() << "InputManager: Found a binary point cloud file.";
+    }
 
-    //second, distances
-    std::vector<unsigned> dist_indexes((num_points * (num_points - 1)) / 2, max_unsigned); //discrete distance matrix (triangle); max_unsigned shall represent undefined distance
-    build_grade_vectors(*data, dist_set, dist_indexes, data->y_exact, input_params.y_bins);
+    //the reader has returned no lines yet, so the remaining text is the whole file
+    const char* begin;
+    const char* end;
+    unsigned lines_before;
+    if (!reader.take_remaining_text(begin, end, lines_before))
+        throw std::runtime_error("A binary point cloud must be read from a file");
+    BinaryInputReader in(begin, end);
 
-    //update progress
-    progress.progress(30);
+    unsigned dimension;
+    exact max_dist;
+    std::vector<DataPoint> points;
+    try {
+        in.read_line(); //file type
+        max_dist = str_to_exact(in.read_line());
+        if (max_dist <= 0)
+            throw std::runtime_error("An invalid input was received for the max distance.");
+        data->x_label = in.read_line();
+        data->y_label = "distance";
 
-    // STEP 4: build the bifiltration
+        uint32_t version = in.read_uint32();
+        if (version != 1)
+            throw std::runtime_error("unsupported version " + std::to_string(version));
+        dimension = in.read_uint32();
+        if (dimension < 1)
+            throw std::runtime_error("Dimension of data must be at least 1");
+        uint64_t num_points = in.read_uint64();
+        if (num_points < 1)
+            throw std::runtime_error("No points loaded.");
+        if (num_points > (uint64_t)(end - begin - in.offset()) / (8 * ((uint64_t)dimension + 1)))
+            throw std::runtime_error("the file is too short for " + std::to_string(num_points) + " points");
+        if (num_points * (num_points - 1) / 2 > std::numeric_limits<unsigned>::max())
+            throw std::runtime_error("too many points");
 
+        if (verbosity >= 4) {
+            std::ostringstream oss;
+            oss << max_dist;
+            debug() << "  Point cloud lives in dimension:" << dimension;
+            debug() << "  Maximum distance of edges in Vietoris-Rips complex:" << oss.str();
+        }
+
+        std::vector<std::vector<double>> coords(num_points, std::vector<double>(dimension));
+        for (uint64_t i = 0; i < num_points; i++)
+            for (unsigned k = 0; k < dimension; k++)
+                coords[i][k] = in.read_double();
+
+        points.reserve(num_points);
+        for (uint64_t i = 0; i < num_points; i++) {
+            double birth = in.read_double();
+            if (!std::isfinite(birth))
+                throw std::runtime_error("birth time of point " + std::to_string(i) + " is not a finite number");
+            points.push_back(DataPoint(std::move(coords[i]), exact(birth)));
+        }
+        if (!in.at_end())
+            throw std::runtime_error("unexpected data after the last point");
+    } catch (std::exception& e) {
+        throw std::runtime_error("byte " + std::to_string(in.offset()) + ": " + e.what());
+    }
     if (verbosity >= 4) {
-        debug() << "  Building Vietoris-Rips bifiltration.";
-        debug() << "     x-grades: " << data->x_exact.size();
-        debug() << "     y-grades: " << data->y_exact.size();
+        debug() << "  Finished reading" << points.size() << "points. Input finished.";
     }
 
-    //build the Vietoris-Rips bifiltration from the discrete index vectors
-    data->simplex_tree.reset(new SimplexTree(input_params.dim, input_params.verbosity));
-    data->simplex_tree->build_VR_complex(value_indexes, dist_indexes, data->x_exact.size(), data->y_exact.size());
+    progress.advanceProgressStage();
+
+    // STEPS 2-4: compute the distances, and build the bifiltration
+    build_point_cloud_bifiltration(*data, points, dimension, max_dist, progress);
+
+    if (verbosity >= 8 && data->simplex_tree) { //there is no simplex tree if only the projection was wanted
+        data->simplex_tree->print_bifiltration();
+    }
 
     return data;
-} //end read_discrete_metric_space()
+} //end read_binary_point_cloud()
+
+//reads a discrete metric space in binary form, with a real-valued function, and constructs a simplex tree
+//  the file begins with four lines of text: "binary_metric", the label for the x-axis, the label for the y-axis, and the maximum distance for edges
+//  the rest of the file is binary, with all values little-endian:
+//    uint32 version, which is 1
+//    uint32 distance format: 0 or 1 for a condensed distance matrix of IEEE 754 floats or doubles,
+//      2 or 3 for an edge list with float or double distances
+//    uint64 number n of points (at least 1)
+//    the values of the function at the points, as n doubles
+//    for a condensed distance matrix, the n(n-1)/2 distances d(i,j) with i < j, in the order d(0,1), d(0,2), ..., d(0,n-1), d(1,2), ...
+//    for an edge list, a uint64 number of edges, then the edges, each given by two different uint32 points and the distance between them
+//  points that are not joined in the edge list, or whose distance is greater than the maximum distance, are not joined by edges
+//  all values are converted to exact values without rounding; the distances are read where they lie in the mapped file, twice
+std::unique_ptr<InputData> InputManager::read_binary_metric_space(FileInputReader& reader, Progress& progress)
+{
+    std::unique_ptr<InputData> data(new InputData);
+    if (verbosity >= 2) {
+        debug() << "InputManager: Found a binary discrete metric space file.";
+    }
+
+    //the reader has returned no lines yet, so the remaining text is the whole file
+    const char* begin;
+    const char* end;
+    unsigned lines_before;
+    if (!reader.take_remaining_text(begin, end, lines_before))
+        throw std::runtime_error("A binary metric space must be read from a file");
+    BinaryInputReader in(begin, end);
+
+    ExactSet value_set; //stores all unique values of the function
+    ExactSet dist_set; //stores all unique values of the distance metric, unless they are binned as they are read
+    std::vector<unsigned> dist_indexes; //discrete distance matrix (triangle); max_unsigned shall represent undefined distance
+    bool binned = false; //true iff the distances have been binned as they were read
+    unsigned num_points;
+    try {
+        in.read_line(); //file type
+        data->x_label = in.read_line();
+        data->y_label = in.read_line();
+        exact max_dist = str_to_exact(in.read_line());
+        if (verbosity >= 4) {
+            std::ostringstream oss;
+            oss << max_dist;
+            debug() << "  Maximum distance of edges in Vietoris-Rips complex:" << oss.str();
+        }
+
+        uint32_t version = in.read_uint32();
+        if (version != 1)
+            throw std::runtime_error("unsupported version " + std::to_string(version));
+        uint32_t distance_format = in.read_uint32();
+        if (distance_format > 3)
+            throw std::runtime_error("unsupported distance format " + std::to_string(distance_format));
+        bool edge_list = distance_format >= 2;
+        bool doubles = distance_format % 2 == 1;
+
+        uint64_t size = in.read_uint64();
+        if (size < 1)
+            throw std::runtime_error("No points loaded.");
+        if (size > (uint64_t)(end - begin - in.offset()) / 8)
+            throw std::runtime_error("the file is too short for " + std::to_string(size) + " points");
+        if (size * (size - 1) / 2 > std::numeric_limits<unsigned>::max())
+            throw std::runtime_error("too many points");
+        num_points = (unsigned)size;
+
+        //read the values of the function, remembering that point i has its value
+        for (unsigned i = 0; i < num_points; i++) {
+            double value = in.read_double();
+            if (!std::isfinite(value))
+                throw std::runtime_error("value of point " + std::to_string(i) + " is not a finite number");
+            value_set.insert(ExactValue(exact(value))).first->indexes.push_back(i);
+        }
+
+        uint64_t num_edges = 0;
+        if (edge_list) {
+            num_edges = in.read_uint64();
+            if (num_edges > (uint64_t)(end - begin - in.offset()) / (doubles ? 16 : 12))
+                throw std::runtime_error("the file is too short for " + std::to_string(num_edges) + " edges");
+        }
+        const BinaryInputReader distances_start = in;
+
+        //reads the distances from the start of the matrix or list each time it is called
+        std::vector<bool> joined; //for the edge list, whether each pair of points has been seen yet
+        auto for_each_distance = [&](auto f) {
+            in = distances_start;
+            auto read_distance = [&](uint32_t i, uint32_t j) {
+                double dist = doubles ? in.read_double() : in.read_float();
+                if (!(dist >= 0 && std::isfinite(dist)))
+                    throw std::runtime_error("distance between points " + std::to_string(i) + " and " + std::to_string(j) + " is not a nonnegative number");
+                return dist;
+            };
+            if (!edge_list) {
+                for (unsigned i = 0; i < num_points; i++)
+                    for (unsigned j = i + 1; j < num_points; j++)
+                        f((unsigned)(((uint64_t)j * (j - 1)) / 2 + i), read_distance(i, j));
+            } else {
+                bool first_pass = joined.empty();
+                if (first_pass)
+                    joined.assign((size_t)num_points * (num_points - 1) / 2, false);
+                for (uint64_t e = 0; e < num_edges; e++) {
+                    uint32_t i = in.read_uint32();
+                    uint32_t j = in.read_uint32();
+                    if (i >= num_points || j >= num_points || i == j)
+                        throw std::runtime_error("edge " + std::to_string(e) + " does not join two different points");
+                    if (i > j)
+                        std::swap(i, j);
+                    unsigned index = (unsigned)(((uint64_t)j * (j - 1)) / 2 + i);
+                    if (first_pass) {
+                        if (joined[index])
+                            throw std::runtime_error("points " + std::to_string(i) + " and " + std::to_string(j) + " are joined by more than one edge");
+                        joined[index] = true;
+                    }
+                    f(index, read_distance(i, j));
+                }
+            }
+            if (!in.at_end())
+                throw std::runtime_error("unexpected data after the distances");
+        };
+
+        //if the distances are to be binned, then bin them as they are read, rather than storing every distinct distance
+        dist_indexes.assign(((size_t)num_points * (num_points - 1)) / 2, std::numeric_limits<unsigned>::max());
+        if (input_params.y_bins > 0 && input_params.y_binning == "uniform") {
+            auto for_each_value = [&](auto f) {
+                for_each_distance([&](unsigned index, double dist) {
+                    auto value = make_lazy_value(dist, [dist]() { return exact(dist); });
+                    f(index, value);
+                });
+            };
+            BinningError error;
+            binned = bin_distances(for_each_value, max_dist, input_params.y_bins, dist_indexes, data->y_exact, error);
+            if (binned && verbosity >= 2)
+                report_binning_error('y', input_params.y_binning, data->y_exact.size(), error);
+        }
+        if (!binned) {
+            dist_set.insert(ExactValue(exact(0))); //distance from a point to itself is always zero
+            insert_distances(for_each_distance, [](double dist) { return exact(dist); }, max_dist, dist_set);
+        }
+    } catch (std::exception& e) {
+        throw std::runtime_error("byte " + std::to_string(in.offset()) + ": " + e.what());
+    }
+    progress.advanceProgressStage(); //advance progress box to stage 2: building bifiltration
+
+    // STEPS 3-4: build the bifiltration
+    if (!binned)
+        build_grade_vectors(dist_set, dist_indexes, data->y_exact, 'y');
+    build_VR_bifiltration(*data, value_set, dist_indexes, num_points, progress);
+
+    return data;
+} //end read_binary_metric_space()
 
 //reads a bifiltration and constructs a simplex tree
-std::unique_ptr<InputData> InputManager::read_bifiltration(std::ifstream& stream, Progress& progress)
+std::unique_ptr<InputData> InputManager::read_bifiltration(FileInputReader& reader, Progress& progress)
 {
     std::unique_ptr<InputData> data(new InputData);
-    FileInputReader reader(stream);
     if (verbosity >= 2) {
         debug() << "InputManager: Found a bifiltration file.\n";
     }
@@ -505,69 +1000,219 @@ std::unique_ptr<InputData> InputManager::read_bifiltration(std::ifstream& stream
     //temporary data structures to store grades
     ExactSet x_set; //stores all unique x-values; must DELETE all elements later!
     ExactSet y_set; //stores all unique x-values; must DELETE all elements later!
-    std::pair<ExactSet::iterator, bool> ret; //for return value upon insert()
 
-    //read simplices
-    unsigned num_simplices = 0;
-    while (reader.has_next_line()) {
-        auto line_info = reader.next_line();
-        try {
-            std::vector<std::string> tokens = line_info.first;
+    //split the rest of the file into chunks that begin at the beginning of a line, and parse them in parallel
+    const size_t MIN_CHUNK_SIZE = 1 << 20; //smaller chunks are not worth a thread
+    const char* text_begin;
+    const char* text_end;
+    unsigned lines_before;
+    std::vector<BifiltrationChunk> chunks;
+    if (reader.take_remaining_text(text_begin, text_end, lines_before)) {
+        size_t num_chunks = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), (text_end - text_begin) / MIN_CHUNK_SIZE + 1);
+        std::vector<const char*> bounds(1, text_begin);
+        for (size_t k = 1; k < num_chunks; k++) {
+            const char* b = std::max(bounds.back(), text_begin + (text_end - text_begin) * k / num_chunks);
+            const char* eol = static_cast<const char*>(memchr(b, '\n', text_end - b));
+            bounds.push_back(eol ? eol + 1 : text_end);
+        }
+        bounds.push_back(text_end);
+
+        chunks.resize(num_chunks);
+        std::vector<std::thread> threads;
+        for (size_t k = 0; k < num_chunks; k++) {
+            threads.push_back(std::thread([&chunks, &bounds, k]() {
+                FileInputReader chunk_reader(bounds[k], bounds[k + 1]);
+                parse_bifiltration_chunk(chunk_reader, chunks[k]);
+            }));
+        }
+        for (std::thread& t : threads)
+            t.join();
+    } else { //then the file is read from a stream, one line at a time
+        lines_before = 0;
+        chunks.resize(1);
+        parse_bifiltration_chunk(reader, chunks[0]);
+    }
 
-            if (tokens.size() > std::numeric_limits<unsigned>::max()) {
-                throw InputError(line_info.second,
-                    "line longer than " + std::to_string(std::numeric_limits<unsigned>::max()) + " tokens");
+    //merge the chunks in order, so that the simplices are numbered as in the file
+    unsigned num_simplices = 0;
+    for (BifiltrationChunk& chunk : chunks) {
+        if (chunk.error) {
+            try {
+                std::rethrow_exception(chunk.error);
+            } catch (std::exception& e) {
+                throw InputError(lines_before + chunk.error_line, "Could not read vertex: " + std::string(e.what()));
             }
+        }
+        lines_before += chunk.lines;
 
-            //read dimension of simplex
-            unsigned dim = static_cast<unsigned>(tokens.size() - 3); //-3 because a n-simplex has (n+1) vertices, and the line also contains two grade values
-
-            //read vertices
-            std::vector<int> verts;
-            for (unsigned i = 0; i <= dim; i++) {
-                int v = std::stoi(tokens[i]);
-                verts.push_back(v);
-            }
+        //insert the distinct grades in order of first appearance, as if they were inserted line by line
+        std::vector<ExactSet::iterator> x_its, y_its;
+        for (exact& value : chunk.x_values)
+            x_its.push_back(x_set.insert(ExactValue(value)).first);
+        for (exact& value : chunk.y_values)
+            y_its.push_back(y_set.insert(ExactValue(value)).first);
 
-            //read multigrade and remember that it corresponds to this simplex
-            ret = x_set.insert(ExactValue(str_to_exact(tokens.at(dim + 1))));
-            (ret.first)->indexes.push_back(num_simplices);
-            ret = y_set.insert(ExactValue(str_to_exact(tokens.at(dim + 2))));
-            (ret.first)->indexes.push_back(num_simplices);
+        std::vector<int> verts;
+        for (size_t i = 0; i < chunk.ends.size(); i++) {
+            //remember that the multigrade corresponds to this simplex
+            x_its[chunk.x_grades[i]]->indexes.push_back(num_simplices);
+            y_its[chunk.y_grades[i]]->indexes.push_back(num_simplices);
 
             //add the simplex to the simplex tree
+            verts.assign(chunk.vertices.begin() + (i == 0 ? 0 : chunk.ends[i - 1]), chunk.vertices.begin() + chunk.ends[i]);
             data->simplex_tree->add_simplex(verts, num_simplices, num_simplices); //multigrade to be set later!
             num_simplices++;
-        } catch (std::exception& e) {
-            throw InputError(line_info.second, "Could not read vertex: " + std::string(e.what()));
         }
+        chunk = BifiltrationChunk(); //release the memory of the chunk
+    }
+
+    progress.advanceProgressStage(); //advance progress box to stage 2: building bifiltration
+
+    set_bifiltration_grades(*data, x_set, y_set, num_simplices);
+
+    return data;
+} //end read_bifiltration()
+
+//reads a bifiltration in binary form and constructs a simplex tree
+//  the file begins with three lines of text: "binary_bifiltration", the label for the x-axis, and the label for the y-axis
+//  the rest of the file is binary, with all values little-endian:
+//    uint32 version, which is 1
+//    uint32 grade format: 0 if grades are indexes into tables of exact grades, 1 if grades are IEEE 754 doubles
+//    if the grade format is 0, the tables of x-grades and of y-grades, each given by a uint64 length followed by
+//      the grades, each of which is an int64 numerator followed by an int64 (positive) denominator
+//    blocks of simplices until the end of the file, each given by a uint32 number k of vertices (at least 1) and a uint64
+//      number of simplices, followed by the simplices, each given by k uint32 vertices, then the x-grade and the y-grade
+//      (as uint32 indexes into the tables, or as doubles)
+//  the simplices are numbered in the order in which they appear, as in a text bifiltration file
+std::unique_ptr<InputData> InputManager::read_binary_bifiltration(FileInputReader& reader, Progress& progress)
+{
+    std::unique_ptr<InputData> data(new InputData);
+    if (verbosity >= 2) {
+        debug() << "InputManager: Found a binary bifiltration file.";
+    }
+
+    //the reader has returned no lines yet, so the remaining text is the whole file
+    const char* begin;
+    const char* end;
+    unsigned lines_before;
+    if (!reader.take_remaining_text(begin, end, lines_before))
+        throw std::runtime_error("A binary bifiltration must be read from a file");
+    BinaryInputReader in(begin, end);
+
+    data->simplex_tree.reset(new SimplexTree(input_params.dim, input_params.verbosity));
+
+    ExactSet x_set; //stores all unique x-values
+    ExactSet y_set; //stores all unique y-values
+    unsigned num_simplices = 0;
+    try {
+        in.read_line(); //file type
+        data->x_label = in.read_line();
+        data->y_label = in.read_line();
+
+        uint32_t version = in.read_uint32();
+        if (version != 1)
+            throw std::runtime_error("unsupported version " + std::to_string(version));
+        uint32_t grade_format = in.read_uint32();
+        if (grade_format > 1)
+            throw std::runtime_error("unsupported grade format " + std::to_string(grade_format));
+
+        //the grades, as iterators into the ExactSets: those in the tables, or the distinct doubles (by their bits) in order of first appearance
+        std::vector<ExactSet::iterator> x_its, y_its;
+        std::unordered_map<uint64_t, unsigned> x_seen, y_seen;
+        if (grade_format == 0) {
+            for (int axis = 0; axis < 2; axis++) {
+                ExactSet& set = (axis == 0) ? x_set : y_set;
+                std::vector<ExactSet::iterator>& its = (axis == 0) ? x_its : y_its;
+                uint64_t length = in.read_uint64();
+                for (uint64_t i = 0; i < length; i++) {
+                    int64_t num = in.read_int64();
+                    int64_t denom = in.read_int64();
+                    if (denom <= 0)
+                        throw std::runtime_error("grade " + std::to_string(i) + " has a denominator that is not positive");
+                    its.push_back(set.insert(ExactValue(exact(num, denom))).first);
+                }
+            }
+        }
+
+        //returns the iterator for the next grade
+        auto read_grade = [&](ExactSet& set, std::vector<ExactSet::iterator>& its, std::unordered_map<uint64_t, unsigned>& seen) {
+            if (grade_format == 0) {
+                uint32_t index = in.read_uint32();
+                if (index >= its.size())
+                    throw std::runtime_error("grade index " + std::to_string(index) + " is not in the table");
+                return its[index];
+            }
+            double value = in.read_double();
+            if (!std::isfinite(value))
+                throw std::runtime_error("grade is not a finite number");
+            uint64_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            auto ret = seen.insert(std::make_pair(bits, (unsigned)its.size()));
+            if (ret.second)
+                its.push_back(set.insert(ExactValue(exact(value))).first);
+            return its[ret.first->second];
+        };
+
+        std::vector<int> verts;
+        while (!in.at_end()) {
+            uint32_t k = in.read_uint32();
+            uint64_t count = in.read_uint64();
+            if (k == 0)
+                throw std::runtime_error("a simplex needs at least one vertex");
+            for (uint64_t s = 0; s < count; s++) {
+                if (num_simplices == std::numeric_limits<unsigned>::max())
+                    throw std::runtime_error("too many simplices");
+                verts.clear();
+                for (uint32_t i = 0; i < k; i++) {
+                    uint32_t v = in.read_uint32();
+                    if (v > (uint32_t)std::numeric_limits<int>::max())
+                        throw std::runtime_error("vertex " + std::to_string(v) + " is out of range");
+                    verts.push_back((int)v);
+                }
+                read_grade(x_set, x_its, x_seen)->indexes.push_back(num_simplices);
+                read_grade(y_set, y_its, y_seen)->indexes.push_back(num_simplices);
+
+                data->simplex_tree->add_simplex(verts, num_simplices, num_simplices); //multigrade to be set later!
+                num_simplices++;
+            }
+        }
+    } catch (std::exception& e) {
+        throw std::runtime_error("byte " + std::to_string(in.offset()) + ": " + e.what());
     }
 
     progress.advanceProgressStage(); //advance progress box to stage 2: building bifiltration
 
+    set_bifiltration_grades(*data, x_set, y_set, num_simplices);
+
+    return data;
+} //end read_binary_bifiltration()
+
+//builds the grade vectors from the ExactSets of the grades of the simplices of a bifiltration, and sets the grades and indexes of the simplex tree
+void InputManager::set_bifiltration_grades(InputData& data, ExactSet& x_set, ExactSet& y_set, unsigned num_simplices)
+{
     //build vectors of discrete grades, using bins
     unsigned max_unsigned = std::numeric_limits<unsigned>::max();
     std::vector<unsigned> x_indexes(num_simplices, max_unsigned); //x_indexes[i] gives the discrete x-index for simplex i in the input order
     std::vector<unsigned> y_indexes(num_simplices, max_unsigned); //y_indexes[i] gives the discrete y-index for simplex i in the input order
 
-    build_grade_vectors(*data, x_set, x_indexes, data->x_exact, input_params.x_bins);
-    build_grade_vectors(*data, y_set, y_indexes, data->y_exact, input_params.y_bins);
+    build_grade_vectors(x_set, x_indexes, data.x_exact, 'x');
+    build_grade_vectors(y_set, y_indexes, data.y_exact, 'y');
+
+    if (input_params.estimate || input_params.memory_limit > 0)
+        fit_memory_limit(data, data.simplex_tree->count_simplices(), x_indexes, y_indexes);
 
     //update simplex tree nodes
-    data->simplex_tree->update_xy_indexes(x_indexes, y_indexes, data->x_exact.size(), data->y_exact.size());
+    data.simplex_tree->update_xy_indexes(x_indexes, y_indexes, data.x_exact.size(), data.y_exact.size());
 
     //compute indexes
-    data->simplex_tree->update_global_indexes();
-    data->simplex_tree->update_dim_indexes();
-
-    return data;
-} //end read_bifiltration()
+    data.simplex_tree->update_global_indexes();
+    data.simplex_tree->update_dim_indexes();
+} //end set_bifiltration_grades()
 
 //reads a file of previously-computed data from RIVET
-std::unique_ptr<InputData> InputManager::read_RIVET_data(std::ifstream& stream, Progress& progress)
+std::unique_ptr<InputData> InputManager::read_RIVET_data(FileInputReader& reader, Progress& progress)
 {
     std::unique_ptr<InputData> data(new InputData);
-    FileInputReader reader(stream);
 
     //read parameters
     auto line_info = reader.next_line();
@@ -623,10 +1268,11 @@ std::unique_ptr<InputData> InputManager::read_RIVET_data(std::ifstream& stream,
         while (reader.has_next_line()) {
             line_info = reader.next_line();
             line = line_info.first;
-            data->barcode_templates.push_back(BarcodeTemplate()); //create a new BarcodeTemplate
+            std::vector<BarTemplate> bars; //bars of the new BarcodeTemplate
 
             if (line[0] != std::string("-")) //then the barcode is nonempty
             {
+                bars.reserve(line.size());
                 for (size_t i = 0; i < line.size(); i++) //loop over all bars
                 {
                     std::vector<std::string> nums = split(line[i], ",");
@@ -635,9 +1281,10 @@ std::unique_ptr<InputData> InputManager::read_RIVET_data(std::ifstream& stream,
                     if (nums[1][0] != 'i') //then b is finite
                         b = std::stol(nums[1]);
                     unsigned m = std::stol(nums[2]);
-                    data->barcode_templates.back().add_bar(a, b, m);
+                    bars.push_back(BarTemplate(a, b, m));
                 }
             }
+            data->barcode_templates.push_back(BarcodeTemplate(bars)); //create the new BarcodeTemplate
         }
 
     } catch (std::exception& e) {
@@ -649,15 +1296,107 @@ std::unique_ptr<InputData> InputManager::read_RIVET_data(std::ifstream& stream,
     return data;
 } //end read_RIVET_data()
 
+//computes the distances between the points of a point cloud, and builds the bifiltered Vietoris-Rips complex
+//  each distance is approximated by a rational number, and pairs of points farther apart than max_dist are not joined by edges
+void InputManager::build_point_cloud_bifiltration(InputData& data, const std::vector<DataPoint>& points, unsigned dimension, const exact& max_dist, Progress& progress)
+{
+    // STEP 2: compute distance matrix, and create ordered lists of all unique distance and time values
+
+    if (verbosity >= 4) {
+        debug() << "  Building lists of grade values.";
+    }
+
+    unsigned num_points = points.size();
+
+    ExactSet dist_set; //stores all unique distance values
+    ExactSet time_set; //stores all unique time values
+
+    dist_set.insert(ExactValue(exact(0))); //distance from a point to itself is always zero
+
+    //store time values, remembering that point i has its birth time value
+    for (unsigned i = 0; i < num_points; i++)
+        time_set.insert(ExactValue(points[i].birth)).first->indexes.push_back(i);
+
+    //compute (approximate) distances between all pairs of points; the pair (i,j) goes in entry j(j-1)/2 + i
+    auto for_each_distance = [&](auto f) {
+        for (unsigned j = 1; j < num_points; j++) {
+            for (unsigned i = 0; i < j; i++) {
+                double fp_dist_squared = 0;
+                for (unsigned k = 0; k < dimension; k++) {
+                    double kth_dist = points[i].coords[k] - points[j].coords[k];
+                    fp_dist_squared += (kth_dist * kth_dist);
+                }
+                f((unsigned)(((uint64_t)j * (j - 1)) / 2 + i), sqrt(fp_dist_squared));
+            }
+        }
+    };
+
+    //find an approximate square root of each distance squared, and store it as an exact value
+    insert_distances(for_each_distance, [this](double dist) { return dist > 0 ? approx(dist) : exact(0); }, max_dist, dist_set);
+
+    // STEPS 3-4: build the bifiltration
+
+    //discrete distance matrix (triangle); max_unsigned shall represent undefined distance
+    std::vector<unsigned> dist_indexes(((size_t)num_points * (num_points - 1)) / 2, std::numeric_limits<unsigned>::max());
+    build_grade_vectors(dist_set, dist_indexes, data.y_exact, 'y');
+
+    build_VR_bifiltration(data, time_set, dist_indexes, num_points, progress);
+} //end build_point_cloud_bifiltration()
+
+//builds the grade vectors from the ExactSet of the times of the points, and then the bifiltered Vietoris-Rips complex
+//  the distances have already been discretized into dist_indexes, the triangle of distances in which the pair of points (i,j) with i < j
+//  goes in entry j(j-1)/2 + i, and their grades stored in data.y_exact
+void InputManager::build_VR_bifiltration(InputData& data, ExactSet& time_set, std::vector<unsigned>& dist_indexes, unsigned num_points, Progress& progress)
+{
+    // STEP 3: build vectors of discrete indexes for constructing the bifiltration
+
+    //vector of discrete time indexes for each point; max_unsigned shall represent undefined time (is this reasonable?)
+    std::vector<unsigned> time_indexes(num_points, std::numeric_limits<unsigned>::max());
+    build_grade_vectors(time_set, time_indexes, data.x_exact, 'x');
+
+    //update progress
+    progress.progress(30);
+
+    // STEP 4: build the bifiltration
+
+    //simplex_tree stores only DISCRETE information!
+    //this only requires (suppose there are k points):
+    //  1. a list of k discrete times
+    //  2. a list of k(k-1)/2 discrete distances
+    //  3. max dimension of simplices to construct, which is one more than the dimension of homology to be computed
+
+    if (verbosity >= 4) {
+        debug() << "  Building Vietoris-Rips bifiltration.";
+        debug() << "     x-grades: " << data.x_exact.size();
+        debug() << "     y-grades: " << data.y_exact.size();
+    }
+
+    if (input_params.collapse_edges)
+        collapse_edges(time_indexes, dist_indexes);
+
+    if (input_params.estimate || input_params.memory_limit > 0) {
+        std::vector<uint64_t> simplices = MemoryEstimate::count_VR_simplices(dist_indexes, num_points, input_params.dim + 1);
+        fit_memory_limit(data, simplices, time_indexes, dist_indexes);
+        if (input_params.estimate) //then the projection is all that is wanted
+            return;
+    }
+
+    data.simplex_tree.reset(new SimplexTree(input_params.dim, input_params.verbosity));
+    data.simplex_tree->build_VR_complex(time_indexes, dist_indexes, data.x_exact.size(), data.y_exact.size());
+} //end build_VR_bifiltration()
+
 //converts an ExactSet of values to the vectors of discrete
 // values that SimplexTree uses to build the bifiltration,
 // and also builds the grade vectors (floating-point and exact)
-void InputManager::build_grade_vectors(InputData& data,
-    ExactSet& value_set,
+//  axis is 'x' or 'y', and selects the number of bins and the binning mode from the input parameters
+void InputManager::build_grade_vectors(ExactSet& value_set,
     std::vector<unsigned>& discrete_indexes,
     std::vector<exact>& grades_exact,
-    unsigned num_bins)
+    char axis)
 {
+    unsigned num_bins = (axis == 'x') ? input_params.x_bins : input_params.y_bins;
+    const std::string& binning = (axis == 'x') ? input_params.x_binning : input_params.y_binning;
+
     if (num_bins == 0 || num_bins >= value_set.size()) //then don't use bins
     {
         grades_exact.reserve(value_set.size());
@@ -672,7 +1411,10 @@ void InputManager::build_grade_vectors(InputData& data,
 
             c++;
         }
-    } else //then use bins: then the number of discrete indexes will equal
+        return;
+    }
+
+    if (binning == "uniform") //then use bins: then the number of discrete indexes will equal
     // the number of bins, and exact values will be equally spaced
     {
         //compute bin size
@@ -681,7 +1423,7 @@ void InputManager::build_grade_vectors(InputData& data,
         exact bin_size = (max - min) / num_bins;
 
         //store bin values
-        data.x_exact.reserve(num_bins);
+        grades_exact.reserve(num_bins);
 
         ExactSet::iterator it = value_set.begin();
         for (unsigned c = 0; c < num_bins; c++) //loop through all bins
@@ -696,9 +1438,81 @@ void InputManager::build_grade_vectors(InputData& data,
                 ++it;
             }
         }
+    } else //then the bins are runs of consecutive values, and the grade of each bin is the largest value in it
+    {
+        std::vector<ExactSet::iterator> last = (binning == "quantile") ? quantile_bins(value_set, num_bins) : adaptive_bins(value_set, num_bins);
+
+        grades_exact.reserve(last.size());
+        ExactSet::iterator it = value_set.begin();
+        for (unsigned c = 0; c < last.size(); c++) {
+            grades_exact.push_back(last[c]->exact_value);
+            for (ExactSet::iterator end = std::next(last[c]); it != end; ++it)
+                for (unsigned i = 0; i < it->indexes.size(); i++)
+                    discrete_indexes[it->indexes[i]] = c;
+        }
+    }
+
+    //report how far the values move up to the grades of their bins
+    if (verbosity >= 2) {
+        std::vector<double> grades;
+        for (const exact& g : grades_exact)
+            grades.push_back(ExactValue(g).double_value);
+        BinningError error;
+        for (ExactSet::iterator it = value_set.begin(); it != value_set.end(); ++it)
+            if (!it->indexes.empty())
+                error.add(grades[discrete_indexes[it->indexes[0]]] - it->double_value, it->indexes.size());
+        report_binning_error(axis, binning, grades_exact.size(), error);
     }
 } //end build_grade_vectors()
 
+
+//reports the memory that the computation is projected to use, given the number of simplices of each dimension
+//  if the projection exceeds the memory limit, then the larger of the numbers of x-grades and y-grades is halved, by merging pairs
+//  of consecutive grades (which the discrete indexes are updated to match), until the projection fits; if the projection does not fit
+//  even with a single grade in each direction, then the memory is needed for the simplices themselves, and an exception is thrown
+void InputManager::fit_memory_limit(InputData& data, const std::vector<uint64_t>& simplices, std::vector<unsigned>& x_indexes, std::vector<unsigned>& y_indexes)
+{
+    uint64_t limit = (uint64_t)input_params.memory_limit << 20;
+    std::vector<unsigned> dims(input_params.dims.begin(), input_params.dims.end());
+    if (dims.empty())
+        dims.push_back(input_params.dim);
+    MemoryEstimate estimate(dims, simplices, data.x_exact.size(), data.y_exact.size());
+    estimate.report();
+    if (limit == 0 || estimate.total_bytes() <= limit)
+        return;
+
+    if (MemoryEstimate(dims, simplices, 1, 1).total_bytes() > limit)
+        throw std::runtime_error("the projected memory exceeds the limit of " + std::to_string(input_params.memory_limit)
+            + " MB even without any grades to bin, so the complex is too large");
+
+    while (estimate.total_bytes() > limit) {
+        if (data.x_exact.size() >= data.y_exact.size())
+            merge_grade_pairs(data.x_exact, x_indexes);
+        else
+            merge_grade_pairs(data.y_exact, y_indexes);
+        estimate = MemoryEstimate(dims, simplices, data.x_exact.size(), data.y_exact.size());
+    }
+    debug() << "  The projected memory exceeds the limit of" << input_params.memory_limit << "MB, so the grades have been coarsened to"
+            << data.x_exact.size() << "x-grades and" << data.y_exact.size() << "y-grades:";
+    estimate.report();
+} //end fit_memory_limit()
+
+//removes dominated edges from the 1-skeleton of a Vietoris-Rips bifiltration, without changing its persistence module
+//  the edges are removed from the triangle of discrete distances, which is then used to build the flag complex of the smaller graph
+void InputManager::collapse_edges(const std::vector<unsigned>& times, std::vector<unsigned>& distances)
+{
+    Timer timer;
+    EdgeCollapser collapser(times, distances);
+    collapser.collapse();
+
+    if (verbosity >= 2) {
+        unsigned long before = collapser.edges_before();
+        unsigned long after = collapser.edges_after();
+        debug() << "  Edge collapse removed" << (before - after) << "of" << before << "edges, leaving" << after << "edges.";
+        debug() << "  -- edge collapse took" << timer.elapsed() << "milliseconds";
+    }
+} //end collapse_edges()
+
 //finds a rational approximation of a floating-point value
 // precondition: x > 0
 exact InputManager::approx(double x)
@@ -97,12 +97,13 @@ struct ExactValueComparator {
 typedef std::set<ExactValue, ExactValueComparator> ExactSet;
 
 struct InputData;
+struct DataPoint;
 
 struct FileType {
     std::string identifier;
     std::string description;
     bool is_data;
-    std::function<std::unique_ptr<InputData>(std::ifstream&, Progress&)> parser;
+    std::function<std::unique_ptr<InputData>(FileInputReader&, Progress&)> parser;
 };
 
 struct InputData {
@@ -149,12 +150,22 @@ private:
 
     void register_file_type(FileType file_type);
 
-    std::unique_ptr<InputData> read_point_cloud(std::ifstream& stream, Progress& progress); //reads a point cloud and constructs a simplex tree representing the bifiltered Vietoris-Rips complex
-    std::unique_ptr<InputData> read_discrete_metric_space(std::ifstream& stream, Progress& progress); //reads data representing a discrete metric space with a real-valued function and constructs a simplex tree
-    std::unique_ptr<InputData> read_bifiltration(std::ifstream& stream, Progress& progress); //reads a bifiltration and constructs a simplex tree
-    std::unique_ptr<InputData> read_RIVET_data(std::ifstream& stream, Progress& progress); //reads a file of previously-computed data from RIVET
+    std::unique_ptr<InputData> read_point_cloud(FileInputReader& reader, Progress& progress); //reads a point cloud and constructs a simplex tree representing the bifiltered Vietoris-Rips complex
+    std::unique_ptr<InputData> read_discrete_metric_space(FileInputReader& reader, Progress& progress); //reads data representing a discrete metric space with a real-valued function and constructs a simplex tree
+    std::unique_ptr<InputData> read_binary_point_cloud(FileInputReader& reader, Progress& progress); //reads a point cloud in binary form and constructs a simplex tree representing the bifiltered Vietoris-Rips complex
+    std::unique_ptr<InputData> read_binary_metric_space(FileInputReader& reader, Progress& progress); //reads a discrete metric space in binary form, with a real-valued function, and constructs a simplex tree
+    std::unique_ptr<InputData> read_bifiltration(FileInputReader& reader, Progress& progress); //reads a bifiltration and constructs a simplex tree
+    std::unique_ptr<InputData> read_binary_bifiltration(FileInputReader& reader, Progress& progress); //reads a bifiltration in binary form and constructs a simplex tree
+    std::unique_ptr<InputData> read_RIVET_data(FileInputReader& reader, Progress& progress); //reads a file of previously-computed data from RIVET
 
-    void build_grade_vectors(InputData& data, ExactSet& value_set, std::vector<unsigned>& indexes, std::vector<exact>& grades_exact, unsigned num_bins); //converts an ExactSets of values to the vectors of discrete values that SimplexTree uses to build the bifiltration, and also builds the grade vectors (floating-point and exact)
+    void build_point_cloud_bifiltration(InputData& data, const std::vector<DataPoint>& points, unsigned dimension, const exact& max_dist, Progress& progress); //computes the distances between the points of a point cloud, and builds the bifiltered Vietoris-Rips complex
+    void build_VR_bifiltration(InputData& data, ExactSet& time_set, std::vector<unsigned>& dist_indexes, unsigned num_points, Progress& progress); //builds the grade vectors from the ExactSet of the times of the points, and then the bifiltered Vietoris-Rips complex from the discrete distances
+    void set_bifiltration_grades(InputData& data, ExactSet& x_set, ExactSet& y_set, unsigned num_simplices); //builds the grade vectors from the ExactSets of the grades of the simplices of a bifiltration, and sets the grades and indexes of the simplex tree
+    void build_grade_vectors(ExactSet& value_set, std::vector<unsigned>& indexes, std::vector<exact>& grades_exact, char axis); //converts an ExactSets of values to the vectors of discrete values that SimplexTree uses to build the bifiltration, and also builds the grade vectors (floating-point and exact)
+
+    void fit_memory_limit(InputData& data, const std::vector<uint64_t>& simplices, std::vector<unsigned>& x_indexes, std::vector<unsigned>& y_indexes); //reports the projected memory, and coarsens the grades if it exceeds the memory limit
+
+    void collapse_edges(const std::vector<unsigned>& times, std::vector<unsigned>& distances); //removes dominated edges from the 1-skeleton of a Vietoris-Rips bifiltration, without changing its persistence module
 
     exact approx(double x); //finds a rational approximation of a floating-point value; precondition: x > 0
     FileType& get_file_type(std::string fileName);
@@ -179,6 +190,22 @@ struct DataPoint {
 
         birth = str_to_exact(strs.back());
     }
+
+    DataPoint(const std::vector<TokenView>& tokens) //same, but parses the tokens in place
+    {
+        coords.reserve(tokens.size() - 1);
+
+        for (unsigned i = 0; i < tokens.size() - 1; i++)
+            coords.push_back(parse_double(tokens[i]));
+
+        birth = str_to_exact(tokens.back().begin, tokens.back().end());
+    }
+
+    DataPoint(std::vector<double> coords, exact birth) //coordinates and birth time that are already numbers
+        : coords(std::move(coords))
+        , birth(birth)
+    {
+    }
 };
 
 #endif // __InputManager_H__
@@ -22,6 +22,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define INPUT_PARAMETERS_H
 
 #include <string>
+#include <vector>
 //TODO: this class currently conflates 3 things: command line arguments, file load dialog arguments, and viewer configuration state
 
 //these parameters are set by the user via the console or the DataSelectDialog before computation can begin
@@ -30,12 +31,24 @@ struct InputParameters {
     std::string shortName; //name of data file, without path
     std::string outputFile; //name of the file where the augmented arrangement should be saved
     int dim; //dimension of homology to compute
+    std::vector<int> dims; //dimensions of homology to compute from the same bifiltration, in increasing order, if there are several; dim is then the largest (not stored in output files)
     unsigned x_bins; //number of bins for x-coordinate (if 0, then bins are not used for x)
     unsigned y_bins; //number of bins for y-coordinate (if 0, then bins are not used for y)
+    std::string x_binning = "uniform"; //how to choose the bins for x-coordinate: "uniform", "quantile", or "adaptive" (not stored in output files)
+    std::string y_binning = "uniform"; //how to choose the bins for y-coordinate: "uniform", "quantile", or "adaptive" (not stored in output files)
     int verbosity; //controls the amount of console output printed
     std::string x_label; //used by configuration dialog
     std::string y_label; //used by configuration dialog
     std::string outputFormat; // Supported values: R0, R1
+    unsigned num_segments = 1; //number of segments of the path whose barcode templates are computed in parallel (not stored in output files)
+    unsigned snapshot_budget = 0; //megabytes of memory for snapshots of RU-decompositions, used to speed up resets (not stored in output files)
+    unsigned seed = 0; //seed for the random transpositions that calibrate the cost model for resets (not stored in output files)
+    std::string strategy = "reset"; //how to handle expensive anchor crossings: "reset", "quicksort", or "vineyards" (not stored in output files)
+    bool collapse_edges = false; //whether to remove dominated edges from Vietoris-Rips bifiltrations before building the simplex tree (not stored in output files)
+    bool estimate = false; //whether to stop after reporting the projected memory, before building the simplex tree (not stored in output files)
+    bool resume = false; //whether to save checkpoints of the finished stages next to the output file, and to resume from them (not stored in output files)
+    unsigned checkpoint_interval = 600; //minimum number of seconds between checkpoints of the traversal of the path through the arrangement (not stored in output files)
+    unsigned memory_limit = 0; //megabytes of memory that the computation may use, which is enforced by coarsening the grades (if 0, then there is no limit; not stored in output files)
 
     template <typename Archive>
     void serialize(Archive& ar, const unsigned int /*version*/)
@@ -172,7 +172,7 @@ void PersistenceDiagram::draw_dots()
     std::map<int, PersistenceDot*> inf_dot_map;
 
     //loop over all bars
-    for (std::multiset<MultiBar>::iterator it = barcode->begin(); it != barcode->end(); ++it) {
+    for (Barcode::const_iterator it = barcode->begin(); it != barcode->end(); ++it) {
         if (it->death == std::numeric_limits<double>::infinity()) //essential cycle (visualized in the upper horizontal strip of the persistence diagram)
         {
             //shift coordinate
@@ -519,7 +519,7 @@ void SliceDiagram::draw_barcode(Barcode const& bc, double zero_coord, bool show)
     unsigned num_bars = 1;
     unsigned index = 0;
 
-    for (std::multiset<MultiBar>::iterator it = bc.begin(); it != bc.end(); ++it) {
+    for (Barcode::const_iterator it = bc.begin(); it != bc.end(); ++it) {
         double start = it->birth - line_zero;
         double end = it->death - line_zero;
 
@@ -0,0 +1,133 @@
+/**********************************************************************
+Copyright 2014-2016 The RIVET Developers. See the COPYRIGHT file at
+the top-level directory of this distribution.
+
+This file is part of RIVET.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+
+#include "crossing_cost_model.h"
+
+#include <algorithm>
+#include <limits>
+
+CrossingCostModel::CrossingCostModel()
+    : fill(1)
+    , entries(0)
+    , sum_tt(0)
+    , sum_tw(0)
+    , sum_ww(0)
+    , sum_ty(0)
+    , sum_wy(0)
+    , reset_entries(0)
+    , reset_work(0)
+{
+}
+
+//sets the features of the current RU-decomposition: the number of columns and the number of entries in R and U
+void CrossingCostModel::set_matrix_features(unsigned long num_cols, unsigned long num_entries)
+{
+    entries = num_entries;
+    fill = std::max(1.0, (double)num_entries / std::max(num_cols, 1ul));
+}
+
+//finds the coefficients of the features t and w in the model of the work of vineyard updates, by least squares
+//  a small ridge term keeps the system solvable while the features are proportional, e.g. when only the random transpositions
+//  of the calibration, which cross no anchor, have been recorded; then the weight gets no coefficient
+bool CrossingCostModel::vineyard_coefficients(double& per_trans, double& per_weight) const
+{
+    if (sum_tt == 0)
+        return false;
+
+    double ridge = 1e-6 * (sum_tt + sum_ww);
+    double a = sum_tt + ridge;
+    double c = sum_ww + ridge;
+    double det = a * c - sum_tw * sum_tw;
+    per_trans = (c * sum_ty - sum_tw * sum_wy) / det;
+    per_weight = (a * sum_wy - sum_tw * sum_ty) / det;
+
+    //a negative coefficient fits the noise of a few crossings rather than work, so then the transpositions alone are used
+    if (per_trans <= 0 || per_weight < 0) {
+        per_trans = sum_ty / sum_tt;
+        per_weight = 0;
+    }
+    return per_trans > 0;
+}
+
+//predicted work of num_trans transpositions to cross an anchor of the given weight
+double CrossingCostModel::vineyard_cost(unsigned long num_trans, unsigned long anchor_weight) const
+{
+    double per_trans, per_weight;
+    if (!vineyard_coefficients(per_trans, per_weight))
+        return 0;
+    return (per_trans * num_trans + per_weight * anchor_weight) * fill;
+}
+
+//predicted work of resetting the matrices
+double CrossingCostModel::reset_cost() const
+{
+    if (reset_entries == 0)
+        return 0;
+    return (reset_work / reset_entries) * entries;
+}
+
+//returns the number of transpositions that is predicted to cost as much as resetting the matrices, when crossing an anchor of the given weight
+unsigned long CrossingCostModel::reset_threshold(unsigned long anchor_weight) const
+{
+    double per_trans, per_weight;
+    if (!vineyard_coefficients(per_trans, per_weight) || reset_entries == 0) //then the model has not been calibrated
+        return 1000;
+
+    double threshold = (reset_cost() - per_weight * anchor_weight * fill) / (per_trans * fill);
+    if (threshold <= 0)
+        return 0;
+    if (threshold >= (double)std::numeric_limits<unsigned long>::max())
+        return std::numeric_limits<unsigned long>::max();
+    return (unsigned long)threshold;
+}
+
+//records the work of num_trans transpositions that crossed an anchor of the given weight
+void CrossingCostModel::record_vineyard_updates(unsigned long num_trans, unsigned long anchor_weight, unsigned long long work)
+{
+    if (num_trans == 0) //don't track work for overhead that doesn't result in any transpositions
+        return;
+    double t = num_trans * fill;
+    double w = anchor_weight * fill;
+    double y = std::max(work, 1ull);
+    sum_tt += t * t;
+    sum_tw += t * w;
+    sum_ww += w * w;
+    sum_ty += t * y;
+    sum_wy += w * y;
+}
+
+//records the work of resetting the matrices
+void CrossingCostModel::record_reset(unsigned long long work)
+{
+    reset_entries += std::max(entries, 1ul);
+    reset_work += std::max(work, 1ull);
+}
+
+//adds the observations recorded by other since it was a copy of base
+void CrossingCostModel::add_observations(const CrossingCostModel& other, const CrossingCostModel& base)
+{
+    sum_tt += other.sum_tt - base.sum_tt;
+    sum_tw += other.sum_tw - base.sum_tw;
+    sum_ww += other.sum_ww - base.sum_ww;
+    sum_ty += other.sum_ty - base.sum_ty;
+    sum_wy += other.sum_wy - base.sum_wy;
+    reset_entries += other.reset_entries - base.reset_entries;
+    reset_work += other.reset_work - base.reset_work;
+}
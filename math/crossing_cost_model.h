@@ -0,0 +1,79 @@
+/**********************************************************************
+Copyright 2014-2016 The RIVET Developers. See the COPYRIGHT file at
+the top-level directory of this distribution.
+
+This file is part of RIVET.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+/**
+ * \class	CrossingCostModel
+ * \brief	Predicts the cost of crossing an anchor by vineyard updates or by resetting the matrices
+ *
+ * Costs are measured as work rather than time: the number of entries in the columns added by reductions and vineyard
+ * updates (see MapMatrix_Base::addition_work()), plus one for each transposition or each entry of a rebuilt matrix. This is the
+ * same on every run with the same input and seed, so the choices between vineyard updates and resets are too.
+ * The work of vineyard updates is modeled as a linear function of two features: the number of transpositions and the weight of
+ * the anchor (the estimate of switches and separations from which the path was chosen), each times the fill of the matrices
+ * (the average number of entries per column of R and U). Its coefficients are fit online by least squares to the crossings
+ * that have been done. The work of a reset is modeled as proportional to the number of entries in the matrices, with the
+ * constant of proportionality calibrated online as a ratio of total work to total entries.
+ */
+
+#ifndef __CROSSING_COST_MODEL_H__
+#define __CROSSING_COST_MODEL_H__
+
+class CrossingCostModel {
+public:
+    CrossingCostModel(); //constructs a model without observations
+
+    //sets the features of the current RU-decomposition: the number of columns and the number of entries in R and U
+    //  these change slowly, so they are measured only when the matrices are reset
+    void set_matrix_features(unsigned long num_cols, unsigned long num_entries);
+
+    //predicted costs, in units of work
+    double vineyard_cost(unsigned long num_trans, unsigned long anchor_weight) const; //cost of num_trans transpositions to cross an anchor of the given weight
+    double reset_cost() const; //cost of resetting the matrices
+
+    //returns the number of transpositions that is predicted to cost as much as resetting the matrices, when crossing an anchor of the given weight
+    //  the matrices should be reset when crossing the anchor would require at least this many transpositions
+    unsigned long reset_threshold(unsigned long anchor_weight) const;
+
+    //record observations, in units of work
+    void record_vineyard_updates(unsigned long num_trans, unsigned long anchor_weight, unsigned long long work);
+    void record_reset(unsigned long long work);
+
+    //adds the observations recorded by other since it was a copy of base (e.g., in another segment of the path)
+    void add_observations(const CrossingCostModel& other, const CrossingCostModel& base);
+
+private:
+    double fill; //average number of entries per column of R and U
+    unsigned long entries; //number of entries in R and U
+
+    //sums over the recorded vineyard updates, from which the least-squares coefficients are found,
+    //  where the features are t = transpositions times fill and w = anchor weight times fill, and y is the work
+    double sum_tt;
+    double sum_tw;
+    double sum_ww;
+    double sum_ty;
+    double sum_wy;
+
+    double reset_entries; //total entries of the matrices at the recorded resets
+    double reset_work; //total work of the recorded resets
+
+    //finds the coefficients of the features t and w in the model of the work of vineyard updates; returns false if there are no observations
+    bool vineyard_coefficients(double& per_trans, double& per_weight) const;
+};
+
+#endif // __CROSSING_COST_MODEL_H__
@@ -0,0 +1,144 @@
+/**********************************************************************
+Copyright 2014-2016 The RIVET Developers. See the COPYRIGHT file at
+the top-level directory of this distribution.
+
+This file is part of RIVET.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+
+#include "edge_collapser.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+
+namespace {
+const unsigned NO_EDGE = std::numeric_limits<unsigned>::max();
+}
+
+//sets up the graph given by the discrete times of the vertices and the triangle of discrete distances
+EdgeCollapser::EdgeCollapser(const std::vector<unsigned>& times, std::vector<unsigned>& distances)
+    : times(times)
+    , distances(distances)
+    , neighbors(times.size())
+    , num_edges(0)
+    , num_removed(0)
+{
+    unsigned long n = times.size();
+    if (distances.size() != n * (n - 1) / 2)
+        throw std::runtime_error("EdgeCollapser: the distance triangle does not match the number of vertices");
+
+    for (unsigned j = 1; j < n; j++) {
+        for (unsigned i = 0; i < j; i++) {
+            if (distance(i, j) != NO_EDGE) {
+                neighbors[i].push_back(j);
+                neighbors[j].push_back(i);
+                num_edges++;
+            }
+        }
+    }
+    for (std::vector<unsigned>& list : neighbors)
+        std::sort(list.begin(), list.end());
+}
+
+//removes the dominated edges, by setting their distances to the maximum unsigned value
+void EdgeCollapser::collapse()
+{
+    //list the edges by grade, with distance as the primary key, so that the edges that appear last are checked first
+    std::vector<std::tuple<unsigned, unsigned, unsigned, unsigned>> edges; //(distance, time, u, v)
+    edges.reserve(num_edges);
+    for (unsigned v = 0; v < neighbors.size(); v++)
+        for (unsigned u : neighbors[v])
+            if (u < v)
+                edges.push_back(std::make_tuple(distance(u, v), std::max(times[u], times[v]), u, v));
+    std::sort(edges.begin(), edges.end(), std::greater<std::tuple<unsigned, unsigned, unsigned, unsigned>>());
+
+    for (auto& edge : edges) {
+        unsigned u = std::get<2>(edge);
+        unsigned v = std::get<3>(edge);
+        if (is_dominated(u, v)) {
+            distance(u, v) = NO_EDGE;
+            num_removed++;
+        }
+    }
+} //end collapse()
+
+//returns the number of edges in the graph before collapse()
+unsigned long EdgeCollapser::edges_before() const
+{
+    return num_edges;
+}
+
+//returns the number of edges that remain after collapse()
+unsigned long EdgeCollapser::edges_after() const
+{
+    return num_edges - num_removed;
+}
+
+//returns a reference to the distance of vertices i != j
+unsigned& EdgeCollapser::distance(unsigned i, unsigned j)
+{
+    if (i > j)
+        std::swap(i, j);
+    return distances[(unsigned long)j * (j - 1) / 2 + i];
+}
+
+//returns true iff the edge (u,v) is dominated in the current graph
+bool EdgeCollapser::is_dominated(unsigned u, unsigned v)
+{
+    unsigned edge_time = std::max(times[u], times[v]);
+    unsigned edge_dist = distance(u, v);
+
+    //find the common neighbors x of u and v, with the distance component of the join of g(e), g(u,x) and g(v,x)
+    //  (the time component of the join is at least the time of w for every candidate w, so it doesn't constrain the edges (w,x))
+    std::vector<unsigned> common;
+    std::vector<unsigned> join_dist;
+    auto it_u = neighbors[u].begin();
+    auto it_v = neighbors[v].begin();
+    while (it_u != neighbors[u].end() && it_v != neighbors[v].end()) {
+        if (*it_u < *it_v) {
+            ++it_u;
+        } else if (*it_v < *it_u) {
+            ++it_v;
+        } else {
+            unsigned x = *it_u;
+            unsigned dist_u = distance(u, x);
+            unsigned dist_v = distance(v, x);
+            if (dist_u != NO_EDGE && dist_v != NO_EDGE) { //then x is still adjacent to both u and v
+                common.push_back(x);
+                join_dist.push_back(std::max(edge_dist, std::max(dist_u, dist_v)));
+            }
+            ++it_u;
+            ++it_v;
+        }
+    }
+
+    //a candidate w is adjacent to u and v at grade g(e), and must be adjacent to every other common neighbor x by the join grade
+    for (unsigned c = 0; c < common.size(); c++) {
+        unsigned w = common[c];
+        if (times[w] > edge_time || join_dist[c] > edge_dist)
+            continue;
+
+        bool dominates = true;
+        for (unsigned k = 0; k < common.size() && dominates; k++)
+            if (k != c && distance(w, common[k]) > join_dist[k]) //NO_EDGE is larger than any join
+                dominates = false;
+        if (dominates)
+            return true;
+    }
+    return false;
+} //end is_dominated()
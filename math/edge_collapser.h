@@ -0,0 +1,64 @@
+/**********************************************************************
+Copyright 2014-2016 The RIVET Developers. See the COPYRIGHT file at
+the top-level directory of this distribution.
+
+This file is part of RIVET.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+/**
+ * \class	EdgeCollapser
+ * \brief	Removes edges from the 1-skeleton of a Vietoris-Rips bifiltration without changing its persistence module
+ *
+ * An edge e = (u,v) appears at grade g(e) = (max(t_u, t_v), d(u,v)), where t is the discrete time (or value) of a vertex and d
+ * the discrete distance. Following Alonso, Kerber, and Pritam, e is filtration-dominated by a vertex w if w is adjacent to
+ * both u and v at grade g(e), and for every other common neighbor x of u and v, the edge (w,x) appears no later than
+ * the join of g(e), g(u,x) and g(v,x). Then at every grade at which e exists, every maximal simplex of the flag complex
+ * that contains e also contains w, so removing e is a sequence of strong collapses, and the flag bifiltration of the graph
+ * without e has an isomorphic persistence module (in every dimension).
+ *
+ * The edges are checked once, from the highest grade to the lowest, and each dominated edge is removed from the graph
+ * before the next edge is checked, so that later checks take the removals into account.
+ */
+
+#ifndef __EDGE_COLLAPSER_H__
+#define __EDGE_COLLAPSER_H__
+
+#include <vector>
+
+class EdgeCollapser {
+public:
+    //sets up the graph given by the discrete times of the vertices and the triangle of discrete distances that SimplexTree::build_VR_complex() takes
+    //  the distance of vertices i < j is distances[j(j-1)/2 + i], and is the maximum unsigned value if there is no edge
+    EdgeCollapser(const std::vector<unsigned>& times, std::vector<unsigned>& distances);
+
+    //removes the dominated edges, by setting their distances to the maximum unsigned value
+    void collapse();
+
+    unsigned long edges_before() const; //returns the number of edges in the graph before collapse()
+    unsigned long edges_after() const; //returns the number of edges that remain after collapse()
+
+private:
+    const std::vector<unsigned>& times; //discrete time of each vertex
+    std::vector<unsigned>& distances; //discrete distance of each pair of vertices (triangle)
+
+    std::vector<std::vector<unsigned>> neighbors; //neighbors of each vertex in the original graph, in increasing order
+    unsigned long num_edges; //number of edges in the original graph
+    unsigned long num_removed; //number of edges removed by collapse()
+
+    unsigned& distance(unsigned i, unsigned j); //returns a reference to the distance of vertices i != j
+    bool is_dominated(unsigned u, unsigned v); //returns true iff the edge (u,v) is dominated in the current graph
+};
+
+#endif // __EDGE_COLLAPSER_H__
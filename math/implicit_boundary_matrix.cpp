@@ -0,0 +1,229 @@
+/**********************************************************************
+Copyright 2014-2016 The RIVET Developers. See the COPYRIGHT file at
+the top-level directory of this distribution.
+
+This file is part of RIVET.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+
+#include "implicit_boundary_matrix.h"
+
+#include "map_matrix.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+const unsigned ImplicitBoundaryMatrix::MAX_VERTICES;
+const unsigned ImplicitBoundaryMatrix::NO_ROW;
+
+//constructs a matrix with the given number of rows and columns for the boundaries of dim-simplices on num_vertices vertices
+ImplicitBoundaryMatrix::ImplicitBoundaryMatrix(unsigned num_vertices, unsigned dim, unsigned rows, unsigned cols)
+    : num_vertices(num_vertices)
+    , dim(dim)
+    , num_rows(rows)
+    , binomials((dim + 2) * (num_vertices + 1), 0)
+    , col_simplex(cols, 0)
+{
+    if (dim + 1 > MAX_VERTICES)
+        throw std::runtime_error("ImplicitBoundaryMatrix: dimension is too large");
+    if (!can_number(num_vertices, dim))
+        throw std::runtime_error("ImplicitBoundaryMatrix: too many vertices to number the simplices");
+
+    //Pascal's triangle
+    for (unsigned n = 0; n <= num_vertices; n++) {
+        binomials[n] = 1;
+        for (unsigned k = 1; k <= dim + 1 && k <= n; k++)
+            binomials[k * (num_vertices + 1) + n] = binomials[(k - 1) * (num_vertices + 1) + n - 1] + binomials[k * (num_vertices + 1) + n - 1];
+    }
+}
+
+//constructs a matrix whose columns are stored explicitly, taking ownership of columns
+ImplicitBoundaryMatrix::ImplicitBoundaryMatrix(MapMatrix_Compact* columns)
+    : num_vertices(0)
+    , dim(0)
+    , num_rows(columns->height())
+    , stored(columns)
+{
+}
+
+ImplicitBoundaryMatrix::~ImplicitBoundaryMatrix()
+{
+}
+
+//returns true iff the dim-simplices on num_vertices vertices can be numbered by 64-bit integers
+//  that is, iff no binomial coefficient C(n, k) with n <= num_vertices and k <= dim + 1 overflows
+bool ImplicitBoundaryMatrix::can_number(unsigned num_vertices, unsigned dim)
+{
+    std::vector<uint64_t> row(dim + 2, 0); //row n of Pascal's triangle, up to column dim + 1
+    row[0] = 1;
+    for (unsigned n = 1; n <= num_vertices; n++) {
+        for (unsigned k = std::min(n, dim + 1); k > 0; k--) {
+            if (row[k] > std::numeric_limits<uint64_t>::max() - row[k - 1])
+                return false;
+            row[k] += row[k - 1];
+        }
+    }
+    return true;
+}
+
+//column j is the boundary of the simplex with the given (sorted) vertices
+void ImplicitBoundaryMatrix::set_column(unsigned j, const std::vector<int>& vertices)
+{
+    if (vertices.size() != dim + 1)
+        throw std::runtime_error("ImplicitBoundaryMatrix::set_column(): simplex has the wrong dimension");
+    col_simplex[j] = simplex_index(vertices);
+}
+
+//row i corresponds to the simplex with the given (sorted) vertices, which is a facet of the column simplices
+void ImplicitBoundaryMatrix::set_row(unsigned i, const std::vector<int>& vertices)
+{
+    if (vertices.size() != dim)
+        throw std::runtime_error("ImplicitBoundaryMatrix::set_row(): simplex has the wrong dimension");
+    face_simplex.push_back(simplex_index(vertices));
+    face_row.push_back(i);
+}
+
+//builds the map from simplex indexes to rows
+//  an array indexed by simplex index takes 4 bytes per possible facet, and a sorted array of indexes 12 bytes per facet, so the smaller one is used
+void ImplicitBoundaryMatrix::finalize()
+{
+    if (dim == 0) //then the columns are empty
+        return;
+
+    uint64_t num_possible = binomial(num_vertices, dim);
+    if (num_possible <= 3 * (uint64_t)face_simplex.size()) {
+        std::vector<unsigned> rows(num_possible, NO_ROW);
+        for (unsigned f = 0; f < face_simplex.size(); f++)
+            rows[face_simplex[f]] = face_row[f];
+        face_row.swap(rows);
+        std::vector<uint64_t>().swap(face_simplex);
+    } else {
+        std::vector<std::pair<uint64_t, unsigned>> faces(face_simplex.size());
+        for (unsigned f = 0; f < face_simplex.size(); f++)
+            faces[f] = std::make_pair(face_simplex[f], face_row[f]);
+        std::sort(faces.begin(), faces.end());
+        for (unsigned f = 0; f < faces.size(); f++) {
+            face_simplex[f] = faces[f].first;
+            face_row[f] = faces[f].second;
+        }
+
+        //the facets with largest vertex v are those with indexes from C(v, dim) to C(v+1, dim) - 1
+        face_start.resize(num_vertices + 1);
+        for (unsigned v = 0; v <= num_vertices; v++)
+            face_start[v] = std::lower_bound(face_simplex.begin(), face_simplex.end(), binomial(v, dim)) - face_simplex.begin();
+    }
+    face_simplex.shrink_to_fit();
+    face_row.shrink_to_fit();
+} //end finalize()
+
+//returns the number of columns in the matrix
+unsigned ImplicitBoundaryMatrix::width() const
+{
+    return stored ? stored->width() : col_simplex.size();
+}
+
+//returns the number of rows in the matrix
+unsigned ImplicitBoundaryMatrix::height() const
+{
+    return num_rows;
+}
+
+//returns the approximate number of bytes used to store this matrix
+unsigned long ImplicitBoundaryMatrix::memory_usage() const
+{
+    unsigned long bytes = sizeof(*this) + (binomials.capacity() + col_simplex.capacity() + face_simplex.capacity()) * sizeof(uint64_t)
+        + (face_row.capacity() + face_start.capacity()) * sizeof(unsigned);
+    if (stored)
+        bytes += stored->memory_usage();
+    return bytes;
+}
+
+//stores the row indexes of the entries in column j in rows, in increasing order
+void ImplicitBoundaryMatrix::get_column(unsigned j, std::vector<unsigned>& rows) const
+{
+    if (stored) {
+        stored->get_column(j, rows);
+        return;
+    }
+    if (j >= col_simplex.size())
+        throw std::runtime_error("ImplicitBoundaryMatrix::get_column(): attempting to access column past end of matrix");
+
+    rows.clear();
+    if (dim == 0)
+        return;
+
+    //find the vertices of the simplex, from the largest to the smallest: vertex k is the largest v with C(v, k+1) <= the rest of the index
+    unsigned vertices[MAX_VERTICES];
+    uint64_t terms[MAX_VERTICES]; //terms[k] is C(vertices[k], k+1), so that the index is the sum of the terms
+    uint64_t index = col_simplex[j];
+    for (unsigned k = dim + 1; k > 0; k--) {
+        const uint64_t* row = &binomials[k * (num_vertices + 1)];
+        unsigned v = std::upper_bound(row, row + num_vertices, index) - row - 1;
+        vertices[k - 1] = v;
+        terms[k - 1] = row[v];
+        index -= row[v];
+    }
+
+    //the facet without vertex m has the same terms for the smaller vertices, and the term C(v, k) instead of C(v, k+1) for each larger vertex v
+    for (unsigned m = 0; m <= dim; m++) {
+        uint64_t facet = 0;
+        for (unsigned k = 0; k < m; k++)
+            facet += terms[k];
+        for (unsigned k = m + 1; k <= dim; k++)
+            facet += binomial(vertices[k], k);
+
+        rows.push_back(find_row(facet, vertices[m == dim ? dim - 1 : dim]));
+    }
+    std::sort(rows.begin(), rows.end());
+} //end get_column()
+
+//returns C(n, k), for k <= dim + 1
+uint64_t ImplicitBoundaryMatrix::binomial(unsigned n, unsigned k) const
+{
+    return binomials[k * (num_vertices + 1) + n];
+}
+
+//returns the index of the simplex with the given (sorted) vertices
+uint64_t ImplicitBoundaryMatrix::simplex_index(const std::vector<int>& vertices) const
+{
+    uint64_t index = 0;
+    for (unsigned k = 0; k < vertices.size(); k++) {
+        if (vertices[k] < 0 || (unsigned)vertices[k] >= num_vertices)
+            throw std::runtime_error("ImplicitBoundaryMatrix: vertex index out of range");
+        index += binomial(vertices[k], k + 1);
+    }
+    return index;
+}
+
+//returns the row of the facet with the given index and largest vertex
+unsigned ImplicitBoundaryMatrix::find_row(uint64_t facet, unsigned max_vertex) const
+{
+    unsigned row = NO_ROW;
+    if (face_start.empty()) {
+        row = face_row[facet];
+    } else {
+        auto first = face_simplex.begin() + face_start[max_vertex];
+        auto last = face_simplex.begin() + face_start[max_vertex + 1];
+        auto it = std::lower_bound(first, last, facet);
+        if (it != last && *it == facet)
+            row = face_row[it - face_simplex.begin()];
+    }
+
+    if (row == NO_ROW)
+        throw std::runtime_error("ImplicitBoundaryMatrix::get_column(): facet simplex not found");
+    return row;
+}
@@ -0,0 +1,90 @@
+/**********************************************************************
+Copyright 2014-2016 The RIVET Developers. See the COPYRIGHT file at
+the top-level directory of this distribution.
+
+This file is part of RIVET.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+/**
+ * \class	ImplicitBoundaryMatrix
+ * \brief	Generates the columns of a boundary matrix on demand, without storing them
+ *
+ * Each simplex with vertices v_0 < v_1 < ... < v_d is identified by its index in the combinatorial number system,
+ * C(v_0, 1) + C(v_1, 2) + ... + C(v_d, d+1), from which its vertices, and hence the indexes of its facets, can be computed.
+ * So the matrix stores only the index of the simplex in each column and a map from the indexes of the facets to rows,
+ * and generates each column when it is needed. The map is an array indexed by simplex index if most d-simplices are present
+ * (as in a Vietoris-Rips complex with a large distance threshold), and otherwise a sorted array of the indexes of the facets,
+ * searched among the facets with the same largest vertex.
+ * The vertices here are the ranks of the vertex labels of the simplex tree, so that labels need not be 0 through n-1.
+ *
+ * If there are too many vertices for the simplices to be numbered by 64-bit integers, then the columns are instead
+ * stored in a MapMatrix_Compact, so that the matrix can be used in the same way.
+ */
+
+#ifndef __IMPLICIT_BOUNDARY_MATRIX_H__
+#define __IMPLICIT_BOUNDARY_MATRIX_H__
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class MapMatrix_Compact;
+
+class ImplicitBoundaryMatrix {
+public:
+    //constructs a matrix with the given number of rows and columns for the boundaries of dim-simplices on num_vertices vertices
+    //  the columns and rows are then specified by set_column() and set_row(), after which finalize() must be called
+    ImplicitBoundaryMatrix(unsigned num_vertices, unsigned dim, unsigned rows, unsigned cols);
+
+    //constructs a matrix whose columns are stored explicitly, taking ownership of columns
+    ImplicitBoundaryMatrix(MapMatrix_Compact* columns);
+
+    ~ImplicitBoundaryMatrix();
+
+    //returns true iff the dim-simplices on num_vertices vertices can be numbered by 64-bit integers
+    static bool can_number(unsigned num_vertices, unsigned dim);
+
+    void set_column(unsigned j, const std::vector<int>& vertices); //column j is the boundary of the simplex with the given (sorted) vertices
+    void set_row(unsigned i, const std::vector<int>& vertices); //row i corresponds to the simplex with the given (sorted) vertices, which is a facet of the column simplices
+    void finalize(); //builds the map from simplex indexes to rows
+
+    unsigned width() const; //returns the number of columns in the matrix
+    unsigned height() const; //returns the number of rows in the matrix
+    unsigned long memory_usage() const; //returns the approximate number of bytes used to store this matrix
+
+    void get_column(unsigned j, std::vector<unsigned>& rows) const; //stores the row indexes of the entries in column j in rows, in increasing order
+
+private:
+    static const unsigned MAX_VERTICES = 8; //maximum number of vertices of the simplices that correspond to columns
+    static const unsigned NO_ROW = ~0u; //marks simplices that do not correspond to rows
+
+    unsigned num_vertices; //vertices are numbered 0 through num_vertices - 1
+    unsigned dim; //dimension of the simplices that correspond to columns
+    unsigned num_rows; //number of rows in the matrix
+
+    std::vector<uint64_t> binomials; //binomials[k * (num_vertices + 1) + n] is the binomial coefficient C(n, k), for k <= dim + 1
+    std::vector<uint64_t> col_simplex; //index of the simplex that corresponds to each column
+    std::vector<uint64_t> face_simplex; //indexes of the facets that correspond to rows, in increasing order (empty if face_row is indexed by simplex index)
+    std::vector<unsigned> face_row; //row of each facet in face_simplex (or of each simplex index, NO_ROW for simplices that are not facets)
+    std::vector<unsigned> face_start; //facets with largest vertex v are face_simplex[face_start[v]] through face_simplex[face_start[v+1] - 1] (empty if face_row is indexed by simplex index)
+
+    std::unique_ptr<MapMatrix_Compact> stored; //the columns, if they are stored explicitly
+
+    uint64_t binomial(unsigned n, unsigned k) const; //returns C(n, k), for k <= dim + 1
+    uint64_t simplex_index(const std::vector<int>& vertices) const; //returns the index of the simplex with the given (sorted) vertices
+    unsigned find_row(uint64_t facet, unsigned max_vertex) const; //returns the row of the facet with the given index and largest vertex
+};
+
+#endif // __IMPLICIT_BOUNDARY_MATRIX_H__
@@ -22,39 +22,115 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
 #include "map_matrix.h"
+#include "implicit_boundary_matrix.h"
 #include "index_matrix.h"
 #include "bool_array.h"
 #include "debug.h"
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <bitset>
+#include <cstddef> //for NULL
+#include <iterator>
 #include <numeric> //for std::accumulate
 #include <stdexcept> //for error-checking and debugging
 
-/********** implementation of base class MapMatrix_Base **********/
+/********** helper functions for columns stored as arrays of bits **********/
+
+//returns the number of bits that are set in word
+static unsigned popcount(uint64_t word)
+{
+#if defined(__GNUC__)
+    return __builtin_popcountll(word);
+#else
+    return std::bitset<64>(word).count();
+#endif
+}
 
-//implementation of subclass MapMatrixNode
-MapMatrix_Base::MapMatrixNode::MapMatrixNode(unsigned row)
-    : row_index(row)
-    , next(NULL)
+//returns the index of the lowest bit that is set in word, which must be nonzero
+static unsigned lowest_bit(uint64_t word)
 {
+#if defined(__GNUC__)
+    return __builtin_ctzll(word);
+#else
+    return popcount((word & (~word + 1)) - 1);
+#endif
 }
 
-unsigned MapMatrix_Base::MapMatrixNode::get_row()
+//returns the index of the highest bit that is set in word, which must be nonzero
+static unsigned highest_bit(uint64_t word)
 {
-    return row_index;
+#if defined(__GNUC__)
+    return 63 - __builtin_clzll(word);
+#else
+    unsigned bit = 0;
+    for (unsigned shift = 32; shift > 0; shift /= 2) {
+        if (word >> shift) {
+            word >>= shift;
+            bit += shift;
+        }
+    }
+    return bit;
+#endif
 }
 
-void MapMatrix_Base::MapMatrixNode::set_next(MapMatrixNode* n)
+//adds the words of source to those of target (with mod-2 arithmetic), and returns the number of bits set in target
+//  uses AVX-512 or AVX2 instructions if the compiler targets them (e.g. with -march=native), and a scalar loop otherwise
+static unsigned xor_words(const uint64_t* source, uint64_t* target, unsigned num_words)
 {
-    next = n;
+    unsigned count = 0;
+    unsigned w = 0;
+#if defined(__AVX512F__)
+    for (; w + 8 <= num_words; w += 8) {
+        __m512i sum = _mm512_xor_si512(_mm512_loadu_si512(source + w), _mm512_loadu_si512(target + w));
+        _mm512_storeu_si512(target + w, sum);
+#if defined(__AVX512VPOPCNTDQ__)
+        count += _mm512_reduce_add_epi64(_mm512_popcnt_epi64(sum));
+#else
+        if (_mm512_test_epi64_mask(sum, sum) != 0) {
+            for (unsigned i = w; i < w + 8; i++)
+                count += popcount(target[i]);
+        }
+#endif
+    }
+#elif defined(__AVX2__)
+    for (; w + 4 <= num_words; w += 4) {
+        __m256i sum = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + w)), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(target + w)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(target + w), sum);
+        if (!_mm256_testz_si256(sum, sum)) {
+            for (unsigned i = w; i < w + 4; i++)
+                count += popcount(target[i]);
+        }
+    }
+#endif
+    //the remaining words, or all of them in builds without AVX, where the compiler may still vectorize this loop
+    for (; w < num_words; w++) {
+        target[w] ^= source[w];
+        count += popcount(target[w]);
+    }
+    return count;
 }
 
-MapMatrix_Base::MapMatrixNode* MapMatrix_Base::MapMatrixNode::get_next()
+//returns the index of the highest bit set in the words (that is, the last row with an entry), or -1 if no bit is set
+static int highest_set_bit(const std::vector<uint64_t>& bits, unsigned num_words)
 {
-    return next;
+    for (unsigned w = num_words; w-- > 0;) {
+        if (bits[w] != 0)
+            return 64 * w + highest_bit(bits[w]);
+    }
+    return -1;
 }
 
+/********** implementation of base class MapMatrix_Base **********/
+
 //constructor to create matrix of specified size (all entries zero)
 MapMatrix_Base::MapMatrix_Base(unsigned rows, unsigned cols)
     : columns(cols)
+    , dense_columns(cols)
+    , column_sizes(cols, 0)
     , num_rows(rows)
 {
 }
@@ -62,6 +138,8 @@ MapMatrix_Base::MapMatrix_Base(unsigned rows, unsigned cols)
 //constructor to create a (square) identity matrix
 MapMatrix_Base::MapMatrix_Base(unsigned size)
     : columns(size)
+    , dense_columns(size)
+    , column_sizes(size, 1)
     , num_rows(size)
 {
     for (unsigned i = 0; i < size; i++) {
@@ -73,26 +151,28 @@ MapMatrix_Base::MapMatrix_Base(unsigned size)
 //destructor: deletes all entries in this matrix
 MapMatrix_Base::~MapMatrix_Base()
 {
-    for (unsigned j = 0; j < columns.size(); j++) {
-        MapMatrixNode* current = columns[j];
-        while (current != NULL) {
-            MapMatrixNode* next = current->get_next();
-            delete current;
-            current = next;
-        }
-    }
+    for (unsigned j = 0; j < columns.size(); j++)
+        clear_column(j);
 }
 
-//returns the number of columns in the matrix
-unsigned MapMatrix_Base::width() const
+//returns the number of nonzero entries in the matrix
+unsigned long MapMatrix_Base::num_entries() const
 {
-    return columns.size();
+    return std::accumulate(column_sizes.begin(), column_sizes.end(), 0ul);
 }
 
-//returns the number of rows in the matrix
-unsigned MapMatrix_Base::height() const
+//returns the approximate number of bytes used to store this matrix
+unsigned long MapMatrix_Base::memory_usage() const
 {
-    return num_rows;
+    unsigned long bytes = sizeof(*this) + columns.capacity() * sizeof(MapMatrixNode*) + dense_columns.capacity() * sizeof(DenseColumn*)
+        + column_sizes.capacity() * sizeof(unsigned);
+    for (unsigned j = 0; j < columns.size(); j++) {
+        if (dense_columns[j] != NULL)
+            bytes += sizeof(DenseColumn) + dense_columns[j]->bits.capacity() * sizeof(uint64_t);
+        else
+            bytes += column_sizes[j] * sizeof(MapMatrixNode);
+    }
+    return bytes;
 }
 
 //sets (to 1) the entry in row i, column j
@@ -104,9 +184,17 @@ void MapMatrix_Base::set(unsigned i, unsigned j)
     if (num_rows <= i)
         throw std::runtime_error("MapMatrix_Base::set(): attempting to set row past end of matrix");
 
+    //if the column is an array of bits, then set the bit
+    if (dense_columns[j] != NULL) {
+        if (!((dense_columns[j]->bits[i / 64] >> (i % 64)) & 1))
+            flip(j, i);
+        return;
+    }
+
     //if the column is empty, then create a node
     if (columns[j] == NULL) {
         columns[j] = new MapMatrixNode(i);
+        column_sizes[j]++;
         return;
     }
 
@@ -123,6 +211,7 @@ void MapMatrix_Base::set(unsigned i, unsigned j)
         MapMatrixNode* newnode = new MapMatrixNode(i);
         newnode->set_next(current);
         columns[j] = newnode;
+        column_sizes[j]++;
         return;
     }
 
@@ -140,7 +229,7 @@ void MapMatrix_Base::set(unsigned i, unsigned j)
             MapMatrixNode* newnode = new MapMatrixNode(i);
             newnode->set_next(next);
             current->set_next(newnode);
-
+            column_sizes[j]++;
             return;
         }
 
@@ -151,6 +240,7 @@ void MapMatrix_Base::set(unsigned i, unsigned j)
     //if we get here, then append a new node to the end of the list
     MapMatrixNode* newnode = new MapMatrixNode(i);
     current->set_next(newnode);
+    column_sizes[j]++;
 } //end set()
 
 //clears (sets to 0) the entry in row i, column j
@@ -162,6 +252,15 @@ void MapMatrix_Base::clear(unsigned i, unsigned j)
     if (num_rows <= i)
         throw std::runtime_error("MapMatrix_Base::clear(): attempting to clear entry in a row past end of matrix");
 
+    //if the column is an array of bits, then clear the bit
+    if (dense_columns[j] != NULL) {
+        if ((dense_columns[j]->bits[i / 64] >> (i % 64)) & 1) {
+            flip(j, i);
+            update_storage(j);
+        }
+        return;
+    }
+
     //if column is empty, then do nothing
     if (columns[j] == NULL)
         return;
@@ -176,6 +275,7 @@ void MapMatrix_Base::clear(unsigned i, unsigned j)
     if (current->get_row() == i) {
         columns[j] = current->get_next();
         delete current;
+        column_sizes[j]--;
         return;
     }
 
@@ -190,6 +290,7 @@ void MapMatrix_Base::clear(unsigned i, unsigned j)
         {
             current->set_next(next->get_next());
             delete next;
+            column_sizes[j]--;
             return;
         }
 
@@ -198,47 +299,63 @@ void MapMatrix_Base::clear(unsigned i, unsigned j)
     }
 } //end clear()
 
-//returns true if entry (i,j) is 1, false otherwise
-bool MapMatrix_Base::entry(unsigned i, unsigned j)
-{
-    //make sure this entry is valid
-    if (columns.size() <= j)
-        throw std::runtime_error("MapMatrix_Base::entry(): attempting to check entry in a column past end of matrix");
-    if (num_rows <= i)
-        throw std::runtime_error("MapMatrix_Base::entry(): attempting to check entry in a row past end of matrix");
-
-    //get initial node pointer
-    MapMatrixNode* np = columns[j];
-
-    //loop while there is another node to check
-    while (np != NULL) {
-        if (np->get_row() < i) //then we won't find row i because row entrys are sorted in descending order
-            return false;
+thread_local unsigned long long MapMatrix_Base::addition_entries = 0;
 
-        if (np->get_row() == i) //then we found the row we wanted
-            return true;
+//returns the number of entries in the columns that have been added by the calling thread so far
+unsigned long long MapMatrix_Base::addition_work()
+{
+    return addition_entries;
+}
 
-        //if we are still looking, then get the next node
-        np = np->get_next();
+//adds column j of source to column k of this matrix (where source may be this matrix, if j != k)
+void MapMatrix_Base::add_column_from(const MapMatrix_Base& source, unsigned j, unsigned k)
+{
+    //make sure this operation is valid
+    if (source.columns.size() <= j || columns.size() <= k)
+        throw std::runtime_error("MapMatrix_Base::add_column_from(): attempting to access column past end of matrix");
+    if (&source == this && j == k)
+        throw std::runtime_error("MapMatrix_Base::add_column_from(): adding a column to itself");
+    if (source.num_rows > num_rows)
+        throw std::runtime_error("MapMatrix_Base::add_column_from(): source matrix has more rows than this matrix");
+
+    addition_entries += source.column_sizes[j] + column_sizes[k];
+
+    const DenseColumn* src = source.dense_columns[j];
+    if (src == NULL && dense_columns[k] == NULL) //then both columns are linked lists
+    {
+        column_sizes[k] += merge_column(source, j, k);
+    } else {
+        if (dense_columns[k] == NULL) //then column j has many entries, so the sum is likely to have many entries as well
+            make_dense(k);
+        DenseColumn* target = dense_columns[k];
+
+        if (src == NULL) //then flip the bits of column k at the entries of column j
+        {
+            for (MapMatrixNode* node = source.columns[j]; node != NULL; node = node->get_next())
+                flip(k, node->get_row());
+        } else if (src->bits.size() == target->bits.size()) //then add the arrays of bits
+        {
+            column_sizes[k] = xor_words(src->bits.data(), target->bits.data(), target->bits.size());
+            target->low = highest_set_bit(target->bits, target->bits.size());
+        } else //then source has fewer rows, so flip the bits of column k at the entries of column j
+        {
+            for (unsigned w = 0; w < src->bits.size(); w++) {
+                for (uint64_t word = src->bits[w]; word != 0; word &= word - 1) //visits the set bits of word, from lowest to highest
+                    flip(k, 64 * w + lowest_bit(word));
+            }
+        }
     }
 
-    //if we get here, then we didn't find the entry
-    return false;
-} //end entry()
+    update_storage(k);
+} //end add_column_from()
 
-//adds column j to column k
-//  RESULT: column j is not changed, column k contains sum of columns j and k (with mod-2 arithmetic)
-void MapMatrix_Base::add_column(unsigned j, unsigned k)
+//adds column j of source to column k, where both columns are linked lists, and returns the change in the number of entries in column k
+int MapMatrix_Base::merge_column(const MapMatrix_Base& source, unsigned j, unsigned k)
 {
-    //make sure this operation is valid
-    if (columns.size() <= j || columns.size() <= k)
-        throw std::runtime_error("MapMatrix_Base::add_column(): attempting to access column past end of matrix");
-    if (j == k)
-        throw std::runtime_error("MapMatrix_Base::add_column(): adding a column to itself");
-
     //pointers
-    MapMatrixNode* jnode = columns[j]; //points to next node from column j that we will add to column k
+    MapMatrixNode* jnode = source.columns[j]; //points to next node from column j that we will add to column k
     MapMatrixNode* khandle = NULL; //points to node in column k that was most recently added; will be non-null after first node is added
+    int change = 0; //change in the number of entries in column k
 
     //loop through all entries in column j
     while (jnode != NULL) {
@@ -253,6 +370,7 @@ void MapMatrix_Base::add_column(unsigned j, unsigned k)
             MapMatrixNode* newnode = new MapMatrixNode(row);
             columns[k] = newnode;
             khandle = newnode;
+            change++;
 
             added = true; //proceed with next element from column j
         }
@@ -264,6 +382,7 @@ void MapMatrix_Base::add_column(unsigned j, unsigned k)
                 MapMatrixNode* next = (*columns[k]).get_next();
                 delete columns[k];
                 columns[k] = next;
+                change--;
                 added = true; //proceed with next element from column j
             } else if ((*columns[k]).get_row() < row) //then insert new initial node into column k
             {
@@ -271,7 +390,8 @@ void MapMatrix_Base::add_column(unsigned j, unsigned k)
                 newnode->set_next(columns[k]);
                 columns[k] = newnode;
                 khandle = columns[k];
-                added = true; //proceed with next element from column j
+                change++;
+                    added = true; //proceed with next element from column j
             } else //then move to next node in column k
             {
                 khandle = columns[k];
@@ -288,13 +408,15 @@ void MapMatrix_Base::add_column(unsigned j, unsigned k)
             {
                 khandle->set_next(next->get_next());
                 delete next;
+                change--;
                 added = true; //proceed with next element from column j
             } else if (next->get_row() < row) //then insert new initial node into column k
             {
                 MapMatrixNode* newnode = new MapMatrixNode(row);
                 newnode->set_next(next);
                 khandle->set_next(newnode);
-                added = true; //proceed with next element from column j
+                change++;
+                    added = true; //proceed with next element from column j
             } else //then next->get_row() > row, so move to next node in column k
             {
                 khandle = next;
@@ -306,13 +428,169 @@ void MapMatrix_Base::add_column(unsigned j, unsigned k)
             MapMatrixNode* newnode = new MapMatrixNode(row);
             khandle->set_next(newnode);
             khandle = newnode;
+            change++;
         }
 
         //move to the next entry in column j
         jnode = jnode->get_next();
     } //end while(jnode != NULL)
 
-} //end add_column()
+    return change;
+} //end merge_column()
+
+//stores the row indexes of the entries in column j in rows, in decreasing order
+void MapMatrix_Base::get_column(unsigned j, std::vector<unsigned>& rows) const
+{
+    rows.clear();
+    if (dense_columns[j] != NULL) {
+        const std::vector<uint64_t>& bits = dense_columns[j]->bits;
+        for (unsigned w = bits.size(); w-- > 0;) {
+            for (uint64_t word = bits[w]; word != 0; word &= ~((uint64_t)1 << highest_bit(word))) //visits the set bits of word, from highest to lowest
+                rows.push_back(64 * w + highest_bit(word));
+        }
+    }
+    for (MapMatrixNode* node = columns[j]; node != NULL; node = node->get_next())
+        rows.push_back(node->get_row());
+}
+
+//replaces column k with column j of source, with row indexes increased by offset
+void MapMatrix_Base::copy_column(const MapMatrix_Base& source, unsigned j, unsigned k, unsigned offset)
+{
+    clear_column(k);
+
+    const DenseColumn* src = source.dense_columns[j];
+    if (src != NULL) //then the copy is also an array of bits
+    {
+        DenseColumn* column = new DenseColumn(*src);
+        if (offset != 0 || source.num_rows != num_rows) {
+            column->bits.assign(num_words(), 0);
+            for (unsigned w = 0; w < src->bits.size(); w++) {
+                for (uint64_t word = src->bits[w]; word != 0; word &= word - 1) { //visits the set bits of word, from lowest to highest
+                    unsigned row = 64 * w + lowest_bit(word) + offset;
+                    column->bits[row / 64] |= (uint64_t)1 << (row % 64);
+                }
+            }
+            column->low += offset;
+        }
+        dense_columns[k] = column;
+        column_sizes[k] = source.column_sizes[j];
+        update_storage(k);
+        return;
+    }
+
+    MapMatrixNode* other_node = source.columns[j];
+    if (other_node != NULL) {
+        //create the first node in this column
+        MapMatrixNode* cur_node = new MapMatrixNode(other_node->get_row() + offset);
+        columns[k] = cur_node;
+
+        //create all other nodes in this column
+        other_node = other_node->get_next();
+        while (other_node != NULL) {
+            MapMatrixNode* new_node = new MapMatrixNode(other_node->get_row() + offset);
+            cur_node->set_next(new_node);
+            cur_node = new_node;
+            other_node = other_node->get_next();
+        }
+    }
+    column_sizes[k] = source.column_sizes[j];
+}
+
+//removes all entries from column j
+void MapMatrix_Base::clear_column(unsigned j)
+{
+    MapMatrixNode* current = columns[j];
+    while (current != NULL) {
+        MapMatrixNode* next = current->get_next();
+        delete current;
+        current = next;
+    }
+    columns[j] = NULL;
+
+    delete dense_columns[j];
+    dense_columns[j] = NULL;
+    column_sizes[j] = 0;
+}
+
+//returns the number of columns that are stored as arrays of bits
+unsigned MapMatrix_Base::num_dense_columns() const
+{
+    return columns.size() - std::count(dense_columns.begin(), dense_columns.end(), static_cast<DenseColumn*>(NULL));
+}
+
+//chooses the storage for column j according to its number of entries
+//  columns switch to arrays of bits at one entry for every 64 rows, and back to linked lists at a quarter of that, so that columns near the threshold do not switch back and forth
+void MapMatrix_Base::update_storage(unsigned j)
+{
+    unsigned words = num_words();
+    if (dense_columns[j] == NULL) {
+        if (column_sizes[j] >= words && column_sizes[j] > 0) //a matrix without rows has no words, but its columns stay linked lists
+            make_dense(j);
+    } else if (4 * column_sizes[j] < words)
+        make_sparse(j);
+}
+
+//returns the number of 64-bit words in a column stored as an array of bits
+unsigned MapMatrix_Base::num_words() const
+{
+    return (num_rows + 63) / 64;
+}
+
+//stores column j as an array of bits
+void MapMatrix_Base::make_dense(unsigned j)
+{
+    DenseColumn* column = new DenseColumn();
+    column->bits.assign(num_words(), 0);
+    column->low = column_low(j);
+
+    MapMatrixNode* node = columns[j];
+    while (node != NULL) {
+        unsigned row = node->get_row();
+        column->bits[row / 64] |= (uint64_t)1 << (row % 64);
+
+        MapMatrixNode* next = node->get_next();
+        delete node;
+        node = next;
+    }
+    columns[j] = NULL;
+    dense_columns[j] = column;
+}
+
+//stores column j as a linked list, with row indexes in decreasing order
+void MapMatrix_Base::make_sparse(unsigned j)
+{
+    DenseColumn* column = dense_columns[j];
+    dense_columns[j] = NULL;
+
+    //since the nodes are created in increasing order, each one is inserted at the beginning of the list
+    MapMatrixNode* first = NULL;
+    for (unsigned w = 0; w < column->bits.size(); w++) {
+        for (uint64_t word = column->bits[w]; word != 0; word &= word - 1) { //visits the set bits of word, from lowest to highest
+            MapMatrixNode* node = new MapMatrixNode(64 * w + lowest_bit(word));
+            node->set_next(first);
+            first = node;
+        }
+    }
+    columns[j] = first;
+    delete column;
+}
+
+//adds an entry in row i to column j, which is stored as an array of bits (with mod-2 arithmetic)
+void MapMatrix_Base::flip(unsigned j, unsigned i)
+{
+    DenseColumn* column = dense_columns[j];
+    uint64_t bit = (uint64_t)1 << (i % 64);
+    column->bits[i / 64] ^= bit;
+    if (column->bits[i / 64] & bit) {
+        column_sizes[j]++;
+        if (static_cast<int>(i) > column->low)
+            column->low = i;
+    } else {
+        column_sizes[j]--;
+        if (static_cast<int>(i) == column->low) //then find the new last entry, which is in a row before row i
+            column->low = highest_set_bit(column->bits, i / 64 + 1);
+    }
+}
 
 /********** implementation of class MapMatrix, for column-sparse matrices **********/
 
@@ -368,22 +646,24 @@ MapMatrix::~MapMatrix()
 {
 }
 
-//returns the number of columns in the matrix
-unsigned MapMatrix::width() const
+//returns the number of nonzero entries in the matrix
+unsigned long MapMatrix::num_entries() const
 {
-    return MapMatrix_Base::width();
+    return MapMatrix_Base::num_entries();
 }
 
-//returns the number of rows in the matrix
-unsigned MapMatrix::height() const
+//returns the approximate number of bytes used to store this matrix
+unsigned long MapMatrix::memory_usage() const
 {
-    return MapMatrix_Base::height();
+    return MapMatrix_Base::memory_usage();
 }
 
 //requests that the columns vector have enough capacity for num_cols columns
 void MapMatrix::reserve_cols(unsigned num_cols)
 {
     columns.reserve(num_cols);
+    dense_columns.reserve(num_cols);
+    column_sizes.reserve(num_cols);
 }
 
 //sets (to 1) the entry in row i, column j
@@ -392,144 +672,22 @@ void MapMatrix::set(unsigned i, unsigned j)
     MapMatrix_Base::set(i, j);
 }
 
-//returns true if entry (i,j) is 1, false otherwise
-bool MapMatrix::entry(unsigned i, unsigned j)
+//returns the number of columns that are stored as arrays of bits
+unsigned MapMatrix::num_dense_columns() const
 {
-    return MapMatrix_Base::entry(i, j);
+    return MapMatrix_Base::num_dense_columns();
 }
 
-//returns the "low" index in the specified column, or 0 if the column is empty or does not exist
-int MapMatrix::low(unsigned j)
-{
-    //make sure this query is valid
-    if (columns.size() <= j)
-        throw std::runtime_error("MapMatrix::low(): attempting to check low number of a column past end of matrix");
-
-    //if the column is empty, then return -1
-    if (columns[j] == NULL)
-        return -1;
-
-    //otherwise, column is non-empty, so return first index (because row indexes are sorted in descending order)
-    return (*columns[j]).get_row();
-}
-
-//returns true iff column j is empty
-bool MapMatrix::col_is_empty(unsigned j)
-{
-    return (columns[j] == NULL);
-}
-
-//adds column j to column k; RESULT: column j is not changed, column k contains sum of columns j and k (with mod-2 arithmetic)
-void MapMatrix::add_column(unsigned j, unsigned k)
-{
-    MapMatrix_Base::add_column(j, k);
-}
-
-//adds column j from MapMatrix* other to column k of this matrix
-void MapMatrix::add_column(MapMatrix* other, unsigned j, unsigned k)
-{
-    //make sure this operation is valid
-    if (other->columns.size() <= j || columns.size() <= k)
-        throw std::runtime_error("MapMatrix::add_column(): attempting to access column(s) past end of matrix");
-
-    //pointers
-    MapMatrixNode* jnode = other->columns[j]; //points to next node from column j that we will add to column k
-    MapMatrixNode* khandle = NULL; //points to node in column k that was most recently added; will be non-null after first node is added
-
-    //loop through all entries in column j
-    while (jnode != NULL) {
-        //now it is save to dereference jnode
-        unsigned row = jnode->get_row();
-
-        //loop through entries in column k, starting at the current position
-        bool added = false;
-
-        if (columns[k] == NULL) //then column k is empty, so insert initial node
-        {
-            MapMatrixNode* newnode = new MapMatrixNode(row);
-            columns[k] = newnode;
-            khandle = newnode;
-
-            added = true; //proceed with next element from column j
-        }
-
-        if (!added && khandle == NULL) //then we haven't yet added anything to column k (but if we get here, column k is nonempty)
-        {
-            if ((*columns[k]).get_row() == row) //then remove this node (since 1+1=0)
-            {
-                MapMatrixNode* next = (*columns[k]).get_next();
-                delete columns[k];
-                columns[k] = next;
-                added = true; //proceed with next element from column j
-            } else if ((*columns[k]).get_row() < row) //then insert new initial node into column k
-            {
-                MapMatrixNode* newnode = new MapMatrixNode(row);
-                newnode->set_next(columns[k]);
-                columns[k] = newnode;
-                khandle = columns[k];
-                added = true; //proceed with next element from column j
-            } else //then move to next node in column k
-            {
-                khandle = columns[k];
-                //now we want to enter the following while loop
-            }
-        } //end if
-
-        while (!added && (khandle->get_next() != NULL)) //if we get here, both columns[k] and khandle are NOT NULL
-        {
-            //consider the next node
-            MapMatrixNode* next = khandle->get_next();
-
-            if (next->get_row() == row) //then remove the next node (since 1+1=0)
-            {
-                khandle->set_next(next->get_next());
-                delete next;
-                added = true; //proceed with next element from column j
-            } else if (next->get_row() < row) //then insert new initial node into column k
-            {
-                MapMatrixNode* newnode = new MapMatrixNode(row);
-                newnode->set_next(next);
-                khandle->set_next(newnode);
-                added = true; //proceed with next element from column j
-            } else //then next->get_row() > row, so move to next node in column k
-            {
-                khandle = next;
-            }
-        } //end while
-
-        if (!added && (khandle->get_next() == NULL)) //then we have reached the end of the list, and we should append a new node
-        {
-            MapMatrixNode* newnode = new MapMatrixNode(row);
-            khandle->set_next(newnode);
-            khandle = newnode;
-        }
-
-        //move to the next entry in column j
-        jnode = jnode->get_next();
-    } //end while(jnode != NULL)
-
-} //end add_column(MapMatrix*, unsigned, unsigned)
-
 //copies NONZERO columns with indexes in [first, last] from other, appending them to this matrix to the right of all existing columns
 //  all row indexes in copied columns are increased by offset
 void MapMatrix::copy_cols_from(MapMatrix* other, int first, int last, unsigned offset)
 {
     for (int j = first; j <= last; j++) {
-        MapMatrixNode* other_node = other->columns[j];
-        if (other_node != NULL) {
-            //create the first node in this column
-            MapMatrixNode* cur_node = new MapMatrixNode(other_node->get_row() + offset);
-            columns.push_back(cur_node);
-
-            //create all other nodes in this column
-            other_node = other_node->get_next();
-            while (other_node != NULL)
-            {
-                MapMatrixNode* new_node = new MapMatrixNode(other_node->get_row() + offset);
-                cur_node->set_next(new_node);
-                cur_node = new_node;
-                other_node = other_node->get_next();
-            }
+        if (!other->column_is_empty(j)) {
+            columns.push_back(NULL);
+            dense_columns.push_back(NULL);
+            column_sizes.push_back(0);
+            copy_column(*other, j, columns.size() - 1, offset);
         }
     }
 }//end copy_cols_from()
@@ -537,26 +695,8 @@ void MapMatrix::copy_cols_from(MapMatrix* other, int first, int last, unsigned o
 //copies columns with indexes in [first, last] from other, inserting them in this matrix with the same column indexes
 void MapMatrix::copy_cols_same_indexes(MapMatrix* other, int first, int last)
 {
-    for (int j = first; j <= last; j++) {
-        MapMatrixNode* other_node = other->columns[j];
-        if (other_node != NULL) {
-            //create the first node in this column
-            MapMatrixNode* cur_node = new MapMatrixNode(other_node->get_row());
-            columns[j] = (cur_node);
-
-            //create all other nodes in this column
-            other_node = other_node->get_next();
-            while (other_node != NULL)
-            {
-                MapMatrixNode* new_node = new MapMatrixNode(other_node->get_row());
-                cur_node->set_next(new_node);
-                cur_node = new_node;
-                other_node = other_node->get_next();
-            }
-        }
-        else
-            columns[j] = NULL; //this shouldn't be necessary
-    }
+    for (int j = first; j <= last; j++)
+        copy_column(*other, j, j, 0);
 }//end copy_cols_same_indexes()
 
 //removes zero columns from this matrix
@@ -576,17 +716,21 @@ void MapMatrix::remove_zero_cols(IndexMatrix* ind_old, IndexMatrix* ind_new)
         for (unsigned x = 0; x < ind_old->width(); x++) {
             int end_col = ind_old->get(y, x); //index of rightmost column at this grade
             for (; cur_col <= end_col; cur_col++) { //loop over all columns at this grade
-                if (columns[cur_col] != NULL) { //then move column
+                if (!column_is_empty(cur_col)) { //then move column
                     new_col++; //new index of this column
                     columns[new_col] = columns[cur_col];
+                    dense_columns[new_col] = dense_columns[cur_col];
+                    column_sizes[new_col] = column_sizes[cur_col];
                 }
             }
             ind_new->set(y, x, new_col); //rightmost column index for this grade
         }
     }
 
-    //resize the columns vector
+    //resize the columns vectors
     columns.resize(new_col + 1);
+    dense_columns.resize(new_col + 1);
+    column_sizes.resize(new_col + 1);
 
 //    qDebug() << "RESULTING MATRIX: (" << columns.size() << "cols)";
 //    print();
@@ -607,15 +751,12 @@ std::ostream& operator<<(std::ostream& out, const MapMatrix& matrix)
         for (unsigned j = 0; j < matrix.columns.size(); j++)
             mx.at(i, j) = false;
 
-    //traverse the linked lists in order to fill the 2D array
-    MapMatrix::MapMatrixNode* current;
+    //traverse the columns in order to fill the 2D array
+    std::vector<unsigned> rows;
     for (unsigned j = 0; j < matrix.columns.size(); j++) {
-        current = matrix.columns[j];
-        while (current != NULL) {
-            int row = current->get_row();
+        matrix.get_column(j, rows);
+        for (unsigned row : rows)
             mx.at(row, j) = true;
-            current = current->get_next();
-        }
     }
 
     for (unsigned i = 0; i < matrix.num_rows; i++) {
@@ -670,29 +811,21 @@ MapMatrix_Perm::MapMatrix_Perm(const MapMatrix_Perm& other)
     , low_by_col(other.low_by_col)
 {
     //copy all matrix entries
-    for (unsigned j = 0; j < other.width(); j++) {
-        MapMatrixNode* other_node = other.columns[j];
-        if (other_node != NULL) {
-            //create the first node in this column
-            MapMatrixNode* cur_node = new MapMatrixNode(other_node->get_row());
-            columns[j] = cur_node;
-
-            //create all other nodes in this column
-            other_node = other_node->get_next();
-            while (other_node != NULL) {
-                MapMatrixNode* new_node = new MapMatrixNode(other_node->get_row());
-                cur_node->set_next(new_node);
-                cur_node = new_node;
-                other_node = other_node->get_next();
-            }
-        }
-    }
+    for (unsigned j = 0; j < other.width(); j++)
+        copy_column(other, j, j, 0);
 }
 
 MapMatrix_Perm::~MapMatrix_Perm()
 {
 }
 
+//returns the approximate number of bytes used to store this matrix, including the permutation and low arrays
+unsigned long MapMatrix_Perm::memory_usage() const
+{
+    return MapMatrix::memory_usage() + (perm.capacity() + mrep.capacity()) * sizeof(unsigned)
+        + (low_by_row.capacity() + low_by_col.capacity()) * sizeof(int);
+}
+
 //sets (to 1) the entry in row i, column j
 //NOTE: to be used for matrix construction only; does not update low array
 void MapMatrix_Perm::set(unsigned i, unsigned j)
@@ -700,12 +833,6 @@ void MapMatrix_Perm::set(unsigned i, unsigned j)
     MapMatrix::set(mrep[i], j);
 }
 
-//returns true if entry (i,j) is 1, false otherwise
-bool MapMatrix_Perm::entry(unsigned i, unsigned j)
-{
-    return MapMatrix::entry(mrep[i], j);
-}
-
 //reduces this matrix and returns the corresponding upper-triangular matrix for the RU-decomposition
 //NOTE -- only to be called before any rows are swapped!
 MapMatrix_RowPriority_Perm* MapMatrix_Perm::decompose_RU()
@@ -713,166 +840,160 @@ MapMatrix_RowPriority_Perm* MapMatrix_Perm::decompose_RU()
     //create the matrix U
     MapMatrix_RowPriority_Perm* U = new MapMatrix_RowPriority_Perm(columns.size()); //NOTE: must be deleted later!
 
+    decompose_RU(U);
+
+    //return the matrix U
+    return U;
+} //end decompose_RU()
+
+//reduces this matrix and fills the low array, performing the opposite row operations on U (so that U must satisfy D = RU on entry)
+//  NOTE: only to be called before any rows are swapped!
+void MapMatrix_Perm::decompose_RU(MapMatrix_RowPriority_Perm* U)
+{
     //loop through columns
     for (unsigned j = 0; j < columns.size(); j++) {
         //while column j is nonempty and its low number is found in the low array, do column operations
-        while (columns[j] != NULL && low_by_row[columns[j]->get_row()] >= 0) {
-            int c = low_by_row[columns[j]->get_row()];
+        int l = column_low(j);
+        while (l >= 0 && low_by_row[l] >= 0) {
+            int c = low_by_row[l];
             add_column(c, j);
             U->add_row(j, c); //perform the opposite row operation on U
+            l = column_low(j);
         }
 
-        if (columns[j] != NULL) //then column is still nonempty, so update lows
+        if (l >= 0) //then column is still nonempty, so update lows
         {
-            low_by_col[j] = columns[j]->get_row();
-            low_by_row[columns[j]->get_row()] = j;
+            low_by_col[j] = l;
+            low_by_row[l] = j;
         }
     }
-
-    //return the matrix U
-    return U;
 } //end decompose_RU()
 
-//returns the row index of the lowest entry in the specified column, or -1 if the column is empty
-int MapMatrix_Perm::low(unsigned j)
-{
-    return low_by_col[j];
-}
-
-//returns the index of the column with low l, or -1 if there is no such column
-int MapMatrix_Perm::find_low(unsigned l)
-{
-    return low_by_row[l];
-}
-
-//transposes rows i and i+1
-//NOTE: this causes low array to be incorrect iff there are columns k and l with low(k)=i, low(l)=i+1, and M[i,l]=1  (as in Vineyards, Case 1.1)
-//      the user must detect this and do a column operation to restore the matrix to a reduced state!
-void MapMatrix_Perm::swap_rows(unsigned i, bool update_lows)
+//permutes the columns of this reduced matrix (and its rows, if row_order is not NULL) all at once, then fixes the RU-decomposition globally
+//  col_order is a map: (current column index) -> (new column index), and similarly for row_order
+//  returns the new upper-triangular matrix for the RU-decomposition; U is not changed
+//  if P is the permutation matrix for col_order, then D = RU implies DP = (RP)(P^T U P); we factor P^T U P = LV with L lower-triangular
+//  and V upper-triangular, so that DP = (RPL)V, and then reduce RPL by column operations that are recorded in V as usual
+MapMatrix_RowPriority_Perm* MapMatrix_Perm::reorder_RU(MapMatrix_RowPriority_Perm* U, const std::vector<unsigned>& col_order, const std::vector<unsigned>* row_order)
 {
-    //get original row indexes of these rows
-    unsigned a = mrep[i];
-    unsigned b = mrep[i + 1];
-
-    //swap entries in permutation and inverse permutation arrays
-    unsigned temp = perm[a]; ///TODO: why do I do this? isn't temp == i?
-    perm[a] = perm[b];
-    perm[b] = temp;
-
-    mrep[i] = b;
-    mrep[i + 1] = a;
-
-    //update low arrays
-    if (update_lows) {
-        int l = low_by_row[i];
-        int k = low_by_row[i + 1];
-
-        low_by_row[i] = k;
-        low_by_row[i + 1] = l;
-
-        if (l != -1)
-            low_by_col[l] = i + 1;
-        if (k != -1)
-            low_by_col[k] = i;
+    unsigned n = columns.size();
+    if (U->width() != n || col_order.size() != n || (row_order != NULL && row_order->size() != num_rows)) {
+        throw std::runtime_error("MapMatrix_Perm::reorder_RU(): sizes of matrices and permutations do not match");
     }
-} //end swap_rows()
 
-//transposes columns j and j+1
-//NOTE: this does not update low arrays! user must do this via swap_lows()
-void MapMatrix_Perm::swap_columns(unsigned j, bool update_lows)
-{
-    //swap columns
-    MapMatrixNode* temp = columns[j];
-    columns[j] = columns[j + 1];
-    columns[j + 1] = temp;
-
-    //update low arrays
-    if (update_lows) {
-        int l = low_by_col[j];
-        int k = low_by_col[j + 1];
-
-        low_by_col[j] = k;
-        low_by_col[j + 1] = l;
-
-        if (l != -1)
-            low_by_row[l] = j + 1;
-        if (k != -1)
-            low_by_row[k] = j;
+    //STEP 1: permute the rows and columns of U, storing the rows of P^T U P, each in increasing order
+    std::vector<std::vector<unsigned>> W(n);
+    std::vector<unsigned> cols;
+    for (unsigned i = 0; i < n; i++) {
+        U->get_row(i, cols);
+        std::vector<unsigned>& row = W[col_order[i]];
+        row.reserve(cols.size());
+        for (unsigned c : cols)
+            row.push_back(col_order[c]);
+        std::sort(row.begin(), row.end());
     }
-}
 
-//clears the matrix, then rebuilds it from reference with columns permuted according to col_order
-//  NOTE: reference should have the same size as this matrix!
-//  col_order is a map: (column index in reference matrix) -> (column index in rebuilt matrix)
-void MapMatrix_Perm::rebuild(MapMatrix_Perm* reference, std::vector<unsigned>& col_order)
-{
-    //clear the matrix
-    for (unsigned j = 0; j < columns.size(); j++) {
-        MapMatrixNode* current = columns[j];
-        while (current != NULL) {
-            MapMatrixNode* next = current->get_next();
-            delete current;
-            current = next;
+    //STEP 2: factor P^T U P = LV by eliminating the entries below the diagonal, row by row; afterwards, W stores the rows of V
+    //  this never fails, since every leading principal submatrix of P^T U P is a permuted principal submatrix of U, and hence invertible
+    std::vector<std::vector<unsigned>> L_cols(n); //L_cols[k] lists the rows i > k for which L(i,k) = 1
+    std::vector<unsigned> sum;
+    for (unsigned i = 0; i < n; i++) {
+        std::vector<unsigned>& row = W[i];
+        while (!row.empty() && row.front() < i) {
+            //row k of V has its first entry in column k, so adding it to row i clears entry (i,k)
+            unsigned k = row.front();
+            sum.clear();
+            std::set_symmetric_difference(row.begin(), row.end(), W[k].begin(), W[k].end(), std::back_inserter(sum));
+            row.swap(sum);
+            L_cols[k].push_back(i);
+        }
+        if (row.empty() || row.front() != i) {
+            throw std::runtime_error("MapMatrix_Perm::reorder_RU(): permuted matrix U is singular");
         }
     }
 
-    //reset low arrays
-    for (unsigned i = 0; i < num_rows; i++)
-        low_by_row[i] = -1;
-    for (unsigned j = 0; j < columns.size(); j++)
-        low_by_col[j] = -1;
+    //STEP 3: store the columns of RP (with rows permuted according to row_order), each in increasing order
+    std::vector<std::vector<unsigned>> R_cols(n);
+    for (unsigned j = 0; j < n; j++) {
+        std::vector<unsigned>& col = R_cols[col_order[j]];
+        get_column(j, col);
+        for (unsigned& row : col)
+            row = (row_order == NULL) ? perm[row] : (*row_order)[perm[row]];
+        std::sort(col.begin(), col.end());
+    }
 
-    //reset permutation vectors
+    //STEP 4: clear the matrix and rebuild it as RPL
+    for (unsigned j = 0; j < n; j++)
+        clear_column(j);
     for (unsigned i = 0; i < num_rows; i++) {
+        low_by_row[i] = -1;
         perm[i] = i;
         mrep[i] = i;
     }
+    for (unsigned j = 0; j < n; j++)
+        low_by_col[j] = -1;
 
-    //build the new matrix
-    for (unsigned j = 0; j < columns.size(); j++) {
-        //copy column j from reference into column col_order[j] of this matrix
-        MapMatrixNode* ref_node = reference->columns[j];
-        if (ref_node != NULL) {
-            //create the first node in this column
-            MapMatrixNode* cur_node = new MapMatrixNode(ref_node->get_row());
-            columns[col_order[j]] = cur_node;
-
-            //create all other nodes in this column
-            ref_node = ref_node->get_next();
-            while (ref_node != NULL) {
-                MapMatrixNode* new_node = new MapMatrixNode(ref_node->get_row());
-                cur_node->set_next(new_node);
-                cur_node = new_node;
-                ref_node = ref_node->get_next();
-            }
+    for (unsigned j = 0; j < n; j++) {
+        //column j of RPL is the sum of column j and the columns i > j of RP for which L(i,j) = 1
+        std::vector<unsigned> col = R_cols[j];
+        for (unsigned i : L_cols[j]) {
+            sum.clear();
+            std::set_symmetric_difference(col.begin(), col.end(), R_cols[i].begin(), R_cols[i].end(), std::back_inserter(sum));
+            col.swap(sum);
+        }
+        for (unsigned row : col) //increasing order, so that each entry is inserted at the start of the column
+            MapMatrix::set(row, j);
+        update_storage(j);
+    }
+
+    //STEP 5: build V, then reduce the matrix
+    MapMatrix_RowPriority_Perm* V = new MapMatrix_RowPriority_Perm(n); //NOTE: must be deleted later!
+    for (unsigned i = 0; i < n; i++) {
+        for (unsigned c : W[i]) {
+            if (c > i) //the diagonal entries are already set
+                V->set(i, c);
         }
     }
-} //end rebuild()
+    decompose_RU(V);
+
+    return V;
+} //end reorder_RU()
+
+//clears the matrix, then rebuilds it from reference with columns permuted according to col_order
+//  NOTE: reference should have the same size as this matrix!
+//  col_order is a map: (column index in reference matrix) -> (column index in rebuilt matrix)
+void MapMatrix_Perm::rebuild(const MapMatrix_Compact* reference, std::vector<unsigned>& col_order)
+{
+    rebuild_from(reference, col_order, NULL);
+}
 
 //clears the matrix, then rebuilds it from reference with columns permuted according to col_order and rows permuted according to row_order
 //  NOTE: reference should have the same size as this matrix!
 //  col_order is a map: (column index in reference matrix) -> (column index in rebuilt matrix) and similarly for row_order
-void MapMatrix_Perm::rebuild(MapMatrix_Perm* reference, std::vector<unsigned>& col_order, std::vector<unsigned>& row_order)
+void MapMatrix_Perm::rebuild(const MapMatrix_Compact* reference, std::vector<unsigned>& col_order, std::vector<unsigned>& row_order)
+{
+    rebuild_from(reference, col_order, &row_order);
+}
+
+//as above, but generating the columns of reference on demand
+void MapMatrix_Perm::rebuild(const ImplicitBoundaryMatrix* reference, std::vector<unsigned>& col_order)
 {
-    ///TESTING: check the permutation
-    //std::vector<bool> check(columns.size(), false);
-    //for (unsigned j = 0; j < columns.size(); j++)
-    //    check[col_order[j]] = true;
-    //for (unsigned j = 0; j < columns.size(); j++)
-    //    if (check[j] == false) {
-    //        debug() << "ERROR: column permutation skipped" << j;
-    //    }
+    rebuild_from(reference, col_order, NULL);
+}
+
+void MapMatrix_Perm::rebuild(const ImplicitBoundaryMatrix* reference, std::vector<unsigned>& col_order, std::vector<unsigned>& row_order)
+{
+    rebuild_from(reference, col_order, &row_order);
+}
 
+//clears the matrix, then rebuilds it from any reference that provides its columns, with rows in increasing order, by get_column()
+//  row_order may be NULL, in which case the rows are not permuted
+template <typename Reference>
+void MapMatrix_Perm::rebuild_from(const Reference* reference, const std::vector<unsigned>& col_order, const std::vector<unsigned>* row_order)
+{
     //clear the matrix
-    for (unsigned j = 0; j < columns.size(); j++) {
-        MapMatrixNode* current = columns[j];
-        while (current != NULL) {
-            MapMatrixNode* next = current->get_next();
-            delete current;
-            current = next;
-        }
-        columns[j] = NULL; ///TODO: CHECK -- HAVE I AVOIDED A MEMORY LEAK HERE?
-    }
+    for (unsigned j = 0; j < columns.size(); j++)
+        clear_column(j);
 
     //reset low arrays
     for (unsigned i = 0; i < num_rows; i++)
@@ -886,15 +1007,20 @@ void MapMatrix_Perm::rebuild(MapMatrix_Perm* reference, std::vector<unsigned>& c
         mrep[i] = i;
     }
 
-    //build the new matrix
+    //build the new matrix: copy column j from reference into column col_order[j] of this matrix
+    std::vector<unsigned> rows;
     for (unsigned j = 0; j < columns.size(); j++) {
-        MapMatrixNode* ref_node = reference->columns[j];
-        while (ref_node != NULL) {
-            MapMatrix::set(row_order[ref_node->get_row()], col_order[j]);
-            ref_node = ref_node->get_next();
+        reference->get_column(j, rows);
+        if (row_order != NULL) {
+            for (unsigned& row : rows)
+                row = (*row_order)[row];
+            std::sort(rows.begin(), rows.end());
         }
+        for (unsigned row : rows) //increasing order, so that each entry is inserted at the start of the column
+            MapMatrix::set(row, col_order[j]);
+        update_storage(col_order[j]);
     }
-} //end rebuild()
+} //end rebuild_from()
 
 //function to print the matrix to standard output, for testing purposes
 void MapMatrix_Perm::print()
@@ -911,15 +1037,12 @@ void MapMatrix_Perm::print()
         for (unsigned j = 0; j < columns.size(); j++)
             mx.at(i, j) = false;
 
-    //traverse the linked lists in order to fill the 2D array
-    MapMatrixNode* current;
+    //traverse the columns in order to fill the 2D array
+    std::vector<unsigned> rows;
     for (unsigned j = 0; j < columns.size(); j++) {
-        current = columns[j];
-        while (current != NULL) {
-            int row = current->get_row();
+        get_column(j, rows);
+        for (unsigned row : rows)
             mx.at(perm[row], j) = true;
-            current = current->get_next();
-        }
     }
 
     //print the matrix
@@ -948,19 +1071,11 @@ void MapMatrix_Perm::check_lows()
     for (unsigned j = 0; j < columns.size(); j++) {
         //find the lowest entry in column j
         int lowest = -1;
-        if (columns[j] != NULL) {
-            //consider the first node
-            MapMatrixNode* current = columns[j];
-            lowest = perm[current->get_row()];
-
-            //consider all following nodes
-            current = current->get_next();
-            while (current != NULL) {
-                if (static_cast<int>(perm[current->get_row()]) > lowest)
-                    lowest = perm[current->get_row()];
-
-                current = current->get_next();
-            }
+        std::vector<unsigned> rows;
+        get_column(j, rows);
+        for (unsigned row : rows) {
+            if (static_cast<int>(perm[row]) > lowest)
+                lowest = perm[row];
         }
 
         //does this match low_by_col[j]?
@@ -989,47 +1104,35 @@ MapMatrix_RowPriority_Perm::MapMatrix_RowPriority_Perm(unsigned size)
 
 //copy constructor
 MapMatrix_RowPriority_Perm::MapMatrix_RowPriority_Perm(const MapMatrix_RowPriority_Perm& other)
-    : MapMatrix_Base(other.height())
+    : MapMatrix_Base(other.num_rows, other.columns.size())
     , perm(other.perm)
     , mrep(other.mrep)
 {
     //copy all matrix entries
-    for (unsigned j = 0; j < other.height(); j++) {
-        MapMatrixNode* other_node = other.columns[j];
-        if (other_node != NULL) {
-            //create the first node in this column
-            MapMatrixNode* cur_node = new MapMatrixNode(other_node->get_row());
-            columns[j] = cur_node;
-
-            //create all other nodes in this column
-            other_node = other_node->get_next();
-            while (other_node != NULL) {
-                MapMatrixNode* new_node = new MapMatrixNode(other_node->get_row());
-                cur_node->set_next(new_node);
-                cur_node = new_node;
-                other_node = other_node->get_next();
-            }
-        }
-    }
+    for (unsigned j = 0; j < other.height(); j++)
+        copy_column(other, j, j, 0);
 }
 
 MapMatrix_RowPriority_Perm::~MapMatrix_RowPriority_Perm()
 {
 }
 
-unsigned MapMatrix_RowPriority_Perm::width() const
+//returns the number of nonzero entries in the matrix
+unsigned long MapMatrix_RowPriority_Perm::num_entries() const
 {
-    return MapMatrix_Base::height();
+    return MapMatrix_Base::num_entries();
 }
 
-unsigned MapMatrix_RowPriority_Perm::height() const
+//returns the approximate number of bytes used to store this matrix, including the permutation arrays
+unsigned long MapMatrix_RowPriority_Perm::memory_usage() const
 {
-    return MapMatrix_Base::width();
+    return MapMatrix_Base::memory_usage() + (perm.capacity() + mrep.capacity()) * sizeof(unsigned);
 }
 
 void MapMatrix_RowPriority_Perm::set(unsigned i, unsigned j)
 {
     MapMatrix_Base::set(mrep[j], i);
+    update_storage(i);
 }
 
 void MapMatrix_RowPriority_Perm::clear(unsigned i, unsigned j)
@@ -1037,40 +1140,19 @@ void MapMatrix_RowPriority_Perm::clear(unsigned i, unsigned j)
     MapMatrix_Base::clear(mrep[j], i);
 }
 
-bool MapMatrix_RowPriority_Perm::entry(unsigned i, unsigned j)
-{
-    return MapMatrix_Base::entry(mrep[j], i);
-}
-
-//adds row j to row k; RESULT: row j is not changed, row k contains sum of rows j and k (with mod-2 arithmetic)
-void MapMatrix_RowPriority_Perm::add_row(unsigned j, unsigned k)
-{
-    return MapMatrix_Base::add_column(j, k);
-}
-
-//transposes rows i and i+1
-void MapMatrix_RowPriority_Perm::swap_rows(unsigned i)
+//stores the column indexes of the nonzero entries in row i in cols, in increasing order
+void MapMatrix_RowPriority_Perm::get_row(unsigned i, std::vector<unsigned>& cols) const
 {
-    MapMatrixNode* temp = columns[i];
-    columns[i] = columns[i + 1];
-    columns[i + 1] = temp;
+    get_column(i, cols);
+    for (unsigned& c : cols)
+        c = perm[c];
+    std::sort(cols.begin(), cols.end());
 }
 
-//transposes columns j and j+1
-void MapMatrix_RowPriority_Perm::swap_columns(unsigned j)
+//returns the number of rows that are stored as arrays of bits
+unsigned MapMatrix_RowPriority_Perm::num_dense_rows() const
 {
-    //get original indexes of these columns
-    unsigned a = mrep[j];
-    unsigned b = mrep[j + 1];
-
-    //swap perm[a] and perm[b]
-    unsigned temp = perm[a];
-    perm[a] = perm[b];
-    perm[b] = temp;
-
-    //swap mrep[i] and mrep[i+1]
-    mrep[j] = b;
-    mrep[j + 1] = a;
+    return num_dense_columns();
 }
 
 //prints the matrix to debug(), for testing
@@ -1089,15 +1171,12 @@ void MapMatrix_RowPriority_Perm::print()
         for (unsigned j = 0; j < num_rows; j++)
             mx.at(i, j) = false;
 
-    //traverse the linked lists in order to fill the 2D array
-    MapMatrixNode* current;
+    //traverse the rows in order to fill the 2D array
+    std::vector<unsigned> cols;
     for (unsigned j = 0; j < columns.size(); j++) {
-        current = columns[j];
-        while (current != NULL) {
-            unsigned row = current->get_row();
-            mx.at(j, perm[row]) = true;
-            current = current->get_next();
-        }
+        get_row(j, cols);
+        for (unsigned k = 0; k < cols.size(); k++)
+            mx.at(j, cols[k]) = true;
     }
 
     //print the matrix
@@ -1125,3 +1204,74 @@ void MapMatrix_RowPriority_Perm::print_perm()
     for (unsigned i = 0; i < mrep.size(); i++)
         qd << mrep[i];
 }
+
+/********** implementation of class MapMatrix_Compact, for read-only reference matrices **********/
+
+//copies the entries of source, which must not have had its rows permuted
+MapMatrix_Compact::MapMatrix_Compact(const MapMatrix_Perm& source)
+    : num_rows(source.height())
+    , entries(source.num_entries())
+    , col_start(source.width() + 1, 0)
+{
+    std::vector<unsigned> rows;
+    for (unsigned j = 0; j < source.width(); j++) {
+        col_start[j] = data.size();
+        source.get_column(j, rows); //decreasing order
+
+        unsigned prev = 0;
+        for (auto it = rows.rbegin(); it != rows.rend(); ++it) {
+            unsigned delta = *it - prev;
+            prev = *it;
+            while (delta >= 0x80) {
+                data.push_back((uint8_t)(delta | 0x80));
+                delta >>= 7;
+            }
+            data.push_back((uint8_t)delta);
+        }
+    }
+    col_start[source.width()] = data.size();
+    data.shrink_to_fit();
+}
+
+unsigned MapMatrix_Compact::width() const
+{
+    return col_start.size() - 1;
+}
+
+unsigned MapMatrix_Compact::height() const
+{
+    return num_rows;
+}
+
+//returns the number of nonzero entries in the matrix
+unsigned long MapMatrix_Compact::num_entries() const
+{
+    return entries;
+}
+
+//returns the approximate number of bytes used to store this matrix
+unsigned long MapMatrix_Compact::memory_usage() const
+{
+    return sizeof(*this) + col_start.capacity() * sizeof(unsigned long) + data.capacity() * sizeof(uint8_t);
+}
+
+//stores the row indexes of the entries in column j in rows, in increasing order
+void MapMatrix_Compact::get_column(unsigned j, std::vector<unsigned>& rows) const
+{
+    if (j + 1 >= col_start.size())
+        throw std::runtime_error("MapMatrix_Compact::get_column(): attempting to access column past end of matrix");
+
+    rows.clear();
+    unsigned row = 0;
+    for (unsigned long pos = col_start[j]; pos < col_start[j + 1];) {
+        unsigned delta = 0;
+        for (unsigned shift = 0;; shift += 7) {
+            uint8_t byte = data[pos++];
+            delta |= (unsigned)(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                break;
+        }
+        row += delta;
+        rows.push_back(row);
+    }
+} //end get_column()
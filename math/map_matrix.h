@@ -36,6 +36,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
  * The class MapMatrix inherits MapMatrix_Base and stores matrices in a column-sparse format, designed for basic persistence calcuations.
  * The class MapMatrix_Perm inherits MapMatrix, adding functionality for row and column permutations; it is designed for the reduced matrices of vineyard updates.
  * Lastly, the class MapMatrix_RowPriority_Perm inherits MapMatrix_Base and stores matrices in a row-sparse format with row and column permutations; it is designed for the upper-triangular matrices of vineyard updates.
+ * The class MapMatrix_Compact is separate: it is a read-only copy of a matrix in compressed sparse column format, kept as the reference from which MapMatrix_Perm is rebuilt.
+ * Columns that fill in during reduction (and rows of MapMatrix_RowPriority_Perm) are stored as arrays of bits instead of linked lists once they have many entries,
+ * so that adding them is a sequence of word operations (vectorized with AVX2 or AVX-512 instructions, if the compiler targets them) rather than a merge of linked lists.
+ *
+ * None of these classes has virtual functions other than its destructor: each subclass hides the functions of its parent that it changes,
+ * so every call is resolved at compile time, and the functions used in the inner loops of reductions and vineyard updates are defined inline below.
  */
 
 #ifndef __MapMatrix_H__
@@ -43,25 +49,39 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 class IndexMatrix;
 
+#include <cstddef> //for NULL
+#include <cstdint>
 #include <ostream> //for testing
+#include <stdexcept>
+#include <utility> //for std::swap
 #include <vector>
 
 //base class simply implements features common to all MapMatrices, whether column-priority or row-priority
 //written here using column-priority terminology, but this class is meant to be inherited, not instantiated directly
 class MapMatrix_Base {
+    friend class MapMatrix_Compact; //reads the columns of the matrix that it copies
+
+public:
+    //returns the number of entries in the columns that have been added by the calling thread, in all matrices, so far
+    //  this counts the work of reductions and vineyard updates the same way on every run, unlike their running time
+    static unsigned long long addition_work();
+
 protected:
     MapMatrix_Base(unsigned rows, unsigned cols); //constructor to create matrix of specified size (all entries zero)
     MapMatrix_Base(unsigned size); //constructor to create a (square) identity matrix
     virtual ~MapMatrix_Base(); //destructor
 
-    virtual unsigned width() const; //returns the number of columns in the matrix
-    virtual unsigned height() const; //returns the number of rows in the matrix
+    unsigned width() const; //returns the number of columns in the matrix
+    unsigned height() const; //returns the number of rows in the matrix
+    unsigned long num_entries() const; //returns the number of nonzero entries in the matrix
+    unsigned long memory_usage() const; //returns the approximate number of bytes used to store this matrix
 
-    virtual void set(unsigned i, unsigned j); //sets (to 1) the entry in row i, column j
-    virtual void clear(unsigned i, unsigned j); //clears (sets to 0) the entry in row i, column j
-    virtual bool entry(unsigned i, unsigned j); //returns true if entry (i,j) is 1, false otherwise
+    void set(unsigned i, unsigned j); //sets (to 1) the entry in row i, column j
+    void clear(unsigned i, unsigned j); //clears (sets to 0) the entry in row i, column j
+    bool entry(unsigned i, unsigned j); //returns true if entry (i,j) is 1, false otherwise
 
-    virtual void add_column(unsigned j, unsigned k); //adds column j to column k; RESULT: column j is not changed, column k contains sum of columns j and k (with mod-2 arithmetic)
+    void add_column(unsigned j, unsigned k); //adds column j to column k; RESULT: column j is not changed, column k contains sum of columns j and k (with mod-2 arithmetic)
+    void add_column_from(const MapMatrix_Base& source, unsigned j, unsigned k); //adds column j of source to column k of this matrix
 
     class MapMatrixNode { //subclass for the nodes in the MapMatrix
     public:
@@ -76,9 +96,36 @@ protected:
         MapMatrixNode* next; //pointer to the next entry in the column containing this node
     };
 
-    std::vector<MapMatrixNode*> columns; //vector of pointers to nodes representing columns of the matrix
+    //a column with at least one entry for every 64 rows is stored as an array of bits instead of a linked list;
+    //  it is stored as a linked list again once it has fewer than a quarter as many entries, so it is never empty
+    struct DenseColumn {
+        std::vector<uint64_t> bits; //bit i is set iff the column has an entry in row i
+        int low; //index of the last row with an entry
+    };
+
+    std::vector<MapMatrixNode*> columns; //vector of pointers to nodes representing columns of the matrix (NULL for columns stored as arrays of bits)
+    std::vector<DenseColumn*> dense_columns; //arrays of bits for the columns stored as such, NULL for the columns stored as linked lists
+    std::vector<unsigned> column_sizes; //number of entries in each column
 
     unsigned num_rows; //number of rows in the matrix
+
+    bool column_is_empty(unsigned j) const; //returns true iff column j has no entries
+    int column_low(unsigned j) const; //returns the index of the last row with an entry in column j, or -1 if column j is empty
+    void get_column(unsigned j, std::vector<unsigned>& rows) const; //stores the row indexes of the entries in column j in rows, in decreasing order
+    void copy_column(const MapMatrix_Base& source, unsigned j, unsigned k, unsigned offset); //replaces column k with column j of source, with row indexes increased by offset
+    void clear_column(unsigned j); //removes all entries from column j
+    void swap_column_storage(unsigned j, unsigned k); //exchanges columns j and k
+    unsigned num_dense_columns() const; //returns the number of columns that are stored as arrays of bits
+    void update_storage(unsigned j); //chooses the storage for column j according to its number of entries
+
+private:
+    static thread_local unsigned long long addition_entries; //returned by addition_work()
+
+    int merge_column(const MapMatrix_Base& source, unsigned j, unsigned k); //adds column j of source to column k, both linked lists, and returns the change in the number of entries in column k
+    unsigned num_words() const; //returns the number of 64-bit words in a column stored as an array of bits
+    void make_dense(unsigned j); //stores column j as an array of bits
+    void make_sparse(unsigned j); //stores column j as a linked list
+    void flip(unsigned j, unsigned i); //adds an entry in row i to column j, which is stored as an array of bits (with mod-2 arithmetic)
 };
 
 //MapMatrix is a column-priority matrix designed for standard persistence calculations
@@ -90,17 +137,20 @@ public:
     virtual ~MapMatrix(); //destructor
 
     friend std::ostream& operator<<(std::ostream&, const MapMatrix&);
-    virtual bool operator==(MapMatrix& other);
+    bool operator==(MapMatrix& other);
     unsigned width() const; //returns the number of columns in the matrix
     unsigned height() const; //returns the number of rows in the matrix
+    unsigned long num_entries() const; //returns the number of nonzero entries in the matrix
+    unsigned long memory_usage() const; //returns the approximate number of bytes used to store this matrix
 
     void reserve_cols(unsigned num_cols); //requests that the columns vector have enough capacity for num_cols columns
 
-    virtual void set(unsigned i, unsigned j); //sets (to 1) the entry in row i, column j
-    virtual bool entry(unsigned i, unsigned j); //returns true if entry (i,j) is 1, false otherwise
+    void set(unsigned i, unsigned j); //sets (to 1) the entry in row i, column j
+    bool entry(unsigned i, unsigned j); //returns true if entry (i,j) is 1, false otherwise
 
-    virtual int low(unsigned j); //returns the "low" index in the specified column, or -1 if the column is empty
+    int low(unsigned j); //returns the "low" index in the specified column, or -1 if the column is empty
     bool col_is_empty(unsigned j); //returns true iff column j is empty (for columns that are not empty, this method is faster than low(j))
+    unsigned num_dense_columns() const; //returns the number of columns that are stored as arrays of bits
 
     void add_column(unsigned j, unsigned k); //adds column j to column k; RESULT: column j is not changed, column k contains sum of columns j and k (with mod-2 arithmetic)
     void add_column(MapMatrix* other, unsigned j, unsigned k); //adds column j from MapMatrix* other to column k of this matrix
@@ -119,13 +169,17 @@ public:
 
 //MapMatrix with row/column permutations and low array, designed for "vineyard updates"
 class MapMatrix_RowPriority_Perm; //forward declaration
-class MapMatrix_Perm : public MapMatrix {
+class MapMatrix_Compact; //forward declaration
+class ImplicitBoundaryMatrix; //forward declaration
+class MapMatrix_Perm final : public MapMatrix {
 public:
     MapMatrix_Perm(unsigned rows, unsigned cols);
     MapMatrix_Perm(unsigned size);
     MapMatrix_Perm(const MapMatrix_Perm& other); //copy constructor
     ~MapMatrix_Perm();
 
+    unsigned long memory_usage() const; //returns the approximate number of bytes used to store this matrix, including the permutation and low arrays
+
     void set(unsigned i, unsigned j); //sets (to 1) the entry in row i, column j
     bool entry(unsigned i, unsigned j); //returns true if entry (i,j) is 1, false otherwise
 
@@ -133,6 +187,16 @@ public:
     //  NOTE: only to be called before any rows are swapped!
     MapMatrix_RowPriority_Perm* decompose_RU(); 
 
+    //reduces this matrix and fills the low array, performing the opposite row operations on U (so that U must satisfy D = RU on entry)
+    //  NOTE: only to be called before any rows are swapped!
+    void decompose_RU(MapMatrix_RowPriority_Perm* U);
+
+    //permutes the columns of this reduced matrix (and its rows, if row_order is not NULL) all at once, then fixes the RU-decomposition globally:
+    //  the permuted U is factored as LU, L is absorbed into this matrix, and this matrix is reduced again
+    //  col_order is a map: (current column index) -> (new column index), and similarly for row_order
+    //  returns the new upper-triangular matrix for the RU-decomposition; U is not changed
+    MapMatrix_RowPriority_Perm* reorder_RU(MapMatrix_RowPriority_Perm* U, const std::vector<unsigned>& col_order, const std::vector<unsigned>* row_order);
+
     int low(unsigned j); //returns the "low" index in the specified column, or -1 if the column is empty
     int find_low(unsigned l); //returns the index of the column with low l, or -1 if there is no such column
 
@@ -140,13 +204,17 @@ public:
     void swap_columns(unsigned j, bool update_lows); //transposes columns j and j+1, optionally updates low array
 
     //clears the matrix, then rebuilds it from reference with columns permuted according to col_order
-    void rebuild(MapMatrix_Perm* reference, std::vector<unsigned>& col_order); 
-    
+    void rebuild(const MapMatrix_Compact* reference, std::vector<unsigned>& col_order);
+
     //clears the matrix, then rebuilds it from reference with columns permuted according to col_order and rows permuted according to row_order
-    void rebuild(MapMatrix_Perm* reference, std::vector<unsigned>& col_order, std::vector<unsigned>& row_order); 
+    void rebuild(const MapMatrix_Compact* reference, std::vector<unsigned>& col_order, std::vector<unsigned>& row_order);
+
+    //as above, but generating the columns of reference on demand
+    void rebuild(const ImplicitBoundaryMatrix* reference, std::vector<unsigned>& col_order);
+    void rebuild(const ImplicitBoundaryMatrix* reference, std::vector<unsigned>& col_order, std::vector<unsigned>& row_order);
 
     ///FOR TESTING ONLY
-    virtual void print(); //prints the matrix to standard output (for testing)
+    void print(); //prints the matrix to standard output (for testing)
     void check_lows(); //checks for inconsistencies in low arrays
 
 protected:
@@ -154,10 +222,16 @@ protected:
     std::vector<unsigned> mrep; //inverse permutation vector
     std::vector<int> low_by_row; //stores index of column with each low number, or -1 if no such column exists -- NOTE: only accurate after decompose_RU() is called
     std::vector<int> low_by_col; //stores the low number for each column, or -1 if the column is empty -- NOTE: only accurate after decompose_RU() is called
+
+private:
+    //clears the matrix, then rebuilds it from any reference that provides its columns, with rows in increasing order, by get_column()
+    //  row_order may be NULL, in which case the rows are not permuted
+    template <typename Reference>
+    void rebuild_from(const Reference* reference, const std::vector<unsigned>& col_order, const std::vector<unsigned>* row_order);
 };
 
 //MapMatrix stored in row-priority format, with row/column permutations, designed for upper-triangular matrices in vineyard updates
-class MapMatrix_RowPriority_Perm : public MapMatrix_Base {
+class MapMatrix_RowPriority_Perm final : public MapMatrix_Base {
 public:
     MapMatrix_RowPriority_Perm(unsigned size); //constructs the identity matrix of specified size
     MapMatrix_RowPriority_Perm(const MapMatrix_RowPriority_Perm& other); //copy constructor
@@ -165,6 +239,8 @@ public:
 
     unsigned width() const; //returns the number of columns in the matrix
     unsigned height() const; //returns the number of rows in the matrix
+    unsigned long num_entries() const; //returns the number of nonzero entries in the matrix
+    unsigned long memory_usage() const; //returns the approximate number of bytes used to store this matrix, including the permutation arrays
 
     void set(unsigned i, unsigned j); //sets (to 1) the entry in row i, column j
     void clear(unsigned i, unsigned j); //clears (sets to 0) the entry in row i, column j
@@ -172,9 +248,13 @@ public:
 
     void add_row(unsigned j, unsigned k); //adds row j to row k; RESULT: row j is not changed, row k contains sum of rows j and k (with mod-2 arithmetic)
 
+    void get_row(unsigned i, std::vector<unsigned>& cols) const; //stores the column indexes of the nonzero entries in row i in cols, in increasing order
+
     void swap_rows(unsigned i); //transposes rows i and i+1
     void swap_columns(unsigned j); //transposes columns j and j+1
 
+    unsigned num_dense_rows() const; //returns the number of rows that are stored as arrays of bits
+
     ///FOR TESTING ONLY
     void print(); //prints the matrix to qDebug() for testing
     void print_perm(); //prints the permutation vectors to qDebug() for testing
@@ -184,4 +264,286 @@ protected:
     std::vector<unsigned> mrep; //inverse permutation vector
 };
 
+//read-only copy of a MapMatrix_Perm in compressed sparse column format, from which the matrix can be rebuilt after it has been reduced
+//  the row indexes of each column are stored in increasing order as differences from the previous row index (the first from zero),
+//  each difference in as few bytes as possible (seven bits per byte, the high bit marking that another byte follows),
+//  so that a column of a boundary matrix, which has few entries with nearby row indexes, takes a few bytes instead of a linked list
+class MapMatrix_Compact {
+public:
+    MapMatrix_Compact(const MapMatrix_Perm& source); //copies the entries of source, which must not have had its rows permuted
+
+    unsigned width() const; //returns the number of columns in the matrix
+    unsigned height() const; //returns the number of rows in the matrix
+    unsigned long num_entries() const; //returns the number of nonzero entries in the matrix
+    unsigned long memory_usage() const; //returns the approximate number of bytes used to store this matrix
+
+    void get_column(unsigned j, std::vector<unsigned>& rows) const; //stores the row indexes of the entries in column j in rows, in increasing order
+
+private:
+    unsigned num_rows; //number of rows in the matrix
+    unsigned long entries; //number of nonzero entries in the matrix
+    std::vector<unsigned long> col_start; //column j is encoded in bytes col_start[j] through col_start[j+1] - 1
+    std::vector<uint8_t> data; //the encoded row indexes of all columns
+};
+
+//the following functions are called in the inner loops of reductions and vineyard updates, so they are defined here, where they can be inlined
+
+//implementation of subclass MapMatrixNode
+inline MapMatrix_Base::MapMatrixNode::MapMatrixNode(unsigned row)
+    : row_index(row)
+    , next(NULL)
+{
+}
+
+inline unsigned MapMatrix_Base::MapMatrixNode::get_row()
+{
+    return row_index;
+}
+
+inline void MapMatrix_Base::MapMatrixNode::set_next(MapMatrixNode* n)
+{
+    next = n;
+}
+
+inline MapMatrix_Base::MapMatrixNode* MapMatrix_Base::MapMatrixNode::get_next()
+{
+    return next;
+}
+
+//returns the number of columns in the matrix
+inline unsigned MapMatrix_Base::width() const
+{
+    return columns.size();
+}
+
+//returns the number of rows in the matrix
+inline unsigned MapMatrix_Base::height() const
+{
+    return num_rows;
+}
+
+//returns true if entry (i,j) is 1, false otherwise
+inline bool MapMatrix_Base::entry(unsigned i, unsigned j)
+{
+    //make sure this entry is valid
+    if (columns.size() <= j)
+        throw std::runtime_error("MapMatrix_Base::entry(): attempting to check entry in a column past end of matrix");
+    if (num_rows <= i)
+        throw std::runtime_error("MapMatrix_Base::entry(): attempting to check entry in a row past end of matrix");
+
+    if (dense_columns[j] != NULL)
+        return (dense_columns[j]->bits[i / 64] >> (i % 64)) & 1;
+
+    //get initial node pointer
+    MapMatrixNode* np = columns[j];
+
+    //loop while there is another node to check
+    while (np != NULL) {
+        if (np->get_row() < i) //then we won't find row i because row entrys are sorted in descending order
+            return false;
+
+        if (np->get_row() == i) //then we found the row we wanted
+            return true;
+
+        //if we are still looking, then get the next node
+        np = np->get_next();
+    }
+
+    //if we get here, then we didn't find the entry
+    return false;
+} //end entry()
+
+//adds column j to column k
+//  RESULT: column j is not changed, column k contains sum of columns j and k (with mod-2 arithmetic)
+inline void MapMatrix_Base::add_column(unsigned j, unsigned k)
+{
+    add_column_from(*this, j, k);
+}
+
+//returns true iff column j has no entries
+inline bool MapMatrix_Base::column_is_empty(unsigned j) const
+{
+    return columns[j] == NULL && dense_columns[j] == NULL;
+}
+
+//returns the index of the last row with an entry in column j, or -1 if column j is empty
+inline int MapMatrix_Base::column_low(unsigned j) const
+{
+    if (dense_columns[j] != NULL)
+        return dense_columns[j]->low;
+    if (columns[j] != NULL)
+        return columns[j]->get_row(); //because row indexes are sorted in descending order
+    return -1;
+}
+
+//exchanges columns j and k
+inline void MapMatrix_Base::swap_column_storage(unsigned j, unsigned k)
+{
+    std::swap(columns[j], columns[k]);
+    std::swap(dense_columns[j], dense_columns[k]);
+    std::swap(column_sizes[j], column_sizes[k]);
+}
+
+//returns the number of columns in the matrix
+inline unsigned MapMatrix::width() const
+{
+    return MapMatrix_Base::width();
+}
+
+//returns the number of rows in the matrix
+inline unsigned MapMatrix::height() const
+{
+    return MapMatrix_Base::height();
+}
+
+//returns true if entry (i,j) is 1, false otherwise
+inline bool MapMatrix::entry(unsigned i, unsigned j)
+{
+    return MapMatrix_Base::entry(i, j);
+}
+
+//returns the "low" index in the specified column, or 0 if the column is empty or does not exist
+inline int MapMatrix::low(unsigned j)
+{
+    //make sure this query is valid
+    if (columns.size() <= j)
+        throw std::runtime_error("MapMatrix::low(): attempting to check low number of a column past end of matrix");
+
+    return column_low(j);
+}
+
+//returns true iff column j is empty
+inline bool MapMatrix::col_is_empty(unsigned j)
+{
+    return column_is_empty(j);
+}
+
+//adds column j to column k; RESULT: column j is not changed, column k contains sum of columns j and k (with mod-2 arithmetic)
+inline void MapMatrix::add_column(unsigned j, unsigned k)
+{
+    MapMatrix_Base::add_column(j, k);
+}
+
+//adds column j from MapMatrix* other to column k of this matrix
+inline void MapMatrix::add_column(MapMatrix* other, unsigned j, unsigned k)
+{
+    add_column_from(*other, j, k);
+} //end add_column(MapMatrix*, unsigned, unsigned)
+
+//returns true if entry (i,j) is 1, false otherwise
+inline bool MapMatrix_Perm::entry(unsigned i, unsigned j)
+{
+    return MapMatrix::entry(mrep[i], j);
+}
+
+//returns the row index of the lowest entry in the specified column, or -1 if the column is empty
+inline int MapMatrix_Perm::low(unsigned j)
+{
+    return low_by_col[j];
+}
+
+//returns the index of the column with low l, or -1 if there is no such column
+inline int MapMatrix_Perm::find_low(unsigned l)
+{
+    return low_by_row[l];
+}
+
+//transposes rows i and i+1
+//NOTE: this causes low array to be incorrect iff there are columns k and l with low(k)=i, low(l)=i+1, and M[i,l]=1  (as in Vineyards, Case 1.1)
+//      the user must detect this and do a column operation to restore the matrix to a reduced state!
+inline void MapMatrix_Perm::swap_rows(unsigned i, bool update_lows)
+{
+    //get original row indexes of these rows
+    unsigned a = mrep[i];
+    unsigned b = mrep[i + 1];
+
+    //swap entries in permutation and inverse permutation arrays
+    unsigned temp = perm[a]; ///TODO: why do I do this? isn't temp == i?
+    perm[a] = perm[b];
+    perm[b] = temp;
+
+    mrep[i] = b;
+    mrep[i + 1] = a;
+
+    //update low arrays
+    if (update_lows) {
+        int l = low_by_row[i];
+        int k = low_by_row[i + 1];
+
+        low_by_row[i] = k;
+        low_by_row[i + 1] = l;
+
+        if (l != -1)
+            low_by_col[l] = i + 1;
+        if (k != -1)
+            low_by_col[k] = i;
+    }
+} //end swap_rows()
+
+//transposes columns j and j+1
+//NOTE: this does not update low arrays! user must do this via swap_lows()
+inline void MapMatrix_Perm::swap_columns(unsigned j, bool update_lows)
+{
+    //swap columns
+    swap_column_storage(j, j + 1);
+
+    //update low arrays
+    if (update_lows) {
+        int l = low_by_col[j];
+        int k = low_by_col[j + 1];
+
+        low_by_col[j] = k;
+        low_by_col[j + 1] = l;
+
+        if (l != -1)
+            low_by_row[l] = j + 1;
+        if (k != -1)
+            low_by_row[k] = j;
+    }
+}
+
+inline unsigned MapMatrix_RowPriority_Perm::width() const
+{
+    return MapMatrix_Base::height();
+}
+
+inline unsigned MapMatrix_RowPriority_Perm::height() const
+{
+    return MapMatrix_Base::width();
+}
+
+inline bool MapMatrix_RowPriority_Perm::entry(unsigned i, unsigned j)
+{
+    return MapMatrix_Base::entry(mrep[j], i);
+}
+
+//adds row j to row k; RESULT: row j is not changed, row k contains sum of rows j and k (with mod-2 arithmetic)
+inline void MapMatrix_RowPriority_Perm::add_row(unsigned j, unsigned k)
+{
+    MapMatrix_Base::add_column(j, k);
+}
+
+//transposes rows i and i+1
+inline void MapMatrix_RowPriority_Perm::swap_rows(unsigned i)
+{
+    swap_column_storage(i, i + 1);
+}
+
+//transposes columns j and j+1
+inline void MapMatrix_RowPriority_Perm::swap_columns(unsigned j)
+{
+    //get original indexes of these columns
+    unsigned a = mrep[j];
+    unsigned b = mrep[j + 1];
+
+    //swap perm[a] and perm[b]
+    unsigned temp = perm[a];
+    perm[a] = perm[b];
+    perm[b] = temp;
+
+    //swap mrep[i] and mrep[i+1]
+    mrep[j] = b;
+    mrep[j + 1] = a;
+}
+
 #endif // __MapMatrix_H__
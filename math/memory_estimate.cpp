@@ -0,0 +1,240 @@
+/**********************************************************************
+Copyright 2014-2016 The RIVET Developers. See the COPYRIGHT file at
+the top-level directory of this distribution.
+
+This file is part of RIVET.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+
+#include "memory_estimate.h"
+
+#include "debug.h"
+#include "st_node.h"
+
+#include <algorithm>
+#include <climits>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <string>
+
+namespace {
+
+//approximate bytes of the allocator's bookkeeping for each block allocated on the heap
+const uint64_t MALLOC_OVERHEAD = 16;
+
+//bytes for each simplex in the tree: the node, and the pointer to it in its parent's vector of children
+const uint64_t TREE_NODE_BYTES = sizeof(STNode) + MALLOC_OVERHEAD + 2 * sizeof(STNode*);
+
+//bytes for each simplex in the multisets that order the simplices of each dimension by grade
+const uint64_t SET_NODE_BYTES = 4 * sizeof(void*) + sizeof(STNode*) + MALLOC_OVERHEAD;
+
+//bytes for each entry of a sparse matrix stored as linked lists
+const uint64_t ENTRY_BYTES = 2 * sizeof(void*) + MALLOC_OVERHEAD;
+
+//bytes for each cell of the arrangement: its face, about three half-edges and one vertex, and its barcode template
+const uint64_t CELL_BYTES = 400;
+
+//projections larger than this are reported as this
+const double MAX_BYTES = 1e18;
+
+//number of random walks down the simplex tree from each vertex, when the simplices are too many to count
+const unsigned WALKS_PER_VERTEX = 16;
+
+//stores in result the elements of cands after position pos that are in the sorted vector nbrs
+void intersect_after(const std::vector<unsigned>& cands, size_t pos, const std::vector<unsigned>& nbrs, std::vector<unsigned>& result)
+{
+    result.clear();
+    std::set_intersection(cands.begin() + pos + 1, cands.end(), nbrs.begin(), nbrs.end(), std::back_inserter(result));
+}
+
+//counts the cliques that extend a clique of dim + 1 vertices by vertices in cands, up to dimension max_dim
+//  returns false if this takes more than work steps, which are subtracted from work
+bool count_cliques(const std::vector<std::vector<unsigned>>& upper, const std::vector<unsigned>& cands, unsigned dim, unsigned max_dim,
+    std::vector<uint64_t>& counts, uint64_t& work)
+{
+    counts[dim + 1] += cands.size();
+    if (dim + 1 == max_dim)
+        return true;
+
+    std::vector<unsigned> next;
+    for (size_t i = 0; i < cands.size(); i++) {
+        uint64_t steps = cands.size() - i + upper[cands[i]].size();
+        if (steps > work)
+            return false;
+        work -= steps;
+        intersect_after(cands, i, upper[cands[i]], next);
+        if (!next.empty() && !count_cliques(upper, next, dim + 1, max_dim, counts, work))
+            return false;
+    }
+    return true;
+}
+
+} //end anonymous namespace
+
+MemoryEstimate::MemoryEstimate(const std::vector<unsigned>& hom_dims, const std::vector<uint64_t>& simplices, unsigned x_grades, unsigned y_grades)
+    : hom_dims(hom_dims)
+    , simplices(simplices)
+    , x_grades(x_grades)
+    , y_grades(y_grades)
+{
+}
+
+//estimates the number of simplices of each dimension, up to max_dim, in the Vietoris-Rips complex of the graph given by the triangle of distances
+//  the vertices and edges are counted exactly, and the higher simplices are cliques found by intersecting the sets of larger neighbors;
+//  if there are too many of them, then each vertex gets several random walks down the tree of cliques that it is the smallest vertex of,
+//  and the product of the numbers of choices along a walk estimates the number of cliques at that depth (Knuth's estimator)
+std::vector<uint64_t> MemoryEstimate::count_VR_simplices(const std::vector<unsigned>& distances, unsigned num_points, unsigned max_dim,
+    uint64_t work_budget)
+{
+    std::vector<uint64_t> counts(max_dim + 1, 0);
+    counts[0] = num_points;
+    if (max_dim == 0 || num_points == 0)
+        return counts;
+
+    //upper[i] lists the neighbors of point i that are larger than i, in increasing order
+    std::vector<std::vector<unsigned>> upper(num_points);
+    for (unsigned j = 1; j < num_points; j++)
+        for (unsigned i = 0; i < j; i++)
+            if (distances[((uint64_t)j * (j - 1)) / 2 + i] != UINT_MAX)
+                upper[i].push_back(j);
+
+    std::vector<uint64_t> exact_counts(counts);
+    uint64_t work = work_budget;
+    bool exact = true;
+    for (unsigned v = 0; v < num_points && exact; v++)
+        exact = count_cliques(upper, upper[v], 0, max_dim, exact_counts, work);
+    if (exact)
+        return exact_counts;
+
+    //too many to count, so estimate the higher simplices from random walks
+    for (unsigned v = 0; v < num_points; v++)
+        counts[1] += upper[v].size();
+
+    std::mt19937 rng(0);
+    std::vector<double> estimates(max_dim + 1, 0);
+    std::vector<unsigned> cands, next;
+    for (unsigned v = 0; v < num_points; v++) {
+        for (unsigned w = 0; w < WALKS_PER_VERTEX && !upper[v].empty(); w++) {
+            cands = upper[v];
+            double weight = 1;
+            for (unsigned dim = 1; dim < max_dim && !cands.empty(); dim++) {
+                weight *= cands.size();
+                size_t pos = std::uniform_int_distribution<size_t>(0, cands.size() - 1)(rng);
+                intersect_after(cands, pos, upper[cands[pos]], next);
+                cands.swap(next);
+                estimates[dim + 1] += weight * cands.size();
+            }
+        }
+    }
+    for (unsigned dim = 2; dim <= max_dim; dim++)
+        counts[dim] = (uint64_t)(estimates[dim] / WALKS_PER_VERTEX + 0.5);
+    return counts;
+} //end count_VR_simplices()
+
+//returns the number of simplices of dimension dim, or 0 if there are none
+uint64_t MemoryEstimate::count(unsigned dim) const
+{
+    return dim < simplices.size() ? simplices[dim] : 0;
+}
+
+//expected number of xi support points: each one is the grade of a simplex of dimension hom_dim or hom_dim + 1, or the join of such grades,
+//  but on random point clouds they number about three times these simplices for homology of dimension 0, and an eighth of them for
+//  higher dimensions, where most cycles are filled in; once the grades are coarse they take up about three fifths (or a quarter) of the grid
+uint64_t MemoryEstimate::support_points(unsigned hom_dim) const
+{
+    uint64_t grid = (uint64_t)x_grades * y_grades;
+    uint64_t simplices = count(hom_dim) + count(hom_dim + 1);
+    if (hom_dim == 0)
+        return std::min(grid * 3 / 5 + 1, 3 * simplices);
+    return std::min(grid / 4 + 1, simplices / 8 + 1);
+}
+
+//expected number of anchors: each one is the join of two support points that are not comparable, or a support point itself,
+//  but in practice there are slightly fewer anchors than support points, so there are projected to be as many
+uint64_t MemoryEstimate::anchors(unsigned hom_dim) const
+{
+    return support_points(hom_dim);
+}
+
+//expected number of cells in the line arrangement: n lines in general position divide the plane into n(n+1)/2 + 1 faces,
+//  but in practice only about a third of the pairs of lines that RIVET builds cross in the region of interest
+uint64_t MemoryEstimate::cells(unsigned hom_dim) const
+{
+    uint64_t a = anchors(hom_dim);
+    return a * a / 6 + a + 1;
+}
+
+uint64_t MemoryEstimate::simplex_tree_bytes() const
+{
+    uint64_t all = 0;
+    for (uint64_t n : simplices)
+        all += n;
+    return all * (TREE_NODE_BYTES + SET_NODE_BYTES);
+}
+
+//MultiBetti holds the boundary matrix of (hom_dim + 1)-simplices and a partially-reduced copy of it, which is later replaced
+//  by its direct sum with itself; the boundary matrix of hom_dim-simplices, the merge and split matrices; and the tables of grades, xi values, and dimensions
+uint64_t MemoryEstimate::betti_bytes(unsigned hom_dim) const
+{
+    uint64_t high_entries = (hom_dim + 2) * count(hom_dim + 1);
+    uint64_t low_entries = (hom_dim + 1) * count(hom_dim);
+    uint64_t entries = 2 * high_entries + low_entries + 3 * count(hom_dim);
+    uint64_t columns = 2 * count(hom_dim + 1) + 4 * count(hom_dim);
+    return entries * ENTRY_BYTES + columns * 2 * sizeof(void*) + (uint64_t)x_grades * y_grades * 32;
+}
+
+//the arrangement; the table of distances between its cells from which the path through them is found, which takes
+//  4 bytes for each pair of cells and is usually the largest part; and the R and U matrices that PersistenceUpdater keeps along the path
+uint64_t MemoryEstimate::arrangement_bytes(unsigned hom_dim) const
+{
+    uint64_t entries = 2 * ((hom_dim + 1) * count(hom_dim) + (hom_dim + 2) * count(hom_dim + 1));
+    uint64_t columns = 2 * (count(hom_dim) + count(hom_dim + 1));
+    double num_cells = cells(hom_dim);
+    double bytes = num_cells * CELL_BYTES + num_cells * num_cells * sizeof(unsigned) + (double)entries * ENTRY_BYTES + columns * 32;
+    return (bytes < MAX_BYTES) ? (uint64_t)bytes : (uint64_t)MAX_BYTES; //beyond any memory, and far from overflow
+}
+
+//the simplex tree lasts for the whole computation, but the matrices of MultiBetti are freed before the arrangement is built
+uint64_t MemoryEstimate::total_bytes() const
+{
+    uint64_t bytes = simplex_tree_bytes();
+    for (unsigned hom_dim : hom_dims)
+        bytes += std::max(betti_bytes(hom_dim), arrangement_bytes(hom_dim));
+    return bytes;
+}
+
+//prints the projection
+void MemoryEstimate::report() const
+{
+    auto megabytes = [](uint64_t bytes) {
+        std::ostringstream ss;
+        ss << std::fixed << std::setprecision(1) << bytes / 1048576.0 << " MB";
+        return ss.str();
+    };
+
+    std::string counts;
+    for (uint64_t n : simplices)
+        counts += (counts.empty() ? "" : " ") + std::to_string(n);
+
+    debug() << "  Projected simplices by dimension:" << counts;
+    debug() << "  Projected grid:" << x_grades << "x-grades by" << y_grades << "y-grades";
+    for (unsigned hom_dim : hom_dims) {
+        debug() << "  Projected for homology dimension " + std::to_string(hom_dim) + ": about" << support_points(hom_dim) << "support points,"
+                << anchors(hom_dim) << "anchors, and" << cells(hom_dim) << "cells; Betti numbers" << megabytes(betti_bytes(hom_dim)) + ", arrangement"
+                << megabytes(arrangement_bytes(hom_dim));
+    }
+    debug() << "  Projected memory: simplex tree" << megabytes(simplex_tree_bytes()) + ", peak" << megabytes(total_bytes());
+} //end report()
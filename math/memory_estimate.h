@@ -0,0 +1,75 @@
+/**********************************************************************
+Copyright 2014-2016 The RIVET Developers. See the COPYRIGHT file at
+the top-level directory of this distribution.
+
+This file is part of RIVET.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+/**
+ * \class	MemoryEstimate
+ * \brief	Projects the memory that a computation will use, before the simplex tree or any matrices are built
+ *
+ * The projection has three parts: the simplex tree, which lasts for the whole computation; the boundary matrices that
+ * MultiBetti builds and reduces; and the line arrangement, with the table of distances between its cells that is used to find
+ * the path through them, and the RU-decompositions that are updated along the path. The last two do not overlap, so the projected
+ * peak is the simplex tree plus the larger of them. The matrices are sized from the numbers of simplices, which are counted
+ * (or estimated) from the edge graph. The xi support points are not known in advance, so their number is projected from the numbers
+ * of simplices of the relevant dimensions and of grades, by bounds measured on random point clouds; the numbers of anchors and cells
+ * follow from it by the ratios measured on the same arrangements. The table of distances grows as the square of the number of cells,
+ * and so as the fourth power of the number of support points, which coarser bins reduce once they take up much of the grid.
+ * If several dimensions of homology are computed from the same simplex tree, then their computations may run at the same time,
+ * so the projection for each of them is added to the simplex tree.
+ */
+
+#ifndef __MEMORY_ESTIMATE_H__
+#define __MEMORY_ESTIMATE_H__
+
+#include <cstdint>
+#include <vector>
+
+class MemoryEstimate {
+public:
+    //projects the memory for computing homology of each dimension in hom_dims, given the number of simplices of each dimension
+    //  (at least up to the largest of hom_dims plus one) and the numbers of x-grades and y-grades
+    MemoryEstimate(const std::vector<unsigned>& hom_dims, const std::vector<uint64_t>& simplices, unsigned x_grades, unsigned y_grades);
+
+    //estimates the number of simplices of each dimension, up to max_dim, in the Vietoris-Rips complex of the graph given by the
+    //  triangle of distances, in which the pair of points (i,j) with i < j is entry j(j-1)/2 + i and UINT_MAX means that there is no edge
+    //  the simplices are counted exactly if that takes at most work_budget steps, and otherwise estimated from random walks down the simplex tree
+    static std::vector<uint64_t> count_VR_simplices(const std::vector<unsigned>& distances, unsigned num_points, unsigned max_dim,
+        uint64_t work_budget = 100000000);
+
+    //projections for homology of dimension hom_dim
+    uint64_t support_points(unsigned hom_dim) const; //expected number of xi support points
+    uint64_t anchors(unsigned hom_dim) const; //expected number of anchors
+    uint64_t cells(unsigned hom_dim) const; //expected number of cells in the line arrangement
+    uint64_t betti_bytes(unsigned hom_dim) const; //boundary matrices and tables of MultiBetti
+    uint64_t arrangement_bytes(unsigned hom_dim) const; //line arrangement, path through it, and RU-decompositions along the path
+
+    uint64_t simplex_tree_bytes() const;
+    uint64_t total_bytes() const; //projected peak, for all of hom_dims
+
+    void report() const; //prints the projection
+
+private:
+    std::vector<unsigned> hom_dims;
+    std::vector<uint64_t> simplices; //number of simplices of each dimension
+    unsigned x_grades;
+    unsigned y_grades;
+
+    uint64_t count(unsigned dim) const; //number of simplices of dimension dim, or 0 if there are none
+};
+
+#endif // __MEMORY_ESTIMATE_H__
@@ -89,9 +89,7 @@ void MultiBetti::compute(unsigned_matrix& hom_dims, Progress& progress)
     }
 
     //input to the algorithm: two boundary matrices, with index data
-    MapMatrix* bdry1 = bifiltration.get_boundary_mx(dimension);
-    IndexMatrix* ind1 = bifiltration.get_index_mx(dimension);
-
+    //  bdry1 is not built until bdry2 has been deleted, so that the two matrices are never stored at the same time
     MapMatrix* bdry2 = bifiltration.get_boundary_mx(dimension + 1);
     IndexMatrix* ind2 = bifiltration.get_index_mx(dimension + 1);
 
@@ -161,6 +159,9 @@ void MultiBetti::compute(unsigned_matrix& hom_dims, Progress& progress)
     //   recurd pointwise nullity of bdry1
     //   also reduce "spliced" matrices and record pointwise dimension of vector spaces U and V
 
+    MapMatrix* bdry1 = bifiltration.get_boundary_mx(dimension);
+    IndexMatrix* ind1 = bifiltration.get_index_mx(dimension);
+
     //data structures used for reducing bdry1 matrix
     Vector lows_bdry1(bdry1->height(), -1); //low array for bdry1
     long zero_cols_bdry1 = 0; //number of zeroed columns in bdry1 at <= current grade
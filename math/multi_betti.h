@@ -66,9 +66,9 @@ public:
     void store_support_points(std::vector<TemplatePoint>& tpts);
 
     SimplexTree& bifiltration; //reference to the bifiltration
+    const int dimension; //dimension of homology to compute
 
 private:
-    const int dimension; //dimension of homology to compute
     unsigned num_x_grades; //number of grades in primary direction
     unsigned num_y_grades; //number of grades in secondary direction
     boost::multi_array<int, 3> xi; //matrix to hold xi values; indices: xi[x][y][subscript]
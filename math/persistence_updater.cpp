@@ -25,23 +25,41 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../dcel/dcel.h"
 #include "dcel/arrangement.h"
 #include "debug.h"
+#include "implicit_boundary_matrix.h"
+#include "interface/checkpoint.h"
 #include "index_matrix.h"
 #include "map_matrix.h"
 #include "multi_betti.h"
 #include "simplex_tree.h"
 
+#include <algorithm>
 #include <chrono>
+#include <exception>
+#include <iterator>
+#include <limits>
+#include <list>
+#include <random>
 #include <stdexcept> //for error-checking and debugging
-#include <stdlib.h> //for rand()
+#include <thread>
+#include <unordered_set>
 #include <timer.h>
 
 //constructor for when we must compute all of the barcode templates
-PersistenceUpdater::PersistenceUpdater(Arrangement& m, SimplexTree& b, std::vector<TemplatePoint>& xi_pts, unsigned verbosity)
+PersistenceUpdater::PersistenceUpdater(Arrangement& m, SimplexTree& b, unsigned dim, std::vector<TemplatePoint>& xi_pts, unsigned verbosity)
     : arrangement(m)
     , bifiltration(b)
-    , dim(b.hom_dim)
+    , dim(dim)
     , verbosity(verbosity)
     , template_points_matrix(m.x_exact.size(), m.y_exact.size())
+    , R_low(NULL)
+    , R_high(NULL)
+    , U_low(NULL)
+    , U_high(NULL)
+    , num_segments(1)
+    , seed(0)
+    , checkpoint(NULL)
+    , strategy(RESET)
+    , is_segment(false)
 //    , testing(false)
 {
     //fill the xiSupportMatrix with the xi support points and anchors
@@ -50,6 +68,75 @@ PersistenceUpdater::PersistenceUpdater(Arrangement& m, SimplexTree& b, std::vect
         //Add anchors to arrangement also
         m.add_anchor(Anchor(matrix_entry));
     }
+
+    //index the entries, so that anchors can be matched with the entries of copies of this updater
+    entries.resize(xi_pts.size());
+    for (unsigned i = 0; i < template_points_matrix.width(); i++) {
+        for (std::shared_ptr<TemplatePointsMatrixEntry> cur = template_points_matrix.get_col(i); cur != nullptr; cur = cur->down)
+            entries[cur->index] = cur;
+    }
+}
+
+//copies the order on simplices (including the grade lists and lift maps) of other, but not its matrices; used for segments of the path
+PersistenceUpdater::PersistenceUpdater(const PersistenceUpdater& other)
+    : arrangement(other.arrangement)
+    , bifiltration(other.bifiltration)
+    , dim(other.dim)
+    , verbosity(other.verbosity)
+    , template_points_matrix(other.template_points_matrix)
+    , lift_low(other.lift_low) //the lift maps refer to entries by index, so they are valid for the copied entries
+    , lift_high(other.lift_high)
+    , R_low(NULL)
+    , R_high(NULL)
+    , U_low(NULL)
+    , U_high(NULL)
+    , perm_low(other.perm_low)
+    , inv_perm_low(other.inv_perm_low)
+    , perm_high(other.perm_high)
+    , inv_perm_high(other.inv_perm_high)
+    , num_segments(1)
+    , seed(other.seed)
+    , checkpoint(NULL)
+    , strategy(other.strategy)
+    , is_segment(true)
+{
+    entries.resize(other.entries.size());
+    for (unsigned i = 0; i < template_points_matrix.width(); i++) {
+        for (std::shared_ptr<TemplatePointsMatrixEntry> cur = template_points_matrix.get_col(i); cur != nullptr; cur = cur->down)
+            entries[cur->index] = cur;
+    }
+}
+
+PersistenceUpdater::~PersistenceUpdater()
+{
+    delete R_low;
+    delete R_high;
+    delete U_low;
+    delete U_high;
+}
+
+//splits the path into the given number of segments, which are traversed in parallel
+void PersistenceUpdater::set_num_segments(unsigned n)
+{
+    num_segments = std::max(n, 1u);
+}
+
+//sets the seed for the random transpositions that calibrate the cost model
+void PersistenceUpdater::set_seed(unsigned s)
+{
+    seed = s;
+}
+
+//sets the checkpoint to which the state of the traversal of the path is saved now and then
+void PersistenceUpdater::set_checkpoint(Checkpoint* c)
+{
+    checkpoint = c;
+}
+
+//sets the number of bytes that may be used to keep copies of RU-decompositions computed when the matrices are reset
+void PersistenceUpdater::set_snapshot_budget(unsigned long bytes)
+{
+    snapshots.set_budget(bytes);
 }
 
 ////constructor for when we load the pre-computed barcode templates from a RIVET data file
@@ -65,6 +152,29 @@ PersistenceUpdater::PersistenceUpdater(Arrangement& m, SimplexTree& b, std::vect
 //computes and stores a barcode template in each 2-cell of arrangement
 //resets the matrices and does a standard persistence calculation for expensive crossings
 void PersistenceUpdater::store_barcodes_with_reset(std::vector<std::shared_ptr<Halfedge>>& path, Progress& progress)
+{
+    strategy = RESET;
+    store_barcodes(path, progress);
+}
+
+//computes and stores a barcode template in each 2-cell of arrangement
+//for expensive crossings, moves all columns to their new positions at once and fixes the RU-decomposition globally
+void PersistenceUpdater::store_barcodes_quicksort(std::vector<std::shared_ptr<Halfedge>>& path, Progress& progress)
+{
+    strategy = QUICKSORT;
+    store_barcodes(path, progress);
+}
+
+//computes and stores a barcode template in each 2-cell of arrangement
+//does vineyard updates for every crossing, however expensive
+void PersistenceUpdater::store_barcodes_vineyards(std::vector<std::shared_ptr<Halfedge>>& path, Progress& progress)
+{
+    strategy = VINEYARDS_ONLY;
+    store_barcodes(path, progress);
+}
+
+//computes and stores a barcode template in each 2-cell of arrangement, handling expensive crossings according to strategy
+void PersistenceUpdater::store_barcodes(std::vector<std::shared_ptr<Halfedge>>& path, Progress& progress)
 {
 
     // PART 1: GET THE BOUNDARY MATRICES WITH PROPER SIMPLEX ORDERING
@@ -93,30 +203,11 @@ void PersistenceUpdater::store_barcodes_with_reset(std::vector<std::shared_ptr<H
     unsigned num_high_simplices = build_simplex_order(ind_high, false, high_simplex_order);
     delete ind_high;
 
-    //get boundary matrices (R) and identity matrices (U) for RU-decomposition
-    R_low = bifiltration.get_boundary_mx(low_simplex_order, num_low_simplices);
-    R_high = bifiltration.get_boundary_mx(low_simplex_order, num_low_simplices, high_simplex_order, num_high_simplices);
-
-    //print runtime data
-    if (verbosity >= 4) {
-        debug() << "  --> computing initial order on simplices and building the boundary matrices took"
-                << timer.elapsed() << "milliseconds";
-    }
-
-    //copy the boundary matrices (R) for fast reset later
-    timer.restart();
-    MapMatrix_Perm* R_low_initial = new MapMatrix_Perm(*R_low);
-    MapMatrix_Perm* R_high_initial = new MapMatrix_Perm(*R_high);
-    if (verbosity >= 4) {
-        debug() << "  --> copying the boundary matrices took"
-                << timer.elapsed() << "milliseconds";
-    }
-
     //initialize the permutation vectors
-    perm_low.resize(R_low->width());
-    inv_perm_low.resize(R_low->width());
-    perm_high.resize(R_high->width());
-    inv_perm_high.resize(R_high->width());
+    perm_low.resize(num_low_simplices);
+    inv_perm_low.resize(num_low_simplices);
+    perm_high.resize(num_high_simplices);
+    inv_perm_high.resize(num_high_simplices);
     for (unsigned j = 0; j < perm_low.size(); j++) {
         perm_low[j] = j;
         inv_perm_low[j] = j;
@@ -126,22 +217,50 @@ void PersistenceUpdater::store_barcodes_with_reset(std::vector<std::shared_ptr<H
         inv_perm_high[j] = j;
     }
 
+    //if the path was partly traversed by an earlier run, then continue from the order on simplices where it stopped
+    unsigned first_step = (checkpoint != NULL && !is_segment) ? restore_checkpoint(path) : 0;
+
+    //get boundary matrices that generate their columns on demand, from which the matrices R are built now and rebuilt when the matrices are reset
+    ImplicitBoundaryMatrix* R_low_initial = bifiltration.get_implicit_boundary_mx(dim, NULL, &low_simplex_order);
+    ImplicitBoundaryMatrix* R_high_initial = bifiltration.get_implicit_boundary_mx(dim + 1, &low_simplex_order, &high_simplex_order);
+    R_low = new MapMatrix_Perm(R_low_initial->height(), R_low_initial->width());
+    R_low->rebuild(R_low_initial, perm_low);
+    R_high = new MapMatrix_Perm(R_high_initial->height(), R_high_initial->width());
+    if (first_step > 0)
+        R_high->rebuild(R_high_initial, perm_high, perm_low);
+    else
+        R_high->rebuild(R_high_initial, perm_high);
+
+    //print runtime data
+    if (verbosity >= 4) {
+        debug() << "  --> computing initial order on simplices and building the boundary matrices took"
+                << timer.elapsed() << "milliseconds; the implicit boundary matrices use"
+                << (R_low_initial->memory_usage() + R_high_initial->memory_usage()) << "bytes, compared to"
+                << (R_low->memory_usage() + R_high->memory_usage()) << "bytes for the boundary matrices";
+    }
+
     // PART 2: INITIAL PERSISTENCE COMPUTATION (RU-decomposition)
 
     timer.restart();
 
     //initial RU-decomposition
+    unsigned long long work_before = MapMatrix_Base::addition_work();
     U_low = R_low->decompose_RU();
     U_high = R_high->decompose_RU();
 
-    unsigned total_time_for_resets = timer.elapsed();
+    long long decomp_time = timer.elapsed_ns();
+    unsigned long long decomp_work = MapMatrix_Base::addition_work() - work_before + count_matrix_entries();
     if (verbosity >= 4) {
-        debug() << "  --> computing the RU decomposition took" << total_time_for_resets << "milliseconds";
+        debug() << "  --> computing the RU decomposition took" << (decomp_time / 1000000) << "milliseconds";
     }
 
-    //store the barcode template in the first cell
+    //store the barcode template in the first cell (all columns must be examined), unless an earlier run already did
+    low_col_bars.assign(R_low->width(), BarTemplate());
+    col_is_dirty.assign(R_low->width(), false);
+    mark_all_columns();
     std::shared_ptr<Face> first_cell = arrangement.topleft->get_twin()->get_face();
-    store_barcode_template(first_cell);
+    if (first_step == 0)
+        store_barcode_template(first_cell);
 
     if (verbosity >= 4) {
         debug() << "Initial persistence computation in cell " << arrangement.FID(first_cell);
@@ -150,204 +269,482 @@ void PersistenceUpdater::store_barcodes_with_reset(std::vector<std::shared_ptr<H
     // PART 3: TRAVERSE THE PATH AND UPDATE PERSISTENCE AT EACH STEP
 
     if (verbosity >= 2) {
-        debug() << "TRAVERSING THE PATH USING THE RESET ALGORITHM: path has" << path.size() << "steps";
+        const char* name = (strategy == RESET) ? "RESET" : (strategy == QUICKSORT) ? "QUICKSORT" : "VINEYARD";
+        debug() << "TRAVERSING THE PATH USING THE" << name << "ALGORITHM: path has" << path.size() << "steps";
     }
 
     //data members for analyzing the computation
-    unsigned long total_transpositions = 0;
-    unsigned total_time_for_transpositions = 0; //NEW
-    unsigned number_of_resets = 1; //we count the initial RU-decomposition as the first reset
-    int max_time = 0;
-
-    // choose the initial value of the threshold intelligently
-    unsigned long threshold;
-    choose_initial_threshold(total_time_for_resets, total_transpositions, total_time_for_transpositions, threshold); 
-        //if the number of swaps might exceed this threshold, then we will do a persistence calculation from scratch instead of vineyard updates
+    ResetStats stats;
+    stats.total_transpositions = 0;
+    stats.total_time_for_transpositions = 0;
+    stats.number_of_resets = 1; //we count the initial RU-decomposition as the first reset
+    stats.number_of_warm_starts = 0;
+    stats.total_time_for_resets = decomp_time;
+    stats.max_time = 0;
+
+    //calibrate the cost model with the initial RU-decomposition and some random transpositions
+    //  if crossing an anchor is predicted to cost more than a reset, then we will do a persistence calculation from scratch instead of vineyard updates
+    calibrate_cost_model(decomp_work, stats);
     if (verbosity >= 4) {
-        debug() << "initial reset threshold set to" << threshold;
+        debug() << "initial reset threshold set to" << stats.model.reset_threshold(0) << "for an anchor of weight 0";
     }
 
-    timer.restart();
-
-
-    //traverse the path
-    Timer steptimer;
+    //determine the direction in which each anchor is crossed, and the steps at which a cell is reached for the first time
+    //  this leaves the anchors in the same state as crossing them one at a time
+    std::vector<bool> from_below(path.size());
+    std::vector<bool> first_visit(path.size());
+    std::unordered_set<std::shared_ptr<Face>> visited;
+    visited.insert(first_cell);
     for (unsigned i = 0; i < path.size(); i++) {
-        progress.progress(i); //update progress bar
+        std::shared_ptr<Anchor> cur_anchor = (path[i])->get_anchor();
+        from_below[i] = cur_anchor->is_above();
+        cur_anchor->toggle(); //remember that we have crossed this anchor
 
-        steptimer.restart(); //time update at each step of the path
-        unsigned long num_trans = 0; //count of how many transpositions we will have to do if we do vineyard updates
-        unsigned long swap_counter = 0; //count of how many transpositions we actually do
+        std::shared_ptr<Face> cur_face = (path[i])->get_face();
+        first_visit[i] = !cur_face->has_been_visited() && visited.insert(cur_face).second;
+    }
 
-        //determine which anchor is represented by this edge
-        std::shared_ptr<Anchor> cur_anchor = (path[i])->get_anchor();
-        std::shared_ptr<TemplatePointsMatrixEntry> at_anchor = cur_anchor->get_entry();
+    timer.restart();
 
-        //get equivalence classes for this anchor
-        std::shared_ptr<TemplatePointsMatrixEntry> down = at_anchor->down;
-        std::shared_ptr<TemplatePointsMatrixEntry> left = at_anchor->left;
+    //traverse the path
+    if (num_segments > 1 && path.size() > first_step + 1)
+        traverse_path_in_segments(path, first_step, from_below, first_visit, R_low_initial, R_high_initial, stats, progress);
+    else
+        traverse_path(path, first_step, path.size(), from_below, first_visit, R_low_initial, R_high_initial, stats, &progress);
 
-        //if this is a strict anchor, then swap simplices
-        if (down != nullptr && left != nullptr) //then this is a strict anchor and some simplices swap
-        {
-            if (verbosity >= 6) {
-                debug() << "  step " << i << " of path: crossing (strict) anchor at (" << cur_anchor->get_x() << ", " << cur_anchor->get_y() << ") into cell " << arrangement.FID((path[i])->get_face()) << "; edge weight: " << cur_anchor->get_weight();
+    //print runtime data
+    if (verbosity >= 2) {
+        debug() << "BARCODE TEMPLATE COMPUTATION COMPLETE: path traversal and persistence updates took" << timer.elapsed() << "milliseconds";
+        if (verbosity >= 4) {
+            debug() << "    max time per anchor crossing:" << (stats.max_time / 1000000) << "milliseconds";
+            debug() << "    total number of transpositions:" << stats.total_transpositions;
+            debug() << "    matrices were reset" << stats.number_of_resets << "times when estimated number of transpositions exceeded the threshold, finally" << stats.model.reset_threshold(0) << "for an anchor of weight 0";
+            if (stats.number_of_warm_starts > 0) {
+                debug() << "    further resets that started from a snapshot of an earlier RU-decomposition:" << stats.number_of_warm_starts;
             }
+            if (stats.number_of_resets > 0) {
+                debug() << "    average time for reset:" << (stats.total_time_for_resets / stats.number_of_resets / 1000000) << "milliseconds";
+            }
+        }
+    }
 
-            //find out how many transpositions we will have to process if we do vineyard updates
-            num_trans = count_transpositions(at_anchor, cur_anchor->is_above());
+    // PART 4: CLEAN UP
 
-            if (cur_anchor->is_above()) //then the anchor is crossed from below to above
-            {
-                remove_lift_entries(at_anchor); //this block of the partition might become empty
-                remove_lift_entries(down); //this block of the partition will move
+    delete R_low;
+    delete R_high;
+    delete U_low;
+    delete U_high;
+    R_low = NULL;
+    R_high = NULL;
+    U_low = NULL;
+    U_high = NULL;
 
-                if (num_trans < threshold) //then do vineyard updates
-                {
-                    swap_counter += split_grade_lists(at_anchor, left, true); //move grades that come before left from anchor to left -- vineyard updates
-                    swap_counter += move_columns(down, left, true); //swaps blocks of columns at down and at left -- vineyard updates
-                } else //then reset the matrices
-                {
-                    split_grade_lists_no_vineyards(at_anchor, left, true); //only updates the xiSupportMatrix and permutation vectors; no vineyard updates
-                    update_order_and_reset_matrices(down, left, true, R_low_initial, R_high_initial); //recompute the RU-decomposition
-                }
+    delete R_low_initial;
+    delete R_high_initial;
+} //end store_barcodes()
 
-                merge_grade_lists(at_anchor, down); //move all grades from down to anchor
-                add_lift_entries(at_anchor); //this block of the partition might have previously been empty
-                add_lift_entries(left); //this block of the partition moved
-            } else //then anchor is crossed from above to below
-            {
-                remove_lift_entries(at_anchor); //this block of the partition might become empty
-                remove_lift_entries(left); //this block of the partition will move
+//traverses steps first_step through (last_step - 1) of the path, updating the RU-decomposition at each step
+//  and storing the barcode template of each cell for which first_visit is true
+void PersistenceUpdater::traverse_path(std::vector<std::shared_ptr<Halfedge>>& path, unsigned first_step, unsigned last_step,
+    const std::vector<bool>& from_below, const std::vector<bool>& first_visit,
+    const ImplicitBoundaryMatrix* RL_initial, const ImplicitBoundaryMatrix* RH_initial, ResetStats& stats, Progress* progress)
+{
+    Timer steptimer;
+    Perm old_perm_low, old_perm_high; //order on columns before an expensive crossing, for the QUICKSORT strategy
+    for (unsigned i = first_step; i < last_step; i++) {
+        if (progress != NULL)
+            progress->progress(i); //update progress bar
 
-                if (num_trans < threshold) //then do vineyard updates
-                {
-                    swap_counter += split_grade_lists(at_anchor, down, false); //move grades that come before left from anchor to left -- vineyard updates
-                    swap_counter += move_columns(left, down, false); //swaps blocks of columns at down and at left -- vineyard updates
-                } else //then reset the matrices
-                {
-                    split_grade_lists_no_vineyards(at_anchor, down, false); //only updates the xiSupportMatrix and permutation vectors; no vineyard updates
-                    update_order_and_reset_matrices(left, down, false, R_low_initial, R_high_initial); //recompute the RU-decomposition
-                }
+        //determine which anchor is represented by this edge
+        std::shared_ptr<Anchor> cur_anchor = (path[i])->get_anchor();
+        std::shared_ptr<TemplatePointsMatrixEntry> at_anchor = entries[cur_anchor->get_entry()->index];
 
-                merge_grade_lists(at_anchor, left); //move all grades from down to anchor
-                add_lift_entries(at_anchor); //this block of the partition might have previously been empty
-                add_lift_entries(down); //this block of the partition moved
-            }
-        } else //this is a non-strict anchor, and we just have to split or merge equivalence classes
-        {
-            if (verbosity >= 6) {
-                debug() << "  step " << i << " of path: crossing (non-strict) anchor at (" << cur_anchor->get_x() << ", " << cur_anchor->get_y() << ") into cell " << arrangement.FID((path[i])->get_face()) << "; edge weight: " << cur_anchor->get_weight();
-            }
+        if (verbosity >= 6) {
+            debug() << "  step " << i << " of path: crossing " << ((at_anchor->down != nullptr && at_anchor->left != nullptr) ? "(strict)" : "(non-strict)")
+                    << " anchor at (" << cur_anchor->get_x() << ", " << cur_anchor->get_y() << ") into cell " << arrangement.FID((path[i])->get_face()) << "; edge weight: " << cur_anchor->get_weight();
+        }
 
-            std::shared_ptr<TemplatePointsMatrixEntry> generator = at_anchor->down;
-            if (generator == nullptr)
-                generator = at_anchor->left;
+        //find out how many transpositions we will have to process if we do vineyard updates
+        unsigned long num_trans = count_crossing_transpositions(at_anchor, from_below[i]);
+
+        //do the updates, resetting the matrices (according to the strategy) if that is predicted to be cheaper
+        steptimer.restart(); //time the update at each step of the path, for the statistics
+        unsigned long long work_before = MapMatrix_Base::addition_work(); //count the work of the update, for the cost model
+        unsigned long weight = cur_anchor->get_weight();
+        unsigned long threshold = (strategy == VINEYARDS_ONLY) ? std::numeric_limits<unsigned long>::max() : stats.model.reset_threshold(weight);
+        bool reset = (num_trans >= threshold);
+        if (reset && strategy == QUICKSORT) {
+            old_perm_low = perm_low;
+            old_perm_high = perm_high;
+        }
+        unsigned long swap_counter = cross_anchor(at_anchor, from_below[i], reset ? ORDER_ONLY : VINEYARD_UPDATES); //count of how many transpositions we actually do
+        bool warm_start = false;
+        if (reset) {
+            if (strategy == QUICKSORT)
+                reorder_matrices(old_perm_low, old_perm_high);
+            else
+                warm_start = reset_matrices(RL_initial, RH_initial, threshold, swap_counter);
+        }
+        long long step_time = steptimer.elapsed_ns();
 
-            if ((cur_anchor->is_above() && generator == at_anchor->down) || (!cur_anchor->is_above() && generator == at_anchor->left))
-            //then merge classes -- there will never be any transpositions in this case
-            {
-                remove_lift_entries(generator);
-                merge_grade_lists(at_anchor, generator);
-                add_lift_entries(at_anchor); //this is necessary in case the class was previously empty
-            } else //then split classes
-            {
-                //find out how many transpositions we will have to process if we do vineyard updates
-                unsigned junk = 0;
-                bool horiz = (generator == at_anchor->left);
-                count_transpositions_from_separations(at_anchor, generator, horiz, true, num_trans, junk);
-                count_transpositions_from_separations(at_anchor, generator, horiz, false, num_trans, junk);
-
-                //now do the updates
-                remove_lift_entries(at_anchor); //this is necessary because the class corresponding to at_anchor might become empty
-
-                if (num_trans < threshold) //then do vineyard updates
-                    swap_counter += split_grade_lists(at_anchor, generator, horiz);
-                else //then reset the matrices
-                {
-                    split_grade_lists_no_vineyards(at_anchor, generator, horiz); //only updates the xiSupportMatrix; no vineyard updates
-                    update_order_and_reset_matrices(R_low_initial, R_high_initial); //recompute the RU-decomposition
-                }
+        //the work is that of the column additions and transpositions, and of writing the matrices if they were rebuilt or copied
+        unsigned long long step_work = MapMatrix_Base::addition_work() - work_before + swap_counter;
 
-                add_lift_entries(at_anchor);
-                add_lift_entries(generator);
-            }
+        //the fill of the matrices changes slowly, so it is only measured when they are reset
+        if (reset) {
+            unsigned long num_entries = count_matrix_entries();
+            stats.model.set_matrix_features(R_low->width() + R_high->width(), num_entries);
+            step_work += num_entries;
         }
 
-        //remember that we have crossed this anchor
-        cur_anchor->toggle();
-
         //if this cell does not yet have a barcode template, then store it now
-        std::shared_ptr<Face> cur_face = (path[i])->get_face();
-        if (!cur_face->has_been_visited())
-            store_barcode_template(cur_face);
+        if (first_visit[i])
+            store_barcode_template((path[i])->get_face());
 
         //print/store data for analysis
-        int step_time = steptimer.elapsed();
 
-        if (num_trans < threshold) //then we did vineyard-updates
+        if (!reset || warm_start) //then we did vineyard-updates
         {
             if (verbosity >= 6) {
-                debug() << "  --> this step took" << step_time << "milliseconds and involved" << swap_counter << "transpositions; estimate was" << num_trans;
+                if (warm_start)
+                    debug() << "  --> this step took" << step_time << "nanoseconds; started from a snapshot and did" << swap_counter << "transpositions to avoid" << num_trans << "transpositions";
+                else
+                    debug() << "  --> this step took" << step_time << "nanoseconds and involved" << swap_counter << "transpositions; estimate was" << num_trans;
             }
             //TESTING: if (swap_counter != num_trans)
             //    debug() << "    ========>>> ERROR: transposition count doesn't match estimate!";
 
             if (swap_counter > 0) //don't track time for overhead that doesn't result in any transpositions
             {
-                total_transpositions += swap_counter;
-                total_time_for_transpositions += step_time;
+                stats.total_transpositions += swap_counter;
+                stats.total_time_for_transpositions += step_time;
+                stats.model.record_vineyard_updates(swap_counter, weight, step_work);
             }
+            if (warm_start)
+                stats.number_of_warm_starts++;
         } else {
             if (verbosity >= 6) {
-                debug() << "  --> this step took" << step_time << "milliseconds; reset matrices to avoid" << num_trans << "transpositions";
+                debug() << "  --> this step took" << step_time << "nanoseconds; reset matrices to avoid" << num_trans << "transpositions";
             }
             //TESTING: if (swap_counter > 0)
             //    debug() << "    ========>>> ERROR: swaps occurred on a matrix reset!";
-            number_of_resets++;
-            total_time_for_resets += step_time;
+            stats.number_of_resets++;
+            stats.total_time_for_resets += step_time;
+            stats.model.record_reset(step_work);
         }
 
-        if (step_time > max_time)
-            max_time = step_time;
+        if (step_time > stats.max_time)
+            stats.max_time = step_time;
 
-        //update the treshold
-        if(swap_counter > 0 || num_trans >= threshold) {
-            threshold = (unsigned long)(((double)total_transpositions / total_time_for_transpositions) * ((double)total_time_for_resets / number_of_resets));
-            if (verbosity >= 6) {
-                // debug() << "===>>> UPDATING THRESHOLD:";
-                // debug() << "    total_trans: " << total_transpositions;
-                // debug() << "    total_time_for_trans: " << total_time_for_transpositions;
-                // debug() << "    total time for resets: " << total_time_for_resets;
-                // debug() << "    number of resets:" << number_of_resets;
-                debug() << "  -- new threshold:" << threshold;
-            }
+        if ((swap_counter > 0 || reset) && verbosity >= 6) {
+            debug() << "  -- new threshold:" << stats.model.reset_threshold(weight) << "for an anchor of weight" << weight;
         }
+
+        //now and then, save the state of the traversal, so that a run that stops can continue from here
+        if (checkpoint != NULL && !is_segment && checkpoint->due())
+            save_checkpoint(path, i + 1);
     } //end path traversal
+} //end traverse_path()
+
+//splits the path into num_segments segments and traverses them in parallel, then stores the barcode templates in the arrangement
+//  the segment boundaries are chosen so that the segments have roughly equal total edge weight (plus one per step)
+//  this updater only updates the order on simplices up to the start of each segment; each segment is traversed by a copy
+//  of this updater, which resets its matrices at the start of the segment (except for the first segment, which takes over
+//  the matrices of this updater)
+void PersistenceUpdater::traverse_path_in_segments(std::vector<std::shared_ptr<Halfedge>>& path, unsigned first_step,
+    const std::vector<bool>& from_below, const std::vector<bool>& first_visit,
+    const ImplicitBoundaryMatrix* RL_initial, const ImplicitBoundaryMatrix* RH_initial, ResetStats& stats, Progress& progress)
+{
+    //choose the segment boundaries
+    unsigned n = std::min<size_t>(num_segments, path.size() - first_step);
+    unsigned long total_weight = 0;
+    for (unsigned i = first_step; i < path.size(); i++)
+        total_weight += path[i]->get_anchor()->get_weight() + 1;
+
+    std::vector<unsigned> boundaries(1, first_step); //segment k consists of steps boundaries[k] through (boundaries[k+1] - 1)
+    unsigned long weight = 0;
+    for (unsigned i = first_step; i + 1 < path.size() && boundaries.size() < n; i++) {
+        weight += path[i]->get_anchor()->get_weight() + 1;
+        if (weight * n >= total_weight * boundaries.size())
+            boundaries.push_back(i + 1);
+    }
+    boundaries.push_back(path.size());
+    n = boundaries.size() - 1;
 
-    //print runtime data
-    if (verbosity >= 2) {
-        debug() << "BARCODE TEMPLATE COMPUTATION COMPLETE: path traversal and persistence updates took" << timer.elapsed() << "milliseconds";
-        if (verbosity >= 4) {
-            debug() << "    max time per anchor crossing:" << max_time;
-            debug() << "    total number of transpositions:" << total_transpositions;
-            debug() << "    matrices were reset" << number_of_resets << "times when estimated number of transpositions exceeded" << threshold;
-            if (number_of_resets > 0) {
-                debug() << "    average time for reset:" << (total_time_for_resets / number_of_resets) << "milliseconds";
+    if (verbosity >= 4) {
+        debug() << "  splitting the path into" << n << "segments, traversed in parallel";
+    }
+
+    //each segment is traversed by its own thread, but at most max_threads segments (and copies of the matrices) exist at once
+    unsigned max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    const ResetStats initial_stats = stats;
+    std::vector<std::unique_ptr<PersistenceUpdater>> segments(n);
+    std::vector<ResetStats> segment_stats(n, stats);
+    std::vector<std::exception_ptr> errors(n);
+    std::vector<std::thread> threads(n);
+
+    //if an exception leaves this function (from this thread or rethrown from a segment), the threads must be joined first,
+    //  since destroying a joinable thread terminates the program
+    struct Joiner {
+        std::vector<std::thread>& threads;
+        ~Joiner()
+        {
+            for (std::thread& t : threads) {
+                if (t.joinable())
+                    t.join();
+            }
+        }
+    } joiner{ threads };
+
+    //waits for segment k, then stores its barcode templates in the arrangement and releases its matrices
+    //  segments must be finished in path order, so that the templates are interned in the same order as by a serial traversal
+    auto finish_segment = [&](unsigned k) {
+        threads[k].join();
+        if (errors[k] != NULL)
+            std::rethrow_exception(errors[k]); //the joiner waits for the other threads
+
+        PersistenceUpdater& segment = *segments[k];
+        unsigned j = 0;
+        for (unsigned i = boundaries[k]; i < boundaries[k + 1]; i++) {
+            if (!first_visit[i])
+                continue;
+            std::shared_ptr<Face> cell = (path[i])->get_face();
+            cell->mark_as_visited();
+            cell->set_template_id(arrangement.barcode_templates.intern(segment.segment_templates.get(segment.segment_template_ids[j++])));
+        }
+        segments[k].reset();
+        progress.progress(boundaries[k + 1]);
+
+        //combine the statistics (each segment started with a copy of the initial statistics)
+        const ResetStats& s = segment_stats[k];
+        stats.total_transpositions += s.total_transpositions - initial_stats.total_transpositions;
+        stats.total_time_for_transpositions += s.total_time_for_transpositions - initial_stats.total_time_for_transpositions;
+        stats.number_of_resets += s.number_of_resets - initial_stats.number_of_resets;
+        stats.number_of_warm_starts += s.number_of_warm_starts - initial_stats.number_of_warm_starts;
+        stats.total_time_for_resets += s.total_time_for_resets - initial_stats.total_time_for_resets;
+        stats.max_time = std::max(stats.max_time, s.max_time);
+        stats.model.add_observations(s.model, initial_stats.model);
+    };
+
+    for (unsigned k = 0; k < n; k++) {
+        if (k >= max_threads)
+            finish_segment(k - max_threads);
+
+        //bring the order on simplices up to the first step of this segment
+        if (k > 0) {
+            for (unsigned i = boundaries[k - 1]; i < boundaries[k]; i++)
+                cross_anchor(entries[path[i]->get_anchor()->get_entry()->index], from_below[i], ORDER_ONLY);
+        }
+
+        segments[k].reset(new PersistenceUpdater(*this));
+        PersistenceUpdater* segment = segments[k].get();
+        segment->snapshots.set_budget(snapshots.get_budget() / std::min(n, max_threads)); //the segments in flight share the budget
+
+        if (k == 0) {
+            //the first segment continues from the current RU-decomposition and barcode template
+            std::swap(segment->R_low, R_low);
+            std::swap(segment->R_high, R_high);
+            std::swap(segment->U_low, U_low);
+            std::swap(segment->U_high, U_high);
+            segment->cur_template = cur_template;
+            segment->low_col_bars.swap(low_col_bars);
+            segment->dirty_cols.swap(dirty_cols);
+            segment->col_is_dirty.swap(col_is_dirty); //this updater no longer tracks bars
+        }
+
+        ResetStats& seg_stats = segment_stats[k];
+        std::exception_ptr& error = errors[k];
+        unsigned first_step = boundaries[k];
+        unsigned last_step = boundaries[k + 1];
+        threads[k] = std::thread([segment, &path, &from_below, &first_visit, RL_initial, RH_initial, &seg_stats, &error, first_step, last_step]() {
+            try {
+                if (segment->R_low == NULL) {
+                    //compute a fresh RU-decomposition for the order on simplices at the start of this segment
+                    Timer timer;
+                    unsigned long long work_before = MapMatrix_Base::addition_work(); //counted by this thread
+                    segment->R_low = new MapMatrix_Perm(RL_initial->height(), RL_initial->width());
+                    segment->R_high = new MapMatrix_Perm(RH_initial->height(), RH_initial->width());
+                    segment->low_col_bars.assign(segment->R_low->width(), BarTemplate());
+                    segment->col_is_dirty.assign(segment->R_low->width(), false);
+                    unsigned long swap_counter = 0;
+                    segment->reset_matrices(RL_initial, RH_initial, 0, swap_counter);
+                    long long reset_time = timer.elapsed_ns();
+                    unsigned long num_entries = segment->count_matrix_entries();
+                    seg_stats.model.set_matrix_features(segment->R_low->width() + segment->R_high->width(), num_entries);
+                    seg_stats.model.record_reset(MapMatrix_Base::addition_work() - work_before + num_entries);
+                    seg_stats.number_of_resets++;
+                    seg_stats.total_time_for_resets += reset_time;
+                }
+                segment->traverse_path(path, first_step, last_step, from_below, first_visit, RL_initial, RH_initial, seg_stats, NULL);
+            } catch (...) {
+                error = std::current_exception();
             }
+        });
+    }
+
+    //wait for the remaining segments
+    for (unsigned k = (n > max_threads) ? n - max_threads : 0; k < n; k++)
+        finish_segment(k);
+} //end traverse_path_in_segments()
+
+//saves the order on simplices, the grade lists, and the barcode templates stored so far, after the given number of steps of the path
+void PersistenceUpdater::save_checkpoint(std::vector<std::shared_ptr<Halfedge>>& path, unsigned step)
+{
+    Timer timer;
+    PathCheckpoint state;
+    state.step = step;
+    state.path_length = path.size();
+    state.perm_low = perm_low;
+    state.inv_perm_low = inv_perm_low;
+    state.perm_high = perm_high;
+    state.inv_perm_high = inv_perm_high;
+    for (auto& entry : entries) {
+        state.entries.push_back(PathCheckpoint::EntryState{ entry->low_simplices, entry->high_simplices,
+            entry->low_count, entry->high_count, entry->low_index, entry->high_index });
+    }
+    state.lift_low = lift_low;
+    state.lift_high = lift_high;
+    for (auto& face : arrangement.faces) {
+        state.visited.push_back(face->has_been_visited());
+        state.template_ids.push_back(face->get_template_id());
+    }
+    state.templates = arrangement.barcode_templates;
+    checkpoint->save_path(state);
+
+    if (verbosity >= 4) {
+        debug() << "  saving the state after step" << step << "of the path took" << timer.elapsed() << "milliseconds";
+    }
+} //end save_checkpoint()
+
+//restores the state saved by save_checkpoint(), if there is a valid checkpoint for this path; returns the number of steps already traversed
+//  precondition: the permutation vectors and grade lists are set up for the start of the path
+unsigned PersistenceUpdater::restore_checkpoint(std::vector<std::shared_ptr<Halfedge>>& path)
+{
+    PathCheckpoint state;
+    if (!checkpoint->load_path(state))
+        return 0;
+
+    //the checkpoint must fit this path, arrangement, and order on simplices
+    if (state.path_length != path.size() || state.step > path.size()
+        || state.perm_low.size() != perm_low.size() || state.inv_perm_low.size() != perm_low.size()
+        || state.perm_high.size() != perm_high.size() || state.inv_perm_high.size() != perm_high.size()
+        || state.entries.size() != entries.size()
+        || state.visited.size() != arrangement.faces.size() || state.template_ids.size() != arrangement.faces.size()) {
+        debug() << "Ignoring the checkpoint of the path, since it does not fit the arrangement";
+        return 0;
+    }
+
+    perm_low = state.perm_low;
+    inv_perm_low = state.inv_perm_low;
+    perm_high = state.perm_high;
+    inv_perm_high = state.inv_perm_high;
+    for (unsigned i = 0; i < entries.size(); i++) {
+        PathCheckpoint::EntryState& saved = state.entries[i];
+        entries[i]->low_simplices.swap(saved.low_simplices);
+        entries[i]->high_simplices.swap(saved.high_simplices);
+        entries[i]->low_count = saved.low_count;
+        entries[i]->high_count = saved.high_count;
+        entries[i]->low_index = saved.low_index;
+        entries[i]->high_index = saved.high_index;
+    }
+    lift_low = state.lift_low;
+    lift_high = state.lift_high;
+    for (unsigned i = 0; i < arrangement.faces.size(); i++) {
+        if (state.visited[i]) {
+            arrangement.faces[i]->mark_as_visited();
+            arrangement.faces[i]->set_template_id(state.template_ids[i]);
         }
     }
+    arrangement.barcode_templates = state.templates;
 
-    // PART 4: CLEAN UP
+    if (verbosity >= 2) {
+        debug() << "Continuing from step" << state.step << "of" << path.size() << "of the path";
+    }
+    return state.step;
+} //end restore_checkpoint()
 
-    delete R_low;
-    delete R_high;
-    delete U_low;
-    delete U_high;
+//counts the number of transpositions that will happen if we cross an anchor and do vineyard updates
+//this function DOES NOT MODIFY the xiSupportMatrix
+unsigned long PersistenceUpdater::count_crossing_transpositions(std::shared_ptr<TemplatePointsMatrixEntry> at_anchor, bool from_below)
+{
+    if (at_anchor->down != nullptr && at_anchor->left != nullptr) //then this is a strict anchor and some simplices swap
+        return count_transpositions(at_anchor, from_below);
+
+    //this is a non-strict anchor, and we just have to split or merge equivalence classes
+    std::shared_ptr<TemplatePointsMatrixEntry> generator = at_anchor->down;
+    if (generator == nullptr)
+        generator = at_anchor->left;
+
+    if ((from_below && generator == at_anchor->down) || (!from_below && generator == at_anchor->left))
+        return 0; //then merge classes -- there will never be any transpositions in this case
+
+    //then split classes
+    unsigned long num_trans = 0;
+    unsigned junk = 0;
+    bool horiz = (generator == at_anchor->left);
+    count_transpositions_from_separations(at_anchor, generator, horiz, true, num_trans, junk);
+    count_transpositions_from_separations(at_anchor, generator, horiz, false, num_trans, junk);
+    return num_trans;
+} //end count_crossing_transpositions()
+
+//crosses an anchor, updating the order on simplices and (depending on mode) the RU-decomposition
+//  returns a count of the number of transpositions performed
+unsigned long PersistenceUpdater::cross_anchor(std::shared_ptr<TemplatePointsMatrixEntry> at_anchor, bool from_below, CrossingMode mode)
+{
+    unsigned long swap_counter = 0;
 
-    delete R_low_initial;
-    delete R_high_initial;
-} //end store_barcodes_with_reset()
+    //get equivalence classes for this anchor
+    std::shared_ptr<TemplatePointsMatrixEntry> down = at_anchor->down;
+    std::shared_ptr<TemplatePointsMatrixEntry> left = at_anchor->left;
+
+    //if this is a strict anchor, then swap simplices
+    if (down != nullptr && left != nullptr) //then this is a strict anchor and some simplices swap
+    {
+        //if the anchor is crossed from below to above, then the columns at down move past the columns at left; otherwise, the reverse
+        std::shared_ptr<TemplatePointsMatrixEntry> first = from_below ? down : left;
+        std::shared_ptr<TemplatePointsMatrixEntry> second = from_below ? left : down;
+
+        remove_lift_entries(at_anchor); //this block of the partition might become empty
+        remove_lift_entries(first); //this block of the partition will move
+
+        if (mode == VINEYARD_UPDATES) {
+            swap_counter += split_grade_lists(at_anchor, second, from_below); //move grades that come before second from anchor to second -- vineyard updates
+            swap_counter += move_columns(first, second, from_below); //swaps blocks of columns at first and at second -- vineyard updates
+        } else {
+            split_grade_lists_no_vineyards(at_anchor, second, from_below); //only updates the xiSupportMatrix and permutation vectors; no vineyard updates
+            update_order(first, second, from_below);
+        }
+
+        merge_grade_lists(at_anchor, first); //move all grades from first to anchor
+        add_lift_entries(at_anchor); //this block of the partition might have previously been empty
+        add_lift_entries(second); //this block of the partition moved
+    } else //this is a non-strict anchor, and we just have to split or merge equivalence classes
+    {
+        std::shared_ptr<TemplatePointsMatrixEntry> generator = (down != nullptr) ? down : left;
+
+        if ((from_below && generator == down) || (!from_below && generator == left))
+        //then merge classes -- there will never be any transpositions in this case
+        {
+            remove_lift_entries(generator);
+            merge_grade_lists(at_anchor, generator);
+            add_lift_entries(at_anchor); //this is necessary in case the class was previously empty
+        } else //then split classes
+        {
+            bool horiz = (generator == left);
+            remove_lift_entries(at_anchor); //this is necessary because the class corresponding to at_anchor might become empty
+
+            if (mode == VINEYARD_UPDATES)
+                swap_counter += split_grade_lists(at_anchor, generator, horiz);
+            else
+                split_grade_lists_no_vineyards(at_anchor, generator, horiz); //only updates the xiSupportMatrix; no vineyard updates
+
+            add_lift_entries(at_anchor);
+            add_lift_entries(generator);
+        }
+    }
+
+    return swap_counter;
+} //end cross_anchor()
 
 //function to set the "edge weights" for each anchor line
 void PersistenceUpdater::set_anchor_weights(std::vector<std::shared_ptr<Halfedge>>& path)
@@ -505,9 +902,9 @@ unsigned PersistenceUpdater::build_simplex_order(IndexMatrix* ind, bool low, std
         std::shared_ptr<TemplatePointsMatrixEntry> cur = template_points_matrix.get_row(row);
         if (cur == nullptr)
             continue;
-        std::list<std::shared_ptr<Multigrade>>* mgrades = (low) ? &(cur->low_simplices) : &(cur->high_simplices);
-        for (std::list<std::shared_ptr<Multigrade>>::iterator it = mgrades->begin(); it != mgrades->end(); ++it) {
-            num_simplices += (*it)->num_cols;
+        const std::vector<Multigrade>& mgrades = (low) ? cur->low_simplices : cur->high_simplices;
+        for (std::vector<Multigrade>::const_iterator it = mgrades.begin(); it != mgrades.end(); ++it) {
+            num_simplices += it->num_cols;
         }
     }
 
@@ -534,14 +931,13 @@ unsigned PersistenceUpdater::build_simplex_order(IndexMatrix* ind, bool low, std
         *cur_ind = o_index;
 
         //get the multigrade list for this TemplatePointsMatrixEntry
-        std::list<std::shared_ptr<Multigrade>>* mgrades = (low) ? &(cur->low_simplices) : &(cur->high_simplices);
+        std::vector<Multigrade>& mgrades = (low) ? cur->low_simplices : cur->high_simplices;
 
         //sort the multigrades in lexicographical order
-        mgrades->sort([](std::shared_ptr<Multigrade> a, std::shared_ptr<Multigrade> b) { return Multigrade::LexComparator(*a, *b); });
+        std::stable_sort(mgrades.begin(), mgrades.end(), Multigrade::LexComparator);
 
         //store map values for all simplices at these multigrades
-        for (std::list<std::shared_ptr<Multigrade>>::iterator it = mgrades->begin(); it != mgrades->end(); ++it) {
-            std::shared_ptr<Multigrade> mg = *it;
+        for (std::vector<Multigrade>::const_iterator mg = mgrades.begin(); mg != mgrades.end(); ++mg) {
             if (verbosity >= 10) {
                 debug() << "  multigrade (" << mg->x << "," << mg->y << ") has" << mg->num_cols << "simplices with last dim_index" << mg->simplex_index << "which will map to order_index" << o_index;
             }
@@ -555,13 +951,15 @@ unsigned PersistenceUpdater::build_simplex_order(IndexMatrix* ind, bool low, std
 
         //if any simplices of the specified dimension were mapped to this equivalence class, then store information about this class
         if (*cur_ind != o_index) {
-            if (low)
-                lift_low.insert(std::pair<unsigned, std::shared_ptr<TemplatePointsMatrixEntry>>(*cur_ind, cur));
-            else
-                lift_high.insert(std::pair<unsigned, std::shared_ptr<TemplatePointsMatrixEntry>>(*cur_ind, cur));
+            LiftMap& lift = low ? lift_low : lift_high;
+            lift.push_back(std::make_pair(*cur_ind, cur->index));
         }
     } //end for(row > 0)
 
+    //the classes were found from right to left, but the lift maps are sorted by column
+    LiftMap& lift = low ? lift_low : lift_high;
+    std::reverse(lift.begin(), lift.end());
+
     return num_simplices;
 } //end build_simplex_order()
 
@@ -606,9 +1004,8 @@ void PersistenceUpdater::count_transpositions_from_separations(std::shared_ptr<T
 {
     int gr_col = greater->low_index;
     int cur_col = gr_col;
-    std::list<std::shared_ptr<Multigrade>> grades = low ? greater->low_simplices : greater->high_simplices;
-    for (std::list<std::shared_ptr<Multigrade>>::iterator it = grades.begin(); it != grades.end(); ++it) {
-        std::shared_ptr<Multigrade> cur_grade = *it;
+    const std::vector<Multigrade>& grades = low ? greater->low_simplices : greater->high_simplices;
+    for (std::vector<Multigrade>::const_iterator cur_grade = grades.begin(); cur_grade != grades.end(); ++cur_grade) {
         if ((horiz && cur_grade->x > lesser->x) || (!horiz && cur_grade->y > lesser->y)) //then there will be transpositions from separations
         {
             count_trans += cur_grade->num_cols * (gr_col - cur_col);
@@ -628,22 +1025,22 @@ unsigned long PersistenceUpdater::split_grade_lists(std::shared_ptr<TemplatePoin
     //low simplices
     int gr_col = greater->low_index;
     int cur_col = gr_col;
-    std::list<std::shared_ptr<Multigrade>> grades = greater->low_simplices;
-    greater->low_simplices.clear();
-    for (std::list<std::shared_ptr<Multigrade>>::iterator it = grades.begin(); it != grades.end(); ++it) {
-        std::shared_ptr<Multigrade> cur_grade = *it;
+    std::vector<Multigrade>& grades = greater->low_simplices;
+    std::vector<Multigrade>::iterator kept = grades.begin(); //grades that still lift to greater are moved to the front of the list
+    for (std::vector<Multigrade>::iterator cur_grade = grades.begin(); cur_grade != grades.end(); ++cur_grade) {
         if ((horiz && cur_grade->x > lesser->x) || (!horiz && cur_grade->y > lesser->y)) //then this grade lifts to greater, so move columns to the right
         {
             if (cur_col != gr_col) //then we must move the columns
                 swap_counter += move_low_columns(cur_col, cur_grade->num_cols, gr_col);
 
-            greater->low_simplices.push_back(cur_grade);
+            *kept++ = *cur_grade;
             gr_col -= cur_grade->num_cols;
         } else //then this grade lifts to lesser, so update lift map, but no need to move columns
-            lesser->low_simplices.push_back(cur_grade);
+            lesser->low_simplices.push_back(*cur_grade);
 
         cur_col -= cur_grade->num_cols;
     }
+    grades.erase(kept, grades.end());
     lesser->low_index = gr_col;
     lesser->low_count = gr_col - cur_col;
     greater->low_count = greater->low_index - lesser->low_index;
@@ -651,22 +1048,22 @@ unsigned long PersistenceUpdater::split_grade_lists(std::shared_ptr<TemplatePoin
     //high simplices
     gr_col = greater->high_index;
     cur_col = gr_col;
-    grades = greater->high_simplices;
-    greater->high_simplices.clear();
-    for (std::list<std::shared_ptr<Multigrade>>::iterator it = grades.begin(); it != grades.end(); ++it) {
-        std::shared_ptr<Multigrade> cur_grade = *it;
+    std::vector<Multigrade>& grades_h = greater->high_simplices;
+    std::vector<Multigrade>::iterator kept_h = grades_h.begin(); //grades that still lift to greater are moved to the front of the list
+    for (std::vector<Multigrade>::iterator cur_grade = grades_h.begin(); cur_grade != grades_h.end(); ++cur_grade) {
         if ((horiz && cur_grade->x > lesser->x) || (!horiz && cur_grade->y > lesser->y)) //then this grade lifts to greater, so move columns to the right
         {
             if (cur_col != gr_col) //then we must move the columns
                 swap_counter += move_high_columns(cur_col, cur_grade->num_cols, gr_col);
 
-            greater->high_simplices.push_back(cur_grade);
+            *kept_h++ = *cur_grade;
             gr_col -= cur_grade->num_cols;
         } else //then this grade lifts to lesser, so update lift map, but no need to move columns
-            lesser->high_simplices.push_back(cur_grade);
+            lesser->high_simplices.push_back(*cur_grade);
 
         cur_col -= cur_grade->num_cols;
     }
+    grades_h.erase(kept_h, grades_h.end());
     lesser->high_index = gr_col;
     lesser->high_count = gr_col - cur_col;
     greater->high_count = greater->high_index - lesser->high_index;
@@ -682,20 +1079,20 @@ void PersistenceUpdater::split_grade_lists_no_vineyards(std::shared_ptr<Template
     //first, low simpilices
     int gr_col = greater->low_index;
     int cur_col = gr_col;
-    std::list<std::shared_ptr<Multigrade>> grades = greater->low_simplices;
-    greater->low_simplices.clear(); ///this isn't so efficient...
-    for (std::list<std::shared_ptr<Multigrade>>::iterator it = grades.begin(); it != grades.end(); ++it) {
-        std::shared_ptr<Multigrade> cur_grade = *it;
+    std::vector<Multigrade>& grades = greater->low_simplices;
+    std::vector<Multigrade>::iterator kept = grades.begin(); //grades that still lift to greater are moved to the front of the list
+    for (std::vector<Multigrade>::iterator cur_grade = grades.begin(); cur_grade != grades.end(); ++cur_grade) {
         cur_grade->simplex_index = cur_col;
         if ((horiz && cur_grade->x > lesser->x) || (!horiz && cur_grade->y > lesser->y)) //then this grade lifts to greater
         {
-            greater->low_simplices.push_back(cur_grade);
+            *kept++ = *cur_grade;
             gr_col -= cur_grade->num_cols;
         } else //then this grade lifts to lesser
-            lesser->low_simplices.push_back(cur_grade);
+            lesser->low_simplices.push_back(*cur_grade);
 
         cur_col -= cur_grade->num_cols;
     }
+    grades.erase(kept, grades.end());
     lesser->low_index = gr_col;
     lesser->low_count = gr_col - cur_col;
     greater->low_count = greater->low_index - lesser->low_index;
@@ -703,20 +1100,20 @@ void PersistenceUpdater::split_grade_lists_no_vineyards(std::shared_ptr<Template
     //now high simplices
     gr_col = greater->high_index;
     cur_col = gr_col;
-    std::list<std::shared_ptr<Multigrade>> grades_h = greater->high_simplices;
-    greater->high_simplices.clear(); ///this isn't so efficient...
-    for (std::list<std::shared_ptr<Multigrade>>::iterator it = grades_h.begin(); it != grades_h.end(); ++it) {
-        std::shared_ptr<Multigrade> cur_grade = *it;
+    std::vector<Multigrade>& grades_h = greater->high_simplices;
+    std::vector<Multigrade>::iterator kept_h = grades_h.begin(); //grades that still lift to greater are moved to the front of the list
+    for (std::vector<Multigrade>::iterator cur_grade = grades_h.begin(); cur_grade != grades_h.end(); ++cur_grade) {
         cur_grade->simplex_index = cur_col;
         if ((horiz && cur_grade->x > lesser->x) || (!horiz && cur_grade->y > lesser->y)) //then this grade lifts to greater
         {
-            greater->high_simplices.push_back(cur_grade);
+            *kept_h++ = *cur_grade;
             gr_col -= cur_grade->num_cols;
         } else //then this grade lifts to lesser
-            lesser->high_simplices.push_back(cur_grade);
+            lesser->high_simplices.push_back(*cur_grade);
 
         cur_col -= cur_grade->num_cols;
     }
+    grades_h.erase(kept_h, grades_h.end());
     lesser->high_index = gr_col;
     lesser->high_count = gr_col - cur_col;
     greater->high_count = greater->high_index - lesser->high_index;
@@ -732,8 +1129,7 @@ void PersistenceUpdater::split_grade_lists_no_vineyards(std::shared_ptr<Template
     while (true) //loop ends with break statement
     {
         //update positions of "low" simplices for this entry
-        for (std::list<std::shared_ptr<Multigrade>>::iterator it = cur_entry->low_simplices.begin(); it != cur_entry->low_simplices.end(); ++it) {
-            std::shared_ptr<Multigrade> cur_grade = *it;
+        for (std::vector<Multigrade>::const_iterator cur_grade = cur_entry->low_simplices.begin(); cur_grade != cur_entry->low_simplices.end(); ++cur_grade) {
             for (unsigned i = 0; i < cur_grade->num_cols; i++) {
                 //column currently in position (cur_grade->simplex_index - i) has new position low_col
                 unsigned original_position = inv_perm_low[cur_grade->simplex_index - i];
@@ -743,8 +1139,7 @@ void PersistenceUpdater::split_grade_lists_no_vineyards(std::shared_ptr<Template
         }
 
         //update positions of "high" simplices for this entry
-        for (std::list<std::shared_ptr<Multigrade>>::iterator it = cur_entry->high_simplices.begin(); it != cur_entry->high_simplices.end(); ++it) {
-            std::shared_ptr<Multigrade> cur_grade = *it;
+        for (std::vector<Multigrade>::const_iterator cur_grade = cur_entry->high_simplices.begin(); cur_grade != cur_entry->high_simplices.end(); ++cur_grade) {
             for (unsigned i = 0; i < cur_grade->num_cols; i++) {
                 //column currently in position (cur_grade->simplex_index - i) has new position high_col
                 unsigned original_position = inv_perm_high[cur_grade->simplex_index - i];
@@ -772,12 +1167,14 @@ void PersistenceUpdater::split_grade_lists_no_vineyards(std::shared_ptr<Template
 void PersistenceUpdater::merge_grade_lists(std::shared_ptr<TemplatePointsMatrixEntry> greater, std::shared_ptr<TemplatePointsMatrixEntry> lesser)
 {
     //low simplices
-    greater->low_simplices.splice(greater->low_simplices.end(), lesser->low_simplices);
+    greater->low_simplices.insert(greater->low_simplices.end(), lesser->low_simplices.begin(), lesser->low_simplices.end());
+    lesser->low_simplices.clear();
     greater->low_count += lesser->low_count;
     lesser->low_count = 0;
 
     //high simplices
-    greater->high_simplices.splice(greater->high_simplices.end(), lesser->high_simplices);
+    greater->high_simplices.insert(greater->high_simplices.end(), lesser->high_simplices.begin(), lesser->high_simplices.end());
+    lesser->high_simplices.clear();
     greater->high_count += lesser->high_count;
     lesser->high_count = 0;
 } //end merge_grade_lists()
@@ -804,21 +1201,18 @@ unsigned long PersistenceUpdater::move_columns(std::shared_ptr<TemplatePointsMat
     unsigned long swap_counter = 0;
 
     //move all "low" simplices for TemplatePointsMatrixEntry first (start with rightmost column, end with leftmost)
-    for (std::list<std::shared_ptr<Multigrade>>::iterator it = first->low_simplices.begin(); it != first->low_simplices.end();) //NOTE: iterator advances in loop
-    {
-        std::shared_ptr<Multigrade> cur_grade = *it;
-
+    std::vector<Multigrade>::iterator kept = first->low_simplices.begin(); //grades that still lift to first are moved to the front of the list
+    for (std::vector<Multigrade>::iterator cur_grade = first->low_simplices.begin(); cur_grade != first->low_simplices.end(); ++cur_grade) {
         if ((from_below && cur_grade->x > second->x) || (!from_below && cur_grade->y > second->y))
         //then move columns at cur_grade past columns at TemplatePointsMatrixEntry second; lift map does not change ( lift : multigrades --> xiSupportElements )
         {
             swap_counter += move_low_columns(low_col, cur_grade->num_cols, second->low_index);
             second->low_index -= cur_grade->num_cols;
-            ++it;
+            *kept++ = *cur_grade;
         } else //then cur_grade now lifts to TemplatePointsMatrixEntry second; columns don't move
         {
             //associate cur_grade with second
-            second->insert_multigrade(cur_grade, true);
-            it = first->low_simplices.erase(it); //NOTE: advances the iterator!!!
+            second->insert_multigrade(*cur_grade, true);
 
             //update column counts
             first->low_count -= cur_grade->num_cols;
@@ -828,12 +1222,11 @@ unsigned long PersistenceUpdater::move_columns(std::shared_ptr<TemplatePointsMat
         //update column index
         low_col -= cur_grade->num_cols;
     } //end "low" simplex loop
+    first->low_simplices.erase(kept, first->low_simplices.end());
 
     //move all "high" simplices for TemplatePointsMatrixEntry first (start with rightmost column, end with leftmost)
-    for (std::list<std::shared_ptr<Multigrade>>::iterator it = first->high_simplices.begin(); it != first->high_simplices.end();) //NOTE: iterator advances in loop
-    {
-        std::shared_ptr<Multigrade> cur_grade = *it;
-
+    std::vector<Multigrade>::iterator kept_h = first->high_simplices.begin(); //grades that still lift to first are moved to the front of the list
+    for (std::vector<Multigrade>::iterator cur_grade = first->high_simplices.begin(); cur_grade != first->high_simplices.end(); ++cur_grade) {
         // debug() << "  ====>>>> moving high simplices at grade (" << cur_grade->x << "," << cur_grade->y << ")";
 
         if ((from_below && cur_grade->x > second->x) || (!from_below && cur_grade->y > second->y))
@@ -841,14 +1234,13 @@ unsigned long PersistenceUpdater::move_columns(std::shared_ptr<TemplatePointsMat
         {
             swap_counter += move_high_columns(high_col, cur_grade->num_cols, second->high_index);
             second->high_index -= cur_grade->num_cols;
-            ++it;
+            *kept_h++ = *cur_grade;
         } else //then cur_grade now lifts to TemplatePointsMatrixEntry second; columns don't move
         {
             // debug() << "====>>>> simplex at (" << cur_grade->x << "," << cur_grade->y << ") now lifts to (" << second->x << "," << second->y << ")";
 
             //associate cur_grade with second
-            second->insert_multigrade(cur_grade, false);
-            it = first->high_simplices.erase(it); //NOTE: advances the iterator!!!
+            second->insert_multigrade(*cur_grade, false);
 
             //update column counts
             first->high_count -= cur_grade->num_cols;
@@ -858,6 +1250,7 @@ unsigned long PersistenceUpdater::move_columns(std::shared_ptr<TemplatePointsMat
         //update column index
         high_col -= cur_grade->num_cols;
     } //end "high" simplex loop
+    first->high_simplices.erase(kept_h, first->high_simplices.end());
 
     //the following should never occur
     if (second->low_index + first->low_count != first->low_index || second->high_index + first->high_count != first->high_index) {
@@ -893,6 +1286,8 @@ unsigned long PersistenceUpdater::move_low_columns(int s, unsigned n, int t)
 
             //now for the vineyards algorithm
             vineyard_update_low(a);
+            mark_low_column(a);
+            mark_low_column(b);
 
             /// TESTING ONLY - FOR CHECKING THAT D=RU
             //if (testing) {
@@ -932,6 +1327,8 @@ unsigned long PersistenceUpdater::move_high_columns(int s, unsigned n, int t)
 
             //now for the vineyards algorithm
             vineyard_update_high(a);
+            mark_high_column(a);
+            mark_high_column(b);
 
             /// TESTING ONLY - FOR CHECKING THAT D=RU
             //if (testing) {
@@ -1113,23 +1510,23 @@ void PersistenceUpdater::vineyard_update_high(unsigned a)
     }
 } //end vineyard update_high()
 
-//swaps two blocks of columns by updating the total order on columns, then rebuilding the matrices and computing a new RU-decomposition
-void PersistenceUpdater::update_order_and_reset_matrices(std::shared_ptr<TemplatePointsMatrixEntry> first, std::shared_ptr<TemplatePointsMatrixEntry> second, bool from_below, MapMatrix_Perm* RL_initial, MapMatrix_Perm* RH_initial)
+//swaps two blocks of columns by updating the total order on columns (but not the matrices)
+void PersistenceUpdater::update_order(std::shared_ptr<TemplatePointsMatrixEntry> first, std::shared_ptr<TemplatePointsMatrixEntry> second, bool from_below)
 {
     //STEP 1: update the lift map for all multigrades and store the current column index for each multigrade
 
     //store current column index for each multigrade that lifts to TemplatePointsMatrixEntry second
     int low_col = second->low_index;
-    for (std::list<std::shared_ptr<Multigrade>>::iterator it = second->low_simplices.begin(); it != second->low_simplices.end(); ++it) //starts with rightmost column, ends with leftmost
+    for (std::vector<Multigrade>::iterator it = second->low_simplices.begin(); it != second->low_simplices.end(); ++it) //starts with rightmost column, ends with leftmost
     {
-        (*it)->simplex_index = low_col;
-        low_col -= (*it)->num_cols;
+        it->simplex_index = low_col;
+        low_col -= it->num_cols;
     }
     int high_col = second->high_index;
-    for (std::list<std::shared_ptr<Multigrade>>::iterator it = second->high_simplices.begin(); it != second->high_simplices.end(); ++it) //starts with rightmost column, ends with leftmost
+    for (std::vector<Multigrade>::iterator it = second->high_simplices.begin(); it != second->high_simplices.end(); ++it) //starts with rightmost column, ends with leftmost
     {
-        (*it)->simplex_index = high_col;
-        high_col -= (*it)->num_cols;
+        it->simplex_index = high_col;
+        high_col -= it->num_cols;
     }
 
     //get column indexes for the first equivalence class
@@ -1142,10 +1539,8 @@ void PersistenceUpdater::update_order_and_reset_matrices(std::shared_ptr<Templat
 
     //store current column index and update the lift map for each multigrade that lifts to TemplatePointsMatrixEntry first
     //"low" simplices (start with rightmost column, end with leftmost)
-    for (std::list<std::shared_ptr<Multigrade>>::iterator it = first->low_simplices.begin(); it != first->low_simplices.end();) //NOTE: iterator advances in loop
-    {
-        std::shared_ptr<Multigrade> cur_grade = *it;
-
+    std::vector<Multigrade>::iterator kept = first->low_simplices.begin(); //grades that still lift to first are moved to the front of the list
+    for (std::vector<Multigrade>::iterator cur_grade = first->low_simplices.begin(); cur_grade != first->low_simplices.end(); ++cur_grade) {
         //remember current position of this grade
         cur_grade->simplex_index = low_col;
 
@@ -1153,12 +1548,11 @@ void PersistenceUpdater::update_order_and_reset_matrices(std::shared_ptr<Templat
         //then move columns at cur_grade past columns at TemplatePointsMatrixEntry second; lift map does not change ( lift : multigrades --> xiSupportElements )
         {
             second->low_index -= cur_grade->num_cols;
-            ++it;
+            *kept++ = *cur_grade;
         } else //then cur_grade now lifts to TemplatePointsMatrixEntry second; columns don't move
         {
             //associate cur_grade with second
-            second->insert_multigrade(cur_grade, true);
-            it = first->low_simplices.erase(it); //NOTE: advances the iterator!!!
+            second->insert_multigrade(*cur_grade, true);
 
             //update column counts
             first->low_count -= cur_grade->num_cols;
@@ -1168,12 +1562,11 @@ void PersistenceUpdater::update_order_and_reset_matrices(std::shared_ptr<Templat
         //update column index
         low_col -= cur_grade->num_cols;
     } //end "low" simplex loop
+    first->low_simplices.erase(kept, first->low_simplices.end());
 
     //"high" simplices (start with rightmost column, end with leftmost)
-    for (std::list<std::shared_ptr<Multigrade>>::iterator it = first->high_simplices.begin(); it != first->high_simplices.end();) //NOTE: iterator advances in loop
-    {
-        std::shared_ptr<Multigrade> cur_grade = *it;
-
+    std::vector<Multigrade>::iterator kept_h = first->high_simplices.begin(); //grades that still lift to first are moved to the front of the list
+    for (std::vector<Multigrade>::iterator cur_grade = first->high_simplices.begin(); cur_grade != first->high_simplices.end(); ++cur_grade) {
         //remember current position of this grade
         cur_grade->simplex_index = high_col;
 
@@ -1181,12 +1574,11 @@ void PersistenceUpdater::update_order_and_reset_matrices(std::shared_ptr<Templat
         //then move columns at cur_grade past columns at TemplatePointsMatrixEntry second; lift map does not change ( lift : multigrades --> xiSupportElements )
         {
             second->high_index -= cur_grade->num_cols;
-            ++it;
+            *kept_h++ = *cur_grade;
         } else //then cur_grade now lifts to TemplatePointsMatrixEntry second; columns don't move
         {
             //associate cur_grade with target
-            second->insert_multigrade(cur_grade, false);
-            it = first->high_simplices.erase(it); //NOTE: advances the iterator!!!
+            second->insert_multigrade(*cur_grade, false);
 
             //update column counts
             first->high_count -= cur_grade->num_cols;
@@ -1196,6 +1588,7 @@ void PersistenceUpdater::update_order_and_reset_matrices(std::shared_ptr<Templat
         //update column index
         high_col -= cur_grade->num_cols;
     } //end "high" simplex loop
+    first->high_simplices.erase(kept_h, first->high_simplices.end());
 
     //STEP 2: traverse grades (backwards) in the new order and update the permutation vectors to reflect the new order on matrix columns
 
@@ -1207,8 +1600,7 @@ void PersistenceUpdater::update_order_and_reset_matrices(std::shared_ptr<Templat
     //loop over xiMatrixEntrys
     while (first != second) {
         //update positions of "low" simplices for this entry
-        for (std::list<std::shared_ptr<Multigrade>>::iterator it = cur_entry->low_simplices.begin(); it != cur_entry->low_simplices.end(); ++it) {
-            std::shared_ptr<Multigrade> cur_grade = *it;
+        for (std::vector<Multigrade>::const_iterator cur_grade = cur_entry->low_simplices.begin(); cur_grade != cur_entry->low_simplices.end(); ++cur_grade) {
             for (unsigned i = 0; i < cur_grade->num_cols; i++) {
                 //column currently in position (cur_grade->simplex_index - i) has new position low_col
                 unsigned original_position = inv_perm_low[cur_grade->simplex_index - i];
@@ -1218,8 +1610,7 @@ void PersistenceUpdater::update_order_and_reset_matrices(std::shared_ptr<Templat
         }
 
         //update positions of "high" simplices for this entry
-        for (std::list<std::shared_ptr<Multigrade>>::iterator it = cur_entry->high_simplices.begin(); it != cur_entry->high_simplices.end(); ++it) {
-            std::shared_ptr<Multigrade> cur_grade = *it;
+        for (std::vector<Multigrade>::const_iterator cur_grade = cur_entry->high_simplices.begin(); cur_grade != cur_entry->high_simplices.end(); ++cur_grade) {
             for (unsigned i = 0; i < cur_grade->num_cols; i++) {
                 //column currently in position (cur_grade->simplex_index - i) has new position high_col
                 unsigned original_position = inv_perm_high[cur_grade->simplex_index - i];
@@ -1240,39 +1631,100 @@ void PersistenceUpdater::update_order_and_reset_matrices(std::shared_ptr<Templat
         inv_perm_low[perm_low[i]] = i;
     for (unsigned i = 0; i < perm_high.size(); i++)
         inv_perm_high[perm_high[i]] = i;
+} //end update_order()
 
-    //STEP 3: re-build the matrix R based on the new order
+//rebuilds the matrices for the current order on columns and computes a new RU-decomposition, which is stored in the snapshot cache
+//  if the current order can be reached from a snapshot by fewer than max_trans transpositions, then instead starts from that
+//  snapshot and does vineyard updates; in this case, returns true and adds the number of transpositions to swap_counter
+bool PersistenceUpdater::reset_matrices(const ImplicitBoundaryMatrix* RL_initial, const ImplicitBoundaryMatrix* RH_initial, unsigned long max_trans, unsigned long& swap_counter)
+{
+    unsigned long num_trans = 0;
+    const RUSnapshot* snapshot = snapshots.find_nearest(perm_low, perm_high, max_trans, num_trans);
+
+    if (snapshot != NULL) {
+        //copy the snapshot, then move its columns into the current order
+        delete R_low;
+        R_low = new MapMatrix_Perm(snapshot->R_low);
+        delete R_high;
+        R_high = new MapMatrix_Perm(snapshot->R_high);
+        delete U_low;
+        U_low = new MapMatrix_RowPriority_Perm(snapshot->U_low);
+        delete U_high;
+        U_high = new MapMatrix_RowPriority_Perm(snapshot->U_high);
+
+        //the low columns must move first, since vineyard updates for low columns also permute the rows of R_high
+        swap_counter += restore_order(snapshot->perm_low, true);
+        swap_counter += restore_order(snapshot->perm_high, false);
+    } else {
+        //re-build the matrix R based on the new order
+        R_low->rebuild(RL_initial, perm_low);
+        R_high->rebuild(RH_initial, perm_high, perm_low);
+
+        //compute the new RU-decomposition
+        ///TODO: should I avoid deleting and reallocating matrix U?
+        delete U_low;
+        U_low = R_low->decompose_RU();
+        delete U_high;
+        U_high = R_high->decompose_RU();
+
+        //keep a copy, so that later resets nearby can start from it
+        snapshots.store(*R_low, *R_high, *U_low, *U_high, perm_low, perm_high);
+    }
 
-    R_low->rebuild(RL_initial, perm_low);
-    R_high->rebuild(RH_initial, perm_high, perm_low);
+    //every bar must be re-examined
+    mark_all_columns();
+    return snapshot != NULL;
+} //end reset_matrices()
 
-    //STEP 4: compute the new RU-decomposition
+//moves the columns of the matrices from the order given by old_perm_low and old_perm_high to the current order all at once,
+//  then fixes the RU-decomposition globally (see MapMatrix_Perm::reorder_RU())
+void PersistenceUpdater::reorder_matrices(const Perm& old_perm_low, const Perm& old_perm_high)
+{
+    //maps from the old column indexes to the current column indexes
+    Perm low_order(perm_low.size());
+    for (unsigned i = 0; i < perm_low.size(); i++)
+        low_order[old_perm_low[i]] = perm_low[i];
+    Perm high_order(perm_high.size());
+    for (unsigned i = 0; i < perm_high.size(); i++)
+        high_order[old_perm_high[i]] = perm_high[i];
 
-    ///TODO: should I avoid deleting and reallocating matrix U?
+    //the rows of R_high correspond to the columns of R_low, so they move too
+    MapMatrix_RowPriority_Perm* U = R_low->reorder_RU(U_low, low_order, NULL);
     delete U_low;
-    U_low = R_low->decompose_RU();
+    U_low = U;
+    U = R_high->reorder_RU(U_high, high_order, &low_order);
     delete U_high;
-    U_high = R_high->decompose_RU();
+    U_high = U;
 
-} //end update_order_and_reset_matrices()
+    //every bar must be re-examined
+    mark_all_columns();
+} //end reorder_matrices()
 
-//updates the total order on columns, rebuilds the matrices, and computing a new RU-decomposition for a NON-STRICT anchor
-void PersistenceUpdater::update_order_and_reset_matrices(MapMatrix_Perm* RL_initial, MapMatrix_Perm* RH_initial)
+//moves the columns of R_low (if low is true) or R_high (otherwise) by vineyard updates from the order given by from to the current order
+//  returns the number of transpositions performed
+unsigned long PersistenceUpdater::restore_order(const Perm& from, bool low)
 {
-    //anything to do here?????
+    const Perm& to = low ? perm_low : perm_high;
 
-    //re-build the matrix R based on the new order
-    R_low->rebuild(RL_initial, perm_low);
-    R_high->rebuild(RH_initial, perm_high, perm_low);
+    //target[c] is the current index of the column that has index c in the order given by from
+    std::vector<unsigned> target(to.size());
+    for (unsigned i = 0; i < to.size(); i++)
+        target[from[i]] = to[i];
 
-    //compute the new RU-decomposition
-    ///TODO: should I avoid deleting and reallocating matrix U?
-    delete U_low;
-    U_low = R_low->decompose_RU();
-    delete U_high;
-    U_high = R_high->decompose_RU();
-
-} //end update_order_and_reset_matrices()
+    //insertion sort by transpositions of adjacent columns, each of which is a vineyard update
+    unsigned long count = 0;
+    for (unsigned c = 1; c < target.size(); c++) {
+        for (unsigned j = c; j > 0 && target[j - 1] > target[j]; j--) {
+            if (low)
+                vineyard_update_low(j - 1);
+            else
+                vineyard_update_high(j - 1);
+            std::swap(target[j - 1], target[j]);
+            count++;
+        }
+    }
+    return count;
+} //end restore_order()
 
 //swaps two blocks of simplices in the total order, and returns the number of transpositions that would be performed on the matrix columns if we were doing vineyard updates
 void PersistenceUpdater::count_switches_and_separations(std::shared_ptr<TemplatePointsMatrixEntry> at_anchor, bool from_below, unsigned long& switches, unsigned long& seps)
@@ -1310,19 +1762,19 @@ void PersistenceUpdater::do_separations(std::shared_ptr<TemplatePointsMatrixEntr
     //first, low simpilicse
     int gr_col = greater->low_index;
     int cur_col = gr_col;
-    std::list<std::shared_ptr<Multigrade>> grades = greater->low_simplices;
-    greater->low_simplices.clear(); ///this isn't so efficient...
-    for (std::list<std::shared_ptr<Multigrade>>::iterator it = grades.begin(); it != grades.end(); ++it) {
-        std::shared_ptr<Multigrade> cur_grade = *it;
+    std::vector<Multigrade>& grades = greater->low_simplices;
+    std::vector<Multigrade>::iterator kept = grades.begin(); //grades that still lift to greater are moved to the front of the list
+    for (std::vector<Multigrade>::iterator cur_grade = grades.begin(); cur_grade != grades.end(); ++cur_grade) {
         if ((horiz && cur_grade->x > lesser->x) || (!horiz && cur_grade->y > lesser->y)) //then this grade lifts to greater
         {
-            greater->low_simplices.push_back(cur_grade);
+            *kept++ = *cur_grade;
             gr_col -= cur_grade->num_cols;
         } else //then this grade lifts to lesser
-            lesser->low_simplices.push_back(cur_grade);
+            lesser->low_simplices.push_back(*cur_grade);
 
         cur_col -= cur_grade->num_cols;
     }
+    grades.erase(kept, grades.end());
     lesser->low_index = gr_col;
     lesser->low_count = gr_col - cur_col;
     greater->low_count = greater->low_index - lesser->low_index;
@@ -1330,19 +1782,19 @@ void PersistenceUpdater::do_separations(std::shared_ptr<TemplatePointsMatrixEntr
     //now high simplices
     gr_col = greater->high_index;
     cur_col = gr_col;
-    std::list<std::shared_ptr<Multigrade>> grades_h = greater->high_simplices;
-    greater->high_simplices.clear(); ///this isn't so efficient...
-    for (std::list<std::shared_ptr<Multigrade>>::iterator it = grades_h.begin(); it != grades_h.end(); ++it) {
-        std::shared_ptr<Multigrade> cur_grade = *it;
+    std::vector<Multigrade>& grades_h = greater->high_simplices;
+    std::vector<Multigrade>::iterator kept_h = grades_h.begin(); //grades that still lift to greater are moved to the front of the list
+    for (std::vector<Multigrade>::iterator cur_grade = grades_h.begin(); cur_grade != grades_h.end(); ++cur_grade) {
         if ((horiz && cur_grade->x > lesser->x) || (!horiz && cur_grade->y > lesser->y)) //then this grade lifts to greater
         {
-            greater->high_simplices.push_back(cur_grade);
+            *kept_h++ = *cur_grade;
             gr_col -= cur_grade->num_cols;
         } else //then this grade lifts to lesser
-            lesser->high_simplices.push_back(cur_grade);
+            lesser->high_simplices.push_back(*cur_grade);
 
         cur_col -= cur_grade->num_cols;
     }
+    grades_h.erase(kept_h, grades_h.end());
     lesser->high_index = gr_col;
     lesser->high_count = gr_col - cur_col;
     greater->high_count = greater->high_index - lesser->high_index;
@@ -1356,14 +1808,18 @@ void PersistenceUpdater::remove_lift_entries(std::shared_ptr<TemplatePointsMatri
     }
 
     //low simplices
-    std::map<unsigned, std::shared_ptr<TemplatePointsMatrixEntry>>::iterator it1 = lift_low.find(entry->low_index);
-    if (it1 != lift_low.end() && it1->second == entry)
+    LiftMap::iterator it1 = find_lift(lift_low, entry->low_index);
+    if (it1 != lift_low.end() && it1->first == entry->low_index && it1->second == entry->index) {
+        mark_lift_range(it1, true);
         lift_low.erase(it1);
+    }
 
     //high simplices
-    std::map<unsigned, std::shared_ptr<TemplatePointsMatrixEntry>>::iterator it2 = lift_high.find(entry->high_index);
-    if (it2 != lift_high.end() && it2->second == entry)
+    LiftMap::iterator it2 = find_lift(lift_high, entry->high_index);
+    if (it2 != lift_high.end() && it2->first == entry->high_index && it2->second == entry->index) {
+        mark_lift_range(it2, false);
         lift_high.erase(it2);
+    }
 
 } //end remove_lift_entries()
 
@@ -1375,88 +1831,185 @@ void PersistenceUpdater::add_lift_entries(std::shared_ptr<TemplatePointsMatrixEn
     }
 
     //low simplices
-    if (entry->low_count > 0)
-        lift_low.insert(std::pair<unsigned, std::shared_ptr<TemplatePointsMatrixEntry>>(entry->low_index, entry));
+    if (entry->low_count > 0) {
+        LiftMap::iterator it = find_lift(lift_low, entry->low_index);
+        if (it == lift_low.end() || it->first != entry->low_index)
+            mark_lift_range(lift_low.insert(it, std::make_pair(entry->low_index, entry->index)), true);
+    }
 
     //high simplices
-    if (entry->high_count > 0)
-        lift_high.insert(std::pair<unsigned, std::shared_ptr<TemplatePointsMatrixEntry>>(entry->high_index, entry));
+    if (entry->high_count > 0) {
+        LiftMap::iterator it = find_lift(lift_high, entry->high_index);
+        if (it == lift_high.end() || it->first != entry->high_index)
+            mark_lift_range(lift_high.insert(it, std::make_pair(entry->high_index, entry->index)), false);
+    }
 } //end add_lift_entries()
 
-//stores a barcode template in a 2-cell of the arrangement
-///TODO: IMPROVE THIS!!! (store previous barcode at the simplicial level, and only examine columns that were modified in the recent update)
+//returns an iterator to the first entry of the given lift map whose column is at least col (or end() if there is none)
+//  this entry determines the lift of column col
+PersistenceUpdater::LiftMap::iterator PersistenceUpdater::find_lift(LiftMap& lift, unsigned col)
+{
+    return std::lower_bound(lift.begin(), lift.end(), col,
+        [](const std::pair<unsigned, unsigned>& a, unsigned c) { return a.first < c; });
+}
+
+//stores a barcode template in a 2-cell of the arrangement (or, for a segment of the path, in segment_templates)
+//  cur_template is updated by re-examining only the columns that were marked since the previous call, so the work
+//  done here is proportional to the size of the most recent vineyard updates rather than to the number of columns
 /// Is there a better way to handle endpoints at infinity?
 void PersistenceUpdater::store_barcode_template(std::shared_ptr<Face> cell)
 {
-    Debug qd = debug(true);
-    if (verbosity >= 6) {
-        qd << "  -- barcode: ";
+    update_barcode_template();
+
+    if (is_segment) {
+        //the template is stored in the arrangement once all segments are finished
+        segment_template_ids.push_back(segment_templates.intern(cur_template));
+        return;
     }
 
     //mark this cell as visited
     cell->mark_as_visited();
+    cell->set_template_id(arrangement.barcode_templates.intern(cur_template));
+} //end store_barcode_template()
+
+//brings cur_template up to date by re-examining the columns marked since the previous call
+void PersistenceUpdater::update_barcode_template()
+{
+    Debug qd = debug(true);
+    if (verbosity >= 6) {
+        qd << "  -- barcode changes (" << dirty_cols.size() << " columns examined): ";
+    }
 
-    //get a reference to the barcode template object
-    BarcodeTemplate& dbc = cell->get_barcode();
+    //find the bars that change for each marked column of R_low
+    std::vector<BarTemplate> added, removed;
+    for (std::vector<unsigned>::iterator it = dirty_cols.begin(); it != dirty_cols.end(); ++it) {
+        unsigned c = *it;
+        col_is_dirty[c] = false;
+
+        //remove the bar that this column previously contributed
+        BarTemplate& old_bar = low_col_bars[c];
+        if (old_bar.multiplicity > 0) {
+            removed.push_back(old_bar);
+            if (verbosity >= 6) {
+                qd << "-(" << old_bar.begin << "," << old_bar.end << ") ";
+            }
+        }
+        old_bar = BarTemplate();
 
-    //loop over all zero-columns in matrix R_low
-    for (unsigned c = 0; c < R_low->width(); c++) {
         if (R_low->col_is_empty(c)) //then simplex corresponding to column c is positive
         {
             //find index of template point corresponding to simplex c
-            std::map<unsigned, std::shared_ptr<TemplatePointsMatrixEntry>>::iterator tp1 = lift_low.lower_bound(c);
-            unsigned a = (tp1 != lift_low.end()) ? tp1->second->index : -1; //index is -1 iff the simplex maps to infinity
+            LiftMap::iterator tp1 = find_lift(lift_low, c);
+            unsigned a = (tp1 != lift_low.end()) ? tp1->second : -1; //index is -1 iff the simplex maps to infinity
 
             //is simplex s paired?
             int s = R_high->find_low(c);
+            unsigned b = -1; //b = -1 = MAX_UNSIGNED indicates an essential cycle
             if (s != -1) //then simplex c is paired with negative simplex s
             {
                 //find index of xi support point corresponding to simplex s
-                std::map<unsigned, std::shared_ptr<TemplatePointsMatrixEntry>>::iterator tp2 = lift_high.lower_bound(s);
-                unsigned b = (tp2 != lift_high.end()) ? tp2->second->index : -1; //index is -1 iff the simplex maps to infinity
+                LiftMap::iterator tp2 = find_lift(lift_high, s);
+                b = (tp2 != lift_high.end()) ? tp2->second : -1; //index is -1 iff the simplex maps to infinity
+            }
 
-                if (a != b) //then we have a bar of positive length
-                {
-                    dbc.add_bar(a, b);
-                    if (verbosity >= 6) {
-                        qd << "(" << c << "," << s << ")-->(" << a << "," << b << ") ";
-                    }
-                }
-            } else //then simplex c generates an essential cycle
+            if (s == -1 || a != b) //then we have a bar of positive length
             {
-                dbc.add_bar(a, -1); //b = -1 = MAX_UNSIGNED indicates this is an essential cycle
+                old_bar = BarTemplate(a, b, 1);
+                added.push_back(old_bar);
                 if (verbosity >= 6) {
-                    qd << c << "-->" << a << " ";
+                    qd << "+(" << a << "," << b << ") ";
                 }
             }
         }
     }
+    dirty_cols.clear();
+
+    //update the template in a single pass
+    if (!added.empty() || !removed.empty())
+        cur_template.update_bars(added, removed);
+
     if (verbosity >= 6) {
         qd << "\n ";
     }
-} //end store_barcode_template()
+} //end update_barcode_template()
+
+//marks the bar of the simplex in column c of R_low, so that it is re-examined by the next call to store_barcode_template()
+void PersistenceUpdater::mark_low_column(unsigned c)
+{
+    if (c < col_is_dirty.size() && !col_is_dirty[c]) {
+        col_is_dirty[c] = true;
+        dirty_cols.push_back(c);
+    }
+}
+
+//marks the bar (if any) that ends at the simplex in column s of R_high
+void PersistenceUpdater::mark_high_column(unsigned s)
+{
+    int c = R_high->low(s);
+    if (c != -1)
+        mark_low_column(c);
+}
+
+//marks every column of R_low, e.g. after the matrices are reset
+void PersistenceUpdater::mark_all_columns()
+{
+    for (unsigned c = 0; c < col_is_dirty.size(); c++)
+        mark_low_column(c);
+}
+
+//marks the columns whose lift is determined by the given entry of lift_low (if low is true) or lift_high (otherwise)
+//  these are the columns after the preceding entry, up to and including the key of this entry
+void PersistenceUpdater::mark_lift_range(LiftMap::iterator it, bool low)
+{
+    if (col_is_dirty.empty()) //then the initial template has not been computed yet, or this updater does not track bars
+        return;
+    unsigned width = low ? R_low->width() : R_high->width();
+    if (width == 0) //then there is nothing to mark
+        return;
 
-//chooses an initial threshold by timing vineyard updates corresponding to random transpositions
-void PersistenceUpdater::choose_initial_threshold(unsigned decomp_time, unsigned long & num_trans, unsigned & trans_time, unsigned long & threshold)
+    LiftMap& lift = low ? lift_low : lift_high;
+    unsigned first = (it == lift.begin()) ? 0 : std::prev(it)->first + 1;
+    unsigned last = std::min(it->first, width - 1);
+
+    for (unsigned j = first; j <= last; j++) {
+        if (low)
+            mark_low_column(j);
+        else
+            mark_high_column(j);
+    }
+} //end mark_lift_range()
+
+//returns the number of entries in the matrices R and U; this is a feature of the cost model
+unsigned long PersistenceUpdater::count_matrix_entries()
+{
+    return R_low->num_entries() + R_high->num_entries() + U_low->num_entries() + U_high->num_entries();
+}
+
+//calibrates the cost model by the work of the initial RU-decomposition and of vineyard updates corresponding to random transpositions
+//  the random transpositions are determined by the seed, and their number by the work, so the calibration is the same on every run
+void PersistenceUpdater::calibrate_cost_model(unsigned long long decomp_work, ResetStats& stats)
 {
     if (verbosity >= 4) {
-        debug() << "RANDOM VINEYARD UPDATES TO CHOOSE THE INITIAL THRESHOLD";
+        debug() << "RANDOM VINEYARD UPDATES TO CALIBRATE THE COST MODEL";
     }
 
-    //other data structures
+    //the initial RU-decomposition is the first reset
     unsigned num_cols = R_low->width() + R_high->width();
-    std::list<unsigned> trans_list;
+    stats.model.set_matrix_features(num_cols, count_matrix_entries());
+    stats.model.record_reset(decomp_work);
 
     //avoid trivial cases
     if (num_cols <= 3) { //if neither the low or high matrix has at least 2 columns, then we can't do transpositions
-        threshold = 1000;
         return;
     }
 
-    //determine the time for which we will do transpositions
-    int runtime = decomp_time / 20;
-    if (runtime < 100)
-        runtime = 100; //run for at least 100 milliseconds
+    //do a fixed number of transpositions, unless this takes much more work than the initial RU-decomposition
+    const unsigned max_trans = 5000;
+    unsigned long long max_work = std::max(decomp_work / 20, 10000000ull);
+    unsigned long long work_before = MapMatrix_Base::addition_work();
+    std::mt19937 rng(seed);
+    std::vector<unsigned> trans_list;
+    trans_list.reserve(max_trans);
 
     //start the timer
     Timer timer;
@@ -1465,10 +2018,9 @@ void PersistenceUpdater::choose_initial_threshold(unsigned decomp_time, unsigned
     if (verbosity >= 8) {
         debug() << "  -->Doing some random vineyard updates...";
     }
-    while ( (timer.elapsed() < runtime || trans_list.size() == 0) &&
-        (timer.elapsed() < 5 || trans_list.size() < 5000) ) //do a transposition
+    while (trans_list.size() < max_trans && (trans_list.size() == 0 || MapMatrix_Base::addition_work() - work_before < max_work)) //do a transposition
     {
-        unsigned rand_col = rand() % (num_cols - 1); //random integer in {0, 1, ..., num_cols - 2}
+        unsigned rand_col = rng() % (num_cols - 1); //random integer in {0, 1, ..., num_cols - 2}; taken modulo so that the sequence is the same on every platform
 
         if (rand_col + 1 < R_low->width()) //then transpose LOW columns rand_col and (rand_col + 1)
         {
@@ -1495,17 +2047,18 @@ void PersistenceUpdater::choose_initial_threshold(unsigned decomp_time, unsigned
         }
     }
 
-    //record the time and number of transpositions
-    trans_time = timer.elapsed();
-    num_trans = 2 * trans_list.size();
+    //record the time, work, and number of transpositions; they cross no anchor, so the anchor weight is 0
+    long long trans_time = timer.elapsed_ns();
+    unsigned long num_trans = 2 * trans_list.size();
+    unsigned long long trans_work = MapMatrix_Base::addition_work() - work_before + num_trans;
+    stats.total_transpositions += num_trans;
+    stats.total_time_for_transpositions += trans_time;
+    stats.model.record_vineyard_updates(num_trans, 0, trans_work);
 
     if (verbosity >= 8) {
-        debug() << "  -->Did" << num_trans << "vineyard updates in" << trans_time << "milliseconds.";
+        debug() << "  -->Did" << num_trans << "vineyard updates in" << trans_time << "nanoseconds, with" << trans_work << "units of work.";
     }
-
-    //compute the threshold
-    threshold = (unsigned long)(((double)num_trans / (double)trans_time) * decomp_time);
-} //end choose_initial_threshold()
+} //end calibrate_cost_model()
 
 ///TESTING ONLY
 /// functions to check that D=RU
@@ -1564,6 +2117,6 @@ void PersistenceUpdater::print_perms(Perm& per, Perm& inv)
 void PersistenceUpdater::print_high_partition()
 {
     debug(true) << "  high partition: ";
-    for (std::map<unsigned, std::shared_ptr<TemplatePointsMatrixEntry>>::iterator it = lift_high.begin(); it != lift_high.end(); ++it)
-        debug(true) << it->first << "->" << it->second->index << ", ";
+    for (LiftMap::iterator it = lift_high.begin(); it != lift_high.end(); ++it)
+        debug(true) << it->first << "->" << it->second << ", ";
 }
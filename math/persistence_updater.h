@@ -30,30 +30,52 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //forward declarations
 class Face;
 class Halfedge;
+class ImplicitBoundaryMatrix;
 class IndexMatrix;
 class MapMatrix_Perm;
 class MapMatrix_RowPriority_Perm;
 class Arrangement;
+class Checkpoint;
 class MultiBetti;
 class SimplexTree;
 class TemplatePoint;
 struct TemplatePointsMatrixEntry;
 
+#include "crossing_cost_model.h"
+#include "ru_snapshot_cache.h"
 #include "template_points_matrix.h"
 
+#include "dcel/barcode_template.h"
 #include <interface/progress.h>
-#include <map>
+#include <utility>
 #include <vector>
 
 class PersistenceUpdater {
 public:
-    PersistenceUpdater(Arrangement& m, SimplexTree& b, std::vector<TemplatePoint>& xi_pts, unsigned verbosity); //constructor for when we must compute all of the barcode templates
+    PersistenceUpdater(Arrangement& m, SimplexTree& b, unsigned dim, std::vector<TemplatePoint>& xi_pts, unsigned verbosity); //constructor for when we must compute all of the barcode templates in homology of dimension dim
+    ~PersistenceUpdater();
 
     //PersistenceUpdater(Arrangement& m, std::vector<TemplatePoint>& xi_pts); //constructor for when we load the pre-computed barcode templates from a RIVET data file
 
     //functions to compute and store barcode templates in each 2-cell of the arrangement
     void store_barcodes_with_reset(std::vector<std::shared_ptr<Halfedge>>& path, Progress& progress); //hybrid approach -- for expensive crossings, resets the matrices and does a standard persistence calculation
-    void store_barcodes_quicksort(std::vector<std::shared_ptr<Halfedge>>& path); ///TODO -- for expensive crossings, rearranges columns via quicksort and fixes the RU-decomposition globally
+    void store_barcodes_quicksort(std::vector<std::shared_ptr<Halfedge>>& path, Progress& progress); //hybrid approach -- for expensive crossings, moves all columns to their new positions at once and fixes the RU-decomposition globally
+    void store_barcodes_vineyards(std::vector<std::shared_ptr<Halfedge>>& path, Progress& progress); //does vineyard updates for every crossing, however expensive (for comparison with the hybrid approaches)
+
+    //splits the path into the given number of segments, which are traversed by separate threads in the above functions
+    //  each segment after the first starts with a fresh RU-decomposition; each thread holds its own copy of the matrices
+    void set_num_segments(unsigned n);
+
+    //sets the number of bytes that may be used to keep copies of RU-decompositions computed when the matrices are reset
+    //  a later reset then starts from the nearest copy and does vineyard updates, if that is cheaper than a new decomposition
+    void set_snapshot_budget(unsigned long bytes);
+
+    //sets the seed for the random transpositions that calibrate the model of the cost of vineyard updates and resets
+    void set_seed(unsigned s);
+
+    //sets the checkpoint to which the state of the traversal of the path is saved now and then, and from which a later run continues
+    //  the state is only saved while the path is traversed in one segment, but a run with several segments can continue from it
+    void set_checkpoint(Checkpoint* c);
 
     //function to set the "edge weights" for each anchor line
     void set_anchor_weights(std::vector<std::shared_ptr<Halfedge>>& path);
@@ -72,8 +94,11 @@ private:
 
     TemplatePointsMatrix template_points_matrix; //sparse matrix to hold xi support points -- used for finding anchors (to build the arrangement) and tracking simplices during the vineyard updates (when computing barcodes to store in the arrangement)
 
-    std::map<unsigned, std::shared_ptr<TemplatePointsMatrixEntry>> lift_low; //map from "low" columns to xiMatrixEntrys
-    std::map<unsigned, std::shared_ptr<TemplatePointsMatrixEntry>> lift_high; //map from "high" columns to xiMatrixEntrys
+    //map from columns to xiMatrixEntrys: pairs (rightmost column mapped to an entry, index of the entry in entries), sorted by column
+    //  a column lifts to the entry of the first pair whose column is not less than it
+    typedef std::vector<std::pair<unsigned, unsigned>> LiftMap;
+    LiftMap lift_low; //map from "low" columns to xiMatrixEntrys
+    LiftMap lift_high; //map from "high" columns to xiMatrixEntrys
 
     MapMatrix_Perm* R_low; //boundary matrix for "low" simplices
     MapMatrix_Perm* R_high; //boundary matrix for "high" simplices
@@ -86,6 +111,52 @@ private:
     std::vector<unsigned> perm_high; //map from column index at initial cell to column index at current cell
     std::vector<unsigned> inv_perm_high; //inverse of the previous map
 
+    //data structures for maintaining the barcode template incrementally along the path
+    BarcodeTemplate cur_template; //barcode template at the current position on the path
+    std::vector<BarTemplate> low_col_bars; //bar contributed to cur_template by the positive simplex in each column of R_low (multiplicity 0 if none)
+    std::vector<unsigned> dirty_cols; //columns of R_low whose bars might have changed since cur_template was last updated
+    std::vector<bool> col_is_dirty; //col_is_dirty[c] is true iff c is in dirty_cols
+
+    std::vector<std::shared_ptr<TemplatePointsMatrixEntry>> entries; //entries of template_points_matrix, by index; used to find the entry at an anchor
+
+    unsigned num_segments; //number of segments of the path that are traversed in parallel
+
+    RUSnapshotCache snapshots; //copies of RU-decompositions computed when the matrices were reset
+
+    unsigned seed; //seed for the random transpositions that calibrate the cost model
+
+    Checkpoint* checkpoint; //where the state of the traversal is saved, or NULL
+
+    //the ways to update the RU-decomposition when crossing an anchor would require many transpositions
+    enum CrossingStrategy {
+        VINEYARDS_ONLY, //do vineyard updates anyway
+        RESET, //rebuild the matrices and compute a new RU-decomposition (possibly starting from a snapshot)
+        QUICKSORT //move all columns to their new positions at once and fix the RU-decomposition globally
+    };
+    CrossingStrategy strategy;
+
+    //barcode templates computed for a segment of the path, before they are stored in the arrangement
+    bool is_segment; //true iff this updater traverses a segment of the path on behalf of another updater
+    BarcodeTemplatePool segment_templates; //distinct templates computed in the segment
+    std::vector<unsigned> segment_template_ids; //index in segment_templates of the template of each cell that is first reached in the segment, in path order
+
+    //running statistics of the path traversal (times in nanoseconds), with the model used to decide whether to do vineyard updates or to reset the matrices when crossing an anchor
+    struct ResetStats {
+        unsigned long total_transpositions;
+        long long total_time_for_transpositions;
+        unsigned number_of_resets;
+        unsigned number_of_warm_starts; //resets that started from a snapshot (their time and transpositions count as vineyard updates)
+        long long total_time_for_resets;
+        long long max_time;
+        CrossingCostModel model; //if the number of transpositions might exceed model.reset_threshold(), then we reset the matrices instead of doing vineyard updates
+    };
+
+    //the ways to update the order on simplices when crossing an anchor
+    enum CrossingMode {
+        VINEYARD_UPDATES, //update the RU-decomposition by vineyard updates
+        ORDER_ONLY //update only the order on simplices; the matrices are not touched (and must be reset afterwards)
+    };
+
     ///TESTING ONLY
     //bool testing;
     //MapMatrix_Perm* D_low;
@@ -95,6 +166,38 @@ private:
 
     typedef std::vector<unsigned> Perm; //for storing permutations
 
+    //copies the order on simplices (including the grade lists and lift maps) of other, but not its matrices; used for segments of the path
+    PersistenceUpdater(const PersistenceUpdater& other);
+
+    //computes and stores a barcode template in each 2-cell of the arrangement, handling expensive crossings according to strategy
+    void store_barcodes(std::vector<std::shared_ptr<Halfedge>>& path, Progress& progress);
+
+    //traverses steps first_step through (last_step - 1) of the path, storing the barcode template of each cell for which first_visit is true
+    //  from_below[i] is true iff the anchor at step i is crossed from below; progress may be NULL
+    void traverse_path(std::vector<std::shared_ptr<Halfedge>>& path, unsigned first_step, unsigned last_step,
+        const std::vector<bool>& from_below, const std::vector<bool>& first_visit,
+        const ImplicitBoundaryMatrix* RL_initial, const ImplicitBoundaryMatrix* RH_initial, ResetStats& stats, Progress* progress);
+
+    //splits steps first_step through the end of the path into num_segments segments of roughly equal edge weight and traverses them in parallel,
+    //  then stores the barcode templates
+    void traverse_path_in_segments(std::vector<std::shared_ptr<Halfedge>>& path, unsigned first_step,
+        const std::vector<bool>& from_below, const std::vector<bool>& first_visit,
+        const ImplicitBoundaryMatrix* RL_initial, const ImplicitBoundaryMatrix* RH_initial, ResetStats& stats, Progress& progress);
+
+    //saves the order on simplices, the grade lists, and the barcode templates stored so far, after the given number of steps of the path
+    void save_checkpoint(std::vector<std::shared_ptr<Halfedge>>& path, unsigned step);
+
+    //restores the state saved by save_checkpoint(), if there is a valid checkpoint for this path; returns the number of steps already traversed
+    //  the matrices must be rebuilt for the restored order on simplices
+    unsigned restore_checkpoint(std::vector<std::shared_ptr<Halfedge>>& path);
+
+    //counts the number of transpositions that will happen if we cross an anchor and do vineyard updates
+    unsigned long count_crossing_transpositions(std::shared_ptr<TemplatePointsMatrixEntry> at_anchor, bool from_below);
+
+    //crosses an anchor, updating the order on simplices and (depending on mode) the RU-decomposition
+    //  returns a count of the number of transpositions performed
+    unsigned long cross_anchor(std::shared_ptr<TemplatePointsMatrixEntry> at_anchor, bool from_below, CrossingMode mode);
+
     //stores multigrade info for the persistence computations (data structures prepared with respect to a near-vertical line positioned to the right of all \xi support points)
     //  low is true for simplices of dimension hom_dim, false for simplices of dimension hom_dim+1
     void store_multigrades(IndexMatrix* ind, bool low);
@@ -137,11 +240,21 @@ private:
     void vineyard_update_low(unsigned a);
     void vineyard_update_high(unsigned a);
 
-    //swaps two blocks of columns by updating the total order on columns, then rebuilding the matrices and computing a new RU-decomposition
-    void update_order_and_reset_matrices(std::shared_ptr<TemplatePointsMatrixEntry> first, std::shared_ptr<TemplatePointsMatrixEntry> second, bool from_below, MapMatrix_Perm* RL_initial, MapMatrix_Perm* RH_initial);
+    //swaps two blocks of columns by updating the total order on columns (but not the matrices)
+    void update_order(std::shared_ptr<TemplatePointsMatrixEntry> first, std::shared_ptr<TemplatePointsMatrixEntry> second, bool from_below);
+
+    //rebuilds the matrices for the current order on columns and computes a new RU-decomposition, which is stored in the snapshot cache
+    //  if the current order can be reached from a snapshot by fewer than max_trans transpositions, then instead starts from that
+    //  snapshot and does vineyard updates; in this case, returns true and adds the number of transpositions to swap_counter
+    bool reset_matrices(const ImplicitBoundaryMatrix* RL_initial, const ImplicitBoundaryMatrix* RH_initial, unsigned long max_trans, unsigned long& swap_counter);
 
-    //updates the total order on columns, rebuilds the matrices, and computing a new RU-decomposition for a NON-STRICT anchor
-    void update_order_and_reset_matrices(MapMatrix_Perm* RL_initial, MapMatrix_Perm* RH_initial);
+    //moves the columns of the matrices from the order given by old_perm_low and old_perm_high to the current order all at once,
+    //  then fixes the RU-decomposition globally
+    void reorder_matrices(const Perm& old_perm_low, const Perm& old_perm_high);
+
+    //moves the columns of R_low (if low is true) or R_high (otherwise) by vineyard updates from the order given by from to the current order
+    //  returns the number of transpositions performed
+    unsigned long restore_order(const Perm& from, bool low);
 
     //swaps two blocks of simplices in the total order, and counts switches and separations
     void count_switches_and_separations(std::shared_ptr<TemplatePointsMatrixEntry> at_anchor, bool from_below, unsigned long& switches, unsigned long& seps);
@@ -155,12 +268,27 @@ private:
     //creates the appropriate entries in lift_low and lift_high for an TemplatePointsMatrixEntry with nonempty sets of "low" or "high" simplices
     void add_lift_entries(std::shared_ptr<TemplatePointsMatrixEntry> entry);
 
-    //stores a barcode template in a 2-cell of the arrangement
-    ///TODO: IMPROVE THIS -- track most recent barcode at the simplicial level and re-examine only the necessary columns!!!
+    //returns an iterator to the entry of the given lift map that determines the lift of column col (or end() if col lifts to infinity)
+    static LiftMap::iterator find_lift(LiftMap& lift, unsigned col);
+
+    //stores a barcode template in a 2-cell of the arrangement (or, for a segment of the path, in segment_templates)
+    //  only the columns marked as dirty since the previous call are re-examined
     void store_barcode_template(std::shared_ptr<Face> cell);
 
-    //chooses an initial threshold by timing vineyard updates corresponding to random transpositions
-    void choose_initial_threshold(unsigned decomp_time, unsigned long & num_trans, unsigned & trans_time, unsigned long & threshold);
+    //brings cur_template up to date with the current RU-decomposition
+    void update_barcode_template();
+
+    //functions to record which bars of cur_template might have changed
+    void mark_low_column(unsigned c); //marks the bar of the simplex in column c of R_low
+    void mark_high_column(unsigned s); //marks the bar (if any) that ends at the simplex in column s of R_high
+    void mark_all_columns(); //marks every column of R_low, e.g. after the matrices are reset
+    void mark_lift_range(LiftMap::iterator it, bool low); //marks the columns whose lift is determined by the given entry of lift_low or lift_high
+
+    //returns the number of entries in the matrices R and U; this is a feature of the cost model
+    unsigned long count_matrix_entries();
+
+    //calibrates the cost model by the work of the initial RU-decomposition and of vineyard updates corresponding to random transpositions
+    void calibrate_cost_model(unsigned long long decomp_work, ResetStats& stats);
 
     ///TESTING ONLY
     //void check_low_matrix(MapMatrix_Perm* RL, MapMatrix_RowPriority_Perm* UL);
@@ -0,0 +1,156 @@
+/**********************************************************************
+Copyright 2014-2016 The RIVET Developers. See the COPYRIGHT file at
+the top-level directory of this distribution.
+
+This file is part of RIVET.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+
+#include "ru_snapshot_cache.h"
+
+#include <algorithm>
+#include <cstddef> //for NULL
+#include <stdexcept>
+
+/********** RUSnapshot **********/
+
+RUSnapshot::RUSnapshot(const MapMatrix_Perm& RL, const MapMatrix_Perm& RH, const MapMatrix_RowPriority_Perm& UL, const MapMatrix_RowPriority_Perm& UH,
+    const std::vector<unsigned>& perm_low, const std::vector<unsigned>& perm_high, unsigned long bytes)
+    : R_low(RL)
+    , R_high(RH)
+    , U_low(UL)
+    , U_high(UH)
+    , perm_low(perm_low)
+    , perm_high(perm_high)
+    , bytes(bytes)
+{
+}
+
+/********** RUSnapshotCache **********/
+
+RUSnapshotCache::RUSnapshotCache()
+    : budget(0)
+    , usage(0)
+{
+}
+
+//sets the maximum number of bytes used by all snapshots, evicting snapshots if necessary
+void RUSnapshotCache::set_budget(unsigned long bytes)
+{
+    budget = bytes;
+    evict(budget);
+}
+
+unsigned long RUSnapshotCache::get_budget() const
+{
+    return budget;
+}
+
+//returns the approximate number of bytes used by all snapshots
+unsigned long RUSnapshotCache::get_usage() const
+{
+    return usage;
+}
+
+//returns the number of snapshots
+unsigned RUSnapshotCache::size() const
+{
+    return snapshots.size();
+}
+
+//stores a copy of the given RU-decomposition, evicting the least recently used snapshots to stay within the budget
+//  returns false (and stores nothing) if the copy alone would exceed the budget
+bool RUSnapshotCache::store(const MapMatrix_Perm& RL, const MapMatrix_Perm& RH, const MapMatrix_RowPriority_Perm& UL, const MapMatrix_RowPriority_Perm& UH,
+    const std::vector<unsigned>& perm_low, const std::vector<unsigned>& perm_high)
+{
+    if (budget == 0)
+        return false;
+
+    //estimate the size of the copy before making it
+    unsigned long bytes = sizeof(RUSnapshot) + RL.memory_usage() + RH.memory_usage() + UL.memory_usage() + UH.memory_usage()
+        + (perm_low.size() + perm_high.size()) * sizeof(unsigned);
+    if (bytes > budget)
+        return false;
+
+    evict(budget - bytes);
+    snapshots.emplace_front(new RUSnapshot(RL, RH, UL, UH, perm_low, perm_high, bytes));
+    usage += bytes;
+    return true;
+} //end store()
+
+//finds the snapshot from which the given order on columns can be reached by the fewest transpositions, if that number is less than max_trans
+//  returns NULL if there is no such snapshot; otherwise stores the number of transpositions in num_trans
+const RUSnapshot* RUSnapshotCache::find_nearest(const std::vector<unsigned>& perm_low, const std::vector<unsigned>& perm_high, unsigned long max_trans, unsigned long& num_trans)
+{
+    auto nearest = snapshots.end();
+    unsigned long limit = max_trans; //only snapshots nearer than this are of interest
+    for (auto it = snapshots.begin(); it != snapshots.end(); ++it) {
+        const RUSnapshot& snapshot = **it;
+        if (snapshot.perm_low.size() != perm_low.size() || snapshot.perm_high.size() != perm_high.size()) {
+            throw std::runtime_error("RUSnapshotCache::find_nearest(): snapshot has the wrong number of columns");
+        }
+
+        unsigned long count = count_transpositions(snapshot.perm_low, perm_low, limit);
+        if (count < limit)
+            count += count_transpositions(snapshot.perm_high, perm_high, limit - count);
+        if (count < limit) {
+            nearest = it;
+            limit = count;
+        }
+    }
+
+    if (nearest == snapshots.end())
+        return NULL;
+
+    //the snapshot is now the most recently used
+    snapshots.splice(snapshots.begin(), snapshots, nearest);
+    num_trans = limit;
+    return snapshots.front().get();
+} //end find_nearest()
+
+//counts the transpositions of adjacent columns required to go from the order given by from to the order given by to
+//  (that is, the number of pairs of columns in different relative order); stops counting at limit
+unsigned long RUSnapshotCache::count_transpositions(const std::vector<unsigned>& from, const std::vector<unsigned>& to, unsigned long limit)
+{
+    unsigned n = from.size();
+
+    //target[c] is the index in the order given by to of the column with index c in the order given by from
+    std::vector<unsigned> target(n);
+    for (unsigned i = 0; i < n; i++)
+        target[from[i]] = to[i];
+
+    //count inversions in target, using a Fenwick tree to count the earlier entries that are less than each entry
+    std::vector<unsigned> tree(n + 1, 0);
+    unsigned long count = 0;
+    for (unsigned c = 0; c < n && count < limit; c++) {
+        unsigned num_less = 0;
+        for (unsigned k = target[c]; k > 0; k -= k & (~k + 1))
+            num_less += tree[k];
+        count += c - num_less;
+
+        for (unsigned k = target[c] + 1; k <= n; k += k & (~k + 1))
+            tree[k]++;
+    }
+    return std::min(count, limit);
+} //end count_transpositions()
+
+//evicts least recently used snapshots until at most bytes are used
+void RUSnapshotCache::evict(unsigned long bytes)
+{
+    while (usage > bytes) {
+        usage -= snapshots.back()->bytes;
+        snapshots.pop_back();
+    }
+}
@@ -0,0 +1,82 @@
+/**********************************************************************
+Copyright 2014-2016 The RIVET Developers. See the COPYRIGHT file at
+the top-level directory of this distribution.
+
+This file is part of RIVET.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+/**
+ * \class	RUSnapshotCache
+ * \brief	Stores copies of RU-decompositions taken along the path, within a fixed memory budget
+ *
+ * When the PersistenceUpdater resets its matrices, it can start from the snapshot whose order on columns is nearest to
+ * the current order (measured by the number of transpositions between the two orders) and fix it by vineyard updates,
+ * instead of computing a new RU-decomposition from the initial boundary matrices.
+ */
+
+#ifndef __RU_SNAPSHOT_CACHE_H__
+#define __RU_SNAPSHOT_CACHE_H__
+
+#include "map_matrix.h"
+
+#include <list>
+#include <memory>
+#include <vector>
+
+//a copy of an RU-decomposition, together with the order on columns for which it was computed
+struct RUSnapshot {
+    RUSnapshot(const MapMatrix_Perm& RL, const MapMatrix_Perm& RH, const MapMatrix_RowPriority_Perm& UL, const MapMatrix_RowPriority_Perm& UH,
+        const std::vector<unsigned>& perm_low, const std::vector<unsigned>& perm_high, unsigned long bytes);
+
+    MapMatrix_Perm R_low;
+    MapMatrix_Perm R_high;
+    MapMatrix_RowPriority_Perm U_low;
+    MapMatrix_RowPriority_Perm U_high;
+    std::vector<unsigned> perm_low; //map from column index at initial cell to column index in this snapshot
+    std::vector<unsigned> perm_high; //map from column index at initial cell to column index in this snapshot
+    unsigned long bytes; //approximate number of bytes used by this snapshot
+};
+
+class RUSnapshotCache {
+public:
+    RUSnapshotCache(); //constructs an empty cache with a budget of zero bytes (so that no snapshots are stored)
+
+    void set_budget(unsigned long bytes); //sets the maximum number of bytes used by all snapshots, evicting snapshots if necessary
+    unsigned long get_budget() const;
+    unsigned long get_usage() const; //returns the approximate number of bytes used by all snapshots
+    unsigned size() const; //returns the number of snapshots
+
+    //stores a copy of the given RU-decomposition, evicting the least recently used snapshots to stay within the budget
+    //  returns false (and stores nothing) if the copy alone would exceed the budget
+    bool store(const MapMatrix_Perm& RL, const MapMatrix_Perm& RH, const MapMatrix_RowPriority_Perm& UL, const MapMatrix_RowPriority_Perm& UH,
+        const std::vector<unsigned>& perm_low, const std::vector<unsigned>& perm_high);
+
+    //finds the snapshot from which the given order on columns can be reached by the fewest transpositions, if that number is less than max_trans
+    //  returns NULL if there is no such snapshot; otherwise stores the number of transpositions in num_trans
+    const RUSnapshot* find_nearest(const std::vector<unsigned>& perm_low, const std::vector<unsigned>& perm_high, unsigned long max_trans, unsigned long& num_trans);
+
+    //counts the transpositions of adjacent columns required to go from the order given by from to the order given by to
+    //  (that is, the number of pairs of columns in different relative order); stops counting at limit
+    static unsigned long count_transpositions(const std::vector<unsigned>& from, const std::vector<unsigned>& to, unsigned long limit);
+
+private:
+    std::list<std::unique_ptr<RUSnapshot>> snapshots; //most recently used first
+    unsigned long budget;
+    unsigned long usage;
+
+    void evict(unsigned long bytes); //evicts least recently used snapshots until at most bytes are used
+};
+
+#endif // __RU_SNAPSHOT_CACHE_H__
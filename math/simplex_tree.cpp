@@ -20,6 +20,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "simplex_tree.h"
 
+#include "implicit_boundary_matrix.h"
 #include "index_matrix.h"
 #include "map_matrix.h"
 #include "st_node.h"
@@ -39,6 +40,7 @@ SimplexTree::SimplexTree(int dim, int v)
     , root(new STNode())
     , x_grades(0)
     , y_grades(0)
+    , ordered_simplices(dim + 2)
 {
     if (hom_dim > 5) {
         throw std::runtime_error("SimplexTree: Dimensions greater than 5 probably don't make sense");
@@ -134,24 +136,19 @@ void SimplexTree::update_gi_recursively(STNode* node, int& gic)
     }
 }
 
-//updates the dimension indexes (reverse-lexicographical multi-grade order) for simplices of dimension (hom_dim-1), hom_dim, and (hom_dim+1)
+//updates the dimension indexes (reverse-lexicographical multi-grade order) for simplices of each dimension up to (hom_dim+1)
+//  so that the boundary matrices for every dimension of homology up to hom_dim can be built from the same tree
 void SimplexTree::update_dim_indexes()
 {
     //build the lists of pointers to simplices of appropriate dimensions
     build_dim_lists_recursively(root, 0);
 
     //update the dimension indexes in the tree
-    int i = 0;
-    for (SimplexSet::iterator it = ordered_low_simplices.begin(); it != ordered_low_simplices.end(); ++it)
-        (*it)->set_dim_index(i++);
-
-    i = 0;
-    for (SimplexSet::iterator it = ordered_simplices.begin(); it != ordered_simplices.end(); ++it)
-        (*it)->set_dim_index(i++);
-
-    i = 0;
-    for (SimplexSet::iterator it = ordered_high_simplices.begin(); it != ordered_high_simplices.end(); ++it)
-        (*it)->set_dim_index(i++);
+    for (SimplexSet& simplices : ordered_simplices) {
+        int i = 0;
+        for (SimplexSet::iterator it = simplices.begin(); it != simplices.end(); ++it)
+            (*it)->set_dim_index(i++);
+    }
 }
 
 //recursively build lists to determine dimension indexes
@@ -161,12 +158,8 @@ void SimplexTree::build_dim_lists_recursively(STNode* node, unsigned cur_dim)
     std::vector<STNode*> kids = node->get_children();
 
     //check dimensions and add children to appropriate list
-    if (cur_dim == hom_dim - 1)
-        ordered_low_simplices.insert(kids.begin(), kids.end());
-    else if (cur_dim == hom_dim)
-        ordered_simplices.insert(kids.begin(), kids.end());
-    else if (cur_dim == hom_dim + 1)
-        ordered_high_simplices.insert(kids.begin(), kids.end());
+    if (cur_dim <= hom_dim + 1)
+        ordered_simplices[cur_dim].insert(kids.begin(), kids.end());
 
     //recurse through children
     for (unsigned i = 0; i < kids.size(); i++) {
@@ -256,160 +249,120 @@ void SimplexTree::build_VR_subtree(std::vector<unsigned>& times,
 //columns ordered according to dimension index (reverse-lexicographic order with respect to multi-grades)
 MapMatrix* SimplexTree::get_boundary_mx(unsigned dim)
 {
-    //select set of simplices of dimension dim
-    SimplexSet* simplices;
-    size_t num_rows;
-
-    if (dim == hom_dim) {
-        simplices = &ordered_simplices;
-        num_rows = ordered_low_simplices.size();
-    } else if (dim == hom_dim + 1) {
-        simplices = &ordered_high_simplices;
-        num_rows = ordered_simplices.size();
-    } else {
+    if (dim > hom_dim + 1) {
         std::stringstream ss;
-        ss << "SimplexTree::get_boundary_mx(): Attempting to compute boundary matrix for improper dimension (" << dim << "), expected either "
-           << hom_dim << " or " << hom_dim + 1;
+        ss << "SimplexTree::get_boundary_mx(): Attempting to compute boundary matrix for improper dimension (" << dim << "), expected at most "
+           << hom_dim + 1;
         throw std::runtime_error(ss.str());
     }
 
-    //create the MapMatrix
-    MapMatrix* mat = new MapMatrix(num_rows, simplices->size()); //DELETE this object later!
-
-    //if we want a matrix for 0-simplices, then we are done
-    if (dim == 0)
-        return mat;
-
-    //loop through simplices, writing columns to the matrix
-    int col = 0; //column counter
-    for (SimplexSet::iterator it = simplices->begin(); it != simplices->end(); ++it) {
-        write_boundary_column(mat, *it, col, 0);
-
-        col++;
+    //generate the columns, and write them to the MapMatrix
+    ImplicitBoundaryMatrix* bdry = get_implicit_boundary_mx(dim, NULL, NULL);
+    MapMatrix* mat = new MapMatrix(bdry->height(), bdry->width()); //DELETE this object later!
+    std::vector<unsigned> rows;
+    for (unsigned j = 0; j < bdry->width(); j++) {
+        bdry->get_column(j, rows);
+        for (unsigned row : rows) //increasing order, so that each entry is inserted at the start of the column
+            mat->set(row, j);
     }
+    delete bdry;
 
     //return the matrix
     return mat;
 } //end get_boundary_mx(int)
 
-//returns a boundary matrix for hom_dim-simplices with columns in a specified order -- for vineyard-update algorithm
-//    simplex_order is a map : dim_index --> order_index for simplices of the given dimension
-//        if simplex_order[i] == -1, then simplex with dim_index i is NOT represented in the boundary matrix
-//    num_simplices is the number of simplices in the order (i.e., the number of entries in the vector that are NOT -1)
-MapMatrix_Perm* SimplexTree::get_boundary_mx(std::vector<int>& coface_order, unsigned num_simplices)
-{
-    //create the matrix
-    MapMatrix_Perm* mat = new MapMatrix_Perm(ordered_low_simplices.size(), num_simplices);
-
-    //loop through all simplices, writing columns to the matrix
-    int dim_index = 0; //tracks our position in the list of hom_dim-simplices
-    for (SimplexSet::iterator it = ordered_simplices.begin(); it != ordered_simplices.end(); ++it) {
-        int order_index = coface_order[dim_index]; //index of the matrix column which will store the boundary of this simplex
-        if (order_index != -1) {
-            write_boundary_column(mat, *it, order_index, 0);
-        }
-
-        dim_index++; //increment the column counter
-    }
-
-    //return the matrix
-    return mat;
-} //end get_boundary_mx(int, vector<int>)
-
-//returns a boundary matrix for (hom_dim+1)-simplices with columns and rows a specified orders -- for vineyard-update algorithm
+//returns a boundary matrix for simplices of dimension at most hom_dim+1 that generates its columns on demand, with columns and rows in specified orders
 //  PARAMETERS:
-//    each vector is a map : dim_index --> order_index for simplices of the given dimension
+//    face_order and coface_order are maps : dim_index --> order_index for simplices of dimension dim-1 and dim, respectively
 //        if order[i] == -1, then simplex with dim_index i is NOT represented in the boundary matrix
-//    each unsigned is the number of simplices in the corresponding order (i.e., the number of entries in the vector that are NOT -1)
-MapMatrix_Perm* SimplexTree::get_boundary_mx(std::vector<int>& face_order, unsigned num_faces, std::vector<int>& coface_order, unsigned num_cofaces)
+//        if an order is NULL, then each simplex is represented by its dim_index
+//  if the simplices cannot be numbered by 64-bit integers, then the returned matrix stores its columns instead
+ImplicitBoundaryMatrix* SimplexTree::get_implicit_boundary_mx(unsigned dim, const std::vector<int>* face_order, const std::vector<int>* coface_order)
 {
-    //create the matrix
-    MapMatrix_Perm* mat = new MapMatrix_Perm(num_faces, num_cofaces);
-
-    //loop through all simplices, writing columns to the matrix
-    int dim_index = 0; //tracks our position in the list of (hom_dim+1)-simplices
-    for (SimplexSet::iterator it = ordered_high_simplices.begin(); it != ordered_high_simplices.end(); ++it) {
-        int order_index = coface_order[dim_index]; //index of the matrix column which will store the boundary of this simplex
-        if (order_index != -1) {
-            //get vertex list for this simplex
-            std::vector<int> verts = find_vertices((*it)->global_index());
-
-            //find all facets of this simplex
-            for (unsigned k = 0; k < verts.size(); k++) ///TODO: optimize! make this faster!
-            {
-                //facet vertices are all vertices in verts[] except verts[k]
-                std::vector<int> facet;
-                for (unsigned l = 0; l < verts.size(); l++)
-                    if (l != k)
-                        facet.push_back(verts[l]);
-
-                //look up order index of the facet
+    //select sets of simplices
+    SimplexSet* cofaces = &simplices_of_dim(dim, "get_implicit_boundary_mx(): Attempting to compute boundary matrix");
+    SimplexSet* faces = &simplices_of_dim((int)dim - 1, "get_implicit_boundary_mx(): Attempting to compute boundary matrix");
+
+    //count the rows and columns
+    unsigned num_faces = faces->size();
+    if (face_order != NULL)
+        num_faces -= std::count(face_order->begin(), face_order->end(), -1);
+    unsigned num_cofaces = cofaces->size();
+    if (coface_order != NULL)
+        num_cofaces -= std::count(coface_order->begin(), coface_order->end(), -1);
+
+    //the vertex labels in the input need not be 0 through n-1, so the simplices are numbered by the ranks of their vertices
+    std::vector<STNode*>& vertex_nodes = root->get_children(); //sorted by vertex index
+    unsigned num_vertices = vertex_nodes.size();
+    std::vector<int> labels(num_vertices);
+    for (unsigned v = 0; v < num_vertices; v++)
+        labels[v] = vertex_nodes[v]->get_vertex();
+    std::vector<int> vertices, ranks;
+    auto to_ranks = [&](const std::vector<int>& verts) -> const std::vector<int>& {
+        ranks.resize(verts.size());
+        for (unsigned k = 0; k < verts.size(); k++)
+            ranks[k] = std::lower_bound(labels.begin(), labels.end(), verts[k]) - labels.begin();
+        return ranks;
+    };
+
+    if (!ImplicitBoundaryMatrix::can_number(num_vertices, dim)) {
+        //write the columns to a matrix, looking up the facets of each simplex in the tree
+        MapMatrix_Perm mat(num_faces, num_cofaces);
+        visit_simplices(root, vertices, dim, [&](STNode* simplex, const std::vector<int>& verts) {
+            int col = (coface_order == NULL) ? simplex->dim_index() : (*coface_order)[simplex->dim_index()];
+            if (col == -1 || dim == 0)
+                return;
+            for (unsigned k = 0; k < verts.size(); k++) {
+                std::vector<int> facet(verts);
+                facet.erase(facet.begin() + k);
                 STNode* facet_node = find_simplex(facet);
                 if (facet_node == NULL)
-                    throw std::runtime_error("SimplexTree::get_boundary_mx(): Facet simplex not found.");
-                int facet_order_index = face_order[facet_node->dim_index()];
-
-                //for this boundary simplex, enter "1" in the appropriate cell in the matrix
-                mat->set(facet_order_index, order_index);
+                    throw std::runtime_error("SimplexTree::get_implicit_boundary_mx(): Facet simplex not found.");
+                int row = (face_order == NULL) ? facet_node->dim_index() : (*face_order)[facet_node->dim_index()];
+                mat.set(row, col);
             }
-        }
-        dim_index++; //increment the column counter
+        });
+        return new ImplicitBoundaryMatrix(new MapMatrix_Compact(mat));
     }
 
-    //return the matrix
-    return mat;
-} //end get_boundary_mx(int, vector<int>, vector<int>)
+    //record the index of each simplex in the combinatorial number system
+    ImplicitBoundaryMatrix* bdry = new ImplicitBoundaryMatrix(num_vertices, dim, num_faces, num_cofaces); //DELETE this object later!
+    visit_simplices(root, vertices, dim, [&](STNode* simplex, const std::vector<int>& verts) {
+        int col = (coface_order == NULL) ? simplex->dim_index() : (*coface_order)[simplex->dim_index()];
+        if (col != -1)
+            bdry->set_column(col, to_ranks(verts));
+    });
+    if (dim > 0) {
+        visit_simplices(root, vertices, dim - 1, [&](STNode* simplex, const std::vector<int>& verts) {
+            int row = (face_order == NULL) ? simplex->dim_index() : (*face_order)[simplex->dim_index()];
+            if (row != -1)
+                bdry->set_row(row, to_ranks(verts));
+        });
+    }
+    bdry->finalize();
+    return bdry;
+} //end get_implicit_boundary_mx()
 
-//writes boundary information for simplex represented by sim in column col of matrix mat; offset allows for block matrices such as B+C
-void SimplexTree::write_boundary_column(MapMatrix* mat, STNode* sim, int col, int offset)
+//calls visit for each simplex of dimension dim in the subtree below node, with its vertices; vertices must contain the vertices of node on entry
+void SimplexTree::visit_simplices(STNode* node, std::vector<int>& vertices, unsigned dim, const std::function<void(STNode*, const std::vector<int>&)>& visit)
 {
-    //get vertex list for this simplex
-    std::vector<int> verts = find_vertices(sim->global_index());
-
-    //for a 0-simplex, there is nothing to do
-    if (verts.size() == 1)
-        return;
-
-    //find all facets of this simplex
-    for (unsigned k = 0; k < verts.size(); k++) {
-        //facet vertices are all vertices in verts[] except verts[k]
-        std::vector<int> facet;
-        for (unsigned l = 0; l < verts.size(); l++)
-            if (l != k)
-                facet.push_back(verts[l]);
-
-        //look up dimension index of the facet
-        STNode* facet_node = find_simplex(facet);
-        if (facet_node == NULL) {
-            std::stringstream ss;
-            for(unsigned i = 0; i < facet.size(); i++) {
-                if(i != 0)
-                    ss << ",";
-                ss << facet[i];
-            }
-
-            throw std::runtime_error("SimplexTree::write_boundary_column(): Facet simplex not found: " + ss.str());
-        }
-        int facet_di = facet_node->dim_index();
-
-        //for this boundary simplex, enter "1" in the appropriate cell in the matrix
-        mat->set(facet_di + offset, col);
+    std::vector<STNode*>& kids = node->get_children();
+    for (unsigned i = 0; i < kids.size(); i++) {
+        vertices.push_back(kids[i]->get_vertex());
+        if (vertices.size() == dim + 1)
+            visit(kids[i], vertices);
+        else
+            visit_simplices(kids[i], vertices, dim, visit);
+        vertices.pop_back();
     }
-} //end write_col();
+} //end visit_simplices()
 
 //returns a matrix of column indexes to accompany MapMatrices
 //  entry (i,j) gives the last column of the MapMatrix that corresponds to multigrade (i,j)
 IndexMatrix* SimplexTree::get_index_mx(unsigned dim)
 {
     //select set of simplices of dimension dim
-    SimplexSet* simplices;
-
-    if (dim == hom_dim)
-        simplices = &ordered_simplices;
-    else if (dim == hom_dim + 1)
-        simplices = &ordered_high_simplices;
-    else
-        throw std::runtime_error("SimplexTree::get_index_mx(): Attempting to compute index matrix for improper dimension.");
+    SimplexSet* simplices = &simplices_of_dim(dim, "get_index_mx(): Attempting to compute index matrix");
 
     //create the IndexMatrix
     unsigned x_size = x_grades;
@@ -509,21 +462,21 @@ void SimplexTree::find_vertices_recursively(std::vector<int>& vertices, STNode*
     find_vertices_recursively(vertices, kids[max], key);
 }
 
-//given a sorted vector of vertex indexes (labels), return a pointer to the node representing the corresponding simplex
+//given a sorted vector of vertex indexes (labels), return a pointer to the node representing the corresponding simplex, or NULL if there is no such simplex
 STNode* SimplexTree::find_simplex(std::vector<int>& vertices)
 {
     size_t size = vertices.size();
     if (size == 0)
         return root; //root is associated with the null simpex
 
-    //search the vector of children nodes for each vertex
+    //search the vector of children nodes (which are sorted by vertex index) for each vertex
     STNode* node = root;
     for (unsigned i = 0; i < size && nullptr != node; i++) {
         std::vector<STNode*>& kids = node->get_children();
         int key = vertices[i];
-        node = *(std::find_if(kids.begin(),
-            kids.end(),
-            [key](STNode* kid) { return kid->get_vertex() == key; }));
+        auto it = std::lower_bound(kids.begin(), kids.end(), key,
+            [](STNode* kid, int v) { return kid->get_vertex() < v; });
+        node = (it != kids.end() && (*it)->get_vertex() == key) ? *it : nullptr;
     }
 
     //return global index
@@ -542,17 +495,21 @@ unsigned SimplexTree::num_y_grades()
     return y_grades;
 }
 
-//returns the number of simplices of dimension (hom_dim-1), hom_dim, or (hom_dim+1)
+//returns the number of simplices of dimension dim, which is at most (hom_dim+1)
 unsigned SimplexTree::get_size(unsigned dim)
 {
-    if (dim == hom_dim - 1)
-        return ordered_low_simplices.size();
-    else if (dim == hom_dim)
-        return ordered_simplices.size();
-    else if (dim == hom_dim + 1)
-        return ordered_high_simplices.size();
-    else
-        throw std::runtime_error("SimplexTree::get_size(): invalid dimension");
+    return simplices_of_dim(dim, "get_size(): Attempting to count simplices").size();
+}
+
+//returns the ordered simplices of dimension dim, which is at least -1 and at most (hom_dim + 1)
+//  caller describes the request, for the error message if the dimension is out of range
+SimplexSet& SimplexTree::simplices_of_dim(int dim, const char* caller)
+{
+    if (dim == -1)
+        return no_simplices;
+    if (dim < -1 || dim > (int)hom_dim + 1)
+        throw std::runtime_error(std::string("SimplexTree::") + caller + " for improper dimension.");
+    return ordered_simplices[dim];
 }
 
 //returns the total number of simplices represented in the simplex tree
@@ -572,6 +529,48 @@ int SimplexTree::get_num_simplices()
     return node->global_index() + 1;
 }
 
+//returns the number of simplices of each dimension represented in the simplex tree
+std::vector<uint64_t> SimplexTree::count_simplices()
+{
+    std::vector<uint64_t> counts;
+    count_simplices_recursively(root, 0, counts);
+    return counts;
+}
+
+//returns a hash of the vertices and multigrades of the simplices of dimension dim, which determine the boundary matrices of that dimension
+//  the simplices are visited in lexicographic order of their vertices, and their fields are combined by the 64-bit FNV-1a hash
+uint64_t SimplexTree::hash_simplices(unsigned dim)
+{
+    uint64_t hash = 14695981039346656037ull;
+    auto combine = [&hash](int value) {
+        for (unsigned k = 0; k < sizeof(value); k++) {
+            hash ^= ((unsigned)value >> (8 * k)) & 0xff;
+            hash *= 1099511628211ull;
+        }
+    };
+    std::vector<int> vertices;
+    visit_simplices(root, vertices, dim, [&](STNode* simplex, const std::vector<int>& verts) {
+        for (int v : verts)
+            combine(v);
+        combine(simplex->grade_x());
+        combine(simplex->grade_y());
+    });
+    return hash;
+}
+
+//recursively count simplices of each dimension
+void SimplexTree::count_simplices_recursively(STNode* node, unsigned cur_dim, std::vector<uint64_t>& counts)
+{
+    std::vector<STNode*>& kids = node->get_children();
+    if (kids.empty())
+        return;
+    if (counts.size() <= cur_dim)
+        counts.resize(cur_dim + 1, 0);
+    counts[cur_dim] += kids.size();
+    for (unsigned i = 0; i < kids.size(); i++)
+        count_simplices_recursively(kids[i], cur_dim + 1, counts);
+}
+
 // TESTING -- RECURSIVELY PRINT TREE
 void SimplexTree::print()
 {
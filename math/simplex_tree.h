@@ -33,12 +33,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define __SimplexTree_H__
 
 //forward declarations
+class ImplicitBoundaryMatrix;
 class IndexMatrix;
 class MapMatrix;
-class MapMatrix_Perm;
 
 #include "st_node.h"
 
+#include <cstdint>
+#include <functional>
 #include <set>
 #include <string>
 #include <vector>
@@ -84,17 +86,15 @@ public:
     //updates the global indexes of all simplices in this simplex tree
     void update_global_indexes(); 
 
-    //updates the dimension indexes (reverse-lexicographical multi-grade order) for simplices of dimension (hom_dim-1), hom_dim, and (hom_dim+1)
+    //updates the dimension indexes (reverse-lexicographical multi-grade order) for simplices of each dimension up to (hom_dim+1)
     void update_dim_indexes(); 
 
-    //returns a matrix of boundary information for simplices
+    //returns a matrix of boundary information for simplices of dimension at most hom_dim+1
     MapMatrix* get_boundary_mx(unsigned dim); 
 
-    //returns a boundary matrix for hom_dim-simplices with columns in a specified order -- for vineyard-update algorithm
-    MapMatrix_Perm* get_boundary_mx(std::vector<int>& coface_order, unsigned num_simplices); 
-
-    //returns a boundary matrix for (hom_dim+1)-simplices with columns and rows a specified orders -- for vineyard-update algorithm
-    MapMatrix_Perm* get_boundary_mx(std::vector<int>& face_order, unsigned num_faces, std::vector<int>& coface_order, unsigned num_cofaces); 
+    //returns a boundary matrix for simplices of dimension at most hom_dim+1 that generates its columns on demand, with columns and rows in specified orders
+    //  face_order and coface_order are maps : dim_index --> order_index, or NULL to order the simplices by dim_index
+    ImplicitBoundaryMatrix* get_implicit_boundary_mx(unsigned dim, const std::vector<int>* face_order, const std::vector<int>* coface_order);
 
     //returns a matrix of column indexes to accompany MapMatrices
     IndexMatrix* get_index_mx(unsigned dim); 
@@ -108,12 +108,14 @@ public:
     unsigned num_x_grades(); //returns the number of unique x-coordinates of the multi-grades
     unsigned num_y_grades(); //returns the number of unique y-coordinates of the multi-grades
 
-    unsigned get_size(unsigned dim); //returns the number of simplices of dimension (hom_dim-1), hom_dim, or (hom_dim+1)
+    unsigned get_size(unsigned dim); //returns the number of simplices of dimension dim, which is at most (hom_dim+1)
 
     int get_num_simplices(); //returns the total number of simplices represented in the simplex tree
+    std::vector<uint64_t> count_simplices(); //returns the number of simplices of each dimension represented in the simplex tree
+    uint64_t hash_simplices(unsigned dim); //returns a hash of the vertices and multigrades of the simplices of dimension dim, which is at most (hom_dim+1)
     //TODO: would it be more efficient to store the total number of simplices???
 
-    const unsigned hom_dim; //the dimension of homology to be computed; max dimension of simplices is one more than this
+    const unsigned hom_dim; //the largest dimension of homology to be computed; max dimension of simplices is one more than this
     const unsigned verbosity; //controls display of output, for debugging
 
     //TESTING
@@ -130,9 +132,10 @@ private:
     unsigned x_grades; //the number of x-grades that exist in this bifiltration
     unsigned y_grades; //the number of y-grades that exist in this bifiltration
 
-    SimplexSet ordered_high_simplices; //pointers to simplices of dimension (hom_dim + 1) in reverse-lexicographical multi-grade order
-    SimplexSet ordered_simplices; //pointers to simplices of dimension hom_dim in reverse-lexicographical multi-grade order
-    SimplexSet ordered_low_simplices; //pointers to simplices of dimension (hom_dim - 1) in reverse-lexicographical multi-grade order
+    std::vector<SimplexSet> ordered_simplices; //ordered_simplices[d] has pointers to simplices of dimension d in reverse-lexicographical multi-grade order, for d <= hom_dim + 1
+    SimplexSet no_simplices; //empty set, standing in for the simplices of dimension -1
+
+    SimplexSet& simplices_of_dim(int dim, const char* caller); //returns the ordered simplices of dimension dim, which is at least -1 and at most (hom_dim + 1)
 
     void build_VR_subtree(std::vector<unsigned>& times, std::vector<unsigned>& distances, STNode& parent, std::vector<unsigned>& parent_indexes, unsigned prev_time, unsigned prev_dist, unsigned cur_dim, unsigned& gic); //recursive function used in build_VR_complex()
 
@@ -142,13 +145,16 @@ private:
 
     void update_gi_recursively(STNode* node, int& gic); //recursively update global indexes of simplices
 
+    void count_simplices_recursively(STNode* node, unsigned cur_dim, std::vector<uint64_t>& counts); //recursively count simplices of each dimension
+
     void build_dim_lists_recursively(STNode* node, unsigned cur_dim); //recursively build lists to determine dimension indexes
 
     //    void find_nodes(STNode& node, int level, std::vector<int>& vec, unsigned time, unsigned dist, unsigned dim); //recursively search tree for simplices of specified dimension that exist at specified multi-index
 
     void find_vertices_recursively(std::vector<int>& vertices, STNode* node, int key); //recursively search for a global index and keep track of vertices
 
-    void write_boundary_column(MapMatrix* mat, STNode* sim, int col, int offset); //writes boundary information for simplex represented by sim in column col of matrix mat; offset allows for block matrices such as B+C
+    //calls visit for each simplex of dimension dim in the subtree below node, with its vertices; vertices must contain the vertices of node on entry
+    void visit_simplices(STNode* node, std::vector<int>& vertices, unsigned dim, const std::function<void(STNode*, const std::vector<int>&)>& visit);
 };
 
 #endif // __SimplexTree_H__
@@ -27,6 +27,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "debug.h"
 
 #include <cstddef> //for NULL
+#include <unordered_map>
 
 /********** xiMatrixEntry **********/
 
@@ -77,16 +78,16 @@ TemplatePointsMatrixEntry::TemplatePointsMatrixEntry(unsigned x, unsigned y)
 void TemplatePointsMatrixEntry::add_multigrade(unsigned x, unsigned y, unsigned num_cols, int index, bool low)
 {
     if (low) {
-        low_simplices.push_back(std::make_shared<Multigrade>(x, y, num_cols, index));
+        low_simplices.push_back(Multigrade(x, y, num_cols, index));
         low_count += num_cols;
     } else {
-        high_simplices.push_back(std::make_shared<Multigrade>(x, y, num_cols, index));
+        high_simplices.push_back(Multigrade(x, y, num_cols, index));
         high_count += num_cols;
     }
 }
 
-//inserts a Multigrade at the beginning of the list for the given dimension
-void TemplatePointsMatrixEntry::insert_multigrade(std::shared_ptr<Multigrade> mg, bool low)
+//inserts a Multigrade at the end of the list for the given dimension
+void TemplatePointsMatrixEntry::insert_multigrade(const Multigrade& mg, bool low)
 {
     if (low)
         low_simplices.push_back(mg);
@@ -128,6 +129,45 @@ TemplatePointsMatrix::TemplatePointsMatrix(unsigned width, unsigned height)
 {
 }
 
+//deep copy: copies every entry, along with its lists of multigrades, so that the copy can be modified independently of other
+//  (e.g. by a thread that computes barcode templates for part of the path)
+TemplatePointsMatrix::TemplatePointsMatrix(const TemplatePointsMatrix& other)
+    : columns(other.columns.size())
+    , rows(other.rows.size())
+{
+    std::unordered_map<const TemplatePointsMatrixEntry*, std::shared_ptr<TemplatePointsMatrixEntry>> copies;
+
+    //copy the entries, which are linked within each column by their down pointers
+    for (unsigned i = 0; i < other.columns.size(); i++) {
+        for (std::shared_ptr<TemplatePointsMatrixEntry> cur = other.columns[i]; cur != NULL; cur = cur->down) {
+            std::shared_ptr<TemplatePointsMatrixEntry> copy(new TemplatePointsMatrixEntry(cur->x, cur->y, cur->index, NULL, NULL));
+            copy->low_simplices = cur->low_simplices;
+            copy->high_simplices = cur->high_simplices;
+            copy->low_count = cur->low_count;
+            copy->high_count = cur->high_count;
+            copy->low_index = cur->low_index;
+            copy->high_index = cur->high_index;
+            copies[cur.get()] = copy;
+        }
+    }
+
+    //link the copies
+    for (auto it = copies.begin(); it != copies.end(); ++it) {
+        if (it->first->down != NULL)
+            it->second->down = copies[it->first->down.get()];
+        if (it->first->left != NULL)
+            it->second->left = copies[it->first->left.get()];
+    }
+    for (unsigned i = 0; i < columns.size(); i++) {
+        if (other.columns[i] != NULL)
+            columns[i] = copies[other.columns[i].get()];
+    }
+    for (unsigned j = 0; j < rows.size(); j++) {
+        if (other.rows[j] != NULL)
+            rows[j] = copies[other.rows[j].get()];
+    }
+} //end copy constructor
+
 //stores the supplied xi support points in the TemplatePointsMatrix
 //  also finds anchors, which are stored in the matrix and in the vector xi_pts
 //  precondition: xi_pts contains the support points in lexicographical order
@@ -192,6 +232,12 @@ std::shared_ptr<TemplatePointsMatrixEntry> TemplatePointsMatrix::get_col(unsigne
     return columns[c];
 }
 
+//returns the number of columns
+unsigned TemplatePointsMatrix::width()
+{
+    return columns.size();
+}
+
 //retuns the number of rows
 unsigned TemplatePointsMatrix::height()
 {
@@ -23,14 +23,27 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 //forward declarations
 class MultiBetti;
-struct Multigrade;
 class TemplatePoint;
 class Arrangement;
 
-#include <list>
 #include <memory>
 #include <vector>
 
+//// each TemplatePointsMatrixEntry maintains two lists of multigrades, stored by value in contiguous arrays
+struct Multigrade {
+    unsigned x; //x-coordinate of this multigrade
+    unsigned y; //y-coordinate of this multigrade
+
+    unsigned num_cols; //number of columns (i.e. simplices) at this multigrade
+    int simplex_index; //last dim_index of the simplices at this multigrade; necessary so that we can build the boundary matrix, and also used for non-vineyard updates to the RU-decomposition
+
+    Multigrade(unsigned x, unsigned y, unsigned num_cols, int simplex_index); //constructor
+
+    Multigrade(); // For serialization
+
+    static bool LexComparator(const Multigrade& first, const Multigrade& second); //comparator for sorting Multigrades lexicographically
+};
+
 //// these are the nodes in the sparse matrix
 struct TemplatePointsMatrixEntry {
     //data structures
@@ -41,8 +54,8 @@ struct TemplatePointsMatrixEntry {
     std::shared_ptr<TemplatePointsMatrixEntry> down; //pointer to the next support point below this one
     std::shared_ptr<TemplatePointsMatrixEntry> left; //pointer to the next support point left of this one
 
-    std::list<std::shared_ptr<Multigrade>> low_simplices; //associated multigrades for simplices of lower dimension
-    std::list<std::shared_ptr<Multigrade>> high_simplices; //associated multigrades for simplices of higher dimension
+    std::vector<Multigrade> low_simplices; //associated multigrades for simplices of lower dimension
+    std::vector<Multigrade> high_simplices; //associated multigrades for simplices of higher dimension
 
     unsigned low_count; //number of columns in matrix of simplices of lower dimension that are mapped to this TemplatePointsMatrixEntry
     unsigned high_count; //number of columns in matrix of simplices of higher dimension that are mapped to this TemplatePointsMatrixEntry
@@ -58,22 +71,7 @@ struct TemplatePointsMatrixEntry {
     void add_multigrade(unsigned x, unsigned y, unsigned num_cols, int index, bool low); //associates a (new) multigrades to this xi entry
     //the "low" argument is true if this multigrade is for low_simplices, and false if it is for high_simplices
 
-    void insert_multigrade(std::shared_ptr<Multigrade> mg, bool low); //inserts a Multigrade at the end of the list for the given dimension; does not update column counts!
-};
-
-//// each TemplatePointsMatrixEntry maintains two lists of multigrades
-struct Multigrade {
-    unsigned x; //x-coordinate of this multigrade
-    unsigned y; //y-coordinate of this multigrade
-
-    unsigned num_cols; //number of columns (i.e. simplices) at this multigrade
-    int simplex_index; //last dim_index of the simplices at this multigrade; necessary so that we can build the boundary matrix, and also used for non-vineyard updates to the RU-decomposition
-
-    Multigrade(unsigned x, unsigned y, unsigned num_cols, int simplex_index); //constructor
-
-    Multigrade(); // For serialization
-
-    static bool LexComparator(const Multigrade& first, const Multigrade& second); //comparator for sorting Multigrades lexicographically
+    void insert_multigrade(const Multigrade& mg, bool low); //inserts a Multigrade at the end of the list for the given dimension; does not update column counts!
 };
 
 //// sparse matrix to store the set U of support points of the multi-graded Betti numbers
@@ -82,6 +80,9 @@ class TemplatePointsMatrix {
 public:
     TemplatePointsMatrix(unsigned width, unsigned height); //constructor
 
+    TemplatePointsMatrix(const TemplatePointsMatrix& other); //deep copy: copies every entry, along with its lists of multigrades
+    TemplatePointsMatrix& operator=(const TemplatePointsMatrix& other) = delete;
+
     std::vector<std::shared_ptr<TemplatePointsMatrixEntry>> fill_and_find_anchors(std::vector<TemplatePoint>& xi_pts); //stores xi support points in the xiSupportMatrix
     //also finds anchors, which are stored both in the matrix and in the vector xi_pts
     //precondition: xi_pts contains the support points in lexicographical order
@@ -89,6 +90,7 @@ public:
     std::shared_ptr<TemplatePointsMatrixEntry> get_row(unsigned r); //gets a pointer to the rightmost entry in row r; returns NULL if row r is empty
     std::shared_ptr<TemplatePointsMatrixEntry> get_col(unsigned c); //gets a pointer to the top entry in column c; returns NULL if column c is empty
 
+    unsigned width(); //returns the number of columns
     unsigned height(); //retuns the number of rows;
 
     void clear_grade_lists(); //clears the level set lists for all entries in the matrix
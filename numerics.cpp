@@ -91,6 +91,41 @@ namespace numeric {
         return r;
     }
 
+    //converts the characters from begin to end to an exact, without copying them if they represent a decimal number
+    //  with at most 18 digits (which fits in a 64-bit integer); accepts the same strings as str_to_exact(const std::string&)
+    exact str_to_exact(const char* begin, const char* end)
+    {
+        const char* c = begin;
+        bool neg = (c != end && *c == '-');
+        if (neg)
+            ++c;
+
+        long long num = 0;
+        unsigned digits = 0;
+        int exp = -1; //number of digits after the decimal point, or -1 if there is no decimal point
+        for (; c != end; ++c) {
+            if (*c >= '0' && *c <= '9') {
+                num = 10 * num + (*c - '0');
+                digits++;
+                if (exp >= 0)
+                    exp++;
+            } else if (*c == '.' && exp < 0) {
+                exp = 0;
+            } else {
+                break;
+            }
+        }
+        if (c != end || digits == 0 || digits > 18)
+            return str_to_exact(std::string(begin, end));
+
+        if (neg)
+            num = -num;
+        long long denom = 1;
+        for (int k = 0; k < exp; k++)
+            denom *= 10;
+        return exact(num, denom);
+    }
+
     //computes the projection of the lower-left corner of the line-selection window onto the specified line
     double project_zero(double angle, double offset, double x_0, double y_0)
     {
@@ -36,6 +36,7 @@ typedef boost::multi_array<unsigned, 2> unsigned_matrix;
 namespace rivet {
 namespace numeric {
     exact str_to_exact(const std::string& str);
+    exact str_to_exact(const char* begin, const char* end);
     bool is_number(const std::string& str);
     std::vector<double> to_doubles(const std::vector<exact> exacts);
     double project_zero(double angle, double offset, double x_0, double y_0);
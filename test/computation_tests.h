@@ -0,0 +1,266 @@
+#ifndef RIVET_CONSOLE_COMPUTATION_TESTS_H
+#define RIVET_CONSOLE_COMPUTATION_TESTS_H
+
+#include "catch.hpp"
+#include "computation.h"
+#include "dcel/arrangement.h"
+#include "interface/checkpoint.h"
+#include "interface/input_manager.h"
+#include "interface/progress.h"
+#include "math/memory_estimate.h"
+#include "math/simplex_tree.h"
+#include "math/template_point.h"
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+//a random Vietoris-Rips bifiltration on n points, whose birth times and distances take num_grades values, with about 70% of the edges
+struct RandomVRInput {
+    std::vector<unsigned> times;
+    std::vector<unsigned> distances;
+    unsigned num_grades;
+
+    RandomVRInput(unsigned n, unsigned num_grades, unsigned seed)
+        : times(n)
+        , distances(n * (n - 1) / 2)
+        , num_grades(num_grades)
+    {
+        std::mt19937 gen(seed);
+        std::uniform_int_distribution<unsigned> grade_dist(0, num_grades - 1);
+        for (unsigned& t : times)
+            t = grade_dist(gen);
+        for (unsigned& d : distances)
+            d = (gen() % 100 < 70) ? grade_dist(gen) : std::numeric_limits<unsigned>::max();
+    }
+
+    //instead, the points lie at random in the unit square and are born in the order of their indexes, and the edges join the points
+    //  closer than max_dist, with distances binned into num_grades values
+    static RandomVRInput points_in_square(unsigned n, unsigned num_grades, double max_dist, unsigned seed)
+    {
+        RandomVRInput vr(n, num_grades, seed);
+        std::mt19937 gen(seed);
+        std::uniform_real_distribution<double> coord_dist(0, 1);
+        std::vector<std::pair<double, double>> points(n);
+        for (unsigned i = 0; i < n; i++) {
+            points[i] = std::make_pair(coord_dist(gen), coord_dist(gen));
+            vr.times[i] = i * num_grades / n;
+        }
+        for (unsigned j = 1; j < n; j++) {
+            for (unsigned i = 0; i < j; i++) {
+                double d = std::hypot(points[i].first - points[j].first, points[i].second - points[j].second);
+                vr.distances[j * (j - 1) / 2 + i] = (d < max_dist) ? (unsigned)(d / max_dist * num_grades) : std::numeric_limits<unsigned>::max();
+            }
+        }
+        return vr;
+    }
+
+    //builds the bifiltration for homology of dimension at most dim; if reversed, then the birth times are given to the points in reverse order
+    InputData build(int dim, bool reversed = false) const
+    {
+        std::vector<unsigned> vertex_times(times), edge_distances(distances);
+        if (reversed)
+            vertex_times.assign(times.rbegin(), times.rend());
+        InputData data;
+        for (unsigned g = 0; g < num_grades; g++) {
+            data.x_exact.push_back(g);
+            data.y_exact.push_back(g);
+        }
+        data.simplex_tree.reset(new SimplexTree(dim, 0));
+        data.simplex_tree->build_VR_complex(vertex_times, edge_distances, num_grades, num_grades);
+        return data;
+    }
+};
+
+//parameters for computing homology of dimension dim without bins or console output
+InputParameters computation_params(int dim)
+{
+    InputParameters params;
+    params.dim = dim;
+    params.x_bins = params.y_bins = 0;
+    params.verbosity = 0;
+    return params;
+}
+
+//counts the faces whose barcode templates differ between two arrangements, which must have the same number of faces
+unsigned count_template_mismatches(Arrangement& a, Arrangement& b)
+{
+    REQUIRE(a.num_faces() == b.num_faces());
+    unsigned mismatches = 0;
+    for (unsigned i = 0; i < a.num_faces(); i++)
+        mismatches += !(a.get_barcode_template(i) == b.get_barcode_template(i));
+    return mismatches;
+}
+
+TEST_CASE("Computations for several dimensions of homology share one simplex tree", "[Computation]")
+{
+    //a bifiltration on 10 points, built once for dimensions up to 1 and once for each dimension alone
+    RandomVRInput vr(10, 4, 11);
+    InputData shared = vr.build(1);
+
+    //the dimensions are computed at the same time from the shared tree
+    std::vector<InputParameters> dim_params = { computation_params(0), computation_params(1) };
+    std::vector<std::unique_ptr<ComputationResult>> results(2);
+    std::vector<std::thread> threads;
+    for (int dim : { 0, 1 }) {
+        threads.emplace_back([&, dim]() {
+            Progress progress;
+            results[dim] = Computation(dim_params[dim], progress).compute(shared);
+        });
+    }
+    for (std::thread& t : threads)
+        t.join();
+
+    for (int dim : { 0, 1 }) {
+        Progress progress;
+        std::unique_ptr<ComputationResult> alone = Computation(dim_params[dim], progress).compute(vr.build(dim));
+        bool same_points = (results[dim]->template_points == alone->template_points);
+        bool same_dims = (results[dim]->homology_dimensions == alone->homology_dimensions);
+        REQUIRE((same_points && same_dims));
+        REQUIRE(count_template_mismatches(*results[dim]->arrangement, *alone->arrangement) == 0);
+    }
+}
+
+TEST_CASE("Computations resume from the checkpoints of their finished stages", "[Computation]")
+{
+    RandomVRInput vr(10, 4, 13);
+    InputData input = vr.build(1);
+
+    InputParameters params = computation_params(1);
+    params.resume = true;
+    params.outputFile = "checkpoint_test.rivet";
+    const std::string arrangement_checkpoint = params.outputFile + ".arrangement.checkpoint";
+    Checkpoint::remove(params.outputFile);
+
+    Progress progress;
+    std::unique_ptr<ComputationResult> first = Computation(params, progress).compute(input);
+    REQUIRE(std::ifstream(params.outputFile + ".betti.checkpoint").good());
+    REQUIRE(std::ifstream(arrangement_checkpoint).good());
+
+    //resume from both checkpoints, then from the Betti numbers alone
+    for (bool keep_arrangement : { true, false }) {
+        if (!keep_arrangement)
+            std::remove(arrangement_checkpoint.c_str());
+        std::unique_ptr<ComputationResult> resumed = Computation(params, progress).compute(input);
+        bool same_points = (resumed->template_points == first->template_points);
+        bool same_dims = (resumed->homology_dimensions == first->homology_dimensions);
+        REQUIRE((same_points && same_dims));
+        REQUIRE(count_template_mismatches(*resumed->arrangement, *first->arrangement) == 0);
+    }
+
+    //a bifiltration with the same numbers of simplices and the same grades, but on relabeled vertices, does not match the checkpoints
+    InputData edited = vr.build(1, true);
+    REQUIRE(edited.simplex_tree->count_simplices() == input.simplex_tree->count_simplices());
+    unsigned_matrix dims;
+    std::vector<TemplatePoint> points;
+    REQUIRE(Checkpoint(params.outputFile, 1, *input.simplex_tree, input.x_exact, input.y_exact, 0, 0).load_betti(dims, points));
+    REQUIRE(!Checkpoint(params.outputFile, 1, *edited.simplex_tree, edited.x_exact, edited.y_exact, 0, 0).load_betti(dims, points));
+
+    Checkpoint::remove(params.outputFile);
+    REQUIRE(!std::ifstream(arrangement_checkpoint).good());
+}
+
+TEST_CASE("Computations continue along the path from the last checkpoint", "[Computation]")
+{
+    RandomVRInput vr(12, 5, 17);
+    InputData input = vr.build(1);
+
+    InputParameters params = computation_params(1);
+    params.outputFile = "path_checkpoint_test.rivet";
+    Checkpoint::remove(params.outputFile);
+
+    Progress progress;
+    std::unique_ptr<ComputationResult> expected = Computation(params, progress).compute(input);
+
+    //stop halfway along the path, after saving the state at every step
+    params.resume = true;
+    params.checkpoint_interval = 0;
+    Progress stopping;
+    unsigned path_length = 0;
+    stopping.setProgressMaximum.connect([&](unsigned max) { path_length = max; });
+    stopping.progress.connect([&](unsigned step) {
+        if (path_length >= 2 && step == path_length / 2)
+            throw std::runtime_error("stopped");
+    });
+    REQUIRE_THROWS(Computation(params, stopping).compute(input));
+    REQUIRE(path_length >= 2);
+    REQUIRE(std::ifstream(params.outputFile + ".path.checkpoint").good());
+
+    //continue, and check that the cells reached before and after the stop have the right templates
+    std::unique_ptr<ComputationResult> resumed = Computation(params, progress).compute(input);
+    REQUIRE(count_template_mismatches(*resumed->arrangement, *expected->arrangement) == 0);
+    Checkpoint::remove(params.outputFile);
+}
+
+TEST_CASE("Computations in parallel segments report errors thrown while the segments run", "[Computation]")
+{
+    RandomVRInput vr(12, 5, 17);
+    InputData input = vr.build(1);
+
+    //an exception from the progress handler, called while later segments are still being traversed, reaches the caller
+    InputParameters params = computation_params(1);
+    params.num_segments = 4;
+    Progress stopping;
+    unsigned path_length = 0;
+    stopping.setProgressMaximum.connect([&](unsigned max) { path_length = max; });
+    stopping.progress.connect([&](unsigned step) {
+        if (path_length >= 2 && step >= path_length / 4)
+            throw std::runtime_error("stopped");
+    });
+    REQUIRE_THROWS_WITH(Computation(params, stopping).compute(input), "stopped");
+    REQUIRE(path_length >= 2);
+}
+
+TEST_CASE("MemoryEstimate projects the size of the arrangement within a small factor of an actual run", "[Computation]")
+{
+    //the projected numbers of support points and cells, which the table of distances between cells is sized from, against those of the run
+    for (int dim : { 0, 1 }) {
+        for (unsigned num_grades : { 10, 20 }) {
+            RandomVRInput vr = RandomVRInput::points_in_square(30, num_grades, 0.4, 19);
+            InputData input = vr.build(dim);
+            MemoryEstimate estimate({ (unsigned)dim }, input.simplex_tree->count_simplices(), num_grades, num_grades);
+
+            InputParameters params = computation_params(dim);
+            Progress progress;
+            std::unique_ptr<ComputationResult> result = Computation(params, progress).compute(input);
+            uint64_t support = result->template_points.size();
+            uint64_t cells = result->arrangement->num_faces();
+            REQUIRE(estimate.support_points(dim) <= 2 * support + 8);
+            REQUIRE(support <= 2 * estimate.support_points(dim) + 8);
+            REQUIRE(estimate.cells(dim) <= 4 * cells + 128);
+            REQUIRE(cells <= 4 * estimate.cells(dim) + 128);
+        }
+    }
+}
+
+TEST_CASE("MemoryEstimate projects the bytes of the arrangement within a small factor of an actual run", "[Computation]")
+{
+    //the table of distances between cells, which ArrangementBuilder allocates as a vector of cells vectors of cells unsigned values
+    //  to find the path, is the largest part of a large arrangement; the projection, which grows as the fourth power of the support points,
+    //  must neither fall far below it nor exceed it by much more than the other parts
+    for (int dim : { 0, 1 }) {
+        for (unsigned num_points : { 30, 60 }) {
+            for (unsigned num_grades : { 8, 16 }) {
+                RandomVRInput vr = RandomVRInput::points_in_square(num_points, num_grades, 0.4, 23);
+                InputData input = vr.build(dim);
+                MemoryEstimate estimate({ (unsigned)dim }, input.simplex_tree->count_simplices(), num_grades, num_grades);
+
+                InputParameters params = computation_params(dim);
+                Progress progress;
+                std::unique_ptr<ComputationResult> result = Computation(params, progress).compute(input);
+                uint64_t cells = result->arrangement->num_faces();
+                uint64_t table_bytes = cells * (cells * sizeof(unsigned) + sizeof(std::vector<unsigned>));
+                uint64_t projected = estimate.arrangement_bytes(dim);
+                REQUIRE(table_bytes <= 8 * projected);
+                REQUIRE(projected <= 8 * table_bytes + (2 << 20)); //the matrices and cells, which are most of small arrangements
+            }
+        }
+    }
+}
+
+#endif //RIVET_CONSOLE_COMPUTATION_TESTS_H
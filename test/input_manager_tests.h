@@ -8,11 +8,70 @@
 #endif //RIVET_CONSOLE_INPUT_MANAGER_TESTS_H
 
 #include "catch.hpp"
+#include "interface/file_input_reader.h"
 #include "interface/input_manager.h"
+#include "interface/progress.h"
+#include "math/memory_estimate.h"
+#include "math/simplex_tree.h"
 #include "numerics.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
 #include <vector>
 
+//a file for a test to write, whose name is unique to this run, and which is removed when the test ends, even if it fails
+struct TempFile {
+    std::string name;
+
+    explicit TempFile(const std::string& prefix)
+    {
+        static unsigned count = 0;
+        name = prefix + "_" + std::to_string(std::random_device()()) + "_" + std::to_string(count++) + ".txt";
+    }
+
+    ~TempFile()
+    {
+        std::remove(name.c_str());
+    }
+};
+
+//writes the lowest bytes of value in little-endian order, as the binary input formats store numbers
+void write_le(std::ostream& out, uint64_t value, unsigned bytes)
+{
+    for (unsigned k = 0; k < bytes; k++)
+        out.put((char)((value >> (8 * k)) & 0xff));
+}
+
+void write_le(std::ostream& out, double value)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    write_le(out, bits, 8);
+}
+
+void write_le(std::ostream& out, float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    write_le(out, bits, 4);
+}
+
+//parameters for reading the given file for homology of dimension dim, without bins or console output
+InputParameters input_params(const std::string& file_name, int dim)
+{
+    InputParameters params;
+    params.fileName = file_name;
+    params.dim = dim;
+    params.x_bins = params.y_bins = 0;
+    params.verbosity = 0;
+    return params;
+}
+
 TEST_CASE("DataPoint parses correctly", "[InputManager]")
 {
     std::vector<std::string> data{ "1.0", "-1.2", "1.12" };
@@ -22,3 +81,472 @@ TEST_CASE("DataPoint parses correctly", "[InputManager]")
     REQUIRE(point.coords[1] == -1.2);
     REQUIRE(point.birth == exact(112, 100));
 }
+
+TEST_CASE("FileInputReader returns the same tokens from a mapped file and from a stream", "[InputManager]")
+{
+    TempFile file("file_input_reader_test");
+    const std::string& file_name = file.name;
+    {
+        std::ofstream out(file_name, std::ios::binary);
+        out << "bifiltration\n# a comment\n\n  x label\t\r\n   # an indented comment\n0 1 -2 3.25 -0.5\r\n\t7   8.125e2\n12";
+    }
+
+    FileInputReader mapped(file_name);
+    std::ifstream stream(file_name);
+    FileInputReader streamed(stream);
+
+    std::vector<std::pair<std::vector<std::string>, unsigned>> expected = {
+        { { "bifiltration" }, 1 }, { { "x", "label" }, 4 }, { { "0", "1", "-2", "3.25", "-0.5" }, 6 }, { { "7", "8.125e2" }, 7 }, { { "12" }, 8 }
+    };
+    unsigned mismatches = 0;
+    for (auto& line : expected) {
+        REQUIRE(mapped.has_next_line());
+        REQUIRE(streamed.has_next_line());
+        unsigned mapped_line;
+        const std::vector<TokenView>& tokens = mapped.next_line_tokens(mapped_line);
+        std::vector<std::string> strings;
+        for (const TokenView& t : tokens)
+            strings.push_back(t.str());
+        mismatches += (strings != line.first) + (mapped_line != line.second) + (streamed.next_line() != line);
+    }
+    REQUIRE(mismatches == 0);
+    REQUIRE(!mapped.has_next_line());
+    REQUIRE(!streamed.has_next_line());
+    REQUIRE_THROWS(mapped.next_line());
+
+    //numbers are parsed in place as they would be from strings
+    std::string numbers = "-2 3.25 -0.5 12. 0.000 123456789012345678.9 -17";
+    std::vector<TokenView> views;
+    for (size_t i = 0, j; i < numbers.size(); i = j + 1) {
+        j = std::min(numbers.find(' ', i), numbers.size());
+        views.push_back(TokenView{ numbers.data() + i, j - i });
+    }
+    for (const TokenView& t : views)
+        mismatches += (rivet::numeric::str_to_exact(t.begin, t.end()) != rivet::numeric::str_to_exact(t.str()));
+    REQUIRE(mismatches == 0);
+    REQUIRE(parse_int(views[0]) == -2);
+    REQUIRE(parse_int(views[6]) == -17);
+    REQUIRE(parse_double(views[1]) == 3.25);
+    REQUIRE_THROWS(parse_int(views[1]));
+}
+
+TEST_CASE("InputManager numbers the simplices of a bifiltration file in order", "[InputManager]")
+{
+    TempFile file("bifiltration_test");
+    const std::string& file_name = file.name;
+    InputParameters params = input_params(file_name, 1);
+    Progress progress;
+
+    {
+        std::ofstream out(file_name);
+        out << "bifiltration\nx label\n# comment\ny label\n0 0 0\n1 1 0.5\n\n2 0.5 1\n# comment\n0 1 1 1\n0 2 1 1.5\n1 2 1 1\n0 1 2 2 2\n";
+    }
+    InputManager manager(params);
+    std::unique_ptr<InputData> data = manager.start(progress);
+    SimplexTree& st = *data->simplex_tree;
+    REQUIRE(st.get_num_simplices() == 7);
+    REQUIRE(data->x_exact == std::vector<exact>({ exact(0), exact(1, 2), exact(1), exact(2) }));
+    REQUIRE(data->y_exact == std::vector<exact>({ exact(0), exact(1, 2), exact(1), exact(3, 2), exact(2) }));
+    std::vector<int> edge = { 0, 2 };
+    REQUIRE(st.find_simplex(edge)->grade_x() == 2);
+    REQUIRE(st.find_simplex(edge)->grade_y() == 3);
+
+    //errors are reported with the line number in the file
+    {
+        std::ofstream out(file_name);
+        out << "bifiltration\nx label\ny label\n0 0 0\n\n1 0 0\n# comment\n0 1 x 1\n";
+    }
+    std::string message;
+    try {
+        manager.start(progress);
+    } catch (std::exception& e) {
+        message = e.what();
+    }
+    REQUIRE(message.substr(0, 8) == "line 8: ");
+}
+
+TEST_CASE("InputManager reads binary bifiltrations like text ones", "[InputManager]")
+{
+    TempFile file("binary_bifiltration_test");
+    const std::string& file_name = file.name;
+    InputParameters params = input_params(file_name, 1);
+    Progress progress;
+    InputManager manager(params);
+
+    std::vector<std::vector<int>> simplices = { { 0 }, { 1 }, { 2 }, { 0, 1 }, { 0, 2 }, { 1, 2 }, { 0, 1, 2 } };
+    std::vector<double> x = { 0, 1, 0.5, 1, 1, 1, 2 }, y = { 0, 0.5, 1, 1, 1.5, 1, 2 };
+    {
+        std::ofstream out(file_name);
+        out << "bifiltration\nx label\ny label\n";
+        for (size_t i = 0; i < simplices.size(); i++) {
+            for (int v : simplices[i])
+                out << v << " ";
+            out << x[i] << " " << y[i] << "\n";
+        }
+    }
+    std::unique_ptr<InputData> text = manager.start(progress);
+
+    for (uint32_t grade_format : { 0u, 1u }) {
+        {
+            std::ofstream out(file_name, std::ios::binary);
+            out << "binary_bifiltration\nx label\ny label\n";
+            write_le(out, 1, 4);
+            write_le(out, grade_format, 4);
+            std::vector<double> x_table = { 0, 0.5, 1, 2 }, y_table = { 0, 0.5, 1, 1.5, 2 };
+            if (grade_format == 0) {
+                for (std::vector<double>* table : { &x_table, &y_table }) {
+                    write_le(out, table->size(), 8);
+                    for (double g : *table) {
+                        write_le(out, (int64_t)(2 * g), 8);
+                        write_le(out, 2, 8);
+                    }
+                }
+            }
+            for (size_t i = 0; i < simplices.size(); i++) {
+                if (i == 0 || simplices[i].size() != simplices[i - 1].size()) {
+                    write_le(out, simplices[i].size(), 4);
+                    write_le(out, std::count_if(simplices.begin(), simplices.end(), [&](const std::vector<int>& s) { return s.size() == simplices[i].size(); }), 8);
+                }
+                for (int v : simplices[i])
+                    write_le(out, v, 4);
+                for (int axis = 0; axis < 2; axis++) {
+                    double g = (axis == 0) ? x[i] : y[i];
+                    std::vector<double>& table = (axis == 0) ? x_table : y_table;
+                    if (grade_format == 0)
+                        write_le(out, std::find(table.begin(), table.end(), g) - table.begin(), 4);
+                    else
+                        write_le(out, g);
+                }
+            }
+        }
+        std::unique_ptr<InputData> binary = manager.start(progress);
+        REQUIRE(binary->x_label == "x label");
+        REQUIRE(binary->x_exact == text->x_exact);
+        REQUIRE(binary->y_exact == text->y_exact);
+        REQUIRE(binary->simplex_tree->get_num_simplices() == text->simplex_tree->get_num_simplices());
+        unsigned mismatches = 0;
+        for (std::vector<int> s : simplices) {
+            STNode* a = text->simplex_tree->find_simplex(s);
+            STNode* b = binary->simplex_tree->find_simplex(s);
+            mismatches += (a->grade_x() != b->grade_x()) + (a->grade_y() != b->grade_y()) + (a->global_index() != b->global_index());
+        }
+        REQUIRE(mismatches == 0);
+    }
+}
+
+TEST_CASE("InputManager reads binary point clouds and metric spaces like text ones", "[InputManager]")
+{
+    TempFile file("binary_metric_test");
+    const std::string& file_name = file.name;
+    InputParameters params = input_params(file_name, 1);
+    Progress progress;
+    InputManager manager(params);
+
+
+    //counts the simplices on 5 vertices whose presence or grades differ between two bifiltrations
+    auto count_mismatches = [](const InputData& a, const InputData& b) {
+        unsigned mismatches = (a.x_exact != b.x_exact) + (a.y_exact != b.y_exact);
+        for (unsigned mask = 1; mask < 32; mask++) {
+            std::vector<int> s;
+            for (int v = 0; v < 5; v++)
+                if (mask & (1 << v))
+                    s.push_back(v);
+            if (s.size() > 3)
+                continue;
+            STNode* p = a.simplex_tree->find_simplex(s);
+            STNode* q = b.simplex_tree->find_simplex(s);
+            if (p == nullptr || q == nullptr)
+                mismatches += (p != q);
+            else
+                mismatches += (p->grade_x() != q->grade_x()) + (p->grade_y() != q->grade_y()) + (p->global_index() != q->global_index());
+        }
+        return mismatches;
+    };
+
+    //a point cloud of 5 points in the plane
+    std::vector<std::vector<double>> coords = { { 0, 0 }, { 1, 0 }, { 0, 1.5 }, { 2, 2 }, { 0.25, 0.5 } };
+    std::vector<double> births = { 0, 0.5, 0.5, 1.25, 2 };
+    {
+        std::ofstream out(file_name);
+        out << "points\n2\n1.75\nbirth\n";
+        for (size_t i = 0; i < coords.size(); i++)
+            out << coords[i][0] << " " << coords[i][1] << " " << births[i] << "\n";
+    }
+    std::unique_ptr<InputData> text = manager.start(progress);
+    {
+        std::ofstream out(file_name, std::ios::binary);
+        out << "binary_points\n1.75\nbirth\n";
+        write_le(out, 1, 4);
+        write_le(out, 2, 4);
+        write_le(out, coords.size(), 8);
+        for (auto& p : coords)
+            for (double c : p)
+                write_le(out, c);
+        for (double b : births)
+            write_le(out, b);
+    }
+    std::unique_ptr<InputData> binary = manager.start(progress);
+    REQUIRE(binary->x_label == "birth");
+    REQUIRE(count_mismatches(*text, *binary) == 0);
+
+    //a metric space on 5 points, in which the pairs (0,3) and (3,4) are farther apart than the maximum distance
+    std::vector<double> values = { 1, 0.5, 2, 0.5, 3 };
+    std::vector<std::vector<double>> dist = { { 0, 1, 0.5, 2.5, 1.25 }, { 1, 0, 1.5, 1, 0.75 }, { 0.5, 1.5, 0, 2, 1 },
+        { 2.5, 1, 2, 0, 3 }, { 1.25, 0.75, 1, 3, 0 } };
+    {
+        std::ofstream out(file_name);
+        out << "metric\nvalue\n";
+        for (double v : values)
+            out << v << " ";
+        out << "\ndistance\n2\n";
+        for (unsigned i = 0; i < 5; i++) {
+            for (unsigned j = i + 1; j < 5; j++)
+                out << dist[i][j] << " ";
+            out << "\n";
+        }
+    }
+    text = manager.start(progress);
+    for (uint32_t distance_format = 0; distance_format < 4; distance_format++) {
+        {
+            std::ofstream out(file_name, std::ios::binary);
+            out << "binary_metric\nvalue\ndistance\n2\n";
+            write_le(out, 1, 4);
+            write_le(out, distance_format, 4);
+            write_le(out, values.size(), 8);
+            for (double v : values)
+                write_le(out, v);
+            if (distance_format >= 2)
+                write_le(out, 9, 8); //the edge list leaves out the pair (3,4), and gives the others in reverse order
+            for (unsigned i = 0; i < 5; i++) {
+                for (unsigned j = i + 1; j < 5; j++) {
+                    if (distance_format >= 2 && i == 3)
+                        continue;
+                    if (distance_format >= 2) {
+                        write_le(out, j, 4);
+                        write_le(out, i, 4);
+                    }
+                    if (distance_format % 2 == 1)
+                        write_le(out, dist[i][j]);
+                    else
+                        write_le(out, (float)dist[i][j]);
+                }
+            }
+        }
+        binary = manager.start(progress);
+        REQUIRE(binary->y_label == "distance");
+        REQUIRE(count_mismatches(*text, *binary) == 0);
+    }
+}
+
+TEST_CASE("InputManager bins the distances of a metric space as it reads them", "[InputManager]")
+{
+    TempFile file("binned_metric_test");
+    const std::string& file_name = file.name;
+    InputParameters params = input_params(file_name, 1);
+    Progress progress;
+
+    //10 points with distances of 3 decimal places, some of them on the boundaries of the bins or beyond the maximum distance
+    const unsigned n = 10;
+    std::mt19937 gen(7);
+    std::vector<std::vector<int>> dist(n, std::vector<int>(n, 0));
+    for (unsigned i = 0; i < n; i++)
+        for (unsigned j = i + 1; j < n; j++)
+            dist[i][j] = dist[j][i] = (j == i + 1) ? 250 * (j % 5) : gen() % 1100;
+    for (bool binary : { false, true }) {
+        {
+            std::ofstream out(file_name, std::ios::binary);
+            if (binary) {
+                out << "binary_metric\nvalue\ndistance\n1\n";
+                write_le(out, 1, 4);
+                write_le(out, 1, 4);
+                write_le(out, n, 8);
+                for (unsigned i = 0; i < n; i++)
+                    write_le(out, (double)(i % 3));
+                for (unsigned i = 0; i < n; i++)
+                    for (unsigned j = i + 1; j < n; j++)
+                        write_le(out, dist[i][j] / 1000.0);
+            } else {
+                out << "metric\nvalue\n";
+                for (unsigned i = 0; i < n; i++)
+                    out << i % 3 << " ";
+                out << "\ndistance\n1\n";
+                for (unsigned i = 0; i < n; i++) {
+                    for (unsigned j = i + 1; j < n; j++)
+                        out << dist[i][j] / 1000.0 << " ";
+                    out << "\n";
+                }
+            }
+        }
+
+        //the distinct distances, without bins, from which the bins of the edges can be found
+        params.y_bins = 0;
+        std::unique_ptr<InputData> exact_data = InputManager(params).start(progress);
+        params.y_bins = 4;
+        std::unique_ptr<InputData> binned = InputManager(params).start(progress);
+
+        const std::vector<exact>& values = exact_data->y_exact;
+        REQUIRE(values.size() > 4);
+        std::vector<exact> bins;
+        for (unsigned c = 0; c < 4; c++)
+            bins.push_back(values.front() + (c + 1) * (values.back() - values.front()) / 4);
+        REQUIRE(binned->y_exact == bins);
+        REQUIRE(binned->x_exact == exact_data->x_exact);
+
+        unsigned mismatches = 0;
+        for (int i = 0; i < (int)n; i++) {
+            for (int j = i + 1; j < (int)n; j++) {
+                std::vector<int> edge = { i, j };
+                STNode* a = exact_data->simplex_tree->find_simplex(edge);
+                STNode* b = binned->simplex_tree->find_simplex(edge);
+                if (a == nullptr || b == nullptr) {
+                    mismatches += (a != b);
+                    continue;
+                }
+                unsigned bin = std::lower_bound(bins.begin(), bins.end(), values[a->grade_y()]) - bins.begin();
+                mismatches += (b->grade_y() != bin) + (b->grade_x() != a->grade_x());
+            }
+        }
+        REQUIRE(mismatches == 0);
+    }
+}
+
+TEST_CASE("InputManager chooses quantile and adaptive bins", "[InputManager]")
+{
+    TempFile file("binning_test");
+    const std::string& file_name = file.name;
+    InputParameters params = input_params(file_name, 0);
+    Progress progress;
+
+    //reads vertices with the given y-grades, binned in the given way, and returns the grades of the bins
+    auto bin = [&](const std::vector<int>& grades, const std::string& binning, unsigned bins) {
+        {
+            std::ofstream out(file_name);
+            out << "bifiltration\nx\ny\n";
+            for (size_t i = 0; i < grades.size(); i++)
+                out << i << " 0 " << grades[i] << "\n";
+        }
+        params.y_bins = bins;
+        params.y_binning = binning;
+        std::unique_ptr<InputData> data = InputManager(params).start(progress);
+
+        //each vertex must be in the first bin whose grade is at least its own
+        unsigned mismatches = 0;
+        for (int i = 0; i < (int)grades.size(); i++) {
+            std::vector<int> vertex = { i };
+            int y = data->simplex_tree->find_simplex(vertex)->grade_y();
+            mismatches += (y >= (int)data->y_exact.size()) || (data->y_exact[y] < grades[i]) || (y > 0 && data->y_exact[y - 1] >= grades[i]);
+        }
+        REQUIRE(mismatches == 0);
+        return data->y_exact;
+    };
+
+    //20 distinct grades, each of one vertex, in 4 bins of 5 grades
+    std::vector<int> grades;
+    for (int k = 0; k < 20; k++)
+        grades.push_back(k * k);
+    REQUIRE(bin(grades, "quantile", 4) == std::vector<exact>({ 16, 81, 196, 361 }));
+
+    //most vertices have the smallest grade, which fills the first quantiles
+    REQUIRE(bin({ 0, 0, 0, 0, 0, 0, 1, 2, 3, 4 }, "quantile", 4) == std::vector<exact>({ 0, 2, 4 }));
+
+    //clusters of grades, which the adaptive bins keep apart, while uniform bins of width 100/3 join the first two
+    std::vector<int> clusters = { 0, 1, 2, 3, 10, 11, 12, 100 };
+    REQUIRE(bin(clusters, "adaptive", 3) == std::vector<exact>({ 3, 12, 100 }));
+    REQUIRE(bin(clusters, "uniform", 3) == std::vector<exact>({ exact(100, 3), exact(200, 3), 100 }));
+}
+
+TEST_CASE("InputManager projects the size of a computation and coarsens the grades to fit a memory limit", "[InputManager]")
+{
+    TempFile file("memory_test");
+    const std::string& file_name = file.name;
+    InputParameters params = input_params(file_name, 2);
+    Progress progress;
+
+    //points in the plane, of which those at distance at most max_dist are joined
+    auto write_points = [&](unsigned num_points, double max_dist) {
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<double> coord(0, 10);
+        std::ofstream out(file_name);
+        out << "points\n2\n" << max_dist << "\nbirth\n";
+        for (unsigned i = 0; i < num_points; i++)
+            out << coord(rng) << " " << coord(rng) << " " << i << "\n";
+    };
+
+    //the simplices of the Vietoris-Rips complex are counted exactly, or estimated if counting them would take too long
+    write_points(60, 4);
+    std::unique_ptr<InputData> data = InputManager(params).start(progress);
+    std::vector<unsigned> distances;
+    for (unsigned j = 1; j < 60; j++)
+        for (unsigned i = 0; i < j; i++) {
+            std::vector<int> edge = { (int)i, (int)j };
+            STNode* node = data->simplex_tree->find_simplex(edge);
+            distances.push_back(node == NULL ? std::numeric_limits<unsigned>::max() : node->grade_y());
+        }
+    std::vector<uint64_t> counts = data->simplex_tree->count_simplices();
+    REQUIRE(counts.size() == 4);
+    REQUIRE(MemoryEstimate::count_VR_simplices(distances, 60, 3) == counts);
+    std::vector<uint64_t> estimates = MemoryEstimate::count_VR_simplices(distances, 60, 3, 100);
+    REQUIRE((estimates[0] == counts[0] && estimates[1] == counts[1]));
+    for (unsigned dim = 2; dim <= 3; dim++)
+        REQUIRE(std::abs((double)estimates[dim] - counts[dim]) < 0.25 * counts[dim]);
+
+    //every point has its own x-grade and most edges their own y-grades, so the arrangement could be huge, but the grades are
+    //  merged until the projection fits, and each point is still in the first bin whose grade is at least its birth time
+    params.dim = 0;
+    params.memory_limit = 1;
+    data = InputManager(params).start(progress);
+    unsigned x_grades = data->x_exact.size();
+    REQUIRE(MemoryEstimate({ 0 }, data->simplex_tree->count_simplices(), x_grades, data->y_exact.size()).total_bytes() <= (1 << 20));
+    REQUIRE((x_grades < 60 && data->y_exact.size() < 1770));
+    unsigned mismatches = 0;
+    for (int i = 0; i < 60; i++) {
+        std::vector<int> vertex = { i };
+        unsigned x = data->simplex_tree->find_simplex(vertex)->grade_x();
+        mismatches += (x >= x_grades) || (data->x_exact[x] < i) || (x > 0 && data->x_exact[x - 1] >= i);
+    }
+    REQUIRE(mismatches == 0);
+
+    //no binning makes room for a complex that is too large in itself
+    write_points(400, 20);
+    REQUIRE_THROWS(InputManager(params).start(progress));
+}
+
+TEST_CASE("InputManager coarsens the grades only when the projection exceeds the memory limit", "[InputManager]")
+{
+    TempFile file("memory_limit_test");
+    const std::string& file_name = file.name;
+    InputParameters params = input_params(file_name, 0);
+    Progress progress;
+
+    {
+        std::mt19937 rng(11);
+        std::uniform_real_distribution<double> coord(0, 10);
+        std::ofstream out(file_name);
+        out << "points\n2\n3\nbirth\n";
+        for (unsigned i = 0; i < 40; i++)
+            out << coord(rng) << " " << coord(rng) << " " << i << "\n";
+    }
+    std::unique_ptr<InputData> unlimited = InputManager(params).start(progress);
+    uint64_t projected = MemoryEstimate({ 0 }, unlimited->simplex_tree->count_simplices(), unlimited->x_exact.size(), unlimited->y_exact.size()).total_bytes();
+    REQUIRE(projected > (4 << 20));
+
+    //with ample memory, the grades are those of a run without a limit
+    params.memory_limit = (unsigned)(projected >> 20) + 1;
+    std::unique_ptr<InputData> ample = InputManager(params).start(progress);
+    REQUIRE(ample->x_exact == unlimited->x_exact);
+    REQUIRE(ample->y_exact == unlimited->y_exact);
+
+    //with half as much, the grades are coarsened until the projection fits
+    params.memory_limit = (unsigned)(projected >> 21);
+    std::unique_ptr<InputData> tight = InputManager(params).start(progress);
+    REQUIRE(tight->x_exact.size() * tight->y_exact.size() < unlimited->x_exact.size() * unlimited->y_exact.size());
+    REQUIRE(MemoryEstimate({ 0 }, tight->simplex_tree->count_simplices(), tight->x_exact.size(), tight->y_exact.size()).total_bytes()
+        <= ((uint64_t)params.memory_limit << 20));
+
+    //with --estimate, only the projection is made, even when the bifiltration would be printed
+    params.memory_limit = 0;
+    params.estimate = true;
+    params.verbosity = 8;
+    std::unique_ptr<InputData> estimated = InputManager(params).start(progress);
+    REQUIRE(estimated->simplex_tree == nullptr);
+}
@@ -1,6 +1,18 @@
 #include "catch.hpp"
+#include "interface/progress.h"
+#include "math/crossing_cost_model.h"
+#include "math/edge_collapser.h"
+#include "math/implicit_boundary_matrix.h"
 #include "math/map_matrix.h"
+#include "math/multi_betti.h"
+#include "math/ru_snapshot_cache.h"
+#include "math/simplex_tree.h"
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <limits>
+#include <numeric>
+#include <random>
 #include <vector>
 
 TEST_CASE("MapMatrix can be initialized", "[MapMatrix]")
@@ -50,6 +62,437 @@ TEST_CASE("MapMatrix.add_column works"
     REQUIRE(test == eye);
 }
 
+TEST_CASE("MapMatrix stores full columns as arrays of bits", "[MapMatrix]")
+{
+    //compare with a dense reference matrix under random column operations, which fill in the columns
+    const unsigned rows = 500;
+    const unsigned cols = 40;
+    std::vector<std::vector<bool>> ref(cols, std::vector<bool>(rows, false));
+    MapMatrix M(rows, cols);
+    MapMatrix other(rows, 1);
+    std::vector<bool> other_ref(rows, false);
+    std::mt19937 rng(5);
+    for (unsigned j = 0; j < cols; j++) {
+        for (unsigned e = 0; e < 3; e++) {
+            unsigned i = rng() % rows;
+            M.set(i, j);
+            ref[j][i] = true;
+        }
+    }
+    for (unsigned i = 0; i < rows; i += 3) {
+        other.set(i, 0);
+        other_ref[i] = true;
+    }
+
+    unsigned max_dense = 0;
+    for (unsigned step = 0; step < 3000; step++) {
+        unsigned j = rng() % cols;
+        unsigned k = rng() % cols;
+        if (step % 97 == 0) {
+            M.add_column(&other, 0, k);
+            for (unsigned i = 0; i < rows; i++)
+                ref[k][i] = (ref[k][i] != other_ref[i]);
+        } else if (step % 10 == 0) { //adding a copy of column k clears it
+            MapMatrix copy(rows, cols);
+            copy.copy_cols_same_indexes(&M, k, k);
+            M.add_column(&copy, k, k);
+            ref[k].assign(rows, false);
+        } else if (j != k) {
+            M.add_column(j, k);
+            for (unsigned i = 0; i < rows; i++)
+                ref[k][i] = (ref[k][i] != ref[j][i]);
+        }
+        max_dense = std::max(max_dense, M.num_dense_columns());
+    }
+    REQUIRE(max_dense > 0);
+
+    //copies keep the same entries, whether or not the row indexes are shifted
+    MapMatrix same(rows, cols);
+    same.copy_cols_same_indexes(&M, 0, cols - 1);
+    MapMatrix shifted(2 * rows, 0);
+    shifted.copy_cols_from(&M, 0, cols - 1, rows);
+
+    unsigned long entries = 0;
+    unsigned mismatches = 0;
+    unsigned nonzero = 0;
+    for (unsigned j = 0; j < cols; j++) {
+        int low = -1;
+        for (unsigned i = 0; i < rows; i++) {
+            if (M.entry(i, j) != ref[j][i] || same.entry(i, j) != ref[j][i])
+                mismatches++;
+            if (ref[j][i])
+                low = i;
+        }
+        entries += std::count(ref[j].begin(), ref[j].end(), true);
+        if (M.low(j) != low || same.low(j) != low || M.col_is_empty(j) != (low == -1))
+            mismatches++;
+        if (low != -1) {
+            if (shifted.low(nonzero) != low + static_cast<int>(rows))
+                mismatches++;
+            nonzero++;
+        }
+    }
+    REQUIRE(mismatches == 0);
+    REQUIRE(M.num_entries() == entries);
+    REQUIRE(shifted.width() == nonzero);
+    REQUIRE(shifted.num_entries() == entries);
+}
+
+TEST_CASE("MapMatrix_Perm.reorder_RU agrees with a new decomposition", "[MapMatrix]")
+{
+    //a matrix with many pairs of columns whose sum has a different low
+    const unsigned n = 6;
+    std::vector<std::vector<unsigned>> D_cols = { { 0, 2 }, { 1, 2 }, { 0, 1 }, { 2, 3 }, { 3, 4, 5 }, { 0, 4, 5 } };
+    std::vector<unsigned> col_order = { 4, 0, 5, 2, 1, 3 };
+    std::vector<unsigned> row_order = { 1, 5, 0, 3, 2, 4 };
+
+    MapMatrix_Perm R(n, n);
+    MapMatrix_Perm D_new(n, n);
+    for (unsigned j = 0; j < n; j++) {
+        for (unsigned i : D_cols[j]) {
+            R.set(i, j);
+            D_new.set(row_order[i], col_order[j]);
+        }
+    }
+    MapMatrix_RowPriority_Perm* U = R.decompose_RU();
+    MapMatrix_RowPriority_Perm* V = R.reorder_RU(U, col_order, &row_order);
+    MapMatrix_Perm R_new(D_new);
+    MapMatrix_RowPriority_Perm* U_new = R_new.decompose_RU();
+
+    //a column of 6 rows is one word as an array of bits, so every nonempty column of the rebuilt matrix is stored as one
+    unsigned nonempty = 0;
+    for (unsigned j = 0; j < n; j++)
+        nonempty += !R.col_is_empty(j);
+    REQUIRE(R.num_dense_columns() == nonempty);
+
+    for (unsigned j = 0; j < n; j++) {
+        REQUIRE(R.low(j) == R_new.low(j));
+
+        //check that the permuted boundary matrix is RV, and that V is upper-triangular
+        for (unsigned i = 0; i < n; i++) {
+            bool sum = false;
+            for (unsigned k = 0; k < n; k++)
+                sum ^= (R.entry(i, k) && V->entry(k, j));
+            REQUIRE(sum == D_new.entry(i, j));
+            if (i >= j)
+                REQUIRE(V->entry(i, j) == (i == j));
+        }
+    }
+
+    delete U;
+    delete V;
+    delete U_new;
+}
+
+TEST_CASE("MapMatrix_Perm can be rebuilt from a MapMatrix_Compact", "[MapMatrix]")
+{
+    //columns with three entries, as in the boundary matrix of 2-simplices, and one full column (stored as an array of bits)
+    const unsigned rows = 1000, cols = 300;
+    std::mt19937 gen(11);
+    std::uniform_int_distribution<unsigned> row_dist(0, rows - 1);
+    std::vector<unsigned> col_order(cols), row_order(rows);
+    std::iota(col_order.begin(), col_order.end(), 0);
+    std::iota(row_order.begin(), row_order.end(), 0);
+    std::shuffle(col_order.begin(), col_order.end(), gen);
+    std::shuffle(row_order.begin(), row_order.end(), gen);
+
+    MapMatrix_Perm D(rows, cols);
+    MapMatrix_Perm D_cols(rows, cols); //columns permuted
+    MapMatrix_Perm D_both(rows, cols); //rows and columns permuted
+    for (unsigned j = 0; j < cols; j++) {
+        for (unsigned k = 0; k < (j == 7 ? rows : 3); k++) {
+            unsigned i = (j == 7) ? k : row_dist(gen);
+            D.set(i, j);
+            D_cols.set(i, col_order[j]);
+            D_both.set(row_order[i], col_order[j]);
+        }
+    }
+
+    MapMatrix_Compact compact(D);
+    REQUIRE(compact.width() == cols);
+    REQUIRE(compact.height() == rows);
+    REQUIRE(compact.num_entries() == D.num_entries());
+    REQUIRE(compact.memory_usage() * 4 < D.memory_usage());
+
+    MapMatrix_Perm R(D);
+    R.decompose_RU();
+    R.rebuild(&compact, col_order);
+    unsigned mismatches = 0;
+    for (unsigned j = 0; j < cols; j++)
+        for (unsigned i = 0; i < rows; i++)
+            mismatches += (R.entry(i, j) != D_cols.entry(i, j));
+    REQUIRE(mismatches == 0);
+    REQUIRE(R.num_entries() == D.num_entries());
+    REQUIRE(R.num_dense_columns() == 1);
+
+    R.rebuild(&compact, col_order, row_order);
+    for (unsigned j = 0; j < cols; j++)
+        for (unsigned i = 0; i < rows; i++)
+            mismatches += (R.entry(i, j) != D_both.entry(i, j));
+    REQUIRE(mismatches == 0);
+    REQUIRE(R.num_entries() == D.num_entries());
+}
+
+TEST_CASE("ImplicitBoundaryMatrix generates the boundary columns of a simplex tree", "[MapMatrix]")
+{
+    //Vietoris-Rips complexes on 9 points with all edges (so that facets are found by simplex index) and with few edges (so that facets are searched)
+    const unsigned n = 9;
+    std::mt19937 gen(5);
+    std::uniform_int_distribution<unsigned> grade_dist(0, 3);
+    for (unsigned threshold : { 100u, 30u }) {
+        std::vector<unsigned> times(n), distances(n * (n - 1) / 2);
+        for (unsigned& t : times)
+            t = grade_dist(gen);
+        for (unsigned& d : distances)
+            d = (gen() % 100 < threshold) ? grade_dist(gen) : std::numeric_limits<unsigned>::max();
+
+        SimplexTree st(1, 0);
+        st.build_VR_complex(times, distances, 4, 4);
+
+        //the columns for triangles, in the order given by dim_index, should list the dim_indexes of their edges
+        ImplicitBoundaryMatrix* bdry = st.get_implicit_boundary_mx(2, NULL, NULL);
+        REQUIRE(bdry->width() == st.get_size(2));
+        REQUIRE(bdry->height() == st.get_size(1));
+        unsigned mismatches = 0;
+        std::vector<unsigned> rows;
+        for (int gi = 0; gi < st.get_num_simplices(); gi++) {
+            std::vector<int> verts = st.find_vertices(gi);
+            if (verts.size() != 3)
+                continue;
+            std::vector<unsigned> expected;
+            for (unsigned k = 0; k < 3; k++) {
+                std::vector<int> facet(verts);
+                facet.erase(facet.begin() + k);
+                expected.push_back(st.find_simplex(facet)->dim_index());
+            }
+            std::sort(expected.begin(), expected.end());
+            bdry->get_column(st.find_simplex(verts)->dim_index(), rows);
+            if (rows != expected)
+                mismatches++;
+        }
+        REQUIRE(mismatches == 0);
+
+        //a matrix rebuilt from the implicit matrix is the boundary matrix
+        MapMatrix* mat = st.get_boundary_mx(2);
+        MapMatrix_Perm R(bdry->height(), bdry->width());
+        std::vector<unsigned> col_order(bdry->width());
+        std::iota(col_order.begin(), col_order.end(), 0);
+        R.rebuild(bdry, col_order);
+        for (unsigned j = 0; j < bdry->width(); j++)
+            for (unsigned i = 0; i < bdry->height(); i++)
+                mismatches += (R.entry(i, j) != mat->entry(i, j));
+        REQUIRE(mismatches == 0);
+        REQUIRE(R.num_entries() == 3ul * bdry->width());
+
+        delete mat;
+        delete bdry;
+    }
+}
+
+TEST_CASE("ImplicitBoundaryMatrix numbers simplices by the ranks of negative and sparse vertex labels", "[MapMatrix]")
+{
+    //a bifiltration on vertices -7, 12, and 2000000000, as a bifiltration file may label them
+    SimplexTree st(1, 0);
+    std::vector<std::vector<int>> simplices = { { -7 }, { 12 }, { 2000000000 }, { -7, 12 }, { -7, 2000000000 }, { 12, 2000000000 }, { -7, 12, 2000000000 } };
+    std::vector<int> x = { 0, 1, 0, 1, 1, 1, 2 }, y = { 0, 0, 1, 1, 1, 1, 2 };
+    for (unsigned i = 0; i < simplices.size(); i++)
+        st.add_simplex(simplices[i], x[i], y[i]);
+    std::vector<unsigned> grades = { 0, 1, 2 };
+    st.update_xy_indexes(grades, grades, 3, 3);
+    st.update_global_indexes();
+    st.update_dim_indexes();
+
+    //the boundary matrices are small and list the facets of each simplex
+    for (unsigned dim : { 1u, 2u }) {
+        ImplicitBoundaryMatrix* bdry = st.get_implicit_boundary_mx(dim, NULL, NULL);
+        REQUIRE(bdry->memory_usage() < 4096);
+        unsigned mismatches = 0;
+        std::vector<unsigned> rows;
+        for (std::vector<int>& verts : simplices) {
+            if (verts.size() != dim + 1)
+                continue;
+            std::vector<unsigned> expected;
+            for (unsigned k = 0; k <= dim; k++) {
+                std::vector<int> facet(verts);
+                facet.erase(facet.begin() + k);
+                expected.push_back(st.find_simplex(facet)->dim_index());
+            }
+            std::sort(expected.begin(), expected.end());
+            bdry->get_column(st.find_simplex(verts)->dim_index(), rows);
+            mismatches += (rows != expected);
+        }
+        REQUIRE(mismatches == 0);
+        delete bdry;
+    }
+}
+
+TEST_CASE("MapMatrix_RowPriority_Perm stores full rows as arrays of bits", "[MapMatrix]")
+{
+    //compare with a dense reference matrix under random row operations, which fill in the rows
+    const unsigned n = 300;
+    std::vector<std::vector<bool>> ref(n, std::vector<bool>(n, false));
+    MapMatrix_RowPriority_Perm U(n);
+    for (unsigned i = 0; i < n; i++)
+        ref[i][i] = true;
+
+    std::mt19937 rng(3);
+    unsigned max_dense = 0;
+    for (unsigned step = 0; step < 4000; step++) {
+        unsigned j = rng() % n;
+        unsigned k = rng() % n;
+        if (step % 3 == 0 && j + 1 < n) {
+            U.swap_rows(j);
+            std::swap(ref[j], ref[j + 1]);
+            U.swap_columns(j);
+            for (unsigned i = 0; i < n; i++)
+                std::vector<bool>::swap(ref[i][j], ref[i][j + 1]);
+        } else if (step % 5 == 0) {
+            U.clear(j, k);
+            ref[j][k] = false;
+        } else if (j != k) {
+            U.add_row(j, k);
+            for (unsigned c = 0; c < n; c++)
+                ref[k][c] = (ref[k][c] != ref[j][c]);
+        }
+        max_dense = std::max(max_dense, U.num_dense_rows());
+    }
+    REQUIRE(max_dense > 0);
+
+    //clearing a row that is stored as an array of bits eventually stores it as a linked list again
+    MapMatrix_RowPriority_Perm copy(U);
+    unsigned dense = copy.num_dense_rows();
+    for (unsigned i = 0; i < n && copy.num_dense_rows() == dense; i++) {
+        for (unsigned c = 0; c < n; c++)
+            copy.clear(i, c);
+    }
+    REQUIRE(copy.num_dense_rows() < dense);
+
+    unsigned long entries = 0;
+    unsigned mismatches = 0;
+    std::vector<unsigned> cols;
+    for (unsigned i = 0; i < n; i++) {
+        U.get_row(i, cols);
+        std::vector<unsigned> ref_cols;
+        for (unsigned c = 0; c < n; c++) {
+            if (U.entry(i, c) != ref[i][c])
+                mismatches++;
+            if (ref[i][c])
+                ref_cols.push_back(c);
+        }
+        if (cols != ref_cols)
+            mismatches++;
+        entries += ref_cols.size();
+    }
+    REQUIRE(mismatches == 0);
+    REQUIRE(U.num_entries() == entries);
+}
+
+TEST_CASE("EdgeCollapser removes edges without changing the persistence module", "[EdgeCollapser]")
+{
+    //random Vietoris-Rips bifiltrations on 12 points, with homology computed before and after the collapse
+    const unsigned n = 12;
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<unsigned> grade_dist(0, 4);
+    for (int dim : { 0, 1 }) {
+        std::vector<unsigned> times(n), distances(n * (n - 1) / 2);
+        for (unsigned& t : times)
+            t = grade_dist(gen);
+        for (unsigned& d : distances)
+            d = (gen() % 100 < 80) ? grade_dist(gen) : std::numeric_limits<unsigned>::max();
+
+        std::vector<unsigned> collapsed(distances);
+        EdgeCollapser collapser(times, collapsed);
+        collapser.collapse();
+        REQUIRE(collapser.edges_after() < collapser.edges_before());
+        REQUIRE(collapser.edges_after() == (unsigned long)std::count_if(collapsed.begin(), collapsed.end(), [](unsigned d) { return d != std::numeric_limits<unsigned>::max(); }));
+
+        SimplexTree st(dim, 0), st_collapsed(dim, 0);
+        st.build_VR_complex(times, distances, 5, 5);
+        st_collapsed.build_VR_complex(times, collapsed, 5, 5);
+        REQUIRE(st_collapsed.get_size(1) < st.get_size(1));
+
+        //the dimensions of homology and the bigraded Betti numbers agree at every grade
+        Progress progress;
+        unsigned_matrix hom_dims, hom_dims_collapsed;
+        MultiBetti mb(st, dim), mb_collapsed(st_collapsed, dim);
+        mb.compute(hom_dims, progress);
+        mb_collapsed.compute(hom_dims_collapsed, progress);
+        unsigned mismatches = 0;
+        for (unsigned x = 0; x < 5; x++)
+            for (unsigned y = 0; y < 5; y++)
+                mismatches += (hom_dims[x][y] != hom_dims_collapsed[x][y]) + (mb.xi0(x, y) != mb_collapsed.xi0(x, y)) + (mb.xi1(x, y) != mb_collapsed.xi1(x, y));
+        REQUIRE(mismatches == 0);
+    }
+}
+
+TEST_CASE("RUSnapshotCache counts transpositions and keeps within its budget", "[RUSnapshotCache]")
+{
+    std::vector<unsigned> id = { 0, 1, 2, 3 };
+    std::vector<unsigned> swap = { 1, 0, 2, 3 };
+    std::vector<unsigned> rev = { 3, 2, 1, 0 };
+    REQUIRE(RUSnapshotCache::count_transpositions(id, id, 100) == 0);
+    REQUIRE(RUSnapshotCache::count_transpositions(id, swap, 100) == 1);
+    REQUIRE(RUSnapshotCache::count_transpositions(id, rev, 100) == 6);
+    REQUIRE(RUSnapshotCache::count_transpositions(swap, rev, 100) == 5);
+    REQUIRE(RUSnapshotCache::count_transpositions(id, rev, 4) == 4);
+
+    MapMatrix_Perm R(4);
+    MapMatrix_RowPriority_Perm U(4);
+    std::vector<unsigned> none;
+
+    RUSnapshotCache cache;
+    REQUIRE(!cache.store(R, R, U, U, rev, none)); //budget is zero
+
+    cache.set_budget(1 << 20);
+    REQUIRE(cache.store(R, R, U, U, rev, none));
+    REQUIRE(cache.store(R, R, U, U, swap, none));
+    REQUIRE(cache.size() == 2);
+
+    unsigned long num_trans = 0;
+    const RUSnapshot* nearest = cache.find_nearest(id, none, 100, num_trans);
+    REQUIRE(nearest != NULL);
+    REQUIRE((nearest->perm_low == swap));
+    REQUIRE(num_trans == 1);
+    REQUIRE(cache.find_nearest(id, none, 1, num_trans) == NULL);
+
+    //the least recently used snapshot is evicted first
+    cache.find_nearest(rev, none, 100, num_trans);
+    cache.set_budget(cache.get_usage() - 1);
+    REQUIRE(cache.size() == 1);
+    REQUIRE((cache.find_nearest(rev, none, 100, num_trans)->perm_low == rev));
+}
+
+TEST_CASE("CrossingCostModel fits the work of crossings to transpositions and anchor weight", "[CrossingCostModel]")
+{
+    //column additions count the entries of both columns
+    MapMatrix mat = { { 1, 1 }, { 0, 1 }, { 1, 0 } };
+    unsigned long long work_before = MapMatrix_Base::addition_work();
+    mat.add_column(0, 1);
+    REQUIRE(MapMatrix_Base::addition_work() - work_before == 4);
+
+    //vineyard updates whose work is exactly 3 per transposition plus 2 per unit of anchor weight, times the fill of 2
+    CrossingCostModel model;
+    REQUIRE(model.reset_threshold(0) == 1000); //not calibrated
+    model.set_matrix_features(100, 200);
+    model.record_reset(10000);
+    std::vector<std::pair<unsigned long, unsigned long>> crossings = { { 10, 0 }, { 5, 20 }, { 40, 10 }, { 1, 100 } };
+    for (auto& c : crossings)
+        model.record_vineyard_updates(c.first, c.second, 2 * (3 * c.first + 2 * c.second));
+    REQUIRE(std::abs(model.vineyard_cost(7, 11) - 2 * (3 * 7 + 2 * 11)) < 0.01);
+    REQUIRE(model.reset_cost() == 10000);
+
+    //a reset costs as much as 10000 / 6 transpositions across an anchor of weight 0, and fewer across heavier anchors
+    REQUIRE(model.reset_threshold(0) == 1666);
+    REQUIRE(model.reset_threshold(1500) == 666);
+    REQUIRE(model.reset_threshold(3000) == 0);
+
+    //observations made in a copy of the model are added to it
+    CrossingCostModel copy(model);
+    copy.record_reset(30000);
+    model.add_observations(copy, CrossingCostModel(model));
+    REQUIRE(model.reset_cost() == 20000);
+}
+
 //not true, apparently:
 /* TEST_CASE( "MapMatrix.col_reduce reduces columns" "[MapMatrix]") { */
 
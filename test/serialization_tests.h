@@ -4,12 +4,22 @@
 
 #ifndef RIVET_CONSOLE_SERIALIZATION_TESTS_H_H
 #define RIVET_CONSOLE_SERIALIZATION_TESTS_H_H
+#include "catch.hpp"
 #include "dcel/anchor.h"
 #include "dcel/arrangement.h"
+#include "dcel/barcode_template.h"
 #include "dcel/dcel.h"
 #include "dcel/serialization.h"
+#include "numerics.h"
 #include <boost/archive/text_iarchive.hpp>
 #include <boost/archive/text_oarchive.hpp>
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 template <typename T>
 T round_trip(const T& thing)
@@ -27,4 +37,140 @@ T round_trip(const T& thing)
     return result;
 }
 
+TEST_CASE("BarcodeTemplatePool stores identical templates once", "[BarcodeTemplatePool]")
+{
+    BarcodeTemplatePool pool;
+    REQUIRE(pool.size() == 1);
+    REQUIRE(pool.intern(BarcodeTemplate()) == 0);
+
+    BarcodeTemplate first;
+    first.add_bar(0, 2);
+    first.add_bar(1, -1, 3);
+
+    BarcodeTemplate same;
+    same.add_bar(1, -1, 3);
+    same.add_bar(0, 2);
+
+    BarcodeTemplate other;
+    other.add_bar(0, 2, 2);
+
+    BarcodeTemplate bulk({ BarTemplate(1, -1, 2), BarTemplate(0, 2), BarTemplate(1, -1, 1) });
+
+    unsigned a = pool.intern(first);
+    REQUIRE(pool.intern(same) == a);
+    REQUIRE(pool.intern(bulk) == a);
+    REQUIRE(pool.intern(other) != a);
+    REQUIRE(pool.size() == 3);
+    REQUIRE((pool.get(a) == first));
+
+    BarcodeTemplatePool copy = round_trip(pool);
+    REQUIRE((copy == pool));
+    REQUIRE(copy.intern(other) == pool.intern(other));
+}
+
+TEST_CASE("BarcodeTemplatePool round-trips snapshots and differences", "[BarcodeTemplatePool]")
+{
+    //a sequence of templates that each differ slightly from the previous one, as along the vineyard path
+    BarcodeTemplatePool pool;
+    BarcodeTemplate bt;
+    for (unsigned i = 0; i < 3 * BarcodeTemplatePool::SNAPSHOT_INTERVAL; i++) {
+        bt.add_bar(i % 7, i % 7 + 3);
+        if (i % 5 == 4)
+            bt.remove_bar((i - 1) % 7, (i - 1) % 7 + 3);
+        bt.add_bar(i, -1);
+        pool.intern(bt);
+    }
+    REQUIRE(pool.size() > 2 * BarcodeTemplatePool::SNAPSHOT_INTERVAL);
+
+    BarcodeTemplatePool copy = round_trip(pool);
+    REQUIRE((copy == pool));
+    REQUIRE(copy.intern(bt) == pool.size() - 1);
+}
+
+//rescales a barcode template along a line with the arithmetic of the original per-bar BarcodeTemplate::rescale(), which computed
+//  the trigonometric functions for each point and combined the infinite bars along horizontal and vertical lines by their births,
+//  and returns the bars sorted by (birth, death, multiplicity)
+std::vector<std::tuple<double, double, unsigned>> rescale_per_bar(const BarcodeTemplate& bt, double angle, double offset,
+    const std::vector<TemplatePoint>& points, const Grades& grades)
+{
+    auto project = [&](const TemplatePoint& pt) {
+        double x = grades.x[pt.x];
+        double y = grades.y[pt.y];
+        if (angle == 0)
+            return (y <= offset) ? x : rivet::numeric::INFTY;
+        if (angle == 90)
+            return (x <= -1 * offset) ? y : rivet::numeric::INFTY;
+        double radians = angle * rivet::numeric::PI / 180;
+        if (y > x * tan(radians) + offset / cos(radians))
+            return y / sin(radians) - offset / tan(radians);
+        return x / cos(radians) + offset * tan(radians);
+    };
+
+    std::vector<std::tuple<double, double, unsigned>> bars;
+    std::map<unsigned, unsigned> infinite_bars; //multiplicity of the infinite bars beginning at each point, along horizontal and vertical lines
+    for (BarTemplate b : bt) {
+        double birth = project(points[b.begin]);
+        if (birth == rivet::numeric::INFTY)
+            continue;
+        double death = (b.end >= points.size()) ? rivet::numeric::INFTY : project(points[b.end]);
+        if (death == rivet::numeric::INFTY && (angle == 0 || angle == 90))
+            infinite_bars[b.begin] += b.multiplicity;
+        else
+            bars.push_back(std::make_tuple(birth, death, b.multiplicity));
+    }
+    for (auto& bar : infinite_bars)
+        bars.push_back(std::make_tuple(project(points[bar.first]), rivet::numeric::INFTY, bar.second));
+    std::sort(bars.begin(), bars.end());
+    return bars;
+}
+
+TEST_CASE("BarcodeTemplate::rescale_batch agrees with the per-bar projection", "[BarcodeTemplate]")
+{
+    std::vector<TemplatePoint> points = { TemplatePoint(0, 0, 1, 0, 0), TemplatePoint(1, 2, 0, 1, 0),
+        TemplatePoint(2, 0, 0, 1, 0), TemplatePoint(0, 2, 0, 1, 0), TemplatePoint(2, 2, 0, 0, 1) };
+    Grades grades;
+    grades.x = { 0.0, 0.5, 1.5 };
+    grades.y = { 0.0, 1.0, 2.0 };
+
+    //infinite bars begin at the same point, so they are combined along horizontal and vertical lines
+    BarcodeTemplate bt({ BarTemplate(0, 4), BarTemplate(0, 1, 2), BarTemplate(0, 2), BarTemplate(0, 5), BarTemplate(1, 4), BarTemplate(3, 5) });
+
+    std::vector<const BarcodeTemplate*> templates;
+    std::vector<ProjectionLine> lines;
+    for (double angle : { 0.0, 30.0, 45.0, 80.0, 90.0 }) {
+        for (double offset : { -1.0, 0.0, 0.75, 2.0 }) {
+            templates.push_back(&bt);
+            lines.push_back(ProjectionLine(angle, offset));
+        }
+    }
+    RescaledBars out;
+    BarcodeTemplate::rescale_batch(templates, lines, TemplatePointCoords(points, grades), out);
+    REQUIRE(out.num_lines() == lines.size());
+
+    auto close = [](double a, double b) { return a == b || std::abs(a - b) < 1e-9; };
+    unsigned mismatches = 0;
+    for (unsigned i = 0; i < lines.size(); i++) {
+        auto expected = rescale_per_bar(bt, lines[i].angle, lines[i].offset, points, grades);
+        std::unique_ptr<Barcode> barcode = out.barcode(i);
+        std::vector<std::tuple<double, double, unsigned>> actual;
+        for (MultiBar bar : *barcode)
+            actual.push_back(std::make_tuple(bar.birth, bar.death, bar.multiplicity));
+        std::sort(actual.begin(), actual.end());
+        REQUIRE(actual.size() == expected.size());
+        for (unsigned j = 0; j < expected.size(); j++) {
+            mismatches += !close(std::get<0>(actual[j]), std::get<0>(expected[j])) + !close(std::get<1>(actual[j]), std::get<1>(expected[j]))
+                + (std::get<2>(actual[j]) != std::get<2>(expected[j]));
+        }
+    }
+    REQUIRE(mismatches == 0);
+
+    //along the horizontal line y = 0.75, only points 0 and 2 project, to their x-grades 0 and 1.5, so the bar from 0 to 2 is finite
+    //  and the three bars from point 0 to points 1, 4, and infinity are combined into one infinite bar of multiplicity 4
+    //  (a Barcode lists its longest bars first)
+    auto horizontal = out.barcode(2); //angle 0, offset 0.75
+    REQUIRE(horizontal->size() == 2);
+    REQUIRE((horizontal->bar(0).birth == 0 && horizontal->bar(0).death == rivet::numeric::INFTY && horizontal->bar(0).multiplicity == 4));
+    REQUIRE((horizontal->bar(1).birth == 0 && horizontal->bar(1).death == 1.5 && horizontal->bar(1).multiplicity == 1));
+}
+
 #endif //RIVET_CONSOLE_SERIALIZATION_TESTS_H_H
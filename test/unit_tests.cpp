@@ -1,5 +1,7 @@
 #define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_COUNTER //test cases in different headers may start on the same line
 #include "catch.hpp"
+#include "computation_tests.h"
 #include "exact_ops.h"
 #include "input_manager_tests.h"
 #include "map_matrix_tests.h"
@@ -26,14 +26,19 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 Timer::Timer()
 {
-    start_time = std::chrono::system_clock::now();
+    start_time = std::chrono::steady_clock::now();
 }
 
 long Timer::elapsed()
 {
-    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now() - start_time).count();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
 }
 
-void Timer::restart() { start_time = std::chrono::system_clock::now(); }
+long long Timer::elapsed_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+void Timer::restart() { start_time = std::chrono::steady_clock::now(); }
 
-std::chrono::system_clock::time_point Timer::started() { return start_time; }
+std::chrono::steady_clock::time_point Timer::started() { return start_time; }
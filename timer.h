@@ -30,12 +30,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 class Timer {
 public:
     Timer();
-    std::chrono::system_clock::time_point started();
+    std::chrono::steady_clock::time_point started();
     void restart();
-    long elapsed();
+    long elapsed(); //milliseconds
+    long long elapsed_ns(); //nanoseconds
 
 private:
-    std::chrono::system_clock::time_point start_time;
+    std::chrono::steady_clock::time_point start_time;
 };
 
 #endif //RIVET_CONSOLE_TIMER_H